@@ -0,0 +1,44 @@
+// SPDX-License-Identifier: GPL-3.0-only
+
+// SPDX-FileCopyrightText: 2026 ergo720
+
+#pragma once
+
+// Runtime detection of the simd extensions of the host cpu. SSE2 is always available on x86-64, so it's used unconditionally there, while the AVX2 kernels
+// are compiled with TARGET_AVX2 and only selected when has_avx2 returns true. Setting the NXBX_NO_AVX2 environment variable makes has_avx2 return false,
+// so that the tests can also check the SSE2 kernels on a host with AVX2
+#if defined(__x86_64__) || defined(_M_X64)
+#define HOST_CPU_X86
+#include <immintrin.h>
+#include <cstdlib>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define TARGET_AVX2
+#else
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+inline bool
+has_avx2()
+{
+	static const bool s_has_avx2 = []() {
+		if (const char *no_avx2 = std::getenv("NXBX_NO_AVX2"); no_avx2 && (no_avx2[0] != '\0') && (no_avx2[0] != '0')) {
+			return false;
+		}
+#if defined(_MSC_VER)
+		int regs[4];
+		__cpuid(regs, 1);
+		if (((regs[2] & (1 << 27)) == 0) || ((_xgetbv(0) & 6) != 6)) {
+			return false; // the os doesn't save the ymm registers
+		}
+		__cpuidex(regs, 7, 0);
+		return (regs[1] & (1 << 5)) != 0;
+#else
+		__builtin_cpu_init(); // this might run before the constructor that initializes the cpu features
+		return __builtin_cpu_supports("avx2") != 0;
+#endif
+		}();
+
+	return s_has_avx2;
+}
+#endif
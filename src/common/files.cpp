@@ -12,10 +12,18 @@
 #undef min
 #elif defined(__linux__)
 #include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <cerrno>
 #endif
 
 #define MODULE_NAME file
 
+#define NATIVE_FILE_CACHE_CAPACITY 128 // max number of host files kept open by g_native_file_cache
+
+native_file_cache g_native_file_cache(NATIVE_FILE_CACHE_CAPACITY);
+
 
 bool
 file_exists(const std::filesystem::path dev_path, const std::string remaining_name, std::filesystem::path &resolved_path)
@@ -173,6 +181,259 @@ open_file(const std::filesystem::path path, std::uintmax_t *size)
 	return std::nullopt;
 }
 
+native_file &
+native_file::operator=(native_file &&other) noexcept
+{
+	if (this != &other) {
+		close();
+		m_handle = std::exchange(other.m_handle, invalid_handle);
+	}
+	return *this;
+}
+
+bool
+native_file::open(const std::filesystem::path path)
+{
+	close();
+#if defined(_WIN64)
+	HANDLE handle = CreateFileW(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	m_handle = (handle == INVALID_HANDLE_VALUE) ? invalid_handle : handle;
+#else
+	m_handle = ::open(path.c_str(), O_RDWR | O_CLOEXEC);
+#endif
+	if (m_handle == invalid_handle) {
+		logger_en(info, "Failed to open native file %s", path.string().c_str());
+		return false;
+	}
+	return true;
+}
+
+void
+native_file::close()
+{
+	if (m_handle != invalid_handle) {
+#if defined(_WIN64)
+		CloseHandle(m_handle);
+#else
+		::close(m_handle);
+#endif
+		m_handle = invalid_handle;
+	}
+}
+
+int64_t
+native_file::read_at(char *buffer, uint32_t size, uint64_t offset) const
+{
+	uint32_t bytes_left = size;
+	while (bytes_left) {
+#if defined(_WIN64)
+		OVERLAPPED ov{};
+		ov.Offset = (DWORD)offset;
+		ov.OffsetHigh = (DWORD)(offset >> 32);
+		DWORD bytes_read;
+		if (!ReadFile(m_handle, buffer, bytes_left, &bytes_read, &ov)) {
+			if (GetLastError() == ERROR_HANDLE_EOF) {
+				break;
+			}
+			return -1;
+		}
+#else
+		ssize_t bytes_read = ::pread(m_handle, buffer, bytes_left, offset);
+		if (bytes_read < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return -1;
+		}
+#endif
+		if (bytes_read == 0) {
+			break; // end of file
+		}
+		buffer += bytes_read;
+		offset += bytes_read;
+		bytes_left -= bytes_read;
+	}
+
+	return size - bytes_left;
+}
+
+int64_t
+native_file::write_at(const char *buffer, uint32_t size, uint64_t offset) const
+{
+	uint32_t bytes_left = size;
+	while (bytes_left) {
+#if defined(_WIN64)
+		OVERLAPPED ov{};
+		ov.Offset = (DWORD)offset;
+		ov.OffsetHigh = (DWORD)(offset >> 32);
+		DWORD bytes_written;
+		if (!WriteFile(m_handle, buffer, bytes_left, &bytes_written, &ov) || (bytes_written == 0)) {
+			return -1;
+		}
+#else
+		ssize_t bytes_written = ::pwrite(m_handle, buffer, bytes_left, offset);
+		if (bytes_written <= 0) {
+			if ((bytes_written < 0) && (errno == EINTR)) {
+				continue;
+			}
+			return -1;
+		}
+#endif
+		buffer += bytes_written;
+		offset += bytes_written;
+		bytes_left -= bytes_written;
+	}
+
+	return size;
+}
+
+native_file_cache::file_ptr
+native_file_cache::acquire(const std::filesystem::path path)
+{
+	std::filesystem::path::string_type key = path.lexically_normal().native();
+	std::unique_lock lock(m_mtx);
+	if (auto it = m_map.find(key); it != m_map.end()) {
+		m_lru.splice(m_lru.begin(), m_lru, it->second);
+		return it->second->file;
+	}
+
+	auto file = std::make_shared<native_file>();
+	if (!file->open(path)) {
+		return nullptr;
+	}
+	m_lru.emplace_front(key, file);
+	m_map.emplace(std::move(key), m_lru.begin());
+	if (m_lru.size() > m_capacity) {
+		// Only drops the cache reference, users of the evicted file keep it open until they are done with it
+		m_map.erase(m_lru.back().key);
+		m_lru.pop_back();
+	}
+
+	return file;
+}
+
+void
+native_file_cache::clear()
+{
+	std::unique_lock lock(m_mtx);
+	m_map.clear();
+	m_lru.clear();
+}
+
+bool
+mapped_file::map(const std::filesystem::path path)
+{
+	unmap();
+#if defined(_WIN64)
+	HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+		logger_en(info, "Failed to open file %s for mapping", path.string().c_str());
+		return false;
+	}
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size) || (size.QuadPart == 0)) {
+		CloseHandle(file);
+		logger_en(info, "Failed to determine the size of file %s for mapping", path.string().c_str());
+		return false;
+	}
+	// NOTE: the mapping object keeps a reference to the file, so the file handle is not needed anymore after this
+	HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	CloseHandle(file);
+	if (mapping == nullptr) {
+		logger_en(info, "Failed to create mapping for file %s", path.string().c_str());
+		return false;
+	}
+	void *data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (data == nullptr) {
+		CloseHandle(mapping);
+		logger_en(info, "Failed to map file %s", path.string().c_str());
+		return false;
+	}
+	m_mapping = mapping;
+	m_data = static_cast<char *>(data);
+	m_size = size.QuadPart;
+#else
+	int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd == -1) {
+		logger_en(info, "Failed to open file %s for mapping", path.string().c_str());
+		return false;
+	}
+	struct stat st;
+	if ((fstat(fd, &st) == -1) || (st.st_size == 0)) {
+		::close(fd);
+		logger_en(info, "Failed to determine the size of file %s for mapping", path.string().c_str());
+		return false;
+	}
+	// NOTE: the mapping keeps a reference to the file, so the fd is not needed anymore after this
+	void *data = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	::close(fd);
+	if (data == MAP_FAILED) {
+		logger_en(info, "Failed to map file %s", path.string().c_str());
+		return false;
+	}
+	m_data = static_cast<char *>(data);
+	m_size = st.st_size;
+#endif
+
+	return true;
+}
+
+void
+mapped_file::unmap()
+{
+	if (m_data) {
+#if defined(_WIN64)
+		UnmapViewOfFile(m_data);
+		CloseHandle(m_mapping);
+		m_mapping = nullptr;
+#else
+		munmap(m_data, m_size);
+#endif
+		m_data = nullptr;
+		m_size = 0;
+	}
+}
+
+void
+mapped_file::advise(uint64_t offset, uint64_t size, advice_t advice) const
+{
+	if ((m_data == nullptr) || (offset >= m_size)) {
+		return;
+	}
+	size = std::min(size, m_size - offset);
+
+#if defined(_WIN64)
+	// Windows only has an equivalent for willneed, and read-ahead of sequential accesses is already done by the memory manager
+	if ((advice == advice_t::willneed) || (advice == advice_t::sequential)) {
+		WIN32_MEMORY_RANGE_ENTRY range{ .VirtualAddress = m_data + offset, .NumberOfBytes = size };
+		PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+	}
+#else
+	// madvise requires a page aligned address
+	static const uint64_t page_mask = sysconf(_SC_PAGESIZE) - 1;
+	uint64_t aligned_offset = offset & ~page_mask;
+	int posix_advice;
+	switch (advice)
+	{
+	case advice_t::sequential:
+		posix_advice = MADV_SEQUENTIAL;
+		break;
+
+	case advice_t::random:
+		posix_advice = MADV_RANDOM;
+		break;
+
+	case advice_t::willneed:
+		posix_advice = MADV_WILLNEED;
+		break;
+
+	default:
+		posix_advice = MADV_NORMAL;
+	}
+	madvise(m_data + aligned_offset, size + (offset - aligned_offset), posix_advice);
+#endif
+}
+
 std::filesystem::path
 to_slash_separator(const std::filesystem::path path)
 {
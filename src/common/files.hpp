@@ -6,9 +6,97 @@
 
 #include <filesystem>
 #include <optional>
+#include <utility>
 #include <fstream>
+#include <cstdint>
+#include <memory>
+#include <list>
+#include <unordered_map>
+#include <mutex>
 
 
+// Thin wrapper around a host file handle. Unlike std::fstream, it has no file position, so the same file can be read/written by multiple threads at once
+class native_file {
+public:
+#if defined(_WIN64)
+	using handle_t = void *;
+	static constexpr handle_t invalid_handle = nullptr;
+#else
+	using handle_t = int;
+	static constexpr handle_t invalid_handle = -1;
+#endif
+
+	native_file() = default;
+	native_file(const native_file &) = delete;
+	native_file &operator=(const native_file &) = delete;
+	native_file(native_file &&other) noexcept : m_handle(std::exchange(other.m_handle, invalid_handle)) {}
+	native_file &operator=(native_file &&other) noexcept;
+	~native_file() { close(); }
+	bool open(const std::filesystem::path path);
+	void close();
+	bool is_open() const { return m_handle != invalid_handle; }
+	handle_t get() const { return m_handle; }
+	// These return the number of bytes transferred, or -1 on failure. A read that returns less than size has reached the end of the file
+	int64_t read_at(char *buffer, uint32_t size, uint64_t offset) const;
+	int64_t write_at(const char *buffer, uint32_t size, uint64_t offset) const;
+
+private:
+	handle_t m_handle = invalid_handle;
+};
+
+// Bounded LRU cache of native files, keyed by host path. A file is opened on its first use, and lazily reopened if it's used again after it was evicted.
+// Evicted files stay open until the last reference to them is dropped, so a file is never closed under a transfer that is still using it
+class native_file_cache {
+public:
+	using file_ptr = std::shared_ptr<const native_file>;
+
+	native_file_cache(size_t capacity) : m_capacity(capacity) {}
+	file_ptr acquire(const std::filesystem::path path); // returns nullptr if the file can't be opened
+	void clear();
+
+private:
+	struct entry_t {
+		std::filesystem::path::string_type key;
+		file_ptr file;
+	};
+
+	size_t m_capacity;
+	std::list<entry_t> m_lru; // most recently used file first
+	std::unordered_map<std::filesystem::path::string_type, std::list<entry_t>::iterator> m_map;
+	std::mutex m_mtx;
+};
+
+// Read-only memory mapping of a whole host file
+class mapped_file {
+public:
+	enum class advice_t {
+		normal,
+		sequential, // the range will be read in order, so aggressive read-ahead is useful
+		random, // the range will be read in small random pieces, so read-ahead is wasted
+		willneed, // the range will be read soon, start to fault it in now
+	};
+
+	mapped_file() = default;
+	mapped_file(const mapped_file &) = delete;
+	mapped_file &operator=(const mapped_file &) = delete;
+	~mapped_file() { unmap(); }
+	bool map(const std::filesystem::path path);
+	void unmap();
+	bool is_mapped() const { return m_data != nullptr; }
+	const char *data() const { return m_data; }
+	uint64_t size() const { return m_size; }
+	void advise(uint64_t offset, uint64_t size, advice_t advice) const;
+
+private:
+	char *m_data = nullptr;
+	uint64_t m_size = 0;
+#if defined(_WIN64)
+	void *m_mapping = nullptr;
+#endif
+};
+
+extern native_file_cache g_native_file_cache;
+
 bool create_directory(const std::filesystem::path path);
 bool file_exists(const std::filesystem::path dev_path, const std::string remaining_name, std::filesystem::path &resolved_path);
 bool file_exists(const std::filesystem::path dev_path, const std::string remaining_name, std::filesystem::path &resolved_path, bool *is_directory);
@@ -43,6 +43,7 @@ struct boot_params {
 	disas_syntax syntax;
 	uint32_t use_dbg;
 	console_t console_type;
+	bool load_kernel = true; // false when the machine is only used to drive the hw devices, without running any guest code
 };
 
 namespace Host
@@ -72,6 +73,9 @@ namespace Host
 	// Signals the machine has stopped
 	void SignalStop();
 
+	// Signals a new frame is ready to be displayed
+	void SignalFrameReady();
+
 	// Checks if the user started in no gui mode
 	bool InNoGUIMode();
 }
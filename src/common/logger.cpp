@@ -0,0 +1,497 @@
+// SPDX-License-Identifier: GPL-3.0-only
+
+// SPDX-FileCopyrightText: 2026 ergo720
+
+#include "logger.hpp"
+#include <thread>
+#include <mutex>
+#include <vector>
+#include <memory>
+#include <string_view>
+#include <chrono>
+#include <cinttypes>
+
+#define LOG_RING_SIZE (1 << 20) // size of the ring buffer of each thread, must be a power of two
+#define LOG_RECORD_ALIGN 32 // records are padded to this size, so that the free space at the end of a ring buffer can always hold a padding record
+#define LOG_MAX_TEXT_SIZE 1024 // max length of the messages that are formatted by the calling thread
+#define LOG_DRAIN_INTERVAL std::chrono::milliseconds(1)
+
+
+namespace log_sink {
+	enum class record_kind_t : uint8_t {
+		padding, // skip to the start of the ring buffer
+		args, // msg is the format string and it's followed by the encoded arguments
+		text, // followed by an already formatted message
+	};
+
+	struct record_t {
+		uint64_t seq; // global order of the messages, used to merge the ring buffers
+		const char *msg;
+		uint32_t size; // size of the record, including this header and the padding
+		uint32_t data_size;
+		int16_t lv;
+		int16_t name;
+		record_kind_t kind;
+	};
+	static_assert(sizeof(record_t) <= LOG_RECORD_ALIGN);
+
+	// Single producer/single consumer ring buffer of variable size records. head and tail increase monotonically, and a record never wraps around the end of
+	// the buffer
+	struct ring_t {
+		alignas(64) std::atomic_uint64_t head = 0; // written by the owner thread only
+		alignas(64) std::atomic_uint64_t tail = 0; // written by the drainer thread only
+		alignas(64) std::atomic_uint64_t num_of_dropped = 0;
+		uint64_t num_of_dropped_reported = 0;
+		std::atomic_bool is_orphaned = false; // set when the owner thread exits
+		std::unique_ptr<uint8_t[]> buffer = std::make_unique_for_overwrite<uint8_t[]>(LOG_RING_SIZE);
+	};
+
+	// Marks the ring buffer of a thread as orphaned when the thread exits, so that the drainer frees it after it has written the remaining messages
+	struct ring_owner_t {
+		ring_t *ring = nullptr;
+		~ring_owner_t()
+		{
+			if (ring) {
+				ring->is_orphaned.store(true, std::memory_order_release);
+				ring = nullptr;
+			}
+		}
+	};
+
+	static std::atomic_uint64_t s_seq = 0;
+	static policy_t s_policy;
+	static FILE *s_out;
+	static std::mutex s_rings_mtx;
+	static std::vector<std::unique_ptr<ring_t>> s_rings; // only changed when a thread logs for the first time, or by the drainer
+	static std::jthread s_drainer; // declared after s_rings, so that it's joined before s_rings is destroyed at exit
+	static thread_local ring_owner_t t_ring_owner;
+
+
+	static ring_t *
+	get_ring()
+	{
+		if (t_ring_owner.ring == nullptr) [[unlikely]] {
+			std::unique_lock lock(s_rings_mtx);
+			t_ring_owner.ring = s_rings.emplace_back(std::make_unique<ring_t>()).get();
+		}
+
+		return t_ring_owner.ring;
+	}
+
+	static void
+	push_record(log_lv lv, log_module name, const char *msg, const void *data, uint32_t data_size, record_kind_t kind)
+	{
+		ring_t *ring = get_ring();
+		uint32_t size = (sizeof(record_t) + data_size + LOG_RECORD_ALIGN - 1) & ~(LOG_RECORD_ALIGN - 1);
+		uint64_t head = ring->head.load(std::memory_order_relaxed);
+		uint64_t offset = head & (LOG_RING_SIZE - 1);
+		uint64_t pad_size = (offset + size) > LOG_RING_SIZE ? LOG_RING_SIZE - offset : 0;
+
+		while (true) {
+			uint64_t tail = ring->tail.load(std::memory_order_acquire);
+			if ((head + pad_size + size - tail) <= LOG_RING_SIZE) {
+				break;
+			}
+			if ((s_policy == policy_t::drop) || !g_is_running.load(std::memory_order_relaxed)) {
+				ring->num_of_dropped.fetch_add(1, std::memory_order_relaxed);
+				return;
+			}
+			ring->tail.wait(tail, std::memory_order_acquire);
+		}
+
+		if (pad_size) {
+			record_t padding{ .size = (uint32_t)pad_size, .kind = record_kind_t::padding };
+			std::memcpy(&ring->buffer[offset], &padding, sizeof(record_t));
+			head += pad_size;
+			offset = 0;
+		}
+
+		record_t record{ s_seq.fetch_add(1, std::memory_order_relaxed), msg, size, data_size, (int16_t)lv, (int16_t)name, kind };
+		std::memcpy(&ring->buffer[offset], &record, sizeof(record_t));
+		std::memcpy(&ring->buffer[offset + sizeof(record_t)], data, data_size);
+		uint64_t new_head = head + size;
+		ring->head.store(new_head, std::memory_order_release);
+
+		// Fatal errors are usually followed by the termination of the emulator, so wait until the message is written, like the old synchronous logger did
+		if ((lv == log_lv::highest) || (lv == log_lv::lowest)) {
+			for (uint64_t tail = ring->tail.load(std::memory_order_acquire); tail < new_head; tail = ring->tail.load(std::memory_order_acquire)) {
+				if (!g_is_running.load(std::memory_order_relaxed)) {
+					break;
+				}
+				ring->tail.wait(tail, std::memory_order_acquire);
+			}
+		}
+	}
+
+	void
+	push(log_lv lv, log_module name, const char *msg, const uint8_t *args, uint32_t args_size)
+	{
+		push_record(lv, name, msg, args, args_size, record_kind_t::args);
+	}
+
+	void
+	push(log_lv lv, log_module name, const char *msg, std::va_list vlist)
+	{
+		// The arguments of a va_list can't be inspected without knowing their types, so these are formatted by the calling thread
+		char buffer[LOG_MAX_TEXT_SIZE];
+		int len = std::vsnprintf(buffer, sizeof(buffer), msg, vlist);
+		push_record(lv, name, nullptr, buffer, len < 0 ? 0 : std::min<uint32_t>(len, sizeof(buffer) - 1), record_kind_t::text);
+	}
+
+	struct arg_value_t {
+		arg_t type;
+		uint64_t value;
+		double f64;
+		std::string_view str;
+	};
+
+	static bool
+	decode_arg(const uint8_t *&args, const uint8_t *end, arg_value_t &arg)
+	{
+		if (args >= end) {
+			return false;
+		}
+
+		arg.type = (arg_t)*args++;
+		switch (arg.type)
+		{
+		case arg_t::i32:
+		case arg_t::u32: {
+			uint32_t value;
+			std::memcpy(&value, args, 4);
+			arg.value = arg.type == arg_t::i32 ? (uint64_t)(int64_t)(int32_t)value : value;
+			args += 4;
+		}
+		break;
+
+		case arg_t::i64:
+		case arg_t::u64:
+		case arg_t::ptr:
+			std::memcpy(&arg.value, args, 8);
+			args += 8;
+			break;
+
+		case arg_t::f64:
+			std::memcpy(&arg.f64, args, 8);
+			args += 8;
+			break;
+
+		case arg_t::str: {
+			uint16_t len;
+			std::memcpy(&len, args, 2);
+			arg.str = std::string_view((const char *)args + 2, len);
+			args += (2 + len);
+		}
+		break;
+
+		default:
+			return false;
+		}
+
+		return true;
+	}
+
+	// Formats a message in the same way printf does, by passing each conversion specification to snprintf together with its decoded argument. Length modifiers
+	// are replaced with ll, because the integer arguments are stored with their original size and signedness
+	static void
+	format_args(std::string &out, const char *fmt, const uint8_t *args, const uint8_t *end)
+	{
+		char buffer[512];
+		auto append = [&out, &buffer](int len) {
+			if (len > 0) {
+				out.append(buffer, std::min<size_t>(len, sizeof(buffer) - 1));
+			}
+			};
+
+		while (*fmt) {
+			if (*fmt != '%') {
+				const char *next = std::strchr(fmt, '%');
+				size_t len = next ? next - fmt : std::strlen(fmt);
+				out.append(fmt, len);
+				fmt += len;
+				continue;
+			}
+			if (fmt[1] == '%') {
+				out += '%';
+				fmt += 2;
+				continue;
+			}
+
+			std::string spec("%");
+			arg_value_t arg;
+			++fmt;
+			while (*fmt && std::strchr("-+ #0", *fmt)) {
+				spec += *fmt++;
+			}
+			for (unsigned i = 0; i < 2; ++i) {
+				// First the width, then the precision
+				if ((i == 1) && (*fmt == '.')) {
+					spec += *fmt++;
+				}
+				if (*fmt == '*') {
+					++fmt;
+					spec += std::to_string(decode_arg(args, end, arg) ? (int32_t)arg.value : 0);
+				}
+				while ((*fmt >= '0') && (*fmt <= '9')) {
+					spec += *fmt++;
+				}
+			}
+
+			unsigned int_size = 4; // h and hh truncate the argument, like printf does
+			while (*fmt && std::strchr("hljztLqI", *fmt)) {
+				if (*fmt == 'h') {
+					int_size = int_size == 2 ? 1 : 2;
+				}
+				else if ((fmt[0] == 'I') && (fmt[1] == '6') && (fmt[2] == '4')) {
+					fmt += 2; // msvc's I64
+				}
+				else if ((fmt[0] == 'I') && (fmt[1] == '3') && (fmt[2] == '2')) {
+					fmt += 2; // msvc's I32
+				}
+				++fmt;
+			}
+
+			char conv = *fmt;
+			if (conv == '\0') {
+				break;
+			}
+			++fmt;
+			if (!decode_arg(args, end, arg)) {
+				out += "<missing argument>";
+				continue;
+			}
+
+			switch (conv)
+			{
+			case 'd':
+			case 'i': {
+				int64_t value = (int64_t)arg.value;
+				if ((arg.type == arg_t::i32) || (arg.type == arg_t::u32)) {
+					value = (int32_t)arg.value;
+				}
+				else if (arg.type == arg_t::f64) {
+					value = (int64_t)arg.f64;
+				}
+				if (int_size == 2) {
+					value = (int16_t)value;
+				}
+				else if (int_size == 1) {
+					value = (int8_t)value;
+				}
+				append(std::snprintf(buffer, sizeof(buffer), (spec + "lld").c_str(), (long long)value));
+			}
+			break;
+
+			case 'u':
+			case 'o':
+			case 'x':
+			case 'X': {
+				uint64_t value = arg.value;
+				if ((arg.type == arg_t::i32) || (arg.type == arg_t::u32)) {
+					value = (uint32_t)arg.value;
+				}
+				else if (arg.type == arg_t::f64) {
+					value = (uint64_t)arg.f64;
+				}
+				if (int_size == 2) {
+					value = (uint16_t)value;
+				}
+				else if (int_size == 1) {
+					value = (uint8_t)value;
+				}
+				append(std::snprintf(buffer, sizeof(buffer), (spec + "ll" + conv).c_str(), (unsigned long long)value));
+			}
+			break;
+
+			case 'c':
+				append(std::snprintf(buffer, sizeof(buffer), (spec + 'c').c_str(), (int)arg.value));
+				break;
+
+			case 'e':
+			case 'E':
+			case 'f':
+			case 'F':
+			case 'g':
+			case 'G':
+			case 'a':
+			case 'A':
+				append(std::snprintf(buffer, sizeof(buffer), (spec + conv).c_str(), arg.type == arg_t::f64 ? arg.f64 : (double)(int64_t)arg.value));
+				break;
+
+			case 's':
+				if (arg.type == arg_t::str) {
+					append(std::snprintf(buffer, sizeof(buffer), (spec + 's').c_str(), std::string(arg.str).c_str()));
+				}
+				else {
+					out += "(null)";
+				}
+				break;
+
+			case 'p':
+				append(std::snprintf(buffer, sizeof(buffer), (spec + 'p').c_str(), (void *)(uintptr_t)arg.value));
+				break;
+
+			default:
+				break; // %n and unknown conversions only consume their argument
+			}
+		}
+	}
+
+	static void
+	write_record(std::string &out, const record_t &record, const uint8_t *data)
+	{
+		out.clear();
+		if (record.lv != std::to_underlying(log_lv::lowest)) {
+			out += lv_to_str[record.lv];
+			out += module_to_str[record.name];
+		}
+		if (record.kind == record_kind_t::args) {
+			format_args(out, record.msg, data, data + record.data_size);
+		}
+		else {
+			out.append((const char *)data, record.data_size);
+		}
+		out += '\n';
+		std::fwrite(out.data(), 1, out.size(), s_out);
+	}
+
+	// Writes all the messages currently in the ring buffers, in the order given by their sequence number, and returns how many were written. Note that a
+	// thread can publish a message after another thread published one with a higher sequence number, so the order is only exact among messages that were
+	// already in the buffers when they were merged
+	static size_t
+	drain(std::string &out)
+	{
+		std::vector<ring_t *> rings;
+		{
+			std::unique_lock lock(s_rings_mtx);
+			rings.reserve(s_rings.size());
+			for (const auto &ring : s_rings) {
+				rings.push_back(ring.get());
+			}
+		}
+
+		size_t num_of_written = 0;
+		while (true) {
+			ring_t *next_ring = nullptr;
+			const record_t *next_record = nullptr;
+			uint64_t next_tail;
+			for (ring_t *ring : rings) {
+				uint64_t head = ring->head.load(std::memory_order_acquire), tail = ring->tail.load(std::memory_order_relaxed);
+				while (tail != head) {
+					const record_t *record = (const record_t *)&ring->buffer[tail & (LOG_RING_SIZE - 1)];
+					if (record->kind != record_kind_t::padding) {
+						if ((next_record == nullptr) || (record->seq < next_record->seq)) {
+							next_ring = ring;
+							next_record = record;
+							next_tail = tail;
+						}
+						break;
+					}
+					tail += record->size;
+					ring->tail.store(tail, std::memory_order_release);
+				}
+			}
+
+			if (next_record == nullptr) {
+				break;
+			}
+
+			write_record(out, *next_record, (const uint8_t *)next_record + sizeof(record_t));
+			bool needs_flush = (next_record->lv == std::to_underlying(log_lv::highest)) || (next_record->lv == std::to_underlying(log_lv::lowest));
+			if (needs_flush) {
+				std::fflush(s_out);
+			}
+			next_ring->tail.store(next_tail + next_record->size, std::memory_order_release);
+			if (needs_flush) {
+				next_ring->tail.notify_all();
+			}
+			++num_of_written;
+		}
+
+		for (ring_t *ring : rings) {
+			// Wake up the threads that wait for space when the policy is block
+			ring->tail.notify_all();
+			if (uint64_t num_of_dropped = ring->num_of_dropped.load(std::memory_order_relaxed); num_of_dropped != ring->num_of_dropped_reported) {
+				std::fprintf(s_out, "%s%sDropped %" PRIu64 " log messages because the buffer was full\n", lv_to_str[std::to_underlying(log_lv::warn)],
+					module_to_str[std::to_underlying(log_module::nxbx)], num_of_dropped - ring->num_of_dropped_reported);
+				ring->num_of_dropped_reported = num_of_dropped;
+				++num_of_written;
+			}
+		}
+
+		if (num_of_written) {
+			std::fflush(s_out);
+		}
+
+		return num_of_written;
+	}
+
+	static void
+	free_orphaned_rings()
+	{
+		std::unique_lock lock(s_rings_mtx);
+		std::erase_if(s_rings, [](const std::unique_ptr<ring_t> &ring) {
+			return ring->is_orphaned.load(std::memory_order_acquire) &&
+				(ring->tail.load(std::memory_order_relaxed) == ring->head.load(std::memory_order_acquire));
+			});
+	}
+
+	static void
+	drainer(std::stop_token stok)
+	{
+		std::string out;
+		while (true) {
+			if (drain(out) == 0) {
+				if (stok.stop_requested()) {
+					break;
+				}
+				free_orphaned_rings();
+				std::this_thread::sleep_for(LOG_DRAIN_INTERVAL);
+			}
+		}
+	}
+
+	void
+	init(const char *path, policy_t policy)
+	{
+		if (g_is_running) {
+			return;
+		}
+
+		s_out = stdout;
+		if (path && *path) {
+			if (s_out = std::fopen(path, "w"); s_out == nullptr) {
+				s_out = stdout;
+				logger<log_lv::warn, log_module::nxbx, false>("Failed to open log file \"%s\", logging to stdout instead", path);
+			}
+		}
+
+		s_policy = (policy == policy_t::block) ? policy_t::block : policy_t::drop;
+		s_drainer = std::jthread(&drainer);
+		g_is_running = true;
+	}
+
+	void
+	deinit()
+	{
+		if (!g_is_running) {
+			return;
+		}
+
+		// The threads that are still logging print synchronously from now on, and the drainer exits after it has written everything that was already queued
+		g_is_running = false;
+		s_drainer.request_stop();
+		s_drainer.join();
+		{
+			std::unique_lock lock(s_rings_mtx);
+			for (const auto &ring : s_rings) {
+				ring->tail.notify_all();
+			}
+		}
+
+		if (s_out != stdout) {
+			std::fclose(s_out);
+		}
+		s_out = stdout;
+	}
+}
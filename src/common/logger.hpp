@@ -4,6 +4,9 @@
 #pragma once
 
 #include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
 #include <stdexcept>
 #include <string>
 #include <atomic>
@@ -11,6 +14,7 @@
 #include <algorithm>
 #include <utility>
 #include <unordered_map>
+#include <type_traits>
 
 #define log_init_failure(msg, ...) do { logger<log_lv::highest, log_module::MODULE_NAME, false>(msg __VA_OPT__(,) __VA_ARGS__); } while(0)
 #define logger_en(lv, msg, ...) do { logger<log_lv::lv, log_module::MODULE_NAME, true>(msg __VA_OPT__(,) __VA_ARGS__); } while(0)
@@ -24,6 +28,8 @@
 #define lv2str(lv, msg) mod_lv_to_string<log_lv::lv, log_module::MODULE_NAME>(msg)
 
 #define NUM_OF_LOG_MODULES32 std::to_underlying(log_module::max) / 32 + 1
+#define LOG_MAX_ARGS_SIZE 1024 // max size of the arguments of a message in a ring buffer
+#define LOG_MAX_STR_ARG_SIZE 256 // max length of a string argument
 
 
 enum class log_lv : int32_t
@@ -167,12 +173,139 @@ inline constexpr std::string mod_lv_to_string(const char *msg)
 	}
 }
 
+// Asynchronous sink for the log messages. When it's running, logger doesn't format the messages: it stores the format string pointer and the arguments in a ring
+// buffer owned by the calling thread, and a background thread formats and writes them. Before init and after deinit, the messages are printed synchronously.
+// NOTE: because the format is only read later, the formats passed to logger must have static storage (string literals, in practice). Text built at runtime
+// must be passed as a "%s" argument instead, which is copied. The va_list overloads are exempt, since those messages are formatted by the calling thread
+namespace log_sink {
+	// What to do when the ring buffer of a thread is full
+	enum class policy_t : int32_t {
+		drop, // discard the message, the number of discarded messages is logged later
+		block, // wait until the background thread has written some messages
+	};
+
+	enum class arg_t : uint8_t {
+		i32,
+		u32,
+		i64,
+		u64,
+		f64,
+		ptr,
+		str,
+	};
+
+	inline std::atomic_bool g_is_running = false;
+
+	void init(const char *path, policy_t policy); // an empty path means stdout
+	void deinit();
+	void push(log_lv lv, log_module name, const char *msg, const uint8_t *args, uint32_t args_size);
+	void push(log_lv lv, log_module name, const char *msg, std::va_list vlist);
+
+	// Each argument is stored as its type followed by its value. Strings are copied (up to LOG_MAX_STR_ARG_SIZE bytes), because they might not exist anymore
+	// when the message is formatted
+	template<typename T>
+	inline uint32_t encode_arg(uint8_t *buffer, uint32_t offset, T arg)
+	{
+		auto store = [buffer, &offset](arg_t type, const void *value, uint32_t size) {
+			if ((offset + 1 + size) <= LOG_MAX_ARGS_SIZE) {
+				buffer[offset] = std::to_underlying(type);
+				std::memcpy(&buffer[offset + 1], value, size);
+				offset += (1 + size);
+			}
+			};
+
+		if constexpr (std::is_same_v<T, const char *> || std::is_same_v<T, char *>) {
+			if (arg) {
+				uint32_t free_size = (offset + 3) <= LOG_MAX_ARGS_SIZE ? LOG_MAX_ARGS_SIZE - offset - 3 : 0;
+				uint16_t len = std::min<size_t>(strnlen(arg, LOG_MAX_STR_ARG_SIZE), free_size);
+				if (free_size) {
+					buffer[offset] = std::to_underlying(arg_t::str);
+					std::memcpy(&buffer[offset + 1], &len, 2);
+					std::memcpy(&buffer[offset + 3], arg, len);
+					offset += (3 + len);
+				}
+			}
+			else {
+				uintptr_t value = 0;
+				store(arg_t::ptr, &value, sizeof(value));
+			}
+		}
+		else if constexpr (std::is_floating_point_v<T>) {
+			double value = arg;
+			store(arg_t::f64, &value, sizeof(value));
+		}
+		else if constexpr (std::is_pointer_v<T> || std::is_null_pointer_v<T>) {
+			uintptr_t value = (uintptr_t)arg;
+			store(arg_t::ptr, &value, sizeof(value));
+		}
+		else if constexpr (std::is_integral_v<T> || std::is_enum_v<T>) {
+			using U = std::conditional_t<std::is_enum_v<T>, std::underlying_type<T>, std::type_identity<T>>::type;
+			if constexpr (sizeof(U) <= 4) {
+				uint32_t value = std::is_signed_v<U> ? (uint32_t)(int32_t)arg : (uint32_t)arg;
+				store(std::is_signed_v<U> ? arg_t::i32 : arg_t::u32, &value, sizeof(value));
+			}
+			else {
+				uint64_t value = (uint64_t)arg;
+				store(std::is_signed_v<U> ? arg_t::i64 : arg_t::u64, &value, sizeof(value));
+			}
+		}
+		else {
+			static_assert(sizeof(T) == 0, "Unsupported logger argument type");
+		}
+
+		return offset;
+	}
+
+	template<typename... Args>
+	inline void push_args(log_lv lv, log_module name, const char *msg, Args... args)
+	{
+		uint8_t buffer[LOG_MAX_ARGS_SIZE];
+		uint32_t size = 0;
+		((size = encode_arg(buffer, size, args)), ...);
+		push(lv, name, msg, buffer, size);
+	}
+}
+
+template<typename... Args>
+inline void logger_impl(log_lv lv, log_module name, const char *msg, Args... args)
+{
+	if (log_sink::g_is_running.load(std::memory_order_relaxed)) {
+		log_sink::push_args(lv, name, msg, args...);
+	}
+	else {
+		std::string str(lv_to_str[std::to_underlying(lv)]);
+		str += module_to_str[std::to_underlying(name)];
+		str += msg;
+		str += '\n';
+		std::printf(str.c_str(), args...);
+		if (lv == log_lv::highest) {
+			std::fflush(stdout);
+		}
+	}
+}
+
+inline void logger_impl(log_lv lv, log_module name, const char *msg, std::va_list vlist)
+{
+	if (log_sink::g_is_running.load(std::memory_order_relaxed)) {
+		log_sink::push(lv, name, msg, vlist);
+	}
+	else {
+		std::string str(msg);
+		if (lv != log_lv::lowest) {
+			str = std::string(lv_to_str[std::to_underlying(lv)]) + module_to_str[std::to_underlying(name)] + str;
+		}
+		str += '\n';
+		std::vprintf(str.c_str(), vlist);
+		if ((lv == log_lv::highest) || (lv == log_lv::lowest)) {
+			std::fflush(stdout);
+		}
+	}
+}
+
 inline void logger(const char *msg, std::va_list vlist)
 {
-	std::string str(msg);
-	str += '\n';
-	std::vprintf(str.c_str(), vlist);
-	std::fflush(stdout);
+	// Messages without a level and module are written without a prefix
+	logger_impl(log_lv::lowest, log_module::lowest, msg, vlist);
 }
 
 inline void logger(const char *msg, ...)
@@ -192,27 +325,27 @@ inline void logger(const char *msg, std::va_list vlist)
 				return;
 			}
 		}
-		std::string str(lv_to_str[std::to_underlying(lv)]);
-		str += module_to_str[std::to_underlying(name)];
-		str += msg;
-		str += '\n';
-		std::vprintf(str.c_str(), vlist);
-		if constexpr (lv == log_lv::highest) {
-			std::fflush(stdout);
-		}
+		logger_impl(lv, name, msg, vlist);
 	}
 	else {
 		throw std::logic_error("Out of range log_lv and/or log_module used");
 	}
 }
 
-template<log_lv lv, log_module name, bool check_if>
-inline void logger(const char *msg, ...)
+template<log_lv lv, log_module name, bool check_if, typename... Args>
+inline void logger(const char *msg, Args... args)
 {
-	std::va_list args;
-	va_start(args, msg);
-	logger<lv, name, check_if>(msg, args);
-	va_end(args);
+	if constexpr (is_log_lv_in_range(lv) && is_log_module_in_range(name)) {
+		if constexpr (check_if) {
+			if ((lv < g_log_lv) || !check_if_enabled<name>()) {
+				return;
+			}
+		}
+		logger_impl(lv, name, msg, args...);
+	}
+	else {
+		throw std::logic_error("Out of range log_lv and/or log_module used");
+	}
 }
 
 template<log_module name, bool check_if>
@@ -225,14 +358,7 @@ inline void logger(log_lv lv, const char *msg, std::va_list vlist)
 					return;
 				}
 			}
-			std::string str(lv_to_str[std::to_underlying(lv)]);
-			str += module_to_str[std::to_underlying(name)];
-			str += msg;
-			str += '\n';
-			std::vprintf(str.c_str(), vlist);
-			if (lv == log_lv::highest) {
-				std::fflush(stdout);
-			}
+			logger_impl(lv, name, msg, vlist);
 		}
 		else {
 			logger("Out of range log_lv used");
@@ -243,13 +369,25 @@ inline void logger(log_lv lv, const char *msg, std::va_list vlist)
 	}
 }
 
-template<log_module name, bool check_if>
-inline void logger(log_lv lv, const char *msg, ...)
+template<log_module name, bool check_if, typename... Args>
+inline void logger(log_lv lv, const char *msg, Args... args)
 {
-	std::va_list args;
-	va_start(args, msg);
-	logger<name, check_if>(lv, msg, args);
-	va_end(args);
+	if constexpr (is_log_module_in_range(name)) {
+		if (is_log_lv_in_range(lv)) {
+			if constexpr (check_if) {
+				if ((lv < g_log_lv) || !check_if_enabled<name>()) {
+					return;
+				}
+			}
+			logger_impl(lv, name, msg, args...);
+		}
+		else {
+			logger("Out of range log_lv used");
+		}
+	}
+	else {
+		throw std::logic_error("Out of range log_module used");
+	}
 }
 
 template<log_lv lv, bool check_if>
@@ -262,14 +400,7 @@ inline void logger(log_module name, const char *msg, std::va_list vlist)
 					return;
 				}
 			}
-			std::string str(lv_to_str[std::to_underlying(lv)]);
-			str += module_to_str[std::to_underlying(name)];
-			str += msg;
-			str += '\n';
-			std::vprintf(str.c_str(), vlist);
-			if constexpr (lv == log_lv::highest) {
-				std::fflush(stdout);
-			}
+			logger_impl(lv, name, msg, vlist);
 		}
 		else {
 			logger("Out of range log_module used");
@@ -280,13 +411,25 @@ inline void logger(log_module name, const char *msg, std::va_list vlist)
 	}
 }
 
-template<log_lv lv, bool check_if>
-inline void logger(log_module name, const char *msg, ...)
+template<log_lv lv, bool check_if, typename... Args>
+inline void logger(log_module name, const char *msg, Args... args)
 {
-	std::va_list args;
-	va_start(args, msg);
-	logger<lv, check_if>(name, msg, args);
-	va_end(args);
+	if constexpr (is_log_lv_in_range(lv)) {
+		if (is_log_module_in_range(name)) {
+			if constexpr (check_if) {
+				if ((lv < g_log_lv) || !check_if_enabled(name)) {
+					return;
+				}
+			}
+			logger_impl(lv, name, msg, args...);
+		}
+		else {
+			logger("Out of range log_module used");
+		}
+	}
+	else {
+		throw std::logic_error("Out of range log_lv used");
+	}
 }
 
 template<log_module name, bool check_if, uint32_t align_mask>
@@ -2,7 +2,9 @@
 
 // SPDX-FileCopyrightText: 2024 ergo720
 
+#ifdef QT_UI_BUILD
 #include "qthost.hpp"
+#endif
 #include "settings.hpp"
 #include "files.hpp"
 #include "logger.hpp"
@@ -99,6 +101,11 @@ settings::reset()
 	set_int64_value("core", "sys_time_bias", 0);
 	set_long_value("core", "log_level", std::to_underlying(g_default_log_lv));
 	set_uint32_value("core", "log_modules0", g_default_log_modules0, true);
+	set_string_value("core", "log_file", ""); // empty means stdout
+	set_long_value("core", "log_policy", std::to_underlying(log_sink::policy_t::drop)); // 0: drop messages when a log buffer is full, 1: wait
+	set_uint32_value("core", "pgraph_queue_size", 256);
+	set_uint32_value("core", "raster_threads", 0); // 0 means automatic
+	set_string_value("core", "gpu_capture_file", ""); // empty means no capture
 	set_string_value("core", "kernel_path", emu_path::g_krnl_path.string().c_str());
 
 	// ui settings
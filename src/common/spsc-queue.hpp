@@ -13,6 +13,7 @@
 #ifndef DRO_SPSC_QUEUE
 #define DRO_SPSC_QUEUE
 
+#include <algorithm>   // for std::min
 #include <array>       // for std::array
 #include <atomic>      // for atomic, memory_order
 #include <concepts>    // for concept, requires
@@ -264,6 +265,56 @@ namespace dro {
 			return true;
 		}
 
+		// Pushes count elements, and waits for the reader when the queue is full. The write index is published once for each contiguous run of free
+		// slots, instead of once for each element
+		void push_n(const T *vals, std::size_t count) noexcept(nothrow_v) {
+			auto writeIndex = writer_.writeIndex_.load(std::memory_order_relaxed);
+
+			while (count) {
+				auto numFree = free_slots(writeIndex);
+				if (numFree < count) {
+					writer_.readIndexCache_ =
+						reader_.readIndex_.load(std::memory_order_acquire);
+					numFree = free_slots(writeIndex);
+					if (numFree == 0) {
+						// Loop while waiting for reader to catch up
+						continue;
+					}
+				}
+
+				const auto num = std::min({ count, numFree, base_type::capacity_ - writeIndex });
+				for (std::size_t i = 0; i < num; ++i) {
+					base_type::buffer_[writeIndex + i + writer_.paddingCache_] = vals[i];
+				}
+				writeIndex = (writeIndex + num == base_type::capacity_) ? 0 : writeIndex + num;
+				writer_.writeIndex_.store(writeIndex, std::memory_order_release);
+				vals += num;
+				count -= num;
+			}
+		}
+
+		// Pops up to maxCount elements without waiting, and returns how many were popped. The read index is published only once
+		[[nodiscard]] std::size_t pop_n(T *vals, std::size_t maxCount) noexcept(nothrow_v) {
+			auto readIndex = reader_.readIndex_.load(std::memory_order_relaxed);
+
+			auto numUsed = used_slots(readIndex);
+			if (numUsed < maxCount) {
+				reader_.writeIndexCache_ =
+					writer_.writeIndex_.load(std::memory_order_acquire);
+				numUsed = used_slots(readIndex);
+			}
+
+			const auto num = std::min(maxCount, numUsed);
+			for (std::size_t i = 0; i < num; ++i) {
+				read_value(readIndex, vals[i]);
+				readIndex = (readIndex == reader_.capacityCache_ - 1) ? 0 : readIndex + 1;
+			}
+			if (num) {
+				reader_.readIndex_.store(readIndex, std::memory_order_release);
+			}
+			return num;
+		}
+
 		[[nodiscard]] std::size_t size() const noexcept {
 			const auto writeIndex = writer_.writeIndex_.load(std::memory_order_acquire);
 			const auto readIndex = reader_.readIndex_.load(std::memory_order_acquire);
@@ -285,6 +336,23 @@ namespace dro {
 		}
 
 	private:
+		// One slot is always left empty, to tell apart a full queue from an empty one
+		std::size_t free_slots(std::size_t writeIndex) const noexcept {
+			const auto readIndex = writer_.readIndexCache_;
+			if (readIndex > writeIndex) {
+				return readIndex - writeIndex - 1;
+			}
+			return (base_type::capacity_ - writeIndex) + readIndex - 1;
+		}
+
+		std::size_t used_slots(std::size_t readIndex) const noexcept {
+			const auto writeIndex = reader_.writeIndexCache_;
+			if (writeIndex >= readIndex) {
+				return writeIndex - readIndex;
+			}
+			return (reader_.capacityCache_ - readIndex) + writeIndex;
+		}
+
 		// Note: The "+ padding" is a constant offset used to prevent false sharing
 		// with memory in front of the SPSC allocations
 		void read_value(std::size_t readIndex, T &val) noexcept(nothrow_v) {
@@ -3,7 +3,6 @@
 // SPDX-FileCopyrightText: 2023 ergo720
 
 #include "util.hpp"
-#include "console.hpp"
 #if defined(_MSC_VER)
 #include <intrin.h>
 #endif
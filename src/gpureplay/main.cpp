@@ -0,0 +1,274 @@
+// SPDX-License-Identifier: GPL-3.0-only
+
+// SPDX-FileCopyrightText: 2026 ergo720
+
+#include "lib86cpu.hpp"
+#include "files.hpp"
+#include "isettings.hpp"
+#include "console.hpp"
+#include "paths.hpp"
+#include "clock.hpp"
+#include "cpu.hpp"
+#include "video/gpu/pmc.hpp"
+#include "video/gpu/pramin.hpp"
+#include "video/gpu/pfifo.hpp"
+#include "video/gpu/pgraph.hpp"
+#include "video/gpu/nv2a_capture.hpp"
+// Must be included last because of the template functions nv2a_read/write, which require a complete definition for the engine objects
+#include "video/gpu/nv2a.hpp"
+#include <vector>
+#include <algorithm>
+#include <thread>
+#include <chrono>
+#include <cstring>
+#include <cinttypes>
+
+#define MODULE_NAME nxbx
+
+#define SNAPSHOT_SIZE (sizeof(nv2a_capture::header_t) + NV_PRAMIN_SIZE + NV_PFIFO_SIZE + NV_PGRAPH_SIZE)
+
+
+// nxbx-gpureplay replays a capture made by nxbx (see nv2a_capture.hpp) through pfifo and pgraph. The machine is created without loading the kernel, so
+// no guest code runs, and the gpu registers are only accessed by this tool
+
+void Host::RequestShutdown(bool allow_confirm, bool allow_save_to_state, bool default_save_to_state) {}
+void Host::SignalStartup() {}
+void Host::SignalStop() {}
+void Host::SignalFrameReady() {}
+bool Host::InNoGUIMode() { return true; }
+const char *Host::GetDefaultThemeName() { return ""; }
+
+static void
+print_help()
+{
+	static const char *help =
+		"usage: nxbx-gpureplay <capture file>\n\
+Replays a gpu capture made by nxbx with the \"gpu_capture_file\" ini key, and reports the\n\
+number of methods executed per second and how many times each method was executed";
+
+	logger("%s", help);
+}
+
+static bool
+is_pusher_done(pfifo *fifo, pgraph *graph, uint32_t put)
+{
+	// The pusher is done when it reached put, or when it can't make progress without the guest: it was disabled or suspended, or an interrupt is pending
+	uint32_t dma_push = fifo->read32(NV_PFIFO_CACHE1_DMA_PUSH);
+	return ((fifo->read32(NV_PFIFO_CACHE1_DMA_GET) & ~3) == (put & ~3)) ||
+		((fifo->read32(NV_PFIFO_CACHE1_PUSH0) & NV_PFIFO_CACHE1_PUSH0_ACCESS) == 0) ||
+		((dma_push & (NV_PFIFO_CACHE1_DMA_PUSH_ACCESS | NV_PFIFO_CACHE1_DMA_PUSH_STATUS)) != NV_PFIFO_CACHE1_DMA_PUSH_ACCESS) ||
+		fifo->read32(NV_PFIFO_INTR_0) || graph->read32(NV_PGRAPH_INTR);
+}
+
+static bool
+is_gpu_done(pfifo *fifo, pgraph *graph, uint32_t put)
+{
+	if (fifo->read32(NV_PFIFO_INTR_0) || graph->read32(NV_PGRAPH_INTR)) {
+		return true; // the guest would need to handle the interrupt, so nothing else will happen
+	}
+	return is_pusher_done(fifo, graph, put) && (fifo->read32(NV_PFIFO_CACHE1_STATUS) & NV_PFIFO_CACHE1_STATUS_LOW_MARK) && graph->isIdle();
+}
+
+static void
+print_stats(const std::vector<uint64_t> &stats, double seconds)
+{
+	uint64_t tot_num_of_mthds = 0;
+	for (uint64_t count : stats) {
+		tot_num_of_mthds += count;
+	}
+	logger("Executed %" PRIu64 " methods in %.3f seconds, %.0f methods/s", tot_num_of_mthds, seconds, seconds > 0 ? tot_num_of_mthds / seconds : 0.0);
+
+	for (size_t gr_class = 0; gr_class < (stats.size() / PGRAPH_NUM_OF_MTHDS); ++gr_class) {
+		std::vector<std::pair<uint64_t, uint32_t>> class_stats; // count, method
+		uint64_t class_num_of_mthds = 0;
+		for (uint32_t i = 0; i < PGRAPH_NUM_OF_MTHDS; ++i) {
+			if (uint64_t count = stats[gr_class * PGRAPH_NUM_OF_MTHDS + i]; count) {
+				class_stats.emplace_back(count, i << 2);
+				class_num_of_mthds += count;
+			}
+		}
+		if (class_num_of_mthds == 0) {
+			continue;
+		}
+
+		logger("Class 0x%02zX: %" PRIu64 " methods", gr_class, class_num_of_mthds);
+		std::sort(class_stats.begin(), class_stats.end(), std::greater<>());
+		for (const auto &[count, mthd] : class_stats) {
+			logger("  method 0x%04" PRIX32 ": %" PRIu64 " (%.2f%%)", mthd, count, count * 100.0 / class_num_of_mthds);
+		}
+	}
+}
+
+static int
+replay(const mapped_file &capture)
+{
+	const char *data = capture.data();
+	uint64_t size = capture.size();
+	nv2a_capture::header_t header;
+	std::memcpy(&header, data, sizeof(header));
+	if (std::memcmp(header.magic, nv2a_capture::g_magic, sizeof(header.magic)) || (header.version != NV2A_CAPTURE_VERSION) ||
+		((header.ramsize != RAM_SIZE64) && (header.ramsize != RAM_SIZE128))) {
+		logger_en(error, "The file is not a gpu capture, or it was made by an incompatible version of nxbx");
+		return 1;
+	}
+
+	// Find the pb fetches that happened after each DMA_PUT write, so that they can be copied to ram before the write is replayed
+	std::vector<std::vector<uint64_t>> fetches(1);
+	for (uint64_t offset = SNAPSHOT_SIZE; offset < size; ) {
+		nv2a_capture::record_t record;
+		if ((size - offset) < sizeof(record)) {
+			logger_en(error, "The capture is truncated, the last record is incomplete");
+			return 1;
+		}
+		std::memcpy(&record, data + offset, sizeof(record));
+		if ((record.type == nv2a_capture::record_type::pfifo_write) && (record.addr == NV_PFIFO_CACHE1_DMA_PUT)) {
+			fetches.emplace_back();
+		}
+		else if (record.type == nv2a_capture::record_type::pb_fetch) {
+			if (((size - offset - sizeof(record)) < (uint64_t)record.size * 4) || ((record.addr + (uint64_t)record.size * 4) > header.ramsize)) {
+				logger_en(error, "The capture has an invalid pb fetch record");
+				return 1;
+			}
+			if (record.value >= fetches.size()) {
+				fetches.resize(record.value + 1);
+			}
+			fetches[record.value].push_back(offset);
+		}
+		offset += sizeof(record) + (record.type == nv2a_capture::record_type::pb_fetch ? record.size * 4 : 0);
+	}
+	logger("Replaying %zu pushbuffer submissions", fetches.size() - 1);
+
+	boot_params params;
+	params.syntax = disas_syntax::intel;
+	params.use_dbg = 0;
+	params.console_type = header.ramsize == RAM_SIZE64 ? console_t::xbox : console_t::devkit;
+	params.load_kernel = false;
+	g_console = new console(params);
+	if (g_console->get_state() == console_state::shut_down) {
+		delete g_console;
+		return 1;
+	}
+
+	machine *machine = g_console->get_machine();
+	nv2a *gpu = machine->getGpu();
+	pmc *pmc = gpu->getPmc();
+	pramin *pramin = gpu->getPramin();
+	pfifo *pfifo = gpu->getPfifo();
+	pgraph *pgraph = gpu->getPgraph();
+	uint8_t *ram = get_ram_ptr(machine->get86cpu());
+	auto copy_fetches = [&](uint32_t put_num)
+		{
+			for (uint64_t offset : fetches[put_num]) {
+				nv2a_capture::record_t record;
+				std::memcpy(&record, data + offset, sizeof(record));
+				std::memcpy(ram + record.addr, data + offset + sizeof(record), record.size * 4);
+			}
+		};
+
+	// Restore the snapshot. The ramin is copied directly to ram, which is fine because the gpu caches are still empty
+	const char *snapshot = data + sizeof(header);
+	pmc->write32(NV_PMC_ENABLE, header.pmc_enable);
+	std::memcpy(ram + header.ramsize - NV_PRAMIN_SIZE, snapshot, NV_PRAMIN_SIZE);
+	std::vector<uint32_t> regs(std::max(NV_PFIFO_SIZE, NV_PGRAPH_SIZE) / 4);
+	std::memcpy(regs.data(), snapshot + NV_PRAMIN_SIZE + NV_PFIFO_SIZE, NV_PGRAPH_SIZE);
+	pgraph->loadRegs(regs.data());
+	std::memcpy(regs.data(), snapshot + NV_PRAMIN_SIZE, NV_PFIFO_SIZE);
+	pfifo->loadRegs(regs.data());
+	pgraph->enableMethodStats();
+	copy_fetches(0);
+
+	uint32_t put_num = 0, last_put = regs[REGS_PFIFO_idx(NV_PFIFO_CACHE1_DMA_PUT)];
+	uint64_t start = timer::get_now();
+	for (uint64_t offset = SNAPSHOT_SIZE; offset < size; ) {
+		nv2a_capture::record_t record;
+		std::memcpy(&record, data + offset, sizeof(record));
+		offset += sizeof(record);
+
+		switch (record.type)
+		{
+		case nv2a_capture::record_type::pfifo_write:
+			if (record.addr == NV_PFIFO_CACHE1_DMA_PUT) {
+				copy_fetches(++put_num);
+				pfifo->write32(record.addr, record.value);
+				// Wait for the pusher before going on, because the following fetches might overwrite the pb entries it still has to read
+				last_put = record.value;
+				while (!is_pusher_done(pfifo, pgraph, last_put)) {
+					std::this_thread::yield();
+				}
+			}
+			else {
+				pfifo->write32(record.addr, record.value);
+			}
+			break;
+
+		case nv2a_capture::record_type::pgraph_write:
+			pgraph->write32(record.addr, record.value);
+			break;
+
+		case nv2a_capture::record_type::pramin_write:
+			pramin->write32(record.addr, record.value);
+			break;
+
+		case nv2a_capture::record_type::pb_fetch:
+			offset += record.size * 4; // already copied to ram
+			break;
+
+		default:
+			logger_en(error, "The capture has an unknown record type %" PRIu32, std::to_underlying(record.type));
+			offset = size;
+		}
+	}
+
+	// Wait until all methods were executed. This is checked twice, because pfifo might be about to submit the last methods to pgraph
+	while (true) {
+		if (is_gpu_done(pfifo, pgraph, last_put)) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			if (is_gpu_done(pfifo, pgraph, last_put)) {
+				break;
+			}
+		}
+		std::this_thread::yield();
+	}
+	double seconds = double(timer::get_now() - start) / timer::g_ticks_per_second;
+
+	print_stats(pgraph->getMethodStats(), seconds);
+	g_console->exit();
+	delete g_console;
+	g_console = nullptr;
+
+	return 0;
+}
+
+int
+main(int argc, char **argv)
+{
+	if ((argc != 2) || (std::strcmp(argv[1], "-help") == 0)) {
+		print_help();
+		return argc == 2 ? 0 : 1;
+	}
+
+	init_info_t init_info;
+	init_info.nxbx_dir = to_slash_separator(std::filesystem::absolute(argv[0]).parent_path()).string();
+	init_info.syntax = disas_syntax::intel;
+	init_info.console_type = console_t::xbox;
+	init_info.input_type = input_t::invalid;
+	init_info.use_dbg = 0;
+	init_info.sync_part = -1;
+
+	// Use the same paths and ini file of nxbx, so that the gpu is configured in the same way
+	if (emu_path::setup(init_info) == false) {
+		return 1;
+	}
+	if (init_settings() == false) {
+		return 1;
+	}
+	get_settings()->set_string_value("core", "gpu_capture_file", ""); // don't capture the replay itself
+
+	mapped_file capture;
+	if (!capture.map(argv[1]) || (capture.size() < SNAPSHOT_SIZE)) {
+		log_init_failure("Failed to open the gpu capture \"%s\"", argv[1]);
+		return 1;
+	}
+
+	return replay(capture);
+}
@@ -30,7 +30,7 @@ console::console(const boot_params &params)
 		m_machine.deinit();
 		return;
 	}
-	io::init(m_machine.get86cpu());
+	io::init(&m_machine);
 	m_state = console_state::initialized;
 }
 
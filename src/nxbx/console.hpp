@@ -33,6 +33,7 @@ public:
 
 	console_state get_state() { return m_state; }
 	boot_params get_boot_params() { return m_params; }
+	machine *get_machine() { return &m_machine; }
 	void apply_log_settings();
 	void update_tray_state(tray_state state, bool do_int);
 	static const std::string &to_string(console_t type);
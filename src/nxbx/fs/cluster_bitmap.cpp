@@ -0,0 +1,245 @@
+// SPDX-License-Identifier: GPL-3.0-only
+
+// SPDX-FileCopyrightText: 2026 ergo720
+
+#include "cluster_bitmap.hpp"
+#include "cpu_features.hpp"
+#include <algorithm>
+#include <bit>
+
+#define WORDS_PER_GROUP ((uint64_t)1 << (CLUSTER_BITMAP_GROUP_SHIFT - 6))
+
+
+namespace fatx {
+	// Scalar and SIMD kernels. The fat ones convert 64 fat entries at a time to a word of the bitmap, and the word ones return the index of the first nonzero
+	// word in [start_word, end_word), or end_word if there's none
+	template<typename T>
+	static void
+	fat_to_bits_scalar(const T *fat, uint64_t num_of_words, uint64_t *bits)
+	{
+		for (uint64_t i = 0; i < num_of_words; ++i, fat += 64) {
+			uint64_t word = 0;
+			for (unsigned j = 0; j < 64; ++j) {
+				word |= (uint64_t)(fat[j] == 0) << j;
+			}
+			bits[i] = word;
+		}
+	}
+
+	static uint64_t
+	find_nonzero_word_scalar(const uint64_t *bits, uint64_t start_word, uint64_t end_word)
+	{
+		while ((start_word < end_word) && (bits[start_word] == 0)) {
+			++start_word;
+		}
+		return start_word;
+	}
+
+#if defined(HOST_CPU_X86)
+	template<typename T>
+	static void
+	fat_to_bits_sse2(const T *fat, uint64_t num_of_words, uint64_t *bits)
+	{
+		const __m128i zero = _mm_setzero_si128();
+		for (uint64_t i = 0; i < num_of_words; ++i, fat += 64) {
+			uint64_t word = 0;
+			for (unsigned j = 0; j < 4; ++j) {
+				// Each iteration makes 16 bits of the word, by packing the compare results down to one byte per entry
+				__m128i packed;
+				const __m128i *src = (const __m128i *)(fat + j * 16);
+				if constexpr (sizeof(T) == 2) {
+					packed = _mm_packs_epi16(_mm_cmpeq_epi16(_mm_loadu_si128(src), zero), _mm_cmpeq_epi16(_mm_loadu_si128(src + 1), zero));
+				} else {
+					__m128i lo = _mm_packs_epi32(_mm_cmpeq_epi32(_mm_loadu_si128(src), zero), _mm_cmpeq_epi32(_mm_loadu_si128(src + 1), zero));
+					__m128i hi = _mm_packs_epi32(_mm_cmpeq_epi32(_mm_loadu_si128(src + 2), zero), _mm_cmpeq_epi32(_mm_loadu_si128(src + 3), zero));
+					packed = _mm_packs_epi16(lo, hi);
+				}
+				word |= (uint64_t)(uint16_t)_mm_movemask_epi8(packed) << (j * 16);
+			}
+			bits[i] = word;
+		}
+	}
+
+	template<typename T>
+	TARGET_AVX2 static void
+	fat_to_bits_avx2(const T *fat, uint64_t num_of_words, uint64_t *bits)
+	{
+		const __m256i zero = _mm256_setzero_si256();
+		for (uint64_t i = 0; i < num_of_words; ++i, fat += 64) {
+			uint64_t word = 0;
+			if constexpr (sizeof(T) == 2) {
+				for (unsigned j = 0; j < 2; ++j) {
+					// packs works on each 128 bit lane separately, so the qwords need to be put back in order before taking the mask
+					const __m256i *src = (const __m256i *)(fat + j * 32);
+					__m256i packed = _mm256_packs_epi16(_mm256_cmpeq_epi16(_mm256_loadu_si256(src), zero), _mm256_cmpeq_epi16(_mm256_loadu_si256(src + 1), zero));
+					packed = _mm256_permute4x64_epi64(packed, 0xD8);
+					word |= (uint64_t)(uint32_t)_mm256_movemask_epi8(packed) << (j * 32);
+				}
+			} else {
+				for (unsigned j = 0; j < 8; ++j) {
+					__m256i cmp = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i *)(fat + j * 8)), zero);
+					word |= (uint64_t)(uint8_t)_mm256_movemask_ps(_mm256_castsi256_ps(cmp)) << (j * 8);
+				}
+			}
+			bits[i] = word;
+		}
+	}
+
+	static uint64_t
+	find_nonzero_word_sse2(const uint64_t *bits, uint64_t start_word, uint64_t end_word)
+	{
+		const __m128i zero = _mm_setzero_si128();
+		for (; (start_word + 2) <= end_word; start_word += 2) {
+			if (_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(bits + start_word)), zero)) != 0xFFFF) {
+				break;
+			}
+		}
+		return find_nonzero_word_scalar(bits, start_word, end_word);
+	}
+
+	TARGET_AVX2 static uint64_t
+	find_nonzero_word_avx2(const uint64_t *bits, uint64_t start_word, uint64_t end_word)
+	{
+		for (; (start_word + 4) <= end_word; start_word += 4) {
+			__m256i v = _mm256_loadu_si256((const __m256i *)(bits + start_word));
+			if (!_mm256_testz_si256(v, v)) {
+				break;
+			}
+		}
+		return find_nonzero_word_scalar(bits, start_word, end_word);
+	}
+#endif
+
+	struct kernels_t {
+		void(*fat16_to_bits)(const uint16_t *, uint64_t, uint64_t *);
+		void(*fat32_to_bits)(const uint32_t *, uint64_t, uint64_t *);
+		uint64_t(*find_nonzero_word)(const uint64_t *, uint64_t, uint64_t);
+	};
+
+	static const kernels_t s_kernels = []() -> kernels_t {
+#if defined(HOST_CPU_X86)
+		if (has_avx2()) {
+			return { &fat_to_bits_avx2<uint16_t>, &fat_to_bits_avx2<uint32_t>, &find_nonzero_word_avx2 };
+		}
+		return { &fat_to_bits_sse2<uint16_t>, &fat_to_bits_sse2<uint32_t>, &find_nonzero_word_sse2 };
+#else
+		return { &fat_to_bits_scalar<uint16_t>, &fat_to_bits_scalar<uint32_t>, &find_nonzero_word_scalar };
+#endif
+		}();
+
+	template<typename T>
+	void
+	cluster_bitmap::init(const T *fat, uint32_t num_of_entries)
+	{
+		m_num_of_entries = num_of_entries;
+		m_bits.assign((num_of_entries + 63) / 64, 0);
+		m_summary.assign(((uint64_t)num_of_entries + (1 << CLUSTER_BITMAP_GROUP_SHIFT) - 1) >> CLUSTER_BITMAP_GROUP_SHIFT, 0);
+
+		uint64_t full_words = num_of_entries / 64;
+		if constexpr (sizeof(T) == 2) {
+			s_kernels.fat16_to_bits(fat, full_words, m_bits.data());
+		} else {
+			s_kernels.fat32_to_bits(fat, full_words, m_bits.data());
+		}
+		for (uint32_t idx = full_words * 64; idx < num_of_entries; ++idx) {
+			m_bits[idx >> 6] |= (uint64_t)(fat[idx] == 0) << (idx & 63);
+		}
+
+		m_num_of_free = 0;
+		for (uint64_t i = 0; i < m_bits.size(); ++i) {
+			unsigned num_of_free = std::popcount(m_bits[i]);
+			m_summary[i / WORDS_PER_GROUP] += num_of_free;
+			m_num_of_free += num_of_free;
+		}
+	}
+
+	template void cluster_bitmap::init<uint16_t>(const uint16_t *fat, uint32_t num_of_entries);
+	template void cluster_bitmap::init<uint32_t>(const uint32_t *fat, uint32_t num_of_entries);
+
+	void
+	cluster_bitmap::set_free(uint32_t idx)
+	{
+		if (!is_free(idx)) {
+			m_bits[idx >> 6] |= (1ULL << (idx & 63));
+			++m_summary[idx >> CLUSTER_BITMAP_GROUP_SHIFT];
+			++m_num_of_free;
+		}
+	}
+
+	void
+	cluster_bitmap::set_used(uint32_t idx)
+	{
+		if (is_free(idx)) {
+			m_bits[idx >> 6] &= ~(1ULL << (idx & 63));
+			--m_summary[idx >> CLUSTER_BITMAP_GROUP_SHIFT];
+			--m_num_of_free;
+		}
+	}
+
+	uint64_t
+	cluster_bitmap::find_nonzero_word(uint64_t start_word, uint64_t end_word) const
+	{
+		// Groups without free clusters are skipped by only looking at the summary
+		while (start_word < end_word) {
+			uint64_t group = start_word / WORDS_PER_GROUP;
+			uint64_t group_end_word = std::min((group + 1) * WORDS_PER_GROUP, end_word);
+			if (m_summary[group]) {
+				if (uint64_t word = s_kernels.find_nonzero_word(m_bits.data(), start_word, group_end_word); word < group_end_word) {
+					return word;
+				}
+			}
+			start_word = group_end_word;
+		}
+
+		return end_word;
+	}
+
+	uint32_t
+	cluster_bitmap::find_free(uint32_t start, uint32_t end) const
+	{
+		end = std::min(end, m_num_of_entries);
+		if (start >= end) {
+			return npos;
+		}
+
+		uint64_t word = start >> 6, end_word = ((uint64_t)end + 63) >> 6;
+		uint64_t bits = m_bits[word] & (~0ULL << (start & 63));
+		while (bits == 0) {
+			if (word = find_nonzero_word(word + 1, end_word); word == end_word) {
+				return npos;
+			}
+			bits = m_bits[word];
+		}
+
+		uint64_t idx = word * 64 + std::countr_zero(bits);
+		return idx < end ? (uint32_t)idx : npos;
+	}
+
+	uint32_t
+	cluster_bitmap::find_free_run(uint32_t start, uint32_t end, uint32_t num_of_bits) const
+	{
+		end = std::min(end, m_num_of_entries);
+		for (uint32_t idx = find_free(start, end); idx != npos; ) {
+			// Measure the run of free bits that starts at idx, stopping as soon as it's long enough
+			uint64_t run_end = idx, max_run_end = std::min((uint64_t)idx + num_of_bits, (uint64_t)end);
+			while (run_end < max_run_end) {
+				unsigned bit = run_end & 63;
+				unsigned ones = std::countr_one(m_bits[run_end >> 6] >> bit);
+				run_end += std::min(ones, 64 - bit);
+				if (ones < (64 - bit)) {
+					break; // found a used cluster
+				}
+			}
+			run_end = std::min(run_end, max_run_end);
+			if ((run_end - idx) >= num_of_bits) {
+				return idx;
+			}
+			if (run_end >= end) {
+				break;
+			}
+			idx = find_free(run_end, end);
+		}
+
+		return npos;
+	}
+}
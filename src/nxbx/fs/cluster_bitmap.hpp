@@ -0,0 +1,38 @@
+// SPDX-License-Identifier: GPL-3.0-only
+
+// SPDX-FileCopyrightText: 2026 ergo720
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#define CLUSTER_BITMAP_GROUP_SHIFT 16 // the summary level tracks groups of 64K clusters
+
+
+namespace fatx {
+	// Bitmap of the free clusters of a partition, where bit n tracks the fat entry n (that is, cluster n + 1). The summary level counts the free clusters of
+	// each group, so that searches can skip full groups without looking at their bits
+	class cluster_bitmap {
+	public:
+		static constexpr uint32_t npos = ~0u;
+
+		template<typename T>
+		void init(const T *fat, uint32_t num_of_entries);
+		bool is_free(uint32_t idx) const { return m_bits[idx >> 6] & (1ULL << (idx & 63)); }
+		void set_free(uint32_t idx);
+		void set_used(uint32_t idx);
+		uint64_t count_free() const { return m_num_of_free; }
+		// These return the index of the first free bit, or the first bit of the first run of num_of_bits free bits, that is inside [start, end), or npos
+		uint32_t find_free(uint32_t start, uint32_t end) const;
+		uint32_t find_free_run(uint32_t start, uint32_t end, uint32_t num_of_bits) const;
+
+	private:
+		uint64_t find_nonzero_word(uint64_t start_word, uint64_t end_word) const;
+
+		std::vector<uint64_t> m_bits;
+		std::vector<uint32_t> m_summary; // number of free clusters in each group
+		uint64_t m_num_of_free;
+		uint32_t m_num_of_entries;
+	};
+}
@@ -4,6 +4,7 @@
 
 #include "fatx.hpp"
 #include "paths.hpp"
+#include "io_backend.hpp"
 #include <array>
 #include <algorithm>
 #include <limits>
@@ -22,6 +23,7 @@
 #define CLUSTER_TABLE_ELEM_SIZE 4096
 #define CLUSTER_TABLE_ENTRIES_PER_ELEM (CLUSTER_TABLE_ELEM_SIZE / sizeof(CLUSTER_DATA_ENTRY))
 #define CLUSTER_TO_OFFSET(n) ((n / CLUSTER_TABLE_ENTRIES_PER_ELEM) * CLUSTER_TABLE_ELEM_SIZE + (n % CLUSTER_TABLE_ENTRIES_PER_ELEM) * sizeof(CLUSTER_DATA_ENTRY))
+#define FAT_PAGE_SHIFT 12 // the FAT is written back to metadata.bin in units of pages of this size
 
 #define NUM_OF_HDD_PARTITIONS 6
 #define PE_PARTFLAGS_IN_USE	0x80000000
@@ -208,40 +210,24 @@ namespace fatx {
 		// Calculate the FAT size
 		m_metadata_fat_sizes = ((partition_length / cluster_size1) * (IS_FATX16() ? 2 : 4) + 4095) & ~4095;
 
-		// Cache the total number of free clusters of the partition
-		auto count_free_clusters = [this]<typename T>()
-			{
-				uint64_t fat_length = m_metadata_fat_sizes;
-				std::unique_ptr<T[]> fat_buffer = std::make_unique_for_overwrite<T[]>(fat_length / sizeof(T));
-				m_pt_fs.seekg(METADATA_FAT_OFFSET, m_pt_fs.beg);
-				m_pt_fs.read((char *)fat_buffer.get(), fat_length);
-				if (!m_pt_fs.good()) {
-					return false;
-				}
-				std::for_each(fat_buffer.get(), fat_buffer.get() + fat_length / sizeof(T), [this](T fat_entry)
-					{
-						uint32_t found_cluster;
-						if constexpr (sizeof(T) == 2) {
-							found_cluster = fat_entry < FATX16_BOUNDARY ? fat_entry : (uint32_t)(int16_t)fat_entry;
-						} else {
-							found_cluster = fat_entry;
-						}
-						if (found_cluster == FATX32_CLUSTER_FREE) {
-							++m_cluster_free_num;
-						}
-					});
+		// Load the whole FAT in memory, and cache the total number of free clusters of the partition
+		m_fat = std::make_unique_for_overwrite<uint8_t[]>(m_metadata_fat_sizes);
+		m_pt_fs.seekg(METADATA_FAT_OFFSET, m_pt_fs.beg);
+		m_pt_fs.read((char *)m_fat.get(), m_metadata_fat_sizes);
+		if (!m_pt_fs.good()) {
+			return false;
+		}
+		m_fat_dirty.assign(((m_metadata_fat_sizes >> FAT_PAGE_SHIFT) + 63) / 64, 0);
+		if (!m_pt_file.open(m_pt_path)) {
+			return false;
+		}
 
-				return true;
-			};
 		if (IS_FATX16()) {
-			if (!count_free_clusters.template operator()<uint16_t>()) {
-				return false;
-			}
+			m_free_clusters.init((const uint16_t *)m_fat.get(), m_metadata_fat_sizes / 2);
 		} else {
-			if (!count_free_clusters.template operator()<uint32_t>()) {
-				return false;
-			}
+			m_free_clusters.init((const uint32_t *)m_fat.get(), m_metadata_fat_sizes / 4);
 		}
+		m_cluster_free_num = m_free_clusters.count_free();
 
 		return true;
 	}
@@ -264,26 +250,37 @@ namespace fatx {
 		// NOTE: this assumes that the non-standard partitions are bigger than around 1GiB (fatx16/32 size boundary)
 		uint64_t fat_length = m_metadata_fat_sizes;
 
-		// NOTE: place fat_buffer on the heap instead of the stack because it can become quite big, depending on the size of the partition. For example, in many
-		// homebrews the non-standard partitions can be up to 927GiB. Assuming a cluster size of 64KiB, this will result in a fat of around 58MiB
-		std::unique_ptr<char[]> fat_buffer = std::make_unique_for_overwrite<char[]>(fat_length);
-		std::fill(fat_buffer.get(), fat_buffer.get() + fat_length, 0); // mark all clusters as free
+		// A write-back of the old FAT still in flight would overwrite the new one
+		wait_for_fat_write_back();
+
+		// NOTE: the fat is kept on the heap because it can become quite big, depending on the size of the partition. For example, in many homebrews the
+		// non-standard partitions can be up to 927GiB. Assuming a cluster size of 64KiB, this will result in a fat of around 58MiB
+		m_fat = std::make_unique<uint8_t[]>(fat_length); // mark all clusters as free
+		m_fat_dirty.assign(((fat_length >> FAT_PAGE_SHIFT) + 63) / 64, 0);
 		if (IS_FATX16()) {
-			uint16_t *fatx16_buffer = (uint16_t *)fat_buffer.get();
+			uint16_t *fatx16_buffer = (uint16_t *)m_fat.get();
 			fatx16_buffer[0] = FATX16_CLUSTER_ROOT;
 			fatx16_buffer[1] = FATX16_CLUSTER_EOC;
+			m_free_clusters.init(fatx16_buffer, fat_length / 2);
 		} else {
-			uint32_t *fatx32_buffer = (uint32_t *)fat_buffer.get();
+			uint32_t *fatx32_buffer = (uint32_t *)m_fat.get();
 			fatx32_buffer[0] = FATX32_CLUSTER_ROOT;
 			fatx32_buffer[1] = FATX32_CLUSTER_EOC;
+			m_free_clusters.init(fatx32_buffer, fat_length / 4);
 		}
 
+		// The write-back uses m_pt_file instead of m_pt_fs, so the FAT must not be left in the buffer of the latter
 		m_pt_fs.seekp(METADATA_FAT_OFFSET, m_pt_fs.beg);
-		m_pt_fs.write(fat_buffer.get(), fat_length);
+		m_pt_fs.write((const char *)m_fat.get(), fat_length);
+		m_pt_fs.flush();
 		if (!m_pt_fs.good()) {
 			return false;
 		}
 
+		if (!m_pt_file.is_open() && !m_pt_file.open(m_pt_path)) {
+			return false;
+		}
+
 		return true;
 	}
 
@@ -303,9 +300,8 @@ namespace fatx {
 				return CLUSTER_INFO_ENTRY();
 			}
 			CLUSTER_DATA_ENTRY data_entry;
-			m_ct_fs.seekg(table_offset, m_ct_fs.beg);
-			m_ct_fs.read((char *)&data_entry, sizeof(CLUSTER_DATA_ENTRY));
-			if (!m_ct_fs.good()) {
+			native_file_cache::file_ptr table_file = g_native_file_cache.acquire(m_ct_path);
+			if (!table_file || (table_file->read_at((char *)&data_entry, sizeof(CLUSTER_DATA_ENTRY), table_offset) != sizeof(CLUSTER_DATA_ENTRY))) {
 				nxbx_mod_fatal(io, "Failed to read ClusterTable%u.bin file", m_pt_num);
 				return CLUSTER_INFO_ENTRY();
 			}
@@ -348,6 +344,168 @@ namespace fatx {
 		return offset / fat_entry_size + 1;
 	}
 
+	template<typename T>
+	uint32_t
+	driver::get_fat_entry(uint32_t cluster) const
+	{
+		T fat_entry = ((const T *)m_fat.get())[cluster - 1];
+		if constexpr (sizeof(T) == 2) {
+			// Sign extend the special fatx16 values, so that they can be compared with the fatx32 ones
+			return fat_entry < FATX16_BOUNDARY ? fat_entry : (uint32_t)(int16_t)fat_entry;
+		} else {
+			return fat_entry;
+		}
+	}
+
+	template<typename T>
+	void
+	driver::set_fat_entry(uint32_t cluster, uint32_t value)
+	{
+		((T *)m_fat.get())[cluster - 1] = (T)value;
+		if (value == FATX32_CLUSTER_FREE) {
+			m_free_clusters.set_free(cluster - 1);
+		} else {
+			m_free_clusters.set_used(cluster - 1);
+		}
+		uint64_t page = cluster_to_fat_offset(cluster) >> FAT_PAGE_SHIFT;
+		m_fat_dirty[page >> 6] |= (1ULL << (page & 63));
+	}
+
+	uint32_t
+	driver::get_fat_entry(uint32_t cluster) const
+	{
+		return IS_FATX16() ? get_fat_entry<uint16_t>(cluster) : get_fat_entry<uint32_t>(cluster);
+	}
+
+	void
+	driver::set_fat_entry(uint32_t cluster, uint32_t value)
+	{
+		IS_FATX16() ? set_fat_entry<uint16_t>(cluster, value) : set_fat_entry<uint32_t>(cluster, value);
+	}
+
+	template<typename F>
+	static void
+	for_each_dirty_run(std::vector<uint64_t> &fat_dirty, F &&f)
+	{
+		// Calls f with the first page and the number of pages of every run of consecutive dirty pages, and marks them as clean
+		uint64_t run_start = 0, run_size = 0;
+		for (size_t i = 0; i < fat_dirty.size(); ++i) {
+			uint64_t dirty = std::exchange(fat_dirty[i], 0);
+			for (unsigned bit = 0; bit < 64; ++bit) {
+				if (dirty & (1ULL << bit)) {
+					if (run_size == 0) {
+						run_start = i * 64 + bit;
+					}
+					++run_size;
+				} else if (run_size) {
+					f(run_start, run_size);
+					run_size = 0;
+				}
+			}
+		}
+		if (run_size) {
+			f(run_start, run_size);
+		}
+	}
+
+	// Snapshot of the dirty pages of a FAT, kept alive until all of its writes are done
+	struct fat_write_back_t {
+		driver *drv;
+		std::unique_ptr<char[]> data;
+		std::vector<io::backend::segment_t> segments; // one for each run of dirty pages
+		std::atomic_uint32_t transfers_left;
+	};
+
+	void
+	driver::fat_write_back_done(void *opaque, int64_t result)
+	{
+		// NOTE: this runs on a backend thread, so it must only touch the atomic members of the driver
+		fat_write_back_t *write_back = static_cast<fat_write_back_t *>(opaque);
+		driver *drv = write_back->drv;
+		if (result < 0) [[unlikely]] {
+			drv->m_fat_write_back_failed.store(true);
+		}
+		if (write_back->transfers_left.fetch_sub(1) == 1) {
+			delete write_back;
+			drv->m_fat_write_back_in_flight.store(false);
+			drv->m_fat_write_back_in_flight.notify_all();
+		}
+	}
+
+	void
+	driver::write_back_fat()
+	{
+		if (m_fat_write_back_failed.exchange(false)) [[unlikely]] {
+			metadata_set_corrupted_state();
+		}
+
+		// Only one write-back can be in flight for each partition, so that the backend can't reorder two writes to the same page. Pages changed in the
+		// meantime are written by the next write-back
+		if (!m_fat || m_fat_write_back_in_flight.load()) {
+			return;
+		}
+
+		std::vector<std::pair<uint64_t, uint64_t>> runs;
+		uint64_t tot_pages = 0;
+		for_each_dirty_run(m_fat_dirty, [&](uint64_t first_page, uint64_t num_of_pages)
+			{
+				runs.emplace_back(first_page, num_of_pages);
+				tot_pages += num_of_pages;
+			});
+		if (runs.empty()) {
+			return;
+		}
+
+		fat_write_back_t *write_back = new fat_write_back_t{ this, std::make_unique_for_overwrite<char[]>(tot_pages << FAT_PAGE_SHIFT), {}, (uint32_t)runs.size() };
+		char *data = write_back->data.get();
+		for (const auto &[first_page, num_of_pages] : runs) {
+			uint32_t size = num_of_pages << FAT_PAGE_SHIFT;
+			std::copy_n((const char *)m_fat.get() + (first_page << FAT_PAGE_SHIFT), size, data);
+			write_back->segments.emplace_back(data, size);
+			data += size;
+		}
+
+		m_fat_write_back_in_flight.store(true);
+		for (size_t i = 0; i < runs.size(); ++i) {
+			io::backend::submit({
+				.file = &m_pt_file,
+				.offset = METADATA_FAT_OFFSET + (runs[i].first << FAT_PAGE_SHIFT),
+				.segments = std::span(&write_back->segments[i], 1),
+				.is_write = true,
+				.completion = &fat_write_back_done,
+				.opaque = write_back
+				});
+		}
+	}
+
+	void
+	driver::wait_for_fat_write_back()
+	{
+		m_fat_write_back_in_flight.wait(true);
+	}
+
+	void
+	driver::write_back_fat_sync()
+	{
+		// Used when the backend is not available anymore, e.g. at shutdown
+		wait_for_fat_write_back();
+		if (m_fat_write_back_failed.exchange(false)) [[unlikely]] {
+			m_metadata_is_corrupted = true;
+			return;
+		}
+
+		if (m_fat) {
+			for_each_dirty_run(m_fat_dirty, [this](uint64_t first_page, uint64_t num_of_pages)
+				{
+					uint64_t offset = first_page << FAT_PAGE_SHIFT;
+					uint32_t size = num_of_pages << FAT_PAGE_SHIFT;
+					if (m_pt_file.write_at((const char *)m_fat.get() + offset, size, METADATA_FAT_OFFSET + offset) != size) {
+						m_metadata_is_corrupted = true;
+					}
+				});
+		}
+	}
+
 	void
 	driver::metadata_set_corrupted_state()
 	{
@@ -432,6 +590,12 @@ namespace fatx {
 		data_entry.size = (uint16_t)path_length;
 		data_entry.offset = m_metadata_file_size;
 
+		native_file_cache::file_ptr table_file = g_native_file_cache.acquire(m_ct_path);
+		if (!table_file) {
+			metadata_set_corrupted_state();
+			return io::status_t::STATUS_IO_DEVICE_ERROR;
+		}
+
 		// Read one table element, and cache as many as possible clusters to it before flushing it back to table bin
 		CLUSTER_DATA_ENTRY table_elem[CLUSTER_TABLE_ENTRIES_PER_ELEM];
 		uint64_t aligned_elem_offset = CLUSTER_TO_OFFSET(clusters[0].first) & ~4095;
@@ -443,10 +607,7 @@ namespace fatx {
 				aligned_elem_offset = CLUSTER_TO_OFFSET(cluster) & ~4095;
 				cluster_elem_base = aligned_elem_offset / CLUSTER_TABLE_ENTRIES_PER_ELEM;
 				cluster_elem_end = cluster_elem_base + CLUSTER_TABLE_ENTRIES_PER_ELEM;
-				m_ct_fs.seekg(aligned_elem_offset, m_ct_fs.beg);
-				m_ct_fs.read((char *)table_elem, CLUSTER_TABLE_ELEM_SIZE);
-				if (!m_ct_fs.good()) {
-					m_ct_fs.clear();
+				if (table_file->read_at((char *)table_elem, CLUSTER_TABLE_ELEM_SIZE, aligned_elem_offset) != CLUSTER_TABLE_ELEM_SIZE) {
 					metadata_set_corrupted_state();
 					return io::status_t::STATUS_IO_DEVICE_ERROR;
 				}
@@ -455,10 +616,7 @@ namespace fatx {
 
 		const auto write_elem = [&]()
 			{
-				m_ct_fs.seekp(aligned_elem_offset, m_ct_fs.beg);
-				m_ct_fs.write((const char *)table_elem, CLUSTER_TABLE_ELEM_SIZE);
-				if (!m_ct_fs.good()) {
-					m_ct_fs.clear();
+				if (table_file->write_at((const char *)table_elem, CLUSTER_TABLE_ELEM_SIZE, aligned_elem_offset) != CLUSTER_TABLE_ELEM_SIZE) {
 					metadata_set_corrupted_state();
 					return io::status_t::STATUS_IO_DEVICE_ERROR;
 				}
@@ -516,10 +674,8 @@ namespace fatx {
 		data_entry.offset = offset;
 
 		uint64_t table_offset = CLUSTER_TO_OFFSET(cluster);
-		m_ct_fs.seekp(table_offset, m_ct_fs.beg);
-		m_ct_fs.write((const char *)&data_entry, sizeof(CLUSTER_DATA_ENTRY));
-		if (!m_ct_fs.good()) {
-			m_ct_fs.clear();
+		native_file_cache::file_ptr table_file = g_native_file_cache.acquire(m_ct_path);
+		if (!table_file || (table_file->write_at((const char *)&data_entry, sizeof(CLUSTER_DATA_ENTRY), table_offset) != sizeof(CLUSTER_DATA_ENTRY))) {
 			metadata_set_corrupted_state();
 			return io::status_t::STATUS_IO_DEVICE_ERROR;
 		}
@@ -536,6 +692,12 @@ namespace fatx {
 		std::sort(clusters.begin(), clusters.end());
 		assert(((*clusters.rbegin() + 1) * sizeof(CLUSTER_DATA_ENTRY)) <= m_cluster_table_file_size);
 
+		native_file_cache::file_ptr table_file = g_native_file_cache.acquire(m_ct_path);
+		if (!table_file) {
+			metadata_set_corrupted_state();
+			return io::status_t::STATUS_IO_DEVICE_ERROR;
+		}
+
 		CLUSTER_DATA_ENTRY table_elem[CLUSTER_TABLE_ENTRIES_PER_ELEM];
 		uint64_t aligned_elem_offset = CLUSTER_TO_OFFSET(clusters[0]) & ~4095;
 		uint32_t cluster_elem_base = aligned_elem_offset / CLUSTER_TABLE_ENTRIES_PER_ELEM;
@@ -546,10 +708,7 @@ namespace fatx {
 				aligned_elem_offset = CLUSTER_TO_OFFSET(cluster) & ~4095;
 				cluster_elem_base = aligned_elem_offset / CLUSTER_TABLE_ENTRIES_PER_ELEM;
 				cluster_elem_end = cluster_elem_base + CLUSTER_TABLE_ENTRIES_PER_ELEM;
-				m_ct_fs.seekg(aligned_elem_offset, m_ct_fs.beg);
-				m_ct_fs.read((char *)table_elem, CLUSTER_TABLE_ELEM_SIZE);
-				if (!m_ct_fs.good()) {
-					m_ct_fs.clear();
+				if (table_file->read_at((char *)table_elem, CLUSTER_TABLE_ELEM_SIZE, aligned_elem_offset) != CLUSTER_TABLE_ELEM_SIZE) {
 					metadata_set_corrupted_state();
 					return io::status_t::STATUS_IO_DEVICE_ERROR;
 				}
@@ -558,10 +717,7 @@ namespace fatx {
 
 		const auto write_elem = [&]()
 			{
-				m_ct_fs.seekp(aligned_elem_offset, m_ct_fs.beg);
-				m_ct_fs.write((const char *)table_elem, CLUSTER_TABLE_ELEM_SIZE);
-				if (!m_ct_fs.good()) {
-					m_ct_fs.clear();
+				if (table_file->write_at((const char *)table_elem, CLUSTER_TABLE_ELEM_SIZE, aligned_elem_offset) != CLUSTER_TABLE_ELEM_SIZE) {
 					metadata_set_corrupted_state();
 					return io::status_t::STATUS_IO_DEVICE_ERROR;
 				}
@@ -597,100 +753,49 @@ namespace fatx {
 	{
 		assert(m_cluster_free_num >= clusters_needed); // caller should have checked that there are enough clusters available left
 
-		bool first_found_cluster = false;
-		constexpr uint64_t size_of_buffer = 4096;
-		char fat_buffer[size_of_buffer];
-		uint64_t fat_length = m_metadata_fat_sizes;
-		uint64_t fat_offset = cluster_to_fat_offset(m_last_allocated_cluster), ori_fat_offset = fat_offset;
-		uint32_t free_clusters = 0;
-
-		const auto find_free_clusters = [&]<typename T>(uint64_t bytes_left)
-			{
-				uint64_t prev_buff_offset = 0, curr_buff_offset = 0;
-
-				while (bytes_left > 0) {
-					uint32_t found_cluster;
-					T fat_entry = *(T *)(fat_buffer + curr_buff_offset);
-					if constexpr (sizeof(T) == 2) {
-						found_cluster = fat_entry < FATX16_BOUNDARY ? fat_entry : (uint32_t)(int16_t)fat_entry;
-					} else {
-						found_cluster = fat_entry;
-					}
-					if (found_cluster == FATX32_CLUSTER_FREE) {
-						found_cluster = fat_offset_to_cluster(fat_offset + curr_buff_offset);
-						found_clusters.emplace_back(found_cluster, free_clusters);
-						++free_clusters;
-						if (first_found_cluster == false) {
-							first_found_cluster = true;
-							if (free_clusters == clusters_needed) { // happens when the file requires only one cluster
-								*(T *)(fat_buffer + curr_buff_offset) = (T)FATX32_CLUSTER_EOC;
-								m_last_allocated_cluster = found_cluster;
-								return true;
-							}
-							prev_buff_offset = curr_buff_offset;
-							bytes_left -= sizeof(T);
-							curr_buff_offset += sizeof(T);
-							continue; // for the first file cluster, there's no preceding fat entry to chain
-						}
-						*(T *)(fat_buffer + prev_buff_offset) = (T)found_cluster; // chain the previous entry with the current cluster
-						prev_buff_offset = curr_buff_offset;
-						if (free_clusters == clusters_needed) {
-							*(T *)(fat_buffer + curr_buff_offset) = (T)FATX32_CLUSTER_EOC;
-							m_last_allocated_cluster = found_cluster;
-							return true;
-						}
-					}
-					bytes_left -= sizeof(T);
-					curr_buff_offset += sizeof(T);
-				}
-
-				return false;
-			};
-
-		uint64_t fat_bytes_to_end = fat_length - fat_offset, tot_bytes_read = 0;
-		retry:
-		while (fat_bytes_to_end > 0) {
-			uint64_t bytes_to_access = std::min(fat_bytes_to_end, size_of_buffer);
-			m_pt_fs.seekg(fat_offset + METADATA_FAT_OFFSET, m_pt_fs.beg);
-			m_pt_fs.read(fat_buffer, bytes_to_access);
-			if (!m_pt_fs.good()) {
-				m_pt_fs.clear();
-				metadata_set_corrupted_state();
-				return io::status_t::STATUS_IO_DEVICE_ERROR;
+		// Allocations of more than one cluster first look for a run of contiguous free clusters, so that the file is not fragmented. If there's none, take the
+		// first free clusters after the last allocated cluster, and then from the beginning of the FAT, since there might be some freed clusters there
+		uint32_t fat_num_of_entries = m_metadata_fat_sizes / (IS_FATX16() ? 2 : 4);
+		uint32_t start_idx = m_last_allocated_cluster - 1;
+		std::vector<uint32_t> free_idx;
+		free_idx.reserve(clusters_needed);
+
+		uint32_t run_idx = cluster_bitmap::npos;
+		if ((clusters_needed > 1) && (clusters_needed <= fat_num_of_entries)) {
+			run_idx = m_free_clusters.find_free_run(start_idx, fat_num_of_entries, clusters_needed);
+			if (run_idx == cluster_bitmap::npos) {
+				run_idx = m_free_clusters.find_free_run(0, std::min<uint64_t>(start_idx + clusters_needed - 1, fat_num_of_entries), clusters_needed);
 			}
-
-			bool has_found_enough_clusters;
-			if (IS_FATX16()) {
-				has_found_enough_clusters = find_free_clusters.template operator()<uint16_t>(bytes_to_access);
-			} else {
-				has_found_enough_clusters = find_free_clusters.template operator()<uint32_t>(bytes_to_access);
-			}
-
-			m_pt_fs.seekp(fat_offset + METADATA_FAT_OFFSET, m_pt_fs.beg);
-			m_pt_fs.write(fat_buffer, bytes_to_access);
-			if (!m_pt_fs.good()) {
-				m_pt_fs.clear();
-				metadata_set_corrupted_state();
-				return io::status_t::STATUS_IO_DEVICE_ERROR;
-			}
-			if (has_found_enough_clusters) {
-				return io::status_t::STATUS_SUCCESS;
+		}
+		if (run_idx != cluster_bitmap::npos) {
+			for (uint32_t i = 0; i < clusters_needed; ++i) {
+				free_idx.push_back(run_idx + i);
 			}
-
-			fat_bytes_to_end -= bytes_to_access;
-			fat_offset += bytes_to_access;
-			tot_bytes_read += bytes_to_access;
+		} else {
+			const auto gather_free_clusters = [&](uint32_t start, uint32_t end)
+				{
+					for (uint32_t idx = m_free_clusters.find_free(start, end); (idx != cluster_bitmap::npos) && (free_idx.size() < clusters_needed);
+						idx = m_free_clusters.find_free(idx + 1, end)) {
+						free_idx.push_back(idx);
+					}
+				};
+			gather_free_clusters(start_idx, fat_num_of_entries);
+			gather_free_clusters(0, start_idx);
 		}
-
-		if (tot_bytes_read == fat_length) [[unlikely]] {
+		if (free_idx.size() < clusters_needed) [[unlikely]] {
 			std::unreachable();
 		}
 
-		// If we reach here, scan the FAT from the beginning up to last_allocated_cluster_num, since there might be some freed clusters there
-		fat_bytes_to_end = ori_fat_offset;
-		fat_offset = 0;
-		goto retry;
-	};
+		// Chain the clusters in the order they were found
+		for (uint32_t i = 0; i < clusters_needed; ++i) {
+			uint32_t found_cluster = free_idx[i] + 1;
+			found_clusters.emplace_back(found_cluster, i);
+			set_fat_entry(found_cluster, (i + 1) < clusters_needed ? free_idx[i + 1] + 1 : FATX32_CLUSTER_EOC);
+		}
+		m_last_allocated_cluster = free_idx.back() + 1;
+
+		return io::status_t::STATUS_SUCCESS;
+	}
 
 	template<typename T>
 	io::status_t
@@ -699,89 +804,36 @@ namespace fatx {
 		// Move in the chain until we find the position of the new eoc, then free all the remaining chained clusters until we find the old eoc
 		// NOTE: If the new size is zero, then there's no new eoc, and all clusters become free
 
-		constexpr uint32_t fat_buffer_size = 4096 / sizeof(T);
-		T fat_buffer[fat_buffer_size];
-		uint32_t num_of_freed_clusters = 0;
-		uint64_t fat_offset = cluster_to_fat_offset(start_cluster);
-		uint32_t found_cluster = start_cluster, buffer_cluster = start_cluster, prev_cluster = start_cluster;
-
-		m_pt_fs.seekg(fat_offset + METADATA_FAT_OFFSET, m_pt_fs.beg);
-		m_pt_fs.read((char *)fat_buffer, fat_buffer_size);
-		if (!m_pt_fs.good()) {
-			m_pt_fs.clear();
-			return io::status_t::STATUS_IO_DEVICE_ERROR;
-		}
+		uint32_t fat_num_of_entries = m_metadata_fat_sizes / sizeof(T);
+		const auto is_cluster_valid = [fat_num_of_entries](uint32_t cluster)
+			{
+				return util::in_range(cluster, 1u, fat_num_of_entries);
+			};
 
-		for (uint32_t i = 0; i < clusters_left; ++i) {
-			prev_cluster = found_cluster;
-			T fat_entry = fat_buffer[found_cluster - buffer_cluster];
-			if constexpr (sizeof(T) == 2) {
-				found_cluster = fat_entry < FATX16_BOUNDARY ? fat_entry : (uint32_t)(int16_t)fat_entry;
-			} else {
-				found_cluster = fat_entry;
-			}
-			if (!util::in_range(found_cluster, buffer_cluster, buffer_cluster + fat_buffer_size - 1)) {
-				buffer_cluster = found_cluster;
-				fat_offset = cluster_to_fat_offset(found_cluster);
-				m_pt_fs.seekg(fat_offset + METADATA_FAT_OFFSET, m_pt_fs.beg);
-				m_pt_fs.read((char *)fat_buffer, fat_buffer_size);
-				if (!m_pt_fs.good()) {
-					m_pt_fs.clear();
-					metadata_set_corrupted_state();
-					return io::status_t::STATUS_IO_DEVICE_ERROR;
-				}
-			}
-			if (i == (clusters_left - 1)) {
-				fat_buffer[prev_cluster - buffer_cluster] = (T)FATX32_CLUSTER_EOC;
-				m_pt_fs.seekp(fat_offset + METADATA_FAT_OFFSET, m_pt_fs.beg);
-				m_pt_fs.write((const char *)fat_buffer, fat_buffer_size);
-				if (!m_pt_fs.good()) {
-					m_pt_fs.clear();
+		uint32_t cluster = start_cluster, num_of_freed_clusters = 0;
+		if (clusters_left) {
+			for (uint32_t i = 1; i < clusters_left; ++i) {
+				cluster = get_fat_entry<T>(cluster);
+				if (!is_cluster_valid(cluster)) [[unlikely]] {
 					metadata_set_corrupted_state();
 					return io::status_t::STATUS_IO_DEVICE_ERROR;
 				}
 			}
+			uint32_t next_cluster = get_fat_entry<T>(cluster);
+			set_fat_entry<T>(cluster, FATX32_CLUSTER_EOC);
+			cluster = next_cluster;
 		}
 
-		while (true) {
-			prev_cluster = found_cluster;
-			T fat_entry = fat_buffer[found_cluster - buffer_cluster];
-			if constexpr (sizeof(T) == 2) {
-				found_cluster = fat_entry < FATX16_BOUNDARY ? fat_entry : (uint32_t)(int16_t)fat_entry;
-			} else {
-				found_cluster = fat_entry;
+		while (cluster != FATX32_CLUSTER_EOC) {
+			if (!is_cluster_valid(cluster) || (num_of_freed_clusters == fat_num_of_entries)) [[unlikely]] {
+				metadata_set_corrupted_state(); // broken or circular chain
+				return io::status_t::STATUS_IO_DEVICE_ERROR;
 			}
-			found_clusters.push_back(prev_cluster);
+			uint32_t next_cluster = get_fat_entry<T>(cluster);
+			set_fat_entry<T>(cluster, FATX32_CLUSTER_FREE);
+			found_clusters.push_back(cluster);
 			++num_of_freed_clusters;
-			if (found_cluster == FATX32_CLUSTER_EOC) {
-				m_pt_fs.seekp(fat_offset + METADATA_FAT_OFFSET, m_pt_fs.beg);
-				m_pt_fs.write((const char *)fat_buffer, fat_buffer_size);
-				if (!m_pt_fs.good()) {
-					m_pt_fs.clear();
-					metadata_set_corrupted_state();
-					return io::status_t::STATUS_IO_DEVICE_ERROR;
-				}
-				break;
-			}
-			if (!util::in_range(found_cluster, buffer_cluster, buffer_cluster + fat_buffer_size - 1)) {
-				m_pt_fs.seekp(fat_offset + METADATA_FAT_OFFSET, m_pt_fs.beg);
-				m_pt_fs.write((const char *)fat_buffer, fat_buffer_size);
-				if (!m_pt_fs.good()) {
-					m_pt_fs.clear();
-					metadata_set_corrupted_state();
-					return io::status_t::STATUS_IO_DEVICE_ERROR;
-				}
-				buffer_cluster = found_cluster;
-				fat_offset = cluster_to_fat_offset(found_cluster);
-				m_pt_fs.seekg(fat_offset + METADATA_FAT_OFFSET, m_pt_fs.beg);
-				m_pt_fs.read((char *)fat_buffer, fat_buffer_size);
-				if (!m_pt_fs.good()) {
-					m_pt_fs.clear();
-					metadata_set_corrupted_state();
-					return io::status_t::STATUS_IO_DEVICE_ERROR;
-				}
-			}
-			fat_buffer[prev_cluster - buffer_cluster] = (T)FATX32_CLUSTER_FREE;
+			cluster = next_cluster;
 		}
 
 		m_cluster_free_num += num_of_freed_clusters;
@@ -797,43 +849,16 @@ namespace fatx {
 			return io::status_t::STATUS_DISK_FULL; // not enough free clusters for the dirent stream and/or file/directory
 		}
 
-		constexpr uint32_t fat_buffer_size = 4096 / sizeof(T);
-		T fat_buffer[fat_buffer_size];
-		uint32_t num_of_freed_clusters = 0;
-		uint64_t fat_offset = cluster_to_fat_offset(start_cluster);
-		uint32_t found_cluster = start_cluster, buffer_cluster = start_cluster, old_cluster_num = 0, buffer_offset;
-
-		m_pt_fs.seekg(fat_offset + METADATA_FAT_OFFSET, m_pt_fs.beg);
-		m_pt_fs.read((char *)fat_buffer, fat_buffer_size);
-		if (!m_pt_fs.good()) {
-			m_pt_fs.clear();
-			return io::status_t::STATUS_IO_DEVICE_ERROR;
-		}
-
 		// Find the eoc of the existing chain
-		while (true) {
-			buffer_offset = found_cluster - buffer_cluster;
-			T fat_entry = fat_buffer[buffer_offset];
-			if constexpr (sizeof(T) == 2) {
-				found_cluster = fat_entry < FATX16_BOUNDARY ? fat_entry : (uint32_t)(int16_t)fat_entry;
-			} else {
-				found_cluster = fat_entry;
-			}
-			if (found_cluster == (T)FATX32_CLUSTER_EOC) {
-				break;
+		uint32_t fat_num_of_entries = m_metadata_fat_sizes / sizeof(T);
+		uint32_t last_cluster = start_cluster, old_cluster_num = 1;
+		for (uint32_t next_cluster = get_fat_entry<T>(last_cluster); next_cluster != FATX32_CLUSTER_EOC; next_cluster = get_fat_entry<T>(last_cluster)) {
+			if (!util::in_range(next_cluster, 1u, fat_num_of_entries) || (old_cluster_num == fat_num_of_entries)) [[unlikely]] {
+				metadata_set_corrupted_state(); // broken or circular chain
+				return io::status_t::STATUS_IO_DEVICE_ERROR;
 			}
+			last_cluster = next_cluster;
 			++old_cluster_num;
-			if (!util::in_range(found_cluster, buffer_cluster, buffer_cluster + fat_buffer_size - 1)) {
-				buffer_cluster = found_cluster;
-				fat_offset = cluster_to_fat_offset(found_cluster);
-				m_pt_fs.seekg(fat_offset + METADATA_FAT_OFFSET, m_pt_fs.beg);
-				m_pt_fs.read((char *)fat_buffer, fat_buffer_size);
-				if (!m_pt_fs.good()) {
-					m_pt_fs.clear();
-					metadata_set_corrupted_state();
-					return io::status_t::STATUS_IO_DEVICE_ERROR;
-				}
-			}
 		}
 
 		std::vector<std::pair<uint32_t, uint32_t>> found_clusters;
@@ -842,14 +867,7 @@ namespace fatx {
 		}
 
 		// Replace the old eoc with the first cluster found above
-		fat_buffer[buffer_offset] = found_clusters[0].first;
-		m_pt_fs.seekg(fat_offset + METADATA_FAT_OFFSET, m_pt_fs.beg);
-		m_pt_fs.write((const char *)fat_buffer, fat_buffer_size);
-		if (!m_pt_fs.good()) {
-			m_pt_fs.clear();
-			metadata_set_corrupted_state();
-			return io::status_t::STATUS_IO_DEVICE_ERROR;
-		}
+		set_fat_entry<T>(last_cluster, found_clusters[0].first);
 
 		if (io::status_t status = update_cluster_table(found_clusters, file_path, old_cluster_num); status != io::status_t::STATUS_SUCCESS) {
 			return status;
@@ -876,15 +894,7 @@ namespace fatx {
 		}
 
 		// Chain the new cluster to the existing chain of the stream
-		uint32_t fat_entry = cluster;
-		uint64_t fat_offset = cluster_to_fat_offset(m_last_dirent_stream_cluster);
-		m_pt_fs.seekp(fat_offset + METADATA_FAT_OFFSET, m_pt_fs.beg);
-		m_pt_fs.write((const char *)&fat_entry, IS_FATX16() ? 2 : 4);
-		if (!m_pt_fs.good()) {
-			m_pt_fs.clear();
-			metadata_set_corrupted_state();
-			return io::status_t::STATUS_IO_DEVICE_ERROR;
-		}
+		set_fat_entry(m_last_dirent_stream_cluster, cluster);
 
 		if (io::status_t status = update_cluster_table(cluster, m_metadata_file_size, cluster_t::directory); status != io::status_t::STATUS_SUCCESS) {
 			return status;
@@ -1022,31 +1032,16 @@ namespace fatx {
 			}
 
 			// Attempt to continue the search from a possibly chained stream
-			char buffer[4];
-			uint32_t fat_entry_size = IS_FATX16() ? 2 : 4;
-			uint64_t fat_offset = (dirent_cluster - 1) * fat_entry_size + METADATA_FAT_OFFSET;
-			m_pt_fs.seekg(fat_offset, m_pt_fs.beg);
-			m_pt_fs.read(buffer, fat_entry_size);
-			if (uint32_t found_cluster; !m_pt_fs.good()) {
-				m_pt_fs.clear();
-				return io::status_t::STATUS_IO_DEVICE_ERROR;
-			} else {
-				if (fat_entry_size == 2) {
-					found_cluster = *(uint16_t *)buffer;
-					found_cluster = found_cluster < FATX16_BOUNDARY ? found_cluster : (uint32_t)(int16_t)found_cluster;
-				} else {
-					found_cluster = *(uint32_t *)buffer;
-				}
-				assert(found_cluster != FATX32_CLUSTER_FREE);
-				if (found_cluster == FATX32_CLUSTER_EOC) {
-					// Reached the end of the stream
-					// NOTE: clusters are not guaranteed to be aligned on a cluster boundary in metadata.bin files
-					m_last_free_dirent_is_on_boundary = (num_dirent + 1) == num_dirent_per_cluster;
-					check_is_empty ? io::status_t::STATUS_SUCCESS : (is_last_name ? io::status_t::STATUS_OBJECT_NAME_NOT_FOUND : io::status_t::STATUS_OBJECT_PATH_NOT_FOUND);
-				}
-				dirent_cluster = m_last_dirent_stream_cluster = found_cluster;
-				bytes_in_cluster = m_cluster_size;
+			uint32_t found_cluster = get_fat_entry(dirent_cluster);
+			assert(found_cluster != FATX32_CLUSTER_FREE);
+			if (found_cluster == FATX32_CLUSTER_EOC) {
+				// Reached the end of the stream
+				// NOTE: clusters are not guaranteed to be aligned on a cluster boundary in metadata.bin files
+				m_last_free_dirent_is_on_boundary = (num_dirent + 1) == num_dirent_per_cluster;
+				return check_is_empty ? io::status_t::STATUS_SUCCESS : (is_last_name ? io::status_t::STATUS_OBJECT_NAME_NOT_FOUND : io::status_t::STATUS_OBJECT_PATH_NOT_FOUND);
 			}
+			dirent_cluster = m_last_dirent_stream_cluster = found_cluster;
+			bytes_in_cluster = m_cluster_size;
 		}
 	}
 
@@ -1357,10 +1352,9 @@ namespace fatx {
 		cluster_data[1].size = 0;
 		cluster_data[1].info = 0;
 		cluster_data[1].offset = METADATA_FAT_OFFSET + m_metadata_fat_sizes;
-		std::fstream *table_fs = &m_ct_fs;
-		table_fs->seekp(0, table_fs->end);
-		table_fs->write((const char *)cluster_data, CLUSTER_TABLE_ELEM_SIZE);
-		if (!table_fs->good()) {
+		// NOTE: the cluster table file was just truncated, so the first element goes at its beginning
+		native_file_cache::file_ptr table_file = g_native_file_cache.acquire(m_ct_path);
+		if (!table_file || (table_file->write_at((const char *)cluster_data, CLUSTER_TABLE_ELEM_SIZE, 0) != CLUSTER_TABLE_ELEM_SIZE)) {
 			return false;
 		}
 		m_cluster_table_file_size = CLUSTER_TABLE_ELEM_SIZE;
@@ -1443,6 +1437,14 @@ namespace fatx {
 				m_pt_fs.clear();
 				return io::status_t::STATUS_IO_DEVICE_ERROR;
 			}
+			if (m_pt_num != DEV_PARTITION0) {
+				// The FAT in metadata.bin might not have been written back yet, so take it from memory
+				uint64_t fat_start = std::max(actual_offset, (uint64_t)METADATA_FAT_OFFSET);
+				uint64_t fat_end = std::min(actual_offset + size, METADATA_FAT_OFFSET + m_metadata_fat_sizes);
+				if (fat_start < fat_end) {
+					std::copy_n((const char *)m_fat.get() + fat_start - METADATA_FAT_OFFSET, fat_end - fat_start, buffer + (fat_start - actual_offset));
+				}
+			}
 		}
 		else {
 			uint32_t bytes_in_cluster = m_cluster_size;
@@ -1472,21 +1474,17 @@ namespace fatx {
 					assert(IS_HDD_HANDLE(m_pt_num)); // only device supported right now
 					std::filesystem::path file_path(emu_path::g_hdd_dir);
 					file_path = combine_file_paths(file_path, info_entry.path);
-					if (auto opt = open_file(file_path); !opt) {
+					// Consecutive clusters usually belong to the same file, so this only opens the host file once for the whole read
+					if (native_file_cache::file_ptr file = g_native_file_cache.acquire(file_path); !file) {
 						return io::status_t::STATUS_IO_DEVICE_ERROR;
 					} else {
 						uint64_t file_offset = (uint64_t)info_entry.cluster << cluster_shift1;
-						opt->seekg(file_offset + cluster_offset, m_pt_fs.beg);
-						opt->read(buffer + buffer_offset, bytes_to_read);
-						if (!opt->good()) {
-							if (opt->eof()) {
-								// This might happen when reading the last cluster of the file
-								uint64_t bytes_read = opt->gcount();
-								std::fill_n(buffer + buffer_offset + bytes_read, bytes_to_read - bytes_read, 0);
-							} else {
-								return io::status_t::STATUS_IO_DEVICE_ERROR;
-							}
+						int64_t bytes_read = file->read_at(buffer + buffer_offset, bytes_to_read, file_offset + cluster_offset);
+						if (bytes_read < 0) {
+							return io::status_t::STATUS_IO_DEVICE_ERROR;
 						}
+						// A short read might happen when reading the last cluster of the file
+						std::fill_n(buffer + buffer_offset + bytes_read, bytes_to_read - bytes_read, 0);
 					}
 				}
 				bytes_left -= bytes_to_read;
@@ -1499,10 +1497,34 @@ namespace fatx {
 		return io::status_t::STATUS_SUCCESS;
 	}
 
+	void
+	driver::write_raw_fat(uint64_t fat_offset, uint32_t size, const char *buffer)
+	{
+		// The FAT is only written back from m_fat, so the guest writes must go there too, otherwise they would be lost at the next write-back. Then, the
+		// entries that were written are reloaded in the free clusters bitmap, which also tracks the change in the number of free clusters
+		std::copy_n(buffer, size, (char *)m_fat.get() + fat_offset);
+
+		uint64_t num_of_free = m_free_clusters.count_free();
+		uint32_t first_cluster = fat_offset_to_cluster(fat_offset);
+		uint32_t last_cluster = fat_offset_to_cluster(fat_offset + size - 1);
+		for (uint32_t cluster = first_cluster; cluster <= last_cluster; ++cluster) {
+			if (get_fat_entry(cluster) == FATX32_CLUSTER_FREE) {
+				m_free_clusters.set_free(cluster - 1);
+			} else {
+				m_free_clusters.set_used(cluster - 1);
+			}
+		}
+		m_cluster_free_num = m_cluster_free_num + m_free_clusters.count_free() - num_of_free;
+
+		for (uint64_t page = fat_offset >> FAT_PAGE_SHIFT, last_page = (fat_offset + size - 1) >> FAT_PAGE_SHIFT; page <= last_page; ++page) {
+			m_fat_dirty[page >> 6] |= (1ULL << (page & 63));
+		}
+	}
+
 	io::status_t
 	driver::write_raw_partition(uint64_t offset, uint32_t size, const char *buffer)
 	{
-		if (m_pt_num == DEV_PARTITION0) {
+		if ((m_pt_num == DEV_PARTITION0) || (offset < m_metadata_fat_sizes)) {
 			uint64_t actual_offset = offset;
 			if (m_pt_num == DEV_PARTITION0) {
 				assert((offset + size) <= (XBOX_CONFIG_AREA_LBA_SIZE * XBOX_HDD_SECTOR_SIZE));
@@ -1510,13 +1532,26 @@ namespace fatx {
 			else {
 				actual_offset += sizeof(USER_DATA_AREA);
 			}
-			m_pt_fs.seekg(actual_offset, m_pt_fs.beg);
-			m_pt_fs.write(buffer, size);
-			if (!m_pt_fs.good()) {
-				m_pt_fs.clear();
-				return io::status_t::STATUS_IO_DEVICE_ERROR;
+			// Same as read_raw_partition, the part of the write that falls in the FAT goes to m_fat instead of metadata.bin
+			uint64_t fat_start = actual_offset, fat_end = actual_offset;
+			if (m_pt_num != DEV_PARTITION0) {
+				fat_start = std::clamp(actual_offset, (uint64_t)METADATA_FAT_OFFSET, METADATA_FAT_OFFSET + m_metadata_fat_sizes);
+				fat_end = std::clamp(actual_offset + size, fat_start, METADATA_FAT_OFFSET + m_metadata_fat_sizes);
+			}
+			for (auto [start, end] : { std::pair{ actual_offset, fat_start }, std::pair{ fat_end, actual_offset + size } }) {
+				if (start < end) {
+					m_pt_fs.seekp(start, m_pt_fs.beg);
+					m_pt_fs.write(buffer + (start - actual_offset), end - start);
+					if (!m_pt_fs.good()) {
+						m_pt_fs.clear();
+						return io::status_t::STATUS_IO_DEVICE_ERROR;
+					}
+				}
+			}
+			if (fat_start < fat_end) {
+				write_raw_fat(fat_start - METADATA_FAT_OFFSET, fat_end - fat_start, buffer + (fat_start - actual_offset));
 			}
-			if (util::in_range(offset, (uint64_t)0, (uint64_t)sizeof(XBOX_PARTITION_TABLE) - 1)) {
+			if ((m_pt_num == DEV_PARTITION0) && util::in_range(offset, (uint64_t)0, (uint64_t)sizeof(XBOX_PARTITION_TABLE) - 1)) {
 				// If we have written to the partition table, reload our copy of it. We don't reformat all partitions because we expect the homebrew to do it
 				m_pt_fs.seekg(0, m_pt_fs.beg);
 				m_pt_fs.read((char *)&g_current_partition_table, sizeof(XBOX_PARTITION_TABLE));
@@ -1524,6 +1559,18 @@ namespace fatx {
 					m_pt_fs.clear();
 					return io::status_t::STATUS_IO_DEVICE_ERROR;
 				}
+			} else if ((m_pt_num != DEV_PARTITION0) && util::in_range(offset, (uint64_t)0, (uint64_t)sizeof(SUPERBLOCK) - 1)) {
+				// If we have written to the superblock, reformat the partition
+				std::fstream fs0(emu_path::g_hdd_dir / "Partition0.bin");
+				fs0.seekg(0, fs0.beg);
+				fs0.read((char *)&g_current_partition_table, sizeof(XBOX_PARTITION_TABLE));
+				if (!fs0.good()) {
+					for (unsigned i = DEV_PARTITION0; i < DEV_PARTITION6; ++i) {
+						get(i).metadata_set_corrupted_state();
+					}
+					return io::status_t::STATUS_IO_DEVICE_ERROR;
+				}
+				format_partition(buffer, offset, sizeof(SUPERBLOCK) - offset);
 			}
 		}
 		else {
@@ -1573,13 +1620,11 @@ namespace fatx {
 					assert(IS_HDD_HANDLE(m_pt_num)); // only device supported right now
 					std::filesystem::path file_path(emu_path::g_hdd_dir);
 					file_path = combine_file_paths(file_path, info_entry.path);
-					if (auto opt = open_file(file_path); !opt) {
+					if (native_file_cache::file_ptr file = g_native_file_cache.acquire(file_path); !file) {
 						return io::status_t::STATUS_IO_DEVICE_ERROR;
 					} else {
 						uint64_t file_offset = (uint64_t)info_entry.cluster << cluster_shift1;
-						opt->seekp(file_offset + cluster_offset, m_pt_fs.beg);
-						opt->write(buffer + buffer_offset, bytes_to_write);
-						if (!opt->good()) {
+						if (file->write_at(buffer + buffer_offset, bytes_to_write, file_offset + cluster_offset) != bytes_to_write) {
 							return io::status_t::STATUS_IO_DEVICE_ERROR;
 						}
 					}
@@ -1589,20 +1634,6 @@ namespace fatx {
 				cluster_offset = 0;
 				++cluster;
 			}
-
-			if (util::in_range(offset, (uint64_t)0, (uint64_t)sizeof(SUPERBLOCK) - 1)) {
-				// If we have written to the superblock, reformat the partition
-				std::fstream fs0(emu_path::g_hdd_dir / "Partition0.bin");
-				fs0.seekg(0, fs0.beg);
-				fs0.read((char *)&g_current_partition_table, sizeof(XBOX_PARTITION_TABLE));
-				if (!fs0.good()) {
-					for (unsigned i = DEV_PARTITION0; i < DEV_PARTITION6; ++i) {
-						get(i).metadata_set_corrupted_state();
-					}
-					return io::status_t::STATUS_IO_DEVICE_ERROR;
-				}
-				format_partition(buffer, offset, sizeof(SUPERBLOCK) - offset);
-			}
 		}
 
 		return io::status_t::STATUS_SUCCESS;
@@ -1629,6 +1660,7 @@ namespace fatx {
 	driver::flush_metadata_file()
 	{
 		if (m_pt_num != DEV_PARTITION0) {
+			write_back_fat_sync();
 			if (m_metadata_is_corrupted == false) {
 				USER_DATA_AREA user_area;
 				std::fill_n((char *)&user_area, sizeof(USER_DATA_AREA), 0);
@@ -1652,6 +1684,14 @@ namespace fatx {
 		}
 	}
 
+	void
+	driver::write_back()
+	{
+		for (unsigned i = DEV_PARTITION1; i < DEV_PARTITION6; ++i) {
+			get(i).write_back_fat();
+		}
+	}
+
 	bool
 	driver::init(std::filesystem::path hdd_dir)
 	{
@@ -1672,18 +1712,17 @@ namespace fatx {
 		m_pt_num = partition_num;
 		m_ct_path = partition_dir.string().substr(0, partition_dir.string().length() - 10) + "ClusterTable" + std::to_string(m_pt_num - DEV_PARTITION0) + ".bin";
 		std::filesystem::path partition_bin = partition_dir.string() + ".bin";
+		m_pt_path = partition_bin;
 		if (!file_exists(partition_bin) || ((partition_num != DEV_PARTITION0) && !file_exists(m_ct_path))) {
 			if (auto opt_metadata = create_file(partition_bin); !opt_metadata) {
 				return false;
 			} else {
 				m_pt_fs = std::move(*opt_metadata);
 				if (m_pt_num != DEV_PARTITION0) {
-					if (auto opt_table = create_file(m_ct_path); !opt_table) {
+					if (!create_file(m_ct_path)) {
 						return false;
-					} else {
-						m_ct_fs = std::move(*opt_table);
-						return format_partition();
 					}
+					return format_partition();
 				}
 				std::error_code ec;
 				std::filesystem::resize_file(partition_bin, 512 * 1024, ec);
@@ -1703,7 +1742,7 @@ namespace fatx {
 				if (auto opt_metadata = open_file(partition_bin); !opt_metadata) {
 					return false;
 				} else {
-					if (auto opt_table = open_file(m_ct_path); !opt_table) {
+					if (!g_native_file_cache.acquire(m_ct_path)) {
 						return false;
 					} else {
 						std::error_code ec1, ec2;
@@ -1719,15 +1758,13 @@ namespace fatx {
 						if (!m_pt_fs.good()) {
 							return false;
 						}
-						m_ct_fs = std::move(*opt_table);
 						PUSER_DATA_AREA user_area = (PUSER_DATA_AREA)buffer;
 						if (user_area->is_corrupted || (user_area->version != METADATA_VERSION_NUM)) {
-							if (opt_metadata = create_file(partition_bin), opt_table = create_file(m_ct_path); !opt_metadata || !opt_table) {
+							if (opt_metadata = create_file(partition_bin); !opt_metadata || !create_file(m_ct_path)) {
 								return false;
 							} else {
 								std::copy_n(&g_hdd_partitiong_table.table_entries[m_pt_num - DEV_PARTITION0 - 1], 1, &g_current_partition_table.table_entries[m_pt_num - DEV_PARTITION0 - 1]);
 								m_pt_fs = std::move(*opt_metadata);
-								m_ct_fs = std::move(*opt_table);
 								return format_partition();
 							}
 						}
@@ -1828,7 +1865,7 @@ namespace fatx {
 			}
 		}
 		catch (const std::filesystem::filesystem_error &err) {
-			logger_mod_en(warn, io, "Failed to iterate through directory %s, the error was %s", err.path1(), err.what());
+			logger_mod_en(warn, io, "Failed to iterate through directory %s, the error was %s", err.path1().string().c_str(), err.what());
 		}
 	}
 
@@ -6,8 +6,11 @@
 
 #include "files.hpp"
 #include "io.hpp"
+#include "cluster_bitmap.hpp"
 #include <unordered_map>
 #include <vector>
+#include <memory>
+#include <atomic>
 #include <assert.h>
 
 #define FATX_MAX_FILE_LENGTH 42
@@ -79,6 +82,7 @@ namespace fatx {
 		void operator=(driver const &) = delete;
 		static bool init(std::filesystem::path hdd_dir);
 		static void flush();
+		static void write_back();
 		void flush_dirent_for_file(DIRENT &io_dirent, uint64_t dirent_offset);
 		uint64_t get_free_cluster_num();
 		io::status_t find_dirent_for_file(std::string_view remaining_path, DIRENT &io_dirent, uint64_t &dirent_offset);
@@ -119,6 +123,17 @@ namespace fatx {
 		bool create_root_dirent();
 		bool setup_cluster_info(std::filesystem::path partition_dir);
 		bool is_name_valid(const std::string name) const;
+		template<typename T>
+		uint32_t get_fat_entry(uint32_t cluster) const;
+		template<typename T>
+		void set_fat_entry(uint32_t cluster, uint32_t value);
+		uint32_t get_fat_entry(uint32_t cluster) const;
+		void set_fat_entry(uint32_t cluster, uint32_t value);
+		void write_raw_fat(uint64_t fat_offset, uint32_t size, const char *buffer);
+		void write_back_fat();
+		void write_back_fat_sync();
+		void wait_for_fat_write_back();
+		static void fat_write_back_done(void *opaque, int64_t result);
 
 		unsigned m_pt_num;
 		uint64_t m_metadata_file_size;
@@ -135,8 +150,14 @@ namespace fatx {
 		bool m_last_free_dirent_is_on_boundary;
 		bool m_metadata_is_corrupted;
 		std::fstream m_pt_fs; // fs of partition file
-		std::fstream m_ct_fs; // fs of cluster table file
-		std::filesystem::path m_ct_path;
+		std::filesystem::path m_ct_path; // cluster table file, accessed through g_native_file_cache
+		std::filesystem::path m_pt_path;
+		native_file m_pt_file; // partition file used by the FAT write-back, which doesn't go through m_pt_fs
+		std::unique_ptr<uint8_t[]> m_fat; // the whole FAT of the partition, with 16 or 32 bit entries depending on IS_FATX16()
+		std::vector<uint64_t> m_fat_dirty; // one bit for each page of m_fat that was changed but not yet written back
+		cluster_bitmap m_free_clusters; // free clusters of m_fat, kept in sync by set_fat_entry
+		std::atomic_bool m_fat_write_back_in_flight;
+		std::atomic_bool m_fat_write_back_failed;
 		std::unordered_map<uint32_t, CLUSTER_INFO_ENTRY> m_cluster_map;
 
 		// NOTE: these constants are defined in the kernel
@@ -8,11 +8,17 @@
 #include "logger.hpp"
 #include <utility>
 #include <cstring>
+#include <vector>
+#include <unordered_set>
+#include <algorithm>
 
 #define SECTOR_SIZE 2048
 #define ROOT_DIR_SECTOR 32
 #define GAME_PARTITION_OFFSET (SECTOR_SIZE * ROOT_DIR_SECTOR * 6192)
 #define FILE_DIRECTORY 0x10
+#define DIRENT_PADDING 0xFFFF // left_idx/right_idx of a dirent made of padding bytes, as found in empty directories
+#define SEQUENTIAL_READ_THRESHOLD (256 * 1024) // reads at least this big are assumed to stream a file, and get read-ahead on the mapping
+#define MAX_DIRECTORY_DEPTH 128 // xbox paths are at most 255 chars long, so no valid xiso has directories nested deeper than this
 
 
 namespace xdvdfs {
@@ -60,22 +66,43 @@ namespace xdvdfs {
 					(volume_desc->root_dirent_file_size))
 				{
 					m_root_dirent_first_sector = volume_desc->m_root_dirent_first_sector;
+					m_root_dirent_file_size = volume_desc->root_dirent_file_size;
+					m_xiso_timestamp = volume_desc->timestamp;
+					m_xiso_offset = offset;
 					m_xiso_fs = std::move(*opt);
-					m_xiso_name = offset;
 					m_xiso_name = std::filesystem::path(arg_str).filename().string();
 					return true;
 				}
 				return false;
 				};
 
+			const auto map_image = [&]() {
+				// Dirents and small files are read at random places, so don't waste read-ahead on them. Large file reads ask for it explicitly in read_image
+				if (m_xiso_map.map(arg_str)) {
+					m_xiso_map.advise(0, m_xiso_map.size(), mapped_file::advice_t::random);
+					logger("Using memory mapped xiso file");
+				} else {
+					logger("Failed to map xiso file, falling back to file stream");
+				}
+				};
+
+			bool is_xiso = false;
 			if (validate_image(0)) {
 				logger("Detected scrubbed xiso file");
-				return true;
+				is_xiso = true;
 			}
-
-			if (validate_image(GAME_PARTITION_OFFSET)) {
+			else if (validate_image(GAME_PARTITION_OFFSET)) {
 				logger("Detected redump xiso file");
-				return true;
+				is_xiso = true;
+			}
+
+			if (is_xiso) {
+				map_image();
+				if (build_index()) {
+					return true;
+				}
+				logger("The dirent trees of the xiso file are corrupted");
+				m_xiso_fs.close();
 			}
 		}
 		else {
@@ -83,22 +110,51 @@ namespace xdvdfs {
 		}
 
 		m_xiso_name = "";
+		m_xiso_map.unmap();
+		m_index.clear();
 
 		return false;
 	}
 
+	int64_t
+	driver::read_image(uint64_t offset, uint32_t size, char *buffer)
+	{
+		// offset is from the start of the image file. This returns the number of bytes read, which is less than size when the read goes past the end of the
+		// image (scrubbed images can be truncated), or -1 on failure
+		if (m_xiso_map.is_mapped()) {
+			if (offset >= m_xiso_map.size()) {
+				return 0;
+			}
+			uint32_t bytes_to_read = (uint32_t)std::min<uint64_t>(size, m_xiso_map.size() - offset);
+			if (bytes_to_read >= SEQUENTIAL_READ_THRESHOLD) {
+				m_xiso_map.advise(offset, bytes_to_read, mapped_file::advice_t::sequential);
+				m_xiso_map.advise(offset, bytes_to_read, mapped_file::advice_t::willneed);
+			}
+			std::memcpy(buffer, m_xiso_map.data() + offset, bytes_to_read);
+			return bytes_to_read;
+		}
+
+		m_xiso_fs.seekg(offset, m_xiso_fs.beg);
+		m_xiso_fs.read(buffer, size);
+		if (m_xiso_fs.good() || m_xiso_fs.eof()) {
+			int64_t bytes_read = m_xiso_fs.gcount();
+			m_xiso_fs.clear();
+			return bytes_read;
+		}
+		m_xiso_fs.clear();
+		return -1;
+	}
+
 	bool
 	driver::read_dirent(file_entry_t &file_entry, uint64_t sector, uint64_t offset)
 	{
 		char buff[SECTOR_SIZE];
-		m_xiso_fs.seekg(SECTOR_SIZE * sector + m_xiso_offset + offset);
-		m_xiso_fs.read(buff, 255 + sizeof(dirent_t) - 1);
-		if (!m_xiso_fs.good()) {
-			m_xiso_fs.clear();
+		int64_t bytes_read = read_image(SECTOR_SIZE * sector + m_xiso_offset + offset, 255 + sizeof(dirent_t) - 1, buff);
+		dirent_t *dirent = (dirent_t *)buff;
+		if ((bytes_read < (int64_t)(sizeof(dirent_t) - 1)) || (bytes_read < (int64_t)(sizeof(dirent_t) - 1 + dirent->file_name_length))) {
 			return false;
 		}
-		
-		dirent_t *dirent = (dirent_t *)buff;
+
 		file_entry.left_idx = dirent->left_idx;
 		file_entry.right_idx = dirent->right_idx;
 		file_entry.file_sector = dirent->file_sector;
@@ -110,8 +166,116 @@ namespace xdvdfs {
 		return true;
 	}
 
+	static std::string
+	to_index_key(std::string_view path)
+	{
+		std::string key(path);
+		std::transform(key.begin(), key.end(), key.begin(), util::xbox_toupper);
+		return key;
+	}
+
+	bool
+	driver::build_index()
+	{
+		// Walks all the dirent trees of the xiso once, so that search_file doesn't need to touch the image anymore. If this fails, the image is rejected.
+		// A directory can point to the sector of one of its parents on a corrupted image, which would nest it forever, so every directory sector is only
+		// walked once, and the nesting is limited to MAX_DIRECTORY_DEPTH
+		struct dir_to_visit_t {
+			uint32_t sector;
+			uint32_t size;
+			uint32_t depth; // zero for the root
+			std::string path; // path of the directory, with a trailing '/' unless it's the root
+		};
+
+		m_index.clear();
+		std::vector<dir_to_visit_t> dirs_to_visit{ { m_root_dirent_first_sector, m_root_dirent_file_size, 0, "" } };
+		std::vector<uint64_t> dirents_to_visit;
+		std::unordered_set<uint32_t> visited_sectors;
+		file_entry_t file_entry;
+		while (!dirs_to_visit.empty()) {
+			dir_to_visit_t dir = std::move(dirs_to_visit.back());
+			dirs_to_visit.pop_back();
+			if (dir.size == 0) {
+				continue; // empty directory
+			}
+			if (dir.depth > MAX_DIRECTORY_DEPTH) {
+				logger_mod_en(error, io, "Xiso directory \"%s\" is nested more than %u levels deep", dir.path.c_str(), MAX_DIRECTORY_DEPTH);
+				m_index.clear();
+				return false;
+			}
+			if (visited_sectors.insert(dir.sector).second == false) {
+				logger_mod_en(error, io, "Xiso directory \"%s\" at sector 0x%08" PRIX32 " was already visited", dir.path.c_str(), dir.sector);
+				m_index.clear();
+				return false;
+			}
+
+			dirents_to_visit.push_back(0);
+			while (!dirents_to_visit.empty()) {
+				uint64_t offset = dirents_to_visit.back();
+				dirents_to_visit.pop_back();
+				if (read_dirent(file_entry, dir.sector, offset) == false) {
+					logger_mod_en(error, io, "Failed to read xiso dirent at sector 0x%08" PRIX32 " and offset 0x%016" PRIX64 " while building the index", dir.sector, offset);
+					m_index.clear();
+					return false;
+				}
+				if ((file_entry.left_idx == DIRENT_PADDING) && (file_entry.right_idx == DIRENT_PADDING)) {
+					continue;
+				}
+
+				// Same checks done by search_file_on_disc, to prevent infinite loops on corrupted images
+				for (uint64_t new_offset : { (uint64_t)file_entry.left_idx << 2, (uint64_t)file_entry.right_idx << 2 }) {
+					if ((new_offset > offset) && (new_offset < dir.size)) {
+						dirents_to_visit.push_back(new_offset);
+					}
+				}
+
+				std::string path = dir.path + file_entry.file_name;
+				auto [it, inserted] = m_index.emplace(to_index_key(path), index_entry_t{ file_entry.file_sector, file_entry.file_size, file_entry.attributes });
+				if (inserted && (file_entry.attributes & FILE_DIRECTORY)) {
+					dirs_to_visit.emplace_back(file_entry.file_sector, file_entry.file_size, dir.depth + 1, std::move(path) + '/');
+				}
+			}
+		}
+
+		logger_mod_en(info, io, "Built xiso index with %zu entries", m_index.size());
+		return true;
+	}
+
 	file_info_t
 	driver::search_file(std::string_view arg_str)
+	{
+		if (m_index.empty()) [[unlikely]] {
+			return search_file_on_disc(arg_str);
+		}
+
+		if (arg_str.empty()) {
+			// special case: open the root directory of the dvd
+			return file_info_t
+			{
+				.exists = true,
+				.is_directory = true,
+				.offset = m_xiso_offset,
+				.size = 0,
+				.timestamp = m_xiso_timestamp
+			};
+		}
+
+		if (auto it = m_index.find(to_index_key(arg_str)); it != m_index.end()) {
+			return file_info_t
+			{
+				.exists = true,
+				.is_directory = (bool)(it->second.attributes & FILE_DIRECTORY),
+				.offset = (uint64_t)it->second.file_sector * SECTOR_SIZE + m_xiso_offset,
+				.size = it->second.file_size,
+				.timestamp = m_xiso_timestamp
+			};
+		}
+
+		return file_info_t{ .exists = false };
+	}
+
+	file_info_t
+	driver::search_file_on_disc(std::string_view arg_str)
 	{
 		if (arg_str.empty()) {
 			// special case: open the root directory of the dvd
@@ -163,7 +327,7 @@ namespace xdvdfs {
 						{
 							.exists = true,
 							.is_directory = (bool)(file_entry.attributes & FILE_DIRECTORY),
-							.offset = file_entry.file_sector * SECTOR_SIZE + m_xiso_offset,
+							.offset = (uint64_t)file_entry.file_sector * SECTOR_SIZE + m_xiso_offset,
 							.size = file_entry.file_size,
 							.timestamp = m_xiso_timestamp
 						};
@@ -186,8 +350,6 @@ namespace xdvdfs {
 	io::status_t
 	driver::read_raw_disc(uint64_t offset, uint32_t size, char *buffer)
 	{
-		m_xiso_fs.seekg(offset, m_xiso_fs.beg);
-		m_xiso_fs.read(buffer, size);
-		return m_xiso_fs.good() ? io::status_t::STATUS_SUCCESS : io::status_t::STATUS_IO_DEVICE_ERROR;
+		return (read_image(offset, size, buffer) == size) ? io::status_t::STATUS_SUCCESS : io::status_t::STATUS_IO_DEVICE_ERROR;
 	}
 }
@@ -5,8 +5,10 @@
 #pragma once
 
 #include "io.hpp"
+#include "files.hpp"
 #include <filesystem>
 #include <fstream>
+#include <unordered_map>
 
 
 namespace xdvdfs {
@@ -27,6 +29,12 @@ namespace xdvdfs {
 		char file_name[256]; // name of the file pointed by the current dirent
 	};
 
+	struct index_entry_t {
+		uint32_t file_sector; // sector number of the file
+		uint32_t file_size; // file size
+		uint8_t attributes; // file attributes
+	};
+
 	class driver {
 	public:
 		static driver &get()
@@ -39,16 +47,25 @@ namespace xdvdfs {
 		bool validate(std::string_view arg_str);
 		file_info_t search_file(std::string_view arg_str);
 		io::status_t read_raw_disc(uint64_t offset, uint32_t size, char *buffer);
+		int64_t read_image(uint64_t offset, uint32_t size, char *buffer);
+		bool is_mapped() const { return m_xiso_map.is_mapped(); }
 
-		std::fstream m_xiso_fs; // fs of xiso image file
+		std::fstream m_xiso_fs; // fs of xiso image file, only used when the image couldn't be mapped
 		uint64_t m_xiso_offset; // offset to add to reach the game partition
 		std::string m_xiso_name;
 
 	private:
 		driver() {};
 		bool read_dirent(file_entry_t &file_entry, uint64_t sector, uint64_t offset);
+		bool build_index();
+		file_info_t search_file_on_disc(std::string_view arg_str);
+
+		mapped_file m_xiso_map; // mapping of xiso image file
 
 		uint32_t m_root_dirent_first_sector;
+		uint32_t m_root_dirent_file_size;
+		// Maps the full path of every file and directory in the xiso, uppercased with util::xbox_toupper, to its dirent. Empty if it couldn't be built
+		std::unordered_map<std::string, index_entry_t> m_index;
 		int64_t m_xiso_timestamp; // global timestamp of xiso image
 	};
 }
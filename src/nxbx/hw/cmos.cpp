@@ -66,6 +66,7 @@ private:
 	uint64_t m_last_clock; // The last time the seconds counter rolled over
 	uint64_t m_lost_ticks; // expressed in us
 	uint64_t m_lost_us;
+	uint32_t m_update_event;
 	std::time_t m_sys_time; // actual real time wall clock of the host
 	int64_t m_sys_time_bias; // difference between guest and host clocks
 	// connected devices
@@ -395,7 +396,7 @@ void cmos::Impl::update_timer()
 	}
 
 	if ((old_int_state ^ m_int_running) | (old_clock_state ^ m_clock_running)) {
-		cpu_set_timeout(m_lc86cpu, m_cpu->checkPeriodicEvents(now));
+		m_cpu->updateTimedEvent(m_update_event, now);
 	}
 }
 
@@ -523,6 +524,7 @@ void cmos::Impl::init(machine *machine)
 	m_lc86cpu = machine->get86cpu();
 	m_cpu = machine->getCpu();
 	m_machine = machine;
+	m_update_event = m_cpu->addTimedEvent(cpu_timed_event<cmos::Impl, &cmos::Impl::getNextUpdateTime>, this);
 	updateIo(false);
 
 	m_ram[0x0A] = 0x26;
@@ -536,6 +538,7 @@ void cmos::Impl::init(machine *machine)
 	m_last_int = m_last_clock = timer::get_now();
 	m_sys_time_bias = get_settings()->get_int64_value("core", "sys_time_bias");
 	m_sys_time = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now()) + m_sys_time_bias;
+	m_cpu->updateTimedEvent(m_update_event, m_last_clock);
 }
 
 void cmos::Impl::deinit()
@@ -564,10 +567,5 @@ void cmos::updateIoLogging()
 	m_impl->updateIoLogging();
 }
 
-uint64_t cmos::getNextUpdateTime(uint64_t now)
-{
-	return m_impl->getNextUpdateTime(now);
-}
-
 cmos::cmos() : m_impl{std::make_unique<cmos::Impl>()} {}
 cmos::~cmos() {}
@@ -19,7 +19,6 @@ public:
 	void deinit();
 	void reset();
 	void updateIoLogging();
-	uint64_t getNextUpdateTime(uint64_t now);
 
 private:
 	class Impl;
@@ -11,12 +11,7 @@
 #include "isettings.hpp"
 #include "paths.hpp"
 #include "cpu.hpp"
-#include "pit.hpp"
-#include "cmos.hpp"
-#include "usb/ohci.hpp"
-#include "video/gpu/nv2a.hpp"
-#include "video/gpu/ptimer.hpp"
-#include "video/gpu/pcrtc.hpp"
+#include "video/gpu/nv2a_defs.hpp"
 #include <fstream>
 #include <cinttypes>
 #include <cstring>
@@ -34,25 +29,23 @@ public:
 	void start();
 	void exit();
 	void updateIoLogging() { updateIo(true); }
-	uint64_t checkPeriodicEvents(uint64_t now);
+	uint32_t addTimedEvent(scheduler::callback_t callback, void *opaque) { return m_scheduler.add(callback, opaque); }
+	void updateTimedEvent(uint32_t event, uint64_t now);
 	cpu_t *get86cpu() { return m_lc86cpu; }
 	uint32_t getRamsize() { return m_ramsize; }
 
 private:
+	void initMemory(const boot_params &params);
 	void updateIo(bool is_update);
-	uint64_t checkPeriodicEvents();
 	static void cpu_logger(log_level lv, const unsigned count, const char *msg, ...);
 
 	uint32_t m_ramsize;
 	bool m_is_dbg_present;
 	// connected devices
 	pic *m_pic;
-	pit *m_pit;
-	cmos *m_cmos;
-	ptimer *m_ptimer;
-	pcrtc *m_pcrtc;
-	usb0 *m_usb0;
 	cpu_t *m_lc86cpu;
+	// timed events of the devices
+	scheduler m_scheduler;
 };	
 
 static consteval bool check_cpu_log_lv()
@@ -93,13 +86,14 @@ void cpu::Impl::reset()
 void cpu::Impl::init(const boot_params &params, machine *machine)
 {
 	m_pic = machine->getPic(0);
-	m_pit = machine->getPit();
-	m_cmos = machine->getCmos();
-	m_ptimer = machine->getGpu()->getPtimer();
-	m_pcrtc = machine->getGpu()->getPcrtc();
-	m_usb0 = machine->getUsb(0);
 	m_ramsize = params.console_type == console_t::xbox ? RAM_SIZE64 : RAM_SIZE128;
 
+	if (!params.load_kernel) {
+		// The devices are driven by the host only (like in nxbx-gpureplay), so no guest code will run
+		initMemory(params);
+		return;
+	}
+
 	// Load the nboxkrnl exe file
 	std::ifstream ifs(emu_path::g_krnl_path.c_str(), std::ios_base::in | std::ios_base::binary);
 	if (!ifs.is_open()) {
@@ -141,29 +135,7 @@ void cpu::Impl::init(const boot_params &params, machine *machine)
 		throw std::runtime_error(lv2str(highest, "Kernel image has an incorrect image base address"));
 	}
 
-	// Init lib86cpu
-	if (!LC86_SUCCESS(cpu_new(m_ramsize, m_lc86cpu))) {
-		throw std::runtime_error(lv2str(highest, "Failed to create cpu instance"));
-	}
-
-	register_log_func(cpu_logger);
-
-	m_is_dbg_present = params.use_dbg;
-	cpu_set_flags(m_lc86cpu, static_cast<uint32_t>(params.syntax) | (m_is_dbg_present ? CPU_DBG_PRESENT : 0));
-
-	if (!LC86_SUCCESS(mem_init_region_ram(m_lc86cpu, 0, m_ramsize))) {
-		throw std::runtime_error(lv2str(highest, "Failed to initialize ram memory"));
-	}
-
-	if (!LC86_SUCCESS(mem_init_region_alias(m_lc86cpu, CONTIGUOUS_MEMORY_BASE, 0, m_ramsize))) {
-		throw std::runtime_error(lv2str(highest, "Failed to initialize contiguous memory"));
-	}
-
-	if (!LC86_SUCCESS(mem_init_region_alias(m_lc86cpu, NV2A_VRAM_BASE, 0, m_ramsize))) {
-		throw std::runtime_error(lv2str(highest, "Failed to initialize vram memory for nv2a"));
-	}
-
-	updateIo(false);
+	initMemory(params);
 
 	// Load kernel exe into ram
 	uint8_t *ram = get_ram_ptr(m_lc86cpu);
@@ -327,21 +299,39 @@ void cpu::Impl::init(const boot_params &params, machine *machine)
 	}
 }
 
-uint64_t cpu::Impl::checkPeriodicEvents(uint64_t now)
+void cpu::Impl::initMemory(const boot_params &params)
 {
-	std::array<uint64_t, 5> dev_timeout;
-	dev_timeout[0] = m_pit->getNextIrqTime(now);
-	dev_timeout[1] = m_cmos->getNextUpdateTime(now);
-	dev_timeout[2] = m_ptimer->getNextAlarmTime(now);
-	dev_timeout[3] = m_pcrtc->getNextVblankTime(now);
-	dev_timeout[4] = m_usb0->getNextUpdateTime(now);
-
-	return *std::min_element(dev_timeout.begin(), dev_timeout.end());
+	// Init lib86cpu
+	if (!LC86_SUCCESS(cpu_new(m_ramsize, m_lc86cpu))) {
+		throw std::runtime_error(lv2str(highest, "Failed to create cpu instance"));
+	}
+
+	register_log_func(cpu_logger);
+
+	m_is_dbg_present = params.use_dbg;
+	cpu_set_flags(m_lc86cpu, static_cast<uint32_t>(params.syntax) | (m_is_dbg_present ? CPU_DBG_PRESENT : 0));
+
+	if (!LC86_SUCCESS(mem_init_region_ram(m_lc86cpu, 0, m_ramsize))) {
+		throw std::runtime_error(lv2str(highest, "Failed to initialize ram memory"));
+	}
+
+	if (!LC86_SUCCESS(mem_init_region_alias(m_lc86cpu, CONTIGUOUS_MEMORY_BASE, 0, m_ramsize))) {
+		throw std::runtime_error(lv2str(highest, "Failed to initialize contiguous memory"));
+	}
+
+	if (!LC86_SUCCESS(mem_init_region_alias(m_lc86cpu, NV2A_VRAM_BASE, 0, m_ramsize))) {
+		throw std::runtime_error(lv2str(highest, "Failed to initialize vram memory for nv2a"));
+	}
+
+	updateIo(false);
 }
 
-uint64_t cpu::Impl::checkPeriodicEvents()
+void cpu::Impl::updateTimedEvent(uint32_t event, uint64_t now)
 {
-	return checkPeriodicEvents(timer::get_now());
+	// The current timeout is still good if the earliest deadline didn't change
+	if (m_scheduler.update(event, now)) {
+		cpu_set_timeout(m_lc86cpu, m_scheduler.getTimeout(now));
+	}
 }
 
 void cpu::Impl::start()
@@ -350,7 +340,7 @@ void cpu::Impl::start()
 
 	lc86_status code;
 	while (true) {
-		code = cpu_run_until(m_lc86cpu, checkPeriodicEvents());
+		code = cpu_run_until(m_lc86cpu, m_scheduler.run(timer::get_now()));
 		if (code != lc86_status::timeout) [[unlikely]] {
 			break;
 		}
@@ -457,9 +447,14 @@ uint32_t cpu::getRamsize()
 	return m_impl->getRamsize();
 }
 
-uint64_t cpu::checkPeriodicEvents(uint64_t now)
+uint32_t cpu::addTimedEvent(scheduler::callback_t callback, void *opaque)
+{
+	return m_impl->addTimedEvent(callback, opaque);
+}
+
+void cpu::updateTimedEvent(uint32_t event, uint64_t now)
 {
-	return m_impl->checkPeriodicEvents(now);
+	m_impl->updateTimedEvent(event, now);
 }
 
 cpu::cpu() : m_impl{std::make_unique<cpu::Impl>()} {}
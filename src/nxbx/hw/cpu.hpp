@@ -4,6 +4,7 @@
 #pragma once
 
 #include "host.hpp"
+#include "scheduler.hpp"
 #include <memory>
 
 #define RAM_SIZE64 0x4000000 // = 64 MiB
@@ -24,7 +25,8 @@ public:
 	void start();
 	void exit();
 	void updateIoLogging();
-	uint64_t checkPeriodicEvents(uint64_t now);
+	uint32_t addTimedEvent(scheduler::callback_t callback, void *opaque);
+	void updateTimedEvent(uint32_t event, uint64_t now);
 	cpu_t *get86cpu();
 	uint32_t getRamsize();
 
@@ -40,6 +42,13 @@ T cpu_read(uint32_t addr, void *opaque)
 	return (device->*f)(addr - base);
 }
 
+template<typename D, auto f>
+uint64_t cpu_timed_event(void *opaque, uint64_t now)
+{
+	D *device = static_cast<D *>(opaque);
+	return (device->*f)(now);
+}
+
 template<typename D, typename T, auto f, uint32_t base = 0>
 void cpu_write(uint32_t addr, const T value, void *opaque)
 {
@@ -86,7 +86,7 @@ bool machine::Impl::init(const boot_params &params, machine *machine)
 		m_cmos->init(machine);
 		m_pci->init(machine);
 		m_nv2a->init(machine);
-		m_vga->init(m_cpu.get(), m_nv2a.get());
+		m_vga->init(get_ram_ptr(m_cpu->get86cpu()), m_cpu->getRamsize());
 		m_smbus->init(machine);
 		m_eeprom->init(machine, log_module::eeprom);
 		m_smc->init(machine, log_module::smc);
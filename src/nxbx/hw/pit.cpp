@@ -42,6 +42,7 @@ private:
 	void channelReset(uint8_t channel);
 
 	PitChannel m_chan[3];
+	uint32_t m_irq_event;
 	// NOTE: on the xbox, the pit frequency is 6% lower than the default one, see https://xboxdevwiki.net/Porting_an_Operating_System_to_the_Xbox_HOWTO#Timer_Frequency
 	static constexpr uint64_t clock_freq = 1125000;
 	// connected devices
@@ -83,7 +84,7 @@ void pit::Impl::startTimer(uint8_t channel)
 {
 	m_chan[channel].last_irq_time = timer::get_now();
 	m_chan[channel].timer_running = 1;
-	cpu_set_timeout(m_lc86cpu, m_cpu->checkPeriodicEvents(m_chan[channel].last_irq_time));
+	m_cpu->updateTimedEvent(m_irq_event, m_chan[channel].last_irq_time);
 }
 
 template<bool log>
@@ -194,6 +195,7 @@ void pit::Impl::init(machine *machine)
 	m_lc86cpu = machine->get86cpu();
 	m_cpu = machine->getCpu();
 	m_machine = machine;
+	m_irq_event = m_cpu->addTimedEvent(cpu_timed_event<pit::Impl, &pit::Impl::getNextIrqTime>, this);
 	updateIo(false);
 	reset();
 }
@@ -214,10 +216,5 @@ void pit::updateIoLogging()
 	m_impl->updateIoLogging();
 }
 
-uint64_t pit::getNextIrqTime(uint64_t now)
-{
-	return m_impl->getNextIrqTime(now);
-}
-
 pit::pit() : m_impl{std::make_unique<pit::Impl>()} {}
 pit::~pit() {}
@@ -18,7 +18,6 @@ public:
 	void init(machine *machine);
 	void reset();
 	void updateIoLogging();
-	uint64_t getNextIrqTime(uint64_t now);
 
 private:
 	class Impl;
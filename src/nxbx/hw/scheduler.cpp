@@ -0,0 +1,98 @@
+// SPDX-License-Identifier: GPL-3.0-only
+// SPDX-FileCopyrightText: 2026 ergo720
+
+#include "scheduler.hpp"
+#include <algorithm>
+#include <utility>
+
+
+uint32_t scheduler::add(callback_t callback, void *opaque)
+{
+	uint32_t event = m_events.size();
+	m_events.emplace_back(callback, opaque, never, (uint32_t)m_heap.size());
+	m_heap.push_back(event);
+	return event;
+}
+
+void scheduler::swap(uint32_t heap_idx1, uint32_t heap_idx2)
+{
+	std::swap(m_heap[heap_idx1], m_heap[heap_idx2]);
+	m_events[m_heap[heap_idx1]].heap_idx = heap_idx1;
+	m_events[m_heap[heap_idx2]].heap_idx = heap_idx2;
+}
+
+void scheduler::siftUp(uint32_t heap_idx)
+{
+	while (heap_idx) {
+		uint32_t parent = (heap_idx - 1) / 2;
+		if (m_events[m_heap[parent]].deadline <= m_events[m_heap[heap_idx]].deadline) {
+			break;
+		}
+		swap(parent, heap_idx);
+		heap_idx = parent;
+	}
+}
+
+void scheduler::siftDown(uint32_t heap_idx)
+{
+	uint32_t size = m_heap.size();
+	while (true) {
+		uint32_t smallest = heap_idx, left = heap_idx * 2 + 1, right = left + 1;
+		if ((left < size) && (m_events[m_heap[left]].deadline < m_events[m_heap[smallest]].deadline)) {
+			smallest = left;
+		}
+		if ((right < size) && (m_events[m_heap[right]].deadline < m_events[m_heap[smallest]].deadline)) {
+			smallest = right;
+		}
+		if (smallest == heap_idx) {
+			break;
+		}
+		swap(smallest, heap_idx);
+		heap_idx = smallest;
+	}
+}
+
+void scheduler::setDeadline(uint32_t event, uint64_t now, uint64_t timeout)
+{
+	// NOTE: a timeout of zero would make the cpu exit immediately without making progress, so it's treated as the smallest possible one instead
+	uint64_t old_deadline = m_events[event].deadline;
+	uint64_t new_deadline = (timeout == never) ? never : now + std::max(timeout, (uint64_t)1);
+	m_events[event].deadline = new_deadline;
+	if (new_deadline < old_deadline) {
+		siftUp(m_events[event].heap_idx);
+	}
+	else if (new_deadline > old_deadline) {
+		siftDown(m_events[event].heap_idx);
+	}
+}
+
+bool scheduler::update(uint32_t event, uint64_t now)
+{
+	uint64_t old_earliest = m_events[m_heap[0]].deadline;
+	setDeadline(event, now, m_events[event].callback(m_events[event].opaque, now));
+	return m_events[m_heap[0]].deadline != old_earliest;
+}
+
+uint64_t scheduler::run(uint64_t now)
+{
+	// Each due event runs once, and then it's moved to its next deadline, which is always in the future
+	while (!m_heap.empty()) {
+		event_t &event = m_events[m_heap[0]];
+		if (event.deadline > now) {
+			break;
+		}
+		setDeadline(m_heap[0], now, event.callback(event.opaque, now));
+	}
+
+	return getTimeout(now);
+}
+
+uint64_t scheduler::getTimeout(uint64_t now) const
+{
+	if (m_heap.empty() || (m_events[m_heap[0]].deadline == never)) {
+		return never;
+	}
+
+	uint64_t deadline = m_events[m_heap[0]].deadline;
+	return deadline > now ? deadline - now : 1;
+}
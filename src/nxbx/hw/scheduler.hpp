@@ -0,0 +1,41 @@
+// SPDX-License-Identifier: GPL-3.0-only
+// SPDX-FileCopyrightText: 2026 ergo720
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <limits>
+
+
+// Keeps the deadlines of the timed events of the devices in a min-heap, so that when the cpu exits it only needs to look at the events that are due.
+// Devices must update their event when a register write can move its deadline earlier. A stale deadline that is too early is harmless, because the callback
+// then just returns the correct one. All functions must be called from the cpu thread
+class scheduler
+{
+public:
+	// Runs the event if it's due, and returns the time until its next deadline, or never when the event is disabled
+	using callback_t = uint64_t(*)(void *opaque, uint64_t now);
+	static constexpr uint64_t never = std::numeric_limits<uint64_t>::max();
+
+	uint32_t add(callback_t callback, void *opaque);
+	bool update(uint32_t event, uint64_t now); // returns true if the earliest deadline has changed
+	uint64_t run(uint64_t now); // runs all due events, and returns the time until the earliest deadline
+	uint64_t getTimeout(uint64_t now) const;
+
+private:
+	struct event_t {
+		callback_t callback;
+		void *opaque;
+		uint64_t deadline;
+		uint32_t heap_idx;
+	};
+
+	void setDeadline(uint32_t event, uint64_t now, uint64_t timeout);
+	void swap(uint32_t heap_idx1, uint32_t heap_idx2);
+	void siftUp(uint32_t heap_idx);
+	void siftDown(uint32_t heap_idx);
+
+	std::vector<event_t> m_events;
+	std::vector<uint32_t> m_heap; // indices in m_events, earliest deadline first. Disabled events stay in the heap with a deadline of never
+};
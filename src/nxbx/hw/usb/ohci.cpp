@@ -65,8 +65,10 @@ private:
 
 	bool m_frame_running;
 	uint64_t m_sof_time; // time of the sof token, that is, when a new frame starts
+	uint32_t m_frame_event;
 	// connected devices
 	machine *m_machine;
+	cpu *m_cpu;
 	cpu_t *m_lc86cpu;
 	// registers
 	port_status m_port[4];
@@ -271,6 +273,7 @@ void usb0::Impl::update_state(uint32_t value)
 		case state_operational:
 			m_sof_time = timer::get_now();
 			m_frame_running = true;
+			m_cpu->updateTimedEvent(m_frame_event, m_sof_time);
 			REG_USB0(FM_REMAINING) = ((REG_USB0(FM_REMAINING) & FM_REMAINING_FRT) | (REG_USB0(FM_INTERVAL) & FM_INTERVAL_FI));
 			set_int(INT_SF);
 			logger_en(debug, "Operational state");
@@ -375,6 +378,8 @@ void usb0::Impl::init(machine *machine)
 {
 	m_lc86cpu = machine->get86cpu();
 	m_machine = machine;
+	m_cpu = machine->getCpu();
+	m_frame_event = m_cpu->addTimedEvent(cpu_timed_event<usb0::Impl, &usb0::Impl::getNextUpdateTime>, this);
 	updateIo(false);
 	reset();
 }
@@ -395,10 +400,5 @@ void usb0::updateIoLogging()
 	m_impl->updateIoLogging();
 }
 
-uint64_t usb0::getNextUpdateTime(uint64_t now)
-{
-	return m_impl->getNextUpdateTime(now);
-}
-
 usb0::usb0() : m_impl{std::make_unique<usb0::Impl>()} {}
 usb0::~usb0() {}
@@ -17,7 +17,6 @@ public:
 	void init(machine *machine);
 	void reset();
 	void updateIoLogging();
-	uint64_t getNextUpdateTime(uint64_t now);
 
 private:
 	class Impl;
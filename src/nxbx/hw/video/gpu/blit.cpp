@@ -0,0 +1,141 @@
+// SPDX-License-Identifier: GPL-3.0-only
+// SPDX-FileCopyrightText: 2026 ergo720
+
+#include "blit.hpp"
+#include <algorithm>
+#include <cstring>
+#if defined(__x86_64__) || defined(_M_X64)
+#include <emmintrin.h>
+#define BLIT_HAS_SSE2
+#endif
+
+#define BLIT_NT_THRESHOLD (1024 * 1024) // copies at least this big (in bytes) use non-temporal stores
+
+
+template<typename T>
+static void
+blit_row_masked(uint8_t *dst, const uint8_t *src, uint32_t row_size, T and_mask, T or_mask)
+{
+	// When dst is after src in memory, the row is copied backwards, so that the overlapping src pixels are read before they are overwritten
+	uint32_t num_of_chunks = 0;
+#ifdef BLIT_HAS_SSE2
+	num_of_chunks = row_size / 16;
+	const __m128i and_v = sizeof(T) == 2 ? _mm_set1_epi16((int16_t)and_mask) : _mm_set1_epi32((int32_t)and_mask);
+	const __m128i or_v = sizeof(T) == 2 ? _mm_set1_epi16((int16_t)or_mask) : _mm_set1_epi32((int32_t)or_mask);
+#endif
+	uint32_t tail_start = num_of_chunks * 16;
+
+	if (dst <= src) {
+#ifdef BLIT_HAS_SSE2
+		for (uint32_t i = 0; i < num_of_chunks; ++i) {
+			__m128i pixels = _mm_loadu_si128((const __m128i *)(src + i * 16));
+			_mm_storeu_si128((__m128i *)(dst + i * 16), _mm_or_si128(_mm_and_si128(pixels, and_v), or_v));
+		}
+#endif
+		for (uint32_t i = tail_start; i < row_size; i += sizeof(T)) {
+			T pixel;
+			std::memcpy(&pixel, src + i, sizeof(T));
+			pixel = (pixel & and_mask) | or_mask;
+			std::memcpy(dst + i, &pixel, sizeof(T));
+		}
+	}
+	else {
+		for (uint32_t i = row_size; i > tail_start; ) {
+			i -= sizeof(T);
+			T pixel;
+			std::memcpy(&pixel, src + i, sizeof(T));
+			pixel = (pixel & and_mask) | or_mask;
+			std::memcpy(dst + i, &pixel, sizeof(T));
+		}
+#ifdef BLIT_HAS_SSE2
+		for (uint32_t i = num_of_chunks; i > 0; --i) {
+			__m128i pixels = _mm_loadu_si128((const __m128i *)(src + (i - 1) * 16));
+			_mm_storeu_si128((__m128i *)(dst + (i - 1) * 16), _mm_or_si128(_mm_and_si128(pixels, and_v), or_v));
+		}
+#endif
+	}
+}
+
+void
+blit_rect(uint8_t *dst, const uint8_t *src, uint32_t dst_pitch, uint32_t src_pitch, uint32_t row_size, uint32_t height, uint32_t bpp,
+	uint32_t and_mask, uint32_t or_mask)
+{
+	if ((row_size == 0) || (height == 0)) {
+		return;
+	}
+
+	// Same as memmove, but for rectangles: when dst is after src the rows are copied from the bottom, so that a row is never overwritten before it's read
+	bool backwards = dst > src;
+	uint8_t *dst_row = backwards ? dst + (uint64_t)(height - 1) * dst_pitch : dst;
+	const uint8_t *src_row = backwards ? src + (uint64_t)(height - 1) * src_pitch : src;
+	int64_t dst_step = backwards ? -(int64_t)dst_pitch : dst_pitch;
+	int64_t src_step = backwards ? -(int64_t)src_pitch : src_pitch;
+	bool is_plain_copy = (bpp == 1) || ((and_mask == ((bpp == 2) ? 0xFFFFu : 0xFFFFFFFFu)) && (or_mask == 0));
+
+	for (uint32_t y = 0; y < height; ++y) {
+		if (is_plain_copy) {
+			// memmove is already vectorized by the c library, and it handles the overlap inside a row
+			std::memmove(dst_row, src_row, row_size);
+		}
+		else if (bpp == 2) {
+			blit_row_masked<uint16_t>(dst_row, src_row, row_size, (uint16_t)and_mask, (uint16_t)or_mask);
+		}
+		else {
+			blit_row_masked<uint32_t>(dst_row, src_row, row_size, and_mask, or_mask);
+		}
+		dst_row += dst_step;
+		src_row += src_step;
+	}
+}
+
+static void
+copy_bulk(uint8_t *dst, const uint8_t *src, uint64_t size)
+{
+#ifdef BLIT_HAS_SSE2
+	if (size >= BLIT_NT_THRESHOLD) {
+		// The destination is usually a texture or a vertex buffer that the cpu won't read soon, so it's written around the caches. The stores need a 16 byte
+		// aligned dst, so the unaligned head is copied normally
+		uint64_t head = (16 - ((uintptr_t)dst & 15)) & 15;
+		std::memcpy(dst, src, head);
+		uint64_t num_of_chunks = (size - head) / 16;
+		for (uint64_t i = 0; i < num_of_chunks; ++i) {
+			_mm_stream_si128((__m128i *)(dst + head + i * 16), _mm_loadu_si128((const __m128i *)(src + head + i * 16)));
+		}
+		_mm_sfence();
+		uint64_t done = head + num_of_chunks * 16;
+		std::memcpy(dst + done, src + done, size - done);
+		return;
+	}
+#endif
+	std::memcpy(dst, src, size);
+}
+
+void
+copy_lines(uint8_t *dst, const uint8_t *src, int32_t dst_pitch, int32_t src_pitch, uint32_t line_length, uint32_t line_count)
+{
+	if ((line_length == 0) || (line_count == 0)) {
+		return;
+	}
+
+	// Find the memory touched by both buffers, to know if they overlap
+	int64_t dst_last = (int64_t)(line_count - 1) * dst_pitch, src_last = (int64_t)(line_count - 1) * src_pitch;
+	const uint8_t *dst_lo = dst + std::min<int64_t>(dst_last, 0), *dst_hi = dst + std::max<int64_t>(dst_last, 0) + line_length;
+	const uint8_t *src_lo = src + std::min<int64_t>(src_last, 0), *src_hi = src + std::max<int64_t>(src_last, 0) + line_length;
+	bool overlap = (dst_lo < src_hi) && (src_lo < dst_hi);
+
+	if (!overlap && (dst_pitch == (int64_t)line_length) && (src_pitch == (int64_t)line_length)) {
+		copy_bulk(dst, src, (uint64_t)line_length * line_count);
+		return;
+	}
+
+	for (uint32_t i = 0; i < line_count; ++i) {
+		if (overlap) {
+			std::memmove(dst, src, line_length);
+		}
+		else {
+			std::memcpy(dst, src, line_length);
+		}
+		dst += dst_pitch;
+		src += src_pitch;
+	}
+}
@@ -0,0 +1,18 @@
+// SPDX-License-Identifier: GPL-3.0-only
+// SPDX-FileCopyrightText: 2026 ergo720
+
+#pragma once
+
+#include <cstdint>
+
+
+// Copies a rectangle of height rows of row_size bytes between two surfaces, which are allowed to overlap. Every pixel of bpp bytes is written as
+// (src & and_mask) | or_mask, which is used to force the unused bits of the X* color formats to their zero or one value. bpp must be 1, 2 or 4, and
+// the masks are only applied when it's 2 or 4
+void blit_rect(uint8_t *dst, const uint8_t *src, uint32_t dst_pitch, uint32_t src_pitch, uint32_t row_size, uint32_t height, uint32_t bpp,
+	uint32_t and_mask, uint32_t or_mask);
+
+// Copies line_count lines of line_length bytes, which start pitch bytes apart (pitches can be negative). When the pitches are equal to the line length, the
+// lines are copied with a single copy, which uses non-temporal stores if it's large enough to only pollute the caches. The lines are copied in order, so
+// overlapping buffers give the same result of copying them one at a time
+void copy_lines(uint8_t *dst, const uint8_t *src, int32_t dst_pitch, int32_t src_pitch, uint32_t line_length, uint32_t line_count);
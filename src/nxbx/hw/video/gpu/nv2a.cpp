@@ -78,7 +78,7 @@ void nv2a::Impl::init(nv2a *gpu, machine *machine)
 	m_pramdac->init(cpu, gpu);
 	m_pbus->init(cpu, gpu, machine->getPci());
 	m_pfb->init(cpu, gpu);
-	m_pcrtc->init(cpu, gpu);
+	m_pcrtc->init(cpu, gpu, machine->getVga());
 	m_ptimer->init(cpu, gpu);
 	m_pramin->init(cpu, gpu);
 	m_pfifo->init(cpu, gpu);
@@ -93,6 +93,9 @@ void nv2a::Impl::deinit()
 	if (m_pfifo) {
 		m_pfifo->deinit();
 	}
+	if (m_pcrtc) {
+		m_pcrtc->deinit();
+	}
 }
 
 pmc *nv2a::Impl::getPmc() { return m_pmc.get(); }
@@ -0,0 +1,116 @@
+// SPDX-License-Identifier: GPL-3.0-only
+// SPDX-FileCopyrightText: 2026 ergo720
+
+#include "nv2a_capture.hpp"
+#include "pramin.hpp"
+#include "pfifo.hpp"
+#include "pgraph.hpp"
+#include "files.hpp"
+#include "logger.hpp"
+#include <mutex>
+#include <vector>
+#include <cstring>
+
+#define MODULE_NAME pfifo
+
+#define CAPTURE_BUFFER_SIZE (1024 * 1024) // records are written to the file in chunks of this size
+
+
+namespace nv2a_capture {
+	// Records come from the cpu thread (register and ramin writes) and from the fifo thread (pb fetches), so they are serialized by this mutex
+	static std::mutex s_mtx;
+	static std::fstream s_file;
+	static std::vector<char> s_buffer;
+
+	static void
+	flush()
+	{
+		if (!s_buffer.empty()) {
+			s_file.write(s_buffer.data(), s_buffer.size());
+			s_buffer.clear();
+			if (!s_file.good()) {
+				logger_en(error, "Failed to write to the gpu capture file, the capture will stop");
+				g_is_active = false;
+			}
+		}
+	}
+
+	static void
+	append(const void *data, uint32_t size)
+	{
+		if ((s_buffer.size() + size) > CAPTURE_BUFFER_SIZE) {
+			flush();
+		}
+		s_buffer.insert(s_buffer.end(), (const char *)data, (const char *)data + size);
+	}
+
+	void
+	init(const char *path)
+	{
+		if (auto opt = create_file(path); opt) {
+			s_file = std::move(*opt);
+			s_buffer.reserve(CAPTURE_BUFFER_SIZE);
+			g_is_armed = true;
+			logger_en(info, "Gpu capture armed, it will start at the first pushbuffer submission. The capture file is \"%s\"", path);
+		}
+		else {
+			logger_en(error, "Failed to create the gpu capture file \"%s\"", path);
+		}
+	}
+
+	void
+	deinit()
+	{
+		std::unique_lock lock(s_mtx);
+		if (g_is_active) {
+			flush();
+		}
+		g_is_armed = false;
+		g_is_active = false;
+		if (s_file.is_open()) {
+			s_file.close();
+		}
+	}
+
+	void
+	start(const header_t &header, const uint8_t *ramin, const uint32_t *pfifo_regs, const uint32_t *pgraph_regs)
+	{
+		std::unique_lock lock(s_mtx);
+		if (!g_is_armed) {
+			return;
+		}
+
+		g_is_armed = false;
+		s_file.write((const char *)&header, sizeof(header_t));
+		s_file.write((const char *)ramin, NV_PRAMIN_SIZE);
+		s_file.write((const char *)pfifo_regs, NV_PFIFO_SIZE);
+		s_file.write((const char *)pgraph_regs, NV_PGRAPH_SIZE);
+		if (!s_file.good()) {
+			logger_en(error, "Failed to write the gpu snapshot to the capture file");
+			return;
+		}
+		g_is_active = true;
+		logger_en(info, "Gpu capture started");
+	}
+
+	void
+	record_write(record_type type, uint32_t addr, uint32_t value)
+	{
+		std::unique_lock lock(s_mtx);
+		if (g_is_active) {
+			record_t record{ .type = type, .addr = addr, .value = value, .size = 0 };
+			append(&record, sizeof(record_t));
+		}
+	}
+
+	void
+	record_fetch(uint32_t put_num, uint32_t ram_addr, const uint32_t *words, uint32_t num_of_words)
+	{
+		std::unique_lock lock(s_mtx);
+		if (g_is_active) {
+			record_t record{ .type = record_type::pb_fetch, .addr = ram_addr, .value = put_num, .size = num_of_words };
+			append(&record, sizeof(record_t));
+			append(words, num_of_words * 4);
+		}
+	}
+}
@@ -0,0 +1,48 @@
+// SPDX-License-Identifier: GPL-3.0-only
+// SPDX-FileCopyrightText: 2026 ergo720
+
+#pragma once
+
+#include <cstdint>
+#include <atomic>
+
+#define NV2A_CAPTURE_VERSION 1
+
+
+// Records the gpu workload of a title, so that it can be replayed offline by nxbx-gpureplay. A capture file starts with a header_t, followed by a snapshot of
+// the gpu state taken at the first DMA_PUT write after the capture was armed: the ramin (NV_PRAMIN_SIZE bytes, as they are stored at the top of ram),
+// the pfifo registers (NV_PFIFO_SIZE bytes) and the pgraph registers (NV_PGRAPH_SIZE bytes). After that, there's a sequence of records, each one
+// starting with a record_t, in the order they happened
+namespace nv2a_capture {
+	struct header_t {
+		char magic[8]; // "NXBXGPUC"
+		uint32_t version;
+		uint32_t ramsize;
+		uint32_t pmc_enable; // value of NV_PMC_ENABLE
+		uint32_t reserved;
+	};
+
+	enum class record_type : uint32_t {
+		pfifo_write, // the guest wrote value to the pfifo register at addr
+		pgraph_write, // the guest wrote value to the pgraph register at addr
+		pramin_write, // the guest wrote to ramin, value is the new dword at offset addr
+		pb_fetch, // the pusher read size dwords of pb at ram address addr, after it saw the DMA_PUT write number value. The dwords follow the record
+	};
+
+	struct record_t {
+		record_type type;
+		uint32_t addr;
+		uint32_t value;
+		uint32_t size;
+	};
+
+	inline constexpr char g_magic[8] = { 'N', 'X', 'B', 'X', 'G', 'P', 'U', 'C' };
+	inline std::atomic_bool g_is_armed; // a capture file was opened, but the snapshot was not taken yet
+	inline std::atomic_bool g_is_active; // the snapshot was taken, so the records are being written
+
+	void init(const char *path);
+	void deinit();
+	void start(const header_t &header, const uint8_t *ramin, const uint32_t *pfifo_regs, const uint32_t *pgraph_regs);
+	void record_write(record_type type, uint32_t addr, uint32_t value);
+	void record_fetch(uint32_t put_num, uint32_t ram_addr, const uint32_t *words, uint32_t num_of_words);
+}
@@ -25,7 +25,18 @@
 enum class nv039 : uint32_t
 {
 	NV039_SET_OBJECT =                                   0x00000000,
+	NV039_NOTIFY =                                       0x00000104,
 	NV039_SET_CONTEXT_DMA_NOTIFIES =                     0x00000180,
+	NV039_SET_CONTEXT_DMA_BUFFER_IN =                    0x00000184,
+	NV039_SET_CONTEXT_DMA_BUFFER_OUT =                   0x00000188,
+	NV039_OFFSET_IN =                                    0x0000030C,
+	NV039_OFFSET_OUT =                                   0x00000310,
+	NV039_PITCH_IN =                                     0x00000314,
+	NV039_PITCH_OUT =                                    0x00000318,
+	NV039_LINE_LENGTH_IN =                               0x0000031C,
+	NV039_LINE_COUNT =                                   0x00000320,
+	NV039_FORMAT =                                       0x00000324,
+	NV039_BUFFER_NOTIFY =                                0x00000328,
 };
 
 enum class nv062 : uint32_t
@@ -33,6 +44,10 @@ enum class nv062 : uint32_t
 	NV062_SET_OBJECT =                                   0x00000000,
 	NV062_SET_CONTEXT_DMA_IMAGE_SOURCE =                 0x00000184,
 	NV062_SET_CONTEXT_DMA_IMAGE_DESTIN =                 0x00000188,
+	NV062_SET_COLOR_FORMAT =                             0x00000300,
+	NV062_SET_PITCH =                                    0x00000304,
+	NV062_SET_OFFSET_SOURCE =                            0x00000308,
+	NV062_SET_OFFSET_DESTIN =                            0x0000030C,
 };
 
 enum class nv097 : uint32_t
@@ -48,11 +63,42 @@ enum class nv097 : uint32_t
 	NV097_SET_CONTEXT_DMA_VERTEX_B =                     0x000001A0,
 	NV097_SET_CONTEXT_DMA_SEMAPHORE =                    0x000001A4,
 	NV097_SET_CONTEXT_DMA_REPORT =                       0x000001A8,
+	NV097_SET_SURFACE_CLIP_HORIZONTAL =                  0x00000200,
+	NV097_SET_SURFACE_CLIP_VERTICAL =                    0x00000204,
+	NV097_SET_SURFACE_FORMAT =                           0x00000208,
+	NV097_SET_SURFACE_PITCH =                            0x0000020C,
+	NV097_SET_SURFACE_COLOR_OFFSET =                     0x00000210,
+	NV097_SET_SURFACE_ZETA_OFFSET =                      0x00000214,
+	NV097_SET_CULL_FACE_ENABLE =                         0x00000308,
+	NV097_SET_DEPTH_TEST_ENABLE =                        0x0000030C,
+	NV097_SET_DEPTH_FUNC =                               0x00000354,
+	NV097_SET_COLOR_MASK =                               0x00000358,
+	NV097_SET_DEPTH_MASK =                               0x0000035C,
+	NV097_SET_SHADE_MODE =                               0x0000037C,
+	NV097_SET_CULL_FACE =                                0x0000039C,
+	NV097_SET_FRONT_FACE =                               0x000003A0,
 	NV097_SET_EYE_POSITION =                             0x00000A50,
 	NV097_SET_FLAT_SHADE_OP =                            0x000009FC,
+	NV097_SET_VERTEX3F =                                 0x00001500,
+	NV097_SET_VERTEX4F =                                 0x00001518,
 	NV097_SET_EDGE_FLAG =                                0x000016BC,
+	NV097_SET_VERTEX_DATA_ARRAY_OFFSET =                 0x00001720,
+	NV097_SET_VERTEX_DATA_ARRAY_FORMAT =                 0x00001760,
+	NV097_SET_BEGIN_END =                                0x000017FC,
+	NV097_ARRAY_ELEMENT16 =                              0x00001800,
+	NV097_ARRAY_ELEMENT32 =                              0x00001808,
+	NV097_DRAW_ARRAYS =                                  0x00001810,
+	NV097_INLINE_ARRAY =                                 0x00001818,
+	NV097_SET_VERTEX_DATA2F_M =                          0x00001880,
+	NV097_SET_VERTEX_DATA4UB =                           0x00001940,
+	NV097_SET_VERTEX_DATA4F_M =                          0x00001A00,
 	NV097_SET_SEMAPHORE_OFFSET =                         0x00001D6C,
 	NV097_BACK_END_WRITE_SEMAPHORE_RELEASE =             0x00001D70,
+	NV097_SET_ZSTENCIL_CLEAR_VALUE =                     0x00001D8C,
+	NV097_SET_COLOR_CLEAR_VALUE =                        0x00001D90,
+	NV097_CLEAR_SURFACE =                                0x00001D94,
+	NV097_SET_CLEAR_RECT_HORIZONTAL =                    0x00001D98,
+	NV097_SET_CLEAR_RECT_VERTICAL =                      0x00001D9C,
 };
 
 enum class nv09f : uint32_t
@@ -66,6 +112,9 @@ enum class nv09f : uint32_t
 	NV09F_SET_CONTEXT_BETA4 =                            0x00000198,
 	NV09F_SET_CONTEXT_SURFACES =                         0x0000019C,
 	NV09F_SET_OPERATION =                                0x000002FC,
+	NV09F_CONTROL_POINT_IN =                             0x00000300,
+	NV09F_CONTROL_POINT_OUT =                            0x00000304,
+	NV09F_SIZE =                                         0x00000308,
 };
 
 // Classes declarations
@@ -77,6 +126,22 @@ enum class nv09f : uint32_t
 #define NV039_NOTIFICATION_STATUS_ERROR_INVALID_STATE    0x1000
 #define NV039_NOTIFICATION_STATUS_ERROR_STATE_IN_USE     0x0800
 #define NV039_NOTIFICATION_STATUS_DONE_SUCCESS           0x0000
+#define NV039_NOTIFY_WRITE_ONLY                          0x00000000
+#define NV039_NOTIFY_WRITE_THEN_AWAKEN                   0x00000001
+#define NV039_FORMAT_INPUT_INC                           0x00000007
+#define NV039_FORMAT_OUTPUT_INC                          0x00000700
+
+#define NV062_SET_COLOR_FORMAT_LE_Y8                     0x00000001
+#define NV062_SET_COLOR_FORMAT_LE_X1R5G5B5_Z1R5G5B5      0x00000002
+#define NV062_SET_COLOR_FORMAT_LE_X1R5G5B5_O1R5G5B5      0x00000003
+#define NV062_SET_COLOR_FORMAT_LE_R5G6B5                 0x00000004
+#define NV062_SET_COLOR_FORMAT_LE_Y16                    0x00000005
+#define NV062_SET_COLOR_FORMAT_LE_X8R8G8B8_Z8R8G8B8      0x00000006
+#define NV062_SET_COLOR_FORMAT_LE_X8R8G8B8_O8R8G8B8      0x00000007
+#define NV062_SET_COLOR_FORMAT_LE_X1A7R8G8B8_Z1A7R8G8B8  0x00000008
+#define NV062_SET_COLOR_FORMAT_LE_X1A7R8G8B8_O1A7R8G8B8  0x00000009
+#define NV062_SET_COLOR_FORMAT_LE_A8R8G8B8               0x0000000A
+#define NV062_SET_COLOR_FORMAT_LE_Y32                    0x0000000B
 
 #define NV097_NOTIFICATION_STATUS_IN_PROGRESS            0x8000
 #define NV097_NOTIFICATION_STATUS_ERROR_PROTECTION_FAULT 0x4000
@@ -89,3 +154,84 @@ enum class nv09f : uint32_t
 #define NV097_SET_FLAT_SHADE_OP_V_FIRST_VTX              0x00000001
 #define NV097_SET_EDGE_FLAG_V_FALSE                      0x00000000
 #define NV097_SET_EDGE_FLAG_V_TRUE                       0x00000001
+#define NV097_SET_SURFACE_FORMAT_COLOR                   0x0000000F
+#define NV097_SET_SURFACE_FORMAT_COLOR_LE_X1R5G5B5_Z1R5G5B5 0x00000001
+#define NV097_SET_SURFACE_FORMAT_COLOR_LE_X1R5G5B5_O1R5G5B5 0x00000002
+#define NV097_SET_SURFACE_FORMAT_COLOR_LE_R5G6B5         0x00000003
+#define NV097_SET_SURFACE_FORMAT_COLOR_LE_X8R8G8B8_Z8R8G8B8 0x00000004
+#define NV097_SET_SURFACE_FORMAT_COLOR_LE_X8R8G8B8_O8R8G8B8 0x00000005
+#define NV097_SET_SURFACE_FORMAT_COLOR_LE_X1A7R8G8B8_Z1A7R8G8B8 0x00000006
+#define NV097_SET_SURFACE_FORMAT_COLOR_LE_X1A7R8G8B8_O1A7R8G8B8 0x00000007
+#define NV097_SET_SURFACE_FORMAT_COLOR_LE_A8R8G8B8       0x00000008
+#define NV097_SET_SURFACE_FORMAT_COLOR_LE_B8             0x00000009
+#define NV097_SET_SURFACE_FORMAT_COLOR_LE_G8B8           0x0000000A
+#define NV097_SET_SURFACE_FORMAT_ZETA                    0x000000F0
+#define NV097_SET_SURFACE_FORMAT_ZETA_Z16                0x00000001
+#define NV097_SET_SURFACE_FORMAT_ZETA_Z24S8              0x00000002
+#define NV097_SET_SURFACE_FORMAT_TYPE                    0x00000F00
+#define NV097_SET_SURFACE_FORMAT_TYPE_PITCH              0x00000001
+#define NV097_SET_SURFACE_FORMAT_TYPE_SWIZZLE            0x00000002
+#define NV097_SET_SURFACE_FORMAT_WIDTH                   0x00FF0000
+#define NV097_SET_SURFACE_FORMAT_HEIGHT                  0xFF000000
+#define NV097_SET_DEPTH_FUNC_V_NEVER                     0x00000200
+#define NV097_SET_DEPTH_FUNC_V_LESS                      0x00000201
+#define NV097_SET_DEPTH_FUNC_V_EQUAL                     0x00000202
+#define NV097_SET_DEPTH_FUNC_V_LEQUAL                    0x00000203
+#define NV097_SET_DEPTH_FUNC_V_GREATER                   0x00000204
+#define NV097_SET_DEPTH_FUNC_V_NOTEQUAL                  0x00000205
+#define NV097_SET_DEPTH_FUNC_V_GEQUAL                    0x00000206
+#define NV097_SET_DEPTH_FUNC_V_ALWAYS                    0x00000207
+#define NV097_SET_COLOR_MASK_BLUE_WRITE_ENABLE           0x000000FF
+#define NV097_SET_COLOR_MASK_GREEN_WRITE_ENABLE          0x0000FF00
+#define NV097_SET_COLOR_MASK_RED_WRITE_ENABLE            0x00FF0000
+#define NV097_SET_COLOR_MASK_ALPHA_WRITE_ENABLE          0xFF000000
+#define NV097_SET_SHADE_MODE_V_FLAT                      0x00001D00
+#define NV097_SET_SHADE_MODE_V_SMOOTH                    0x00001D01
+#define NV097_SET_CULL_FACE_V_FRONT                      0x00000404
+#define NV097_SET_CULL_FACE_V_BACK                       0x00000405
+#define NV097_SET_CULL_FACE_V_FRONT_AND_BACK             0x00000408
+#define NV097_SET_FRONT_FACE_V_CW                        0x00000900
+#define NV097_SET_FRONT_FACE_V_CCW                       0x00000901
+#define NV097_SET_VERTEX_DATA_ARRAY_OFFSET_CONTEXT_DMA   0x80000000 // vertex B=1
+#define NV097_SET_VERTEX_DATA_ARRAY_OFFSET_OFFSET        0x7FFFFFFF
+#define NV097_SET_VERTEX_DATA_ARRAY_FORMAT_TYPE          0x0000000F
+#define NV097_SET_VERTEX_DATA_ARRAY_FORMAT_TYPE_UB_D3D   0x00000000
+#define NV097_SET_VERTEX_DATA_ARRAY_FORMAT_TYPE_S1       0x00000001
+#define NV097_SET_VERTEX_DATA_ARRAY_FORMAT_TYPE_F        0x00000002
+#define NV097_SET_VERTEX_DATA_ARRAY_FORMAT_TYPE_UB_OGL   0x00000004
+#define NV097_SET_VERTEX_DATA_ARRAY_FORMAT_TYPE_S32K     0x00000005
+#define NV097_SET_VERTEX_DATA_ARRAY_FORMAT_TYPE_CMP      0x00000006
+#define NV097_SET_VERTEX_DATA_ARRAY_FORMAT_SIZE          0x000000F0
+#define NV097_SET_VERTEX_DATA_ARRAY_FORMAT_STRIDE        0xFFFFFF00
+#define NV097_SET_BEGIN_END_OP_END                       0x00000000
+#define NV097_SET_BEGIN_END_OP_POINTS                    0x00000001
+#define NV097_SET_BEGIN_END_OP_LINES                     0x00000002
+#define NV097_SET_BEGIN_END_OP_LINE_LOOP                 0x00000003
+#define NV097_SET_BEGIN_END_OP_LINE_STRIP                0x00000004
+#define NV097_SET_BEGIN_END_OP_TRIANGLES                 0x00000005
+#define NV097_SET_BEGIN_END_OP_TRIANGLE_STRIP            0x00000006
+#define NV097_SET_BEGIN_END_OP_TRIANGLE_FAN              0x00000007
+#define NV097_SET_BEGIN_END_OP_QUADS                     0x00000008
+#define NV097_SET_BEGIN_END_OP_QUAD_STRIP                0x00000009
+#define NV097_SET_BEGIN_END_OP_POLYGON                   0x0000000A
+#define NV097_DRAW_ARRAYS_START_INDEX                    0x00FFFFFF
+#define NV097_DRAW_ARRAYS_COUNT                          0xFF000000 // number of vertices minus one
+#define NV097_SET_TEXTURE_FORMAT_COLOR_SZ_I8_A8R8G8B8    0x0000000B
+#define NV097_SET_TEXTURE_FORMAT_COLOR_L_DXT1_A1R5G5B5   0x0000000C
+#define NV097_SET_TEXTURE_FORMAT_COLOR_L_DXT23_A8R8G8B8  0x0000000E
+#define NV097_SET_TEXTURE_FORMAT_COLOR_L_DXT45_A8R8G8B8  0x0000000F
+#define NV097_SET_TEXTURE_FORMAT_COLOR_LC_IMAGE_CR8YB8CB8YA8 0x00000024
+#define NV097_SET_TEXTURE_FORMAT_COLOR_LC_IMAGE_YB8CR8YA8CB8 0x00000025
+#define NV097_CLEAR_SURFACE_Z                            0x00000001
+#define NV097_CLEAR_SURFACE_STENCIL                      0x00000002
+#define NV097_CLEAR_SURFACE_R                            0x00000010
+#define NV097_CLEAR_SURFACE_G                            0x00000020
+#define NV097_CLEAR_SURFACE_B                            0x00000040
+#define NV097_CLEAR_SURFACE_A                            0x00000080
+
+#define NV09F_SET_OPERATION_SRCCOPY_AND                  0x00000000
+#define NV09F_SET_OPERATION_ROP_AND                      0x00000001
+#define NV09F_SET_OPERATION_BLEND_AND                    0x00000002
+#define NV09F_SET_OPERATION_SRCCOPY                      0x00000003
+#define NV09F_SET_OPERATION_SRCCOPY_PREMULT              0x00000004
+#define NV09F_SET_OPERATION_BLEND_PREMULT                0x00000005
@@ -4,7 +4,10 @@
 #include "lib86cpu.hpp"
 #include "clock.hpp"
 #include "pmc.hpp"
+#include "pramdac.hpp"
 #include "pcrtc.hpp"
+#include "presenter.hpp"
+#include "../vga.hpp"
 // Must be included last because of the template functions nv2a_read/write, which require a complete definition for the engine objects
 #include "nv2a.hpp"
 #include <cinttypes>
@@ -16,7 +19,8 @@
 class pcrtc::Impl
 {
 public:
-	void init(cpu *cpu, nv2a *gpu);
+	void init(cpu *cpu, nv2a *gpu, vga *vga);
+	void deinit();
 	void reset();
 	void updateIo() { updateIo(true); }
 	uint64_t getNextVblankTime(uint64_t now);
@@ -24,6 +28,7 @@ public:
 	uint32_t read32(uint32_t addr);
 	template<bool log, engine_enabled enabled>
 	void write32(uint32_t addr, const uint32_t value);
+	presenter *getPresenter() { return &m_presenter; }
 
 private:
 	void updateIo(bool is_update);
@@ -32,8 +37,13 @@ private:
 
 	static constexpr double s_vblank_ntsc_period = 16.6666666667 * 1000;
 	uint64_t m_vblank_last;
+	uint32_t m_vblank_event;
 	// connected devices
 	pmc *m_pmc;
+	pramdac *m_pramdac;
+	cpu *m_cpu;
+	vga *m_vga;
+	presenter m_presenter;
 	cpu_t *m_lc86cpu;
 	// atomic registers
 	std::atomic_uint32_t m_int_status;
@@ -51,20 +61,27 @@ private:
 
 uint64_t pcrtc::Impl::getNextVblankTime(uint64_t now)
 {
-	if (m_int_enabled & NV_PCRTC_INTR_EN_0_VBLANK_ENABLED) {
-		uint64_t next_time = m_vblank_last + s_vblank_ntsc_period;
-		if (now >= next_time) {
-			m_vblank_last = next_time; // next_time is a time in the past now!
-
+	uint64_t next_time = m_vblank_last + s_vblank_ntsc_period;
+	if (now >= next_time) {
+		m_vblank_last = next_time; // next_time is a time in the past now!
+
+		// The vga scanout is refreshed at every vblank, even when the vblank interrupt is disabled. Then, the framebuffer is presented in the mode the crtc
+		// has now
+		m_vga->update();
+		presenter_mode mode;
+		mode.fb_addr = m_fb_addr;
+		m_vga->getCrtcMode(mode.width, mode.height, mode.pitch, mode.bpp);
+		mode.is_565 = m_pramdac->read32(NV_PRAMDAC_GENERAL_CONTROL) & NV_PRAMDAC_GENERAL_CONTROL_ALT_MODE_SEL;
+		m_presenter.vblank(mode);
+
+		if (m_int_enabled & NV_PCRTC_INTR_EN_0_VBLANK_ENABLED) {
 			m_int_status |= NV_PCRTC_INTR_0_VBLANK_PENDING;
 			m_pmc->updateIrq();
-			return s_vblank_ntsc_period;
 		}
-
-		return next_time - now; // time remaining until next vblank
+		return s_vblank_ntsc_period;
 	}
 
-	return std::numeric_limits<uint64_t>::max();
+	return next_time - now; // time remaining until next vblank
 }
 
 template<bool log, engine_enabled enabled>
@@ -90,6 +107,7 @@ void pcrtc::Impl::write32(uint32_t addr, const uint32_t value)
 		m_int_enabled = value;
 		if (m_int_enabled & NV_PCRTC_INTR_EN_0_VBLANK_ENABLED && (old_state ^ value) & NV_PCRTC_INTR_EN_0_VBLANK_ENABLED) {
 			m_vblank_last = timer::get_now(); // triggers only on disabled -> enabled state change
+			m_cpu->updateTimedEvent(m_vblank_event, m_vblank_last);
 		}
 		m_pmc->updateIrq();
 	}
@@ -97,6 +115,7 @@ void pcrtc::Impl::write32(uint32_t addr, const uint32_t value)
 
 	case NV_PCRTC_START:
 		m_fb_addr = value & 0x7FFFFFC; // fb is 4 byte aligned
+		m_vga->setStart(m_fb_addr);
 		break;
 
 	case NV_PCRTC_CONFIG:
@@ -197,21 +216,39 @@ void pcrtc::Impl::reset()
 	m_int_status = NV_PCRTC_INTR_0_VBLANK_NOT_PENDING;
 	m_int_enabled = NV_PCRTC_INTR_EN_0_VBLANK_DISABLED;
 	m_fb_addr = 0;
+	m_vga->setStart(m_fb_addr);
 	m_config = 0;
+	m_vblank_last = timer::get_now();
 }
 
-void pcrtc::Impl::init(cpu *cpu, nv2a *gpu)
+void pcrtc::Impl::init(cpu *cpu, nv2a *gpu, vga *vga)
 {
 	m_pmc = gpu->getPmc();
+	m_pramdac = gpu->getPramdac();
 	m_lc86cpu = cpu->get86cpu();
+	m_cpu = cpu;
+	m_vga = vga;
+	m_vblank_event = m_cpu->addTimedEvent(cpu_timed_event<pcrtc::Impl, &pcrtc::Impl::getNextVblankTime>, this);
 	reset();
 	updateIo(false);
+	m_presenter.init(get_ram_ptr(m_lc86cpu), cpu->getRamsize(), vga);
+	m_cpu->updateTimedEvent(m_vblank_event, m_vblank_last);
+}
+
+void pcrtc::Impl::deinit()
+{
+	m_presenter.deinit();
 }
 
 /** Public interface implementation **/
-void pcrtc::init(cpu *cpu, nv2a *gpu)
+void pcrtc::init(cpu *cpu, nv2a *gpu, vga *vga)
+{
+	m_impl->init(cpu, gpu, vga);
+}
+
+void pcrtc::deinit()
 {
-	m_impl->init(cpu, gpu);
+	m_impl->deinit();
 }
 
 void pcrtc::reset()
@@ -224,11 +261,6 @@ void pcrtc::updateIo()
 	m_impl->updateIo();
 }
 
-uint64_t pcrtc::getNextVblankTime(uint64_t now)
-{
-	return m_impl->getNextVblankTime(now);
-}
-
 uint32_t pcrtc::read32(uint32_t addr)
 {
 	return m_impl->read32<false, on>(addr);
@@ -239,5 +271,10 @@ void pcrtc::write32(uint32_t addr, const uint32_t value)
 	m_impl->write32<false, on>(addr, value);
 }
 
+presenter *pcrtc::getPresenter()
+{
+	return m_impl->getPresenter();
+}
+
 pcrtc::pcrtc() : m_impl{std::make_unique<pcrtc::Impl>()} {}
 pcrtc::~pcrtc() {}
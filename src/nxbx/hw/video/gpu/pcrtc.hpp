@@ -23,18 +23,21 @@
 
 class cpu;
 class nv2a;
+class vga;
+class presenter;
 
 class pcrtc
 {
 public:
 	pcrtc();
 	~pcrtc();
-	void init(cpu *cpu, nv2a *gpu);
+	void init(cpu *cpu, nv2a *gpu, vga *vga);
+	void deinit();
 	void reset();
 	void updateIo();
-	uint64_t getNextVblankTime(uint64_t now);
 	uint32_t read32(uint32_t addr);
 	void write32(uint32_t addr, const uint32_t value);
+	presenter *getPresenter();
 
 private:
 	class Impl;
@@ -9,6 +9,9 @@
 // Must be included last because of the template functions nv2a_read/write, which require a complete definition for the engine objects
 #include "nv2a.hpp"
 #include "util.hpp"
+#include "clock.hpp"
+#include "isettings.hpp"
+#include "nv2a_capture.hpp"
 #include <thread>
 #include <mutex>
 #include <coroutine>
@@ -18,10 +21,16 @@
 #include <bit>
 #include <charconv>
 #include <cinttypes>
+#include <algorithm>
+#include <array>
+#include <cstring>
 
 #define MODULE_NAME pfifo
 
 #define SET_REG(reg, mask, val) (REG_PFIFO(reg) &= ~(mask)) |= (val)
+#define CACHE1_NUM_OF_ENTRIES 128
+#define RAMHT_CACHE_SIZE 256 // number of entries of the ramht lookup cache, must be a power of two
+#define RAMHT_CACHE_EMPTY -1U
 
 
 /** Private device implementation **/
@@ -38,6 +47,12 @@ public:
 	uint8_t read8(uint32_t addr);
 	template<bool log, engine_enabled enabled>
 	void write32(uint32_t addr, const uint32_t value);
+	uint64_t getMethodsPerSecond() { return m_methods_per_sec.load(std::memory_order_relaxed); }
+	void invalidateRamht(uint32_t offset);
+	uint64_t getRamhtCacheHits() { return m_ramht_cache_hits.load(std::memory_order_relaxed); }
+	uint64_t getRamhtCacheMisses() { return m_ramht_cache_misses.load(std::memory_order_relaxed); }
+	uint64_t getIdleTime() { return m_idle_time.load(std::memory_order_relaxed); }
+	void loadRegs(const uint32_t *regs);
 
 private:
 	struct CoroFrame
@@ -65,6 +80,13 @@ private:
 		uint32_t m_chid; // channel to which the object is bound
 		uint32_t m_valid; // whether or not the object is valid
 	};
+	struct RamhtCacheEntry
+	{
+		uint32_t m_handle;
+		uint32_t m_chid;
+		uint32_t m_slot; // index of the ramht entry that m_elem was decoded from, or RAMHT_CACHE_EMPTY
+		RamhtElement m_elem;
+	};
 
 	void logRead(uint32_t addr, uint32_t value);
 	void logWrite(uint32_t addr, uint32_t value);
@@ -75,13 +97,34 @@ private:
 	CoroFrame pusher(const std::stop_token &stok);
 	void puller(const std::stop_token &stok, std::coroutine_handle<CoroFrame::promise_type> coro_pusher);
 	RamhtElement ramhtSearch(uint32_t handle);
+	void flushRamhtCache();
+	bool isPusherRunning();
+	uint32_t getCache1FreeEntries();
+	void updateThroughput(uint32_t num_of_methods);
+	void startCapture();
 
 	uint8_t *m_ram;
+	uint32_t m_ramsize;
 	std::jthread m_jthr; // async fifo worker thread
 	std::atomic_flag m_fifo_has_work;
 	std::atomic_flag m_puller_has_err;
 	std::atomic_bool m_is_enabled;
 	std::mutex m_fifo_mtx;
+	// methods/second counter, only accessed by the fifo thread
+	uint64_t m_throughput_start;
+	uint64_t m_throughput_num_of_methods;
+	std::atomic_uint64_t m_methods_per_sec;
+	// Time (in us) that the fifo thread spent waiting for work or for pgraph to go idle
+	std::atomic_uint64_t m_idle_time;
+	uint64_t m_throughput_fifo_idle; // idle times at the start of the current throughput period
+	uint64_t m_throughput_pgraph_idle;
+	uint32_t m_capture_put_num; // number of DMA_PUT writes since the gpu capture started
+	// Direct mapped cache of the ramht lookups, indexed by channel and handle. Entries are invalidated by pramin when the guest writes to their ramht slot
+	std::array<RamhtCacheEntry, RAMHT_CACHE_SIZE> m_ramht_cache;
+	std::atomic_uint32_t m_ramht_offset; // copy of the ramht range in ramin, read by pramin without taking m_fifo_mtx
+	std::atomic_uint32_t m_ramht_size;
+	std::atomic_uint64_t m_ramht_cache_hits;
+	std::atomic_uint64_t m_ramht_cache_misses;
 	// connected devices
 	pmc *m_pmc;
 	pgraph *m_pgraph;
@@ -134,9 +177,20 @@ void pfifo::Impl::write32(uint32_t addr, const uint32_t value)
 	if constexpr (log) {
 		logWrite(addr, value);
 	}
+	if ((addr == NV_PFIFO_CACHE1_DMA_PUT) && nv2a_capture::g_is_armed.load(std::memory_order_relaxed)) [[unlikely]] {
+		startCapture();
+	}
 
 	std::unique_lock lock(m_fifo_mtx);
 
+	if (nv2a_capture::g_is_active.load(std::memory_order_relaxed)) [[unlikely]] {
+		// Recorded while holding the lock, so that the pb fetches of the pusher can be matched with the DMA_PUT write they happened after
+		nv2a_capture::record_write(nv2a_capture::record_type::pfifo_write, addr, value);
+		if (addr == NV_PFIFO_CACHE1_DMA_PUT) {
+			++m_capture_put_num;
+		}
+	}
+
 	switch (addr)
 	{
 	case NV_PFIFO_INTR_0:
@@ -176,6 +230,12 @@ void pfifo::Impl::write32(uint32_t addr, const uint32_t value)
 		// read-only
 		break;
 
+	case NV_PFIFO_RAMHT:
+		// The ramht moved or changed size, so all cached lookups are stale
+		REG_PFIFO(addr) = value;
+		flushRamhtCache();
+		break;
+
 	case NV_PFIFO_CACHE1_HASH:
 		REG_PFIFO(addr) = value;
 		m_puller_has_err.clear();
@@ -238,7 +298,9 @@ pfifo::Impl::CoroFrame pfifo::Impl::pusher(const std::stop_token &stok)
 	while (true) {
 		// Wait until there's some work to do
 		m_fifo_mtx.unlock();
+		uint64_t idle_start = timer::get_now();
 		m_fifo_has_work.wait(false);
+		m_idle_time.fetch_add(timer::get_now() - idle_start, std::memory_order_relaxed);
 		m_fifo_mtx.lock();
 		m_fifo_has_work.clear();
 
@@ -247,9 +309,7 @@ pfifo::Impl::CoroFrame pfifo::Impl::pusher(const std::stop_token &stok)
 			throw std::exception();
 		}
 
-		if ((((REG_PFIFO(NV_PFIFO_CACHE1_PUSH0) & NV_PFIFO_CACHE1_PUSH0_ACCESS) << 1) |
-			(REG_PFIFO(NV_PFIFO_CACHE1_DMA_PUSH) & (NV_PFIFO_CACHE1_DMA_PUSH_ACCESS | NV_PFIFO_CACHE1_DMA_PUSH_STATUS))) ^
-			(NV_PFIFO_CACHE1_DMA_PUSH_ACCESS | (NV_PFIFO_CACHE1_PUSH0_ACCESS << 1))) {
+		if (!isPusherRunning()) {
 			// Pusher is either disabled or suspended, so switch to puller since there might still be entries in cache1
 			co_await std::suspend_always();
 			continue;
@@ -260,6 +320,7 @@ pfifo::Impl::CoroFrame pfifo::Impl::pusher(const std::stop_token &stok)
 
 		uint32_t curr_pb_get = REG_PFIFO(NV_PFIFO_CACHE1_DMA_GET) & ~3;
 		uint32_t curr_pb_put = REG_PFIFO(NV_PFIFO_CACHE1_DMA_PUT) & ~3;
+		uint32_t capture_put_num = m_capture_put_num;
 		// Find the address of the new pb entries from the pb object
 		DmaObj pb_obj = m_nv2a->getDmaObj((REG_PFIFO(NV_PFIFO_CACHE1_DMA_INSTANCE) & NV_PFIFO_CACHE1_DMA_INSTANCE_ADDRESS) << 4);
 
@@ -270,48 +331,65 @@ pfifo::Impl::CoroFrame pfifo::Impl::pusher(const std::stop_token &stok)
 				err_code = NV_PFIFO_CACHE1_DMA_STATE_ERROR_PROTECTION; // set mem fault error
 				goto pusher_error;
 			}
-			uint8_t *pb_addr = m_ram + pb_obj.target_addr + curr_pb_get; // ram host base addr + pb base addr + pb offset
-			uint32_t pb_entry = *(uint32_t *)pb_addr;
-			curr_pb_get += 4;
-
 			uint32_t mthd_cnt = (REG_PFIFO(NV_PFIFO_CACHE1_DMA_STATE) & NV_PFIFO_CACHE1_DMA_STATE_METHOD_COUNT) >> 18; // parameter count of method
 			if (mthd_cnt) {
-				// A method is already being processed, so the following words must be its parameters
-
-				REG_PFIFO(NV_PFIFO_CACHE1_DMA_DATA_SHADOW) = pb_entry; // save in shadow reg the current entry
-
-				uint32_t cache1_put = REG_PFIFO(NV_PFIFO_CACHE1_PUT) & 0x1FC;
+				// A method is already being processed, so the following words must be its parameters. All the parameters that are already in the pb and fit
+				// in cache1 are pushed as a single batch, so that the puller is only resumed once for all of them
+				uint32_t num_of_words = std::min({ mthd_cnt, ((curr_pb_put > curr_pb_get ? curr_pb_put : pb_obj.limit) - curr_pb_get + 3) >> 2,
+					(pb_obj.limit - curr_pb_get + 3) >> 2, (uint32_t)CACHE1_NUM_OF_ENTRIES });
 				uint32_t dma_state = REG_PFIFO(NV_PFIFO_CACHE1_DMA_STATE);
-				uint32_t mthd_type = dma_state & NV_PFIFO_CACHE1_DMA_STATE_METHOD_TYPE; // method type
-				uint32_t mthd = dma_state & NV_PFIFO_CACHE1_DMA_STATE_METHOD; // the actual method specified
-				uint32_t subchan = dma_state & NV_PFIFO_CACHE1_DMA_STATE_SUBCHANNEL; // the bound subchannel
-
-				// Add the method and its parameter to cache1
-				REG_PFIFO(NV_PFIFO_CACHE1_METHOD(cache1_put >> 2)) = mthd_type | mthd | subchan;
-				REG_PFIFO(NV_PFIFO_CACHE1_DATA(cache1_put >> 2)) = pb_entry;
-
-				uint32_t cache1_status = REG_PFIFO(NV_PFIFO_CACHE1_STATUS);
-				REG_PFIFO(NV_PFIFO_CACHE1_PUT) = (cache1_put + 4) & 0x1FC;
-				if (REG_PFIFO(NV_PFIFO_CACHE1_PUT) == REG_PFIFO(NV_PFIFO_CACHE1_GET)) {
-					cache1_status |= NV_PFIFO_CACHE1_STATUS_HIGH_MARK; // cache1 full
-				}
-				if (cache1_status & NV_PFIFO_CACHE1_STATUS_LOW_MARK) {
-					cache1_status &= ~NV_PFIFO_CACHE1_STATUS_LOW_MARK; // cache1 no longer empty
-				}
-				REG_PFIFO(NV_PFIFO_CACHE1_STATUS) = cache1_status;
+				uint32_t pb_words[CACHE1_NUM_OF_ENTRIES];
 
-				// Update dma state
-				if (mthd_type == 0) {
-					dma_state &= ~NV_PFIFO_CACHE1_DMA_STATE_METHOD;
-					dma_state |= (mthd + 4); // increasing method: method increases by one for each parameter
+				// Only the guest ram is accessed while decoding, so let the cpu access the registers in the meantime. If it changed the pusher state, the batch
+				// is discarded and the pb is processed again from the new state
+				m_fifo_mtx.unlock();
+				std::memcpy(pb_words, m_ram + pb_obj.target_addr + curr_pb_get, num_of_words * 4); // ram host base addr + pb base addr + pb offset
+				m_fifo_mtx.lock();
+				if (!isPusherRunning() || ((REG_PFIFO(NV_PFIFO_CACHE1_DMA_GET) & ~3) != curr_pb_get) || (REG_PFIFO(NV_PFIFO_CACHE1_DMA_STATE) != dma_state)) {
+					m_fifo_has_work.test_and_set();
+					break;
 				}
-				mthd_cnt--;
-				dma_state &= ~NV_PFIFO_CACHE1_DMA_STATE_METHOD_COUNT;
-				dma_state |= (mthd_cnt << 18);
-				REG_PFIFO(NV_PFIFO_CACHE1_DMA_STATE) = dma_state; // resave dma state with updated method and count
-				REG_PFIFO(NV_PFIFO_CACHE1_DMA_DCOUNT)++;
 
-				REG_PFIFO(NV_PFIFO_CACHE1_DMA_GET) = curr_pb_get; // write back updated dma get pointer
+				num_of_words = std::min(num_of_words, getCache1FreeEntries());
+				if (num_of_words) {
+					if (nv2a_capture::g_is_active.load(std::memory_order_relaxed)) [[unlikely]] {
+						nv2a_capture::record_fetch(capture_put_num, pb_obj.target_addr + curr_pb_get, pb_words, num_of_words);
+					}
+					uint32_t cache1_put = REG_PFIFO(NV_PFIFO_CACHE1_PUT) & 0x1FC;
+					uint32_t mthd_type = dma_state & NV_PFIFO_CACHE1_DMA_STATE_METHOD_TYPE; // method type
+					uint32_t mthd = dma_state & NV_PFIFO_CACHE1_DMA_STATE_METHOD; // the actual method specified
+					uint32_t subchan = dma_state & NV_PFIFO_CACHE1_DMA_STATE_SUBCHANNEL; // the bound subchannel
+
+					// Add the methods and their parameters to cache1
+					for (uint32_t i = 0; i < num_of_words; ++i) {
+						REG_PFIFO(NV_PFIFO_CACHE1_METHOD(cache1_put >> 2)) = mthd_type | mthd | subchan;
+						REG_PFIFO(NV_PFIFO_CACHE1_DATA(cache1_put >> 2)) = pb_words[i];
+						cache1_put = (cache1_put + 4) & 0x1FC;
+						if (mthd_type == 0) {
+							mthd = (mthd + 4) & NV_PFIFO_CACHE1_DMA_STATE_METHOD; // increasing method: method increases by one for each parameter
+						}
+					}
+					curr_pb_get += (num_of_words * 4);
+					mthd_cnt -= num_of_words;
+
+					uint32_t cache1_status = REG_PFIFO(NV_PFIFO_CACHE1_STATUS);
+					REG_PFIFO(NV_PFIFO_CACHE1_PUT) = cache1_put;
+					if (REG_PFIFO(NV_PFIFO_CACHE1_PUT) == REG_PFIFO(NV_PFIFO_CACHE1_GET)) {
+						cache1_status |= NV_PFIFO_CACHE1_STATUS_HIGH_MARK; // cache1 full
+					}
+					if (cache1_status & NV_PFIFO_CACHE1_STATUS_LOW_MARK) {
+						cache1_status &= ~NV_PFIFO_CACHE1_STATUS_LOW_MARK; // cache1 no longer empty
+					}
+					REG_PFIFO(NV_PFIFO_CACHE1_STATUS) = cache1_status;
+
+					// Update dma state
+					dma_state &= ~(NV_PFIFO_CACHE1_DMA_STATE_METHOD | NV_PFIFO_CACHE1_DMA_STATE_METHOD_COUNT);
+					dma_state |= (mthd | (mthd_cnt << 18));
+					REG_PFIFO(NV_PFIFO_CACHE1_DMA_STATE) = dma_state; // resave dma state with updated method and count
+					REG_PFIFO(NV_PFIFO_CACHE1_DMA_DCOUNT) += num_of_words;
+					REG_PFIFO(NV_PFIFO_CACHE1_DMA_DATA_SHADOW) = pb_words[num_of_words - 1]; // save in shadow reg the last entry
+					REG_PFIFO(NV_PFIFO_CACHE1_DMA_GET) = curr_pb_get; // write back updated dma get pointer
+				}
 
 				co_await std::suspend_always(); // switch to puller
 
@@ -322,6 +400,11 @@ pfifo::Impl::CoroFrame pfifo::Impl::pusher(const std::stop_token &stok)
 			}
 			else {
 				// No methods is currently active, so this must be a new one
+				uint32_t pb_entry = *(uint32_t *)(m_ram + pb_obj.target_addr + curr_pb_get);
+				if (nv2a_capture::g_is_active.load(std::memory_order_relaxed)) [[unlikely]] {
+					nv2a_capture::record_fetch(capture_put_num, pb_obj.target_addr + curr_pb_get, &pb_entry, 1);
+				}
+				curr_pb_get += 4;
 				REG_PFIFO(NV_PFIFO_CACHE1_DMA_RSVD_SHADOW) = pb_entry; // save in shadow reg the current entry
 
 				if ((pb_entry & 0xE0000003) == 0x20000000) {
@@ -388,7 +471,7 @@ pfifo::Impl::CoroFrame pfifo::Impl::pusher(const std::stop_token &stok)
 
 	pusher_error:
 		assert((err_msg != "") && err_code);
-		logger_en(warn, err_msg.c_str());
+		logger_en(warn, "%s", err_msg.c_str()); // err_msg is built at runtime, so it can't be used as the format
 		REG_PFIFO(NV_PFIFO_CACHE1_DMA_STATE) |= (err_code << 29); // set error code
 		REG_PFIFO(NV_PFIFO_CACHE1_DMA_PUSH) &= ~NV_PFIFO_CACHE1_DMA_PUSH_STATE; // no longer busy
 		REG_PFIFO(NV_PFIFO_CACHE1_DMA_PUSH) |= NV_PFIFO_CACHE1_DMA_PUSH_STATUS; // suspend pusher
@@ -405,9 +488,9 @@ void pfifo::Impl::puller(const std::stop_token &stok, std::coroutine_handle<Coro
 	coro(); // switch to pusher (this only happens at startup)
 
 	// These three are used when the puller encounters an error
-	std::string err_msg("");
-	const std::string hash_err("Puller exception: hashing failed, no matching object found. Method 0x%08" PRIX32 ", subchannel %" PRIu32 ", parameter 0x%08" PRIX32);
-	const std::string sw_method("Puller exception: software method. Method 0x%08" PRIX32 ", subchannel %" PRIu32 ", parameter 0x%08" PRIX32);
+	const char *err_msg = nullptr;
+	const char *const hash_err = "Puller exception: hashing failed, no matching object found. Method 0x%08" PRIX32 ", subchannel %" PRIu32 ", parameter 0x%08" PRIX32;
+	const char *const sw_method = "Puller exception: software method. Method 0x%08" PRIX32 ", subchannel %" PRIu32 ", parameter 0x%08" PRIX32;
 	uint32_t err_code = 0;
 
 	auto &&wait_for_idle = [this](uint32_t engine)
@@ -420,7 +503,9 @@ void pfifo::Impl::puller(const std::stop_token &stok, std::coroutine_handle<Coro
 				}
 				else if (last_engine == NV_RAMHT_ENGINE_GRAPHICS) {
 					// wait for pgraph to become idle
-					while (m_pgraph->read32(NV_PGRAPH_STATUS)) {}
+					uint64_t idle_start = timer::get_now();
+					m_pgraph->waitForIdle();
+					m_idle_time.fetch_add(timer::get_now() - idle_start, std::memory_order_relaxed);
 				}
 				else {
 					// NV_RAMHT_ENGINE_DVD might be the PMEDIA engine. This is currently not implemented, so abort here
@@ -429,6 +514,13 @@ void pfifo::Impl::puller(const std::stop_token &stok, std::coroutine_handle<Coro
 			}
 		};
 
+	// Methods that are sent to the bound engine as they are
+	auto &&is_plain_mthd = [](uint32_t mthd_entry)
+		{
+			uint32_t mthd = mthd_entry & NV_PFIFO_CACHE1_DMA_STATE_METHOD;
+			return (mthd >= 0x100) && ((mthd < 0x180) || (mthd >= 0x200));
+		};
+
 	while (true) {
 		uint32_t cache1_status = REG_PFIFO(NV_PFIFO_CACHE1_STATUS);
 
@@ -458,6 +550,45 @@ void pfifo::Impl::puller(const std::stop_token &stok, std::coroutine_handle<Coro
 		}
 
 		uint32_t cache1_get = REG_PFIFO(NV_PFIFO_CACHE1_GET);
+		if (uint32_t subchan = (REG_PFIFO(NV_PFIFO_CACHE1_METHOD(cache1_get >> 2)) & NV_PFIFO_CACHE1_DMA_STATE_SUBCHANNEL) >> 13;
+			is_plain_mthd(REG_PFIFO(NV_PFIFO_CACHE1_METHOD(cache1_get >> 2))) &&
+			(((REG_PFIFO(NV_PFIFO_CACHE1_ENGINE) >> (subchan << 2)) & 3) == NV_RAMHT_ENGINE_GRAPHICS)) {
+			// Fast path: pop the whole run of methods for the same subchannel that don't need a ramht lookup, and submit them with a single release of the lock
+			wait_for_idle(NV_RAMHT_ENGINE_GRAPHICS);
+			SET_REG(NV_PFIFO_CACHE1_PULL1, NV_PFIFO_CACHE1_PULL1_ENGINE, NV_RAMHT_ENGINE_GRAPHICS);
+
+			uint32_t mthds[CACHE1_NUM_OF_ENTRIES], params[CACHE1_NUM_OF_ENTRIES];
+			uint32_t num_of_entries = CACHE1_NUM_OF_ENTRIES - getCache1FreeEntries(), num_of_mthds = 0;
+			do {
+				uint32_t mthd_entry = REG_PFIFO(NV_PFIFO_CACHE1_METHOD(cache1_get >> 2));
+				if (!is_plain_mthd(mthd_entry) || (((mthd_entry & NV_PFIFO_CACHE1_DMA_STATE_SUBCHANNEL) >> 13) != subchan)) {
+					break;
+				}
+				mthds[num_of_mthds] = mthd_entry & NV_PFIFO_CACHE1_DMA_STATE_METHOD;
+				params[num_of_mthds] = REG_PFIFO(NV_PFIFO_CACHE1_DATA(cache1_get >> 2));
+				cache1_get = (cache1_get + 4) & 0x1FC;
+				++num_of_mthds;
+			} while (num_of_mthds < num_of_entries);
+
+			REG_PFIFO(NV_PFIFO_CACHE1_GET) = cache1_get;
+			if (cache1_get == REG_PFIFO(NV_PFIFO_CACHE1_PUT)) {
+				cache1_status |= NV_PFIFO_CACHE1_STATUS_LOW_MARK; // cache1 empty again
+			}
+			cache1_status &= ~NV_PFIFO_CACHE1_STATUS_HIGH_MARK; // cache1 no longer full
+			REG_PFIFO(NV_PFIFO_CACHE1_STATUS) = cache1_status;
+
+			// Release the lock since submitMethods will block if the pgraph queue is full
+			m_fifo_mtx.unlock();
+			m_pgraph->submitMethods(mthds, params, num_of_mthds, subchan);
+			m_fifo_mtx.lock();
+			updateThroughput(num_of_mthds);
+
+			if (stok.stop_requested()) [[unlikely]] {
+				break;
+			}
+			continue;
+		}
+
 		REG_PFIFO(NV_PFIFO_CACHE1_GET) = (cache1_get + 4) & 0x1FC;
 		if (REG_PFIFO(NV_PFIFO_CACHE1_GET) == REG_PFIFO(NV_PFIFO_CACHE1_PUT)) {
 			cache1_status |= NV_PFIFO_CACHE1_STATUS_LOW_MARK; // cache1 empty again
@@ -533,6 +664,7 @@ void pfifo::Impl::puller(const std::stop_token &stok, std::coroutine_handle<Coro
 			nxbx_fatal("Method 0x%08" PRIX32 ", subchannel %" PRIu32 ", parameter 0x%08" PRIX32 " not implemented", mthd, subchan, param);
 			break;
 		}
+		updateThroughput(1);
 
 		if (stok.stop_requested()) [[unlikely]] {
 			break;
@@ -541,8 +673,8 @@ void pfifo::Impl::puller(const std::stop_token &stok, std::coroutine_handle<Coro
 		continue;
 
 	puller_error:
-		assert((err_msg != "") && err_code);
-		logger_en(warn, err_msg.c_str(), mthd, subchan, param);
+		assert(err_msg && err_code);
+		logger_en(warn, err_msg, mthd, subchan, param);
 		REG_PFIFO(NV_PFIFO_CACHE1_PULL0) |= err_code; // set error code
 		REG_PFIFO(NV_PFIFO_CACHE1_DMA_PUSH) &= ~NV_PFIFO_CACHE1_DMA_PUSH_STATE; // clear pusher busy flag
 		REG_PFIFO(NV_PFIFO_CACHE1_GET) = cache1_get; // restart from the faulting method
@@ -550,7 +682,7 @@ void pfifo::Impl::puller(const std::stop_token &stok, std::coroutine_handle<Coro
 		m_puller_has_err.test_and_set();
 		m_fifo_mtx.unlock();
 		m_pmc->updateIrq();
-		err_msg = "";
+		err_msg = nullptr;
 		err_code = 0;
 		m_puller_has_err.wait(true);
 		m_fifo_mtx.lock();
@@ -572,6 +704,10 @@ void pfifo::Impl::fifoHandler(std::stop_token stok)
 	// This function is called in a separate thread, and acts as the pfifo pusher and puller
 
 	std::coroutine_handle<CoroFrame::promise_type> coro;
+	m_throughput_start = timer::get_now();
+	m_throughput_num_of_methods = 0;
+	m_throughput_fifo_idle = m_idle_time;
+	m_throughput_pgraph_idle = m_pgraph->getIdleTime();
 
 	try {
 		coro = pusher(stok).m_handle; // grab coro handle
@@ -584,6 +720,44 @@ void pfifo::Impl::fifoHandler(std::stop_token stok)
 	coro.destroy();
 }
 
+bool pfifo::Impl::isPusherRunning()
+{
+	return ((((REG_PFIFO(NV_PFIFO_CACHE1_PUSH0) & NV_PFIFO_CACHE1_PUSH0_ACCESS) << 1) |
+		(REG_PFIFO(NV_PFIFO_CACHE1_DMA_PUSH) & (NV_PFIFO_CACHE1_DMA_PUSH_ACCESS | NV_PFIFO_CACHE1_DMA_PUSH_STATUS))) ^
+		(NV_PFIFO_CACHE1_DMA_PUSH_ACCESS | (NV_PFIFO_CACHE1_PUSH0_ACCESS << 1))) == 0;
+}
+
+uint32_t pfifo::Impl::getCache1FreeEntries()
+{
+	uint32_t cache1_status = REG_PFIFO(NV_PFIFO_CACHE1_STATUS);
+	if (cache1_status & NV_PFIFO_CACHE1_STATUS_LOW_MARK) {
+		return CACHE1_NUM_OF_ENTRIES;
+	}
+	if (cache1_status & NV_PFIFO_CACHE1_STATUS_HIGH_MARK) {
+		return 0;
+	}
+	return ((REG_PFIFO(NV_PFIFO_CACHE1_GET) - REG_PFIFO(NV_PFIFO_CACHE1_PUT)) & 0x1FC) >> 2;
+}
+
+void pfifo::Impl::updateThroughput(uint32_t num_of_methods)
+{
+	// Averaged over periods of (at least) one second
+	m_throughput_num_of_methods += num_of_methods;
+	uint64_t now = timer::get_now(), elapsed = now - m_throughput_start;
+	if (elapsed >= timer::g_ticks_per_second) {
+		uint64_t methods_per_sec = m_throughput_num_of_methods * timer::g_ticks_per_second / elapsed;
+		m_methods_per_sec.store(methods_per_sec, std::memory_order_relaxed);
+		uint64_t fifo_idle = m_idle_time, pgraph_idle = m_pgraph->getIdleTime();
+		logger_en(info, "Throughput: %" PRIu64 " methods/s, ramht cache hits %" PRIu64 ", misses %" PRIu64 ", idle time fifo %" PRIu64 "%%, pgraph %" PRIu64 "%%",
+			methods_per_sec, m_ramht_cache_hits.load(), m_ramht_cache_misses.load(), std::min((fifo_idle - m_throughput_fifo_idle) * 100 / elapsed, (uint64_t)100),
+			std::min((pgraph_idle - m_throughput_pgraph_idle) * 100 / elapsed, (uint64_t)100));
+		m_throughput_start = now;
+		m_throughput_num_of_methods = 0;
+		m_throughput_fifo_idle = fifo_idle;
+		m_throughput_pgraph_idle = pgraph_idle;
+	}
+}
+
 pfifo::Impl::RamhtElement pfifo::Impl::ramhtSearch(uint32_t handle)
 {
 	// An object is referenced by a user defined 32 bit handle. The hw looks up objects in a hash table in the instance memory (ramin)
@@ -596,6 +770,13 @@ pfifo::Impl::RamhtElement pfifo::Impl::ramhtSearch(uint32_t handle)
 
 	uint32_t ramht_size = 1 << (((REG_PFIFO(NV_PFIFO_RAMHT) & NV_PFIFO_RAMHT_SIZE) >> 16) + 12);
 	uint32_t curr_chan_id = REG_PFIFO(NV_PFIFO_CACHE1_PUSH1) & NV_PFIFO_CACHE1_PUSH1_CHID;
+	RamhtCacheEntry &cache_entry = m_ramht_cache[(handle ^ (handle >> 8) ^ (handle >> 16) ^ (curr_chan_id << 3)) & (RAMHT_CACHE_SIZE - 1)];
+	if ((cache_entry.m_slot != RAMHT_CACHE_EMPTY) && (cache_entry.m_handle == handle) && (cache_entry.m_chid == curr_chan_id)) {
+		m_ramht_cache_hits.fetch_add(1, std::memory_order_relaxed);
+		return cache_entry.m_elem;
+	}
+	m_ramht_cache_misses.fetch_add(1, std::memory_order_relaxed);
+	uint32_t orig_handle = handle;
 	uint32_t ramht_bits = std::countr_zero(ramht_size) - 1;
 	uint32_t hash = 0;
 
@@ -616,13 +797,75 @@ pfifo::Impl::RamhtElement pfifo::Impl::ramhtSearch(uint32_t handle)
 	uint32_t entry_handle = m_pramin->read32(ramht_addr + hash * 8);
 	uint32_t entry_ctx = m_pramin->read32(ramht_addr + 4 + hash * 8);
 
-	return RamhtElement{
-		.m_handle = entry_handle,
-		.m_instance = (entry_ctx & NV_RAMHT_INSTANCE) << 4,
-		.m_engine = (entry_ctx & NV_RAMHT_ENGINE) >> 16,
-		.m_chid = (entry_ctx & NV_RAMHT_CHID) >> 24,
-		.m_valid = (entry_ctx & NV_RAMHT_STATUS) >> 31,
+	cache_entry = RamhtCacheEntry{
+		.m_handle = orig_handle,
+		.m_chid = curr_chan_id,
+		.m_slot = hash,
+		.m_elem = RamhtElement{
+			.m_handle = entry_handle,
+			.m_instance = (entry_ctx & NV_RAMHT_INSTANCE) << 4,
+			.m_engine = (entry_ctx & NV_RAMHT_ENGINE) >> 16,
+			.m_chid = (entry_ctx & NV_RAMHT_CHID) >> 24,
+			.m_valid = (entry_ctx & NV_RAMHT_STATUS) >> 31,
+		}
 	};
+
+	return cache_entry.m_elem;
+}
+
+void pfifo::Impl::startCapture()
+{
+	// Called by the cpu thread at the first DMA_PUT write after the capture was armed, so that the snapshot includes the channels and objects that the title
+	// created during its initialization. The pgraph registers are read first, because pgraph takes its own lock
+	nv2a_capture::header_t header;
+	std::memcpy(header.magic, nv2a_capture::g_magic, sizeof(header.magic));
+	header.version = NV2A_CAPTURE_VERSION;
+	header.ramsize = m_ramsize;
+	header.pmc_enable = m_pmc->read32(NV_PMC_ENABLE);
+	header.reserved = 0;
+	std::unique_ptr<uint32_t[]> pgraph_regs(new uint32_t[NV_PGRAPH_SIZE / 4]);
+	m_pgraph->saveRegs(pgraph_regs.get());
+
+	std::unique_lock lock(m_fifo_mtx);
+	m_capture_put_num = 0;
+	nv2a_capture::start(header, m_ram + m_ramsize - NV_PRAMIN_SIZE, m_regs, pgraph_regs.get());
+}
+
+void pfifo::Impl::loadRegs(const uint32_t *regs)
+{
+	std::unique_lock lock(m_fifo_mtx);
+	std::copy(regs, regs + NV_PFIFO_SIZE / 4, std::begin(m_regs));
+	flushRamhtCache();
+	lock.unlock();
+	m_fifo_has_work.test_and_set();
+	m_fifo_has_work.notify_one();
+}
+
+void pfifo::Impl::flushRamhtCache()
+{
+	// NOTE: m_fifo_mtx must be held by the caller, unless the fifo thread is not running
+	for (RamhtCacheEntry &entry : m_ramht_cache) {
+		entry.m_slot = RAMHT_CACHE_EMPTY;
+	}
+	m_ramht_offset.store((REG_PFIFO(NV_PFIFO_RAMHT) & NV_PFIFO_RAMHT_BASE_ADDRESS) << 8, std::memory_order_relaxed);
+	m_ramht_size.store(1 << (((REG_PFIFO(NV_PFIFO_RAMHT) & NV_PFIFO_RAMHT_SIZE) >> 16) + 12), std::memory_order_relaxed);
+}
+
+void pfifo::Impl::invalidateRamht(uint32_t offset)
+{
+	// Called by pramin for every write to ramin, so only the writes that land inside the ramht take the lock
+	uint32_t ramht_offset = offset - m_ramht_offset.load(std::memory_order_relaxed);
+	if (ramht_offset >= m_ramht_size.load(std::memory_order_relaxed)) {
+		return;
+	}
+
+	uint32_t slot = ramht_offset >> 3;
+	std::unique_lock lock(m_fifo_mtx);
+	for (RamhtCacheEntry &entry : m_ramht_cache) {
+		if (entry.m_slot == slot) {
+			entry.m_slot = RAMHT_CACHE_EMPTY;
+		}
+	}
 }
 
 void
@@ -735,6 +978,7 @@ pfifo::Impl::reset()
 	REG_PFIFO(NV_PFIFO_RAMHT) = 0x00000100;
 	REG_PFIFO(NV_PFIFO_RAMFC) = 0x008A0110;
 	REG_PFIFO(NV_PFIFO_RAMRO) = 0x00000114;
+	flushRamhtCache();
 }
 
 void pfifo::Impl::init(cpu *cpu, nv2a *gpu)
@@ -748,6 +992,11 @@ void pfifo::Impl::init(cpu *cpu, nv2a *gpu)
 	updateIo(false);
 
 	m_ram = get_ram_ptr(m_lc86cpu);
+	m_ramsize = cpu->getRamsize();
+	m_capture_put_num = 0;
+	if (const char *capture_path = get_settings()->get_string_value("core", "gpu_capture_file", ""); capture_path && *capture_path) {
+		nv2a_capture::init(capture_path);
+	}
 	m_jthr = std::jthread(std::bind_front(&pfifo::Impl::fifoHandler, this));
 }
 
@@ -763,6 +1012,7 @@ void pfifo::Impl::deinit()
 	m_fifo_has_work.test_and_set();
 	m_fifo_has_work.notify_one();
 	m_jthr.join();
+	nv2a_capture::deinit();
 }
 
 /** Public interface implementation **/
@@ -796,5 +1046,35 @@ void pfifo::write32(uint32_t addr, const uint32_t value)
 	m_impl->write32<false, on>(addr, value);
 }
 
+uint64_t pfifo::getMethodsPerSecond()
+{
+	return m_impl->getMethodsPerSecond();
+}
+
+void pfifo::invalidateRamht(uint32_t offset)
+{
+	m_impl->invalidateRamht(offset);
+}
+
+uint64_t pfifo::getRamhtCacheHits()
+{
+	return m_impl->getRamhtCacheHits();
+}
+
+uint64_t pfifo::getRamhtCacheMisses()
+{
+	return m_impl->getRamhtCacheMisses();
+}
+
+uint64_t pfifo::getIdleTime()
+{
+	return m_impl->getIdleTime();
+}
+
+void pfifo::loadRegs(const uint32_t *regs)
+{
+	m_impl->loadRegs(regs);
+}
+
 pfifo::pfifo() : m_impl{std::make_unique<pfifo::Impl>()} {}
 pfifo::~pfifo() {}
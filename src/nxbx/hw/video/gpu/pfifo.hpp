@@ -104,6 +104,12 @@ public:
 	void updateIo();
 	uint32_t read32(uint32_t addr);
 	void write32(uint32_t addr, const uint32_t value);
+	uint64_t getMethodsPerSecond(); // number of methods sent to the engines in the last second
+	void invalidateRamht(uint32_t offset); // called by pramin when ramin is written at offset
+	uint64_t getRamhtCacheHits();
+	uint64_t getRamhtCacheMisses();
+	uint64_t getIdleTime(); // total time (in us) that the fifo thread was idle
+	void loadRegs(const uint32_t *regs); // used by the gpu replay, the registers are an array of NV_PFIFO_SIZE bytes
 
 private:
 	class Impl;
@@ -4,20 +4,34 @@
 #include "lib86cpu.hpp"
 #include "pramin.hpp"
 #include "pmc.hpp"
+#include "ptimer.hpp"
 #include "pgraph.hpp"
 // Must be included last because of the template functions nv2a_read/write, which require a complete definition for the engine objects
 #include "nv2a.hpp"
 #include "util.hpp"
+#include "isettings.hpp"
+#include "clock.hpp"
+#include "nv2a_capture.hpp"
+#include "raster.hpp"
+#include "blit.hpp"
 #include <thread>
 #include <atomic>
 #include <mutex>
 #include <cassert>
 #include <cinttypes>
 #include <cstring>
+#include <algorithm>
+#include <bit>
 #ifdef _WIN32
 #undef max
 #endif
 #include "spsc-queue.hpp"
+#if defined(__x86_64__) || defined(_M_X64)
+#include <immintrin.h>
+#define CPU_RELAX() _mm_pause()
+#else
+#define CPU_RELAX()
+#endif
 
 #define MODULE_NAME pgraph
 
@@ -51,9 +65,20 @@ __func__, mthd, subchan, param)
 #define CTX_SWITCH_CHID 0x1F // target channel
 #define CTX_SWITCH_STATUS (1 << 31) // switch requested=1
 
+#define PGRAPH_QUEUE_DEFAULT_SIZE 256 // default number of entries of the input queue, can be changed with the "pgraph_queue_size" ini key
+#define PGRAPH_QUEUE_MIN_SIZE 16
+#define PGRAPH_QUEUE_MAX_SIZE 65536
+#define PGRAPH_BATCH_SIZE 64 // max number of methods moved in one go through the input queue
+#define PGRAPH_IDLE_SPIN_MIN 16 // bounds of the number of spins done by waitForIdle before sleeping on the status word
+#define PGRAPH_IDLE_SPIN_MAX 4096
+
 // Constant register offsets of the vertex processor when using the fixed function pipeline
 #define NV_IGRAPH_XF_XFCTX_EYEP              0x38
 
+// Vertex attributes used by the rasterizer
+#define NV097_VTX_ATTR_POSITION              0
+#define NV097_VTX_ATTR_DIFFUSE               3
+
 #include "nv2a_classes.hpp"
 
 struct NvNotification
@@ -88,6 +113,14 @@ public:
 		}
 		submitMethod(mthd, param, subchan, ctx_switch);
 	}
+	void submitMethods(const uint32_t *mthds, const uint32_t *params, uint32_t num_of_mthds, uint32_t subchan);
+	void waitForIdle();
+	uint64_t getIdleTime() { return m_idle_time.load(std::memory_order_relaxed); }
+	bool isIdle();
+	void saveRegs(uint32_t *regs);
+	void loadRegs(const uint32_t *regs);
+	void enableMethodStats();
+	std::vector<uint64_t> getMethodStats();
 
 	// method friend declarations
 	friend void unimplemented_method(MTHD_HANDLER_ARGS);
@@ -95,11 +128,27 @@ public:
 	friend void dispatch_nv039(MTHD_HANDLER_ARGS);
 	friend void NV039_SET_OBJECT(MTHD_HANDLER_ARGS);
 	friend void NV039_SET_CONTEXT_DMA_NOTIFIES(MTHD_HANDLER_ARGS);
+	friend void nv039_write_notification(pgraph::ImplAlias *impl, uint32_t mthd, uint32_t idx, uint16_t status);
+	friend void NV039_NOTIFY(MTHD_HANDLER_ARGS);
+	friend void NV039_SET_CONTEXT_DMA_BUFFER_IN(MTHD_HANDLER_ARGS);
+	friend void NV039_SET_CONTEXT_DMA_BUFFER_OUT(MTHD_HANDLER_ARGS);
+	friend void NV039_OFFSET_IN(MTHD_HANDLER_ARGS);
+	friend void NV039_OFFSET_OUT(MTHD_HANDLER_ARGS);
+	friend void NV039_PITCH_IN(MTHD_HANDLER_ARGS);
+	friend void NV039_PITCH_OUT(MTHD_HANDLER_ARGS);
+	friend void NV039_LINE_LENGTH_IN(MTHD_HANDLER_ARGS);
+	friend void NV039_LINE_COUNT(MTHD_HANDLER_ARGS);
+	friend void NV039_FORMAT(MTHD_HANDLER_ARGS);
+	friend void NV039_BUFFER_NOTIFY(MTHD_HANDLER_ARGS);
 
 	friend void dispatch_nv062(MTHD_HANDLER_ARGS);
 	friend void NV062_SET_OBJECT(MTHD_HANDLER_ARGS);
 	friend void NV062_SET_CONTEXT_DMA_IMAGE_SOURCE(MTHD_HANDLER_ARGS);
 	friend void NV062_SET_CONTEXT_DMA_IMAGE_DESTIN(MTHD_HANDLER_ARGS);
+	friend void NV062_SET_COLOR_FORMAT(MTHD_HANDLER_ARGS);
+	friend void NV062_SET_PITCH(MTHD_HANDLER_ARGS);
+	friend void NV062_SET_OFFSET_SOURCE(MTHD_HANDLER_ARGS);
+	friend void NV062_SET_OFFSET_DESTIN(MTHD_HANDLER_ARGS);
 
 	friend void dispatch_nv097(MTHD_HANDLER_ARGS);
 	friend void nv097_set_dma_obj(pgraph::ImplAlias *impl, uint32_t param, uint32_t idx);
@@ -111,11 +160,51 @@ public:
 	friend void NV097_SET_EDGE_FLAG(MTHD_HANDLER_ARGS);
 	friend void NV097_SET_SEMAPHORE_OFFSET(MTHD_HANDLER_ARGS);
 	friend void NV097_BACK_END_WRITE_SEMAPHORE_RELEASE(MTHD_HANDLER_ARGS);
+	friend void nv097_update_raster_state(pgraph::ImplAlias *impl);
+	friend void nv097_draw_triangle(pgraph::ImplAlias *impl, const raster_vertex &v0, const raster_vertex &v1, const raster_vertex &v2,
+		const raster_vertex &provoking);
+	friend void nv097_emit_vertex(pgraph::ImplAlias *impl, const raster_vertex &vtx);
+	friend void nv097_emit_current_vertex(pgraph::ImplAlias *impl);
+	friend void nv097_fetch_vertex(pgraph::ImplAlias *impl, uint32_t index);
+	friend void NV097_SET_SURFACE_CLIP_HORIZONTAL(MTHD_HANDLER_ARGS);
+	friend void NV097_SET_SURFACE_CLIP_VERTICAL(MTHD_HANDLER_ARGS);
+	friend void NV097_SET_SURFACE_FORMAT(MTHD_HANDLER_ARGS);
+	friend void NV097_SET_SURFACE_PITCH(MTHD_HANDLER_ARGS);
+	friend void NV097_SET_SURFACE_COLOR_OFFSET(MTHD_HANDLER_ARGS);
+	friend void NV097_SET_SURFACE_ZETA_OFFSET(MTHD_HANDLER_ARGS);
+	friend void NV097_SET_CULL_FACE_ENABLE(MTHD_HANDLER_ARGS);
+	friend void NV097_SET_DEPTH_TEST_ENABLE(MTHD_HANDLER_ARGS);
+	friend void NV097_SET_DEPTH_FUNC(MTHD_HANDLER_ARGS);
+	friend void NV097_SET_COLOR_MASK(MTHD_HANDLER_ARGS);
+	friend void NV097_SET_DEPTH_MASK(MTHD_HANDLER_ARGS);
+	friend void NV097_SET_SHADE_MODE(MTHD_HANDLER_ARGS);
+	friend void NV097_SET_CULL_FACE(MTHD_HANDLER_ARGS);
+	friend void NV097_SET_FRONT_FACE(MTHD_HANDLER_ARGS);
+	friend void NV097_SET_VERTEX3F(MTHD_HANDLER_ARGS);
+	friend void NV097_SET_VERTEX4F(MTHD_HANDLER_ARGS);
+	friend void NV097_SET_VERTEX_DATA_ARRAY_OFFSET(MTHD_HANDLER_ARGS);
+	friend void NV097_SET_VERTEX_DATA_ARRAY_FORMAT(MTHD_HANDLER_ARGS);
+	friend void NV097_SET_BEGIN_END(MTHD_HANDLER_ARGS);
+	friend void NV097_ARRAY_ELEMENT16(MTHD_HANDLER_ARGS);
+	friend void NV097_ARRAY_ELEMENT32(MTHD_HANDLER_ARGS);
+	friend void NV097_DRAW_ARRAYS(MTHD_HANDLER_ARGS);
+	friend void NV097_INLINE_ARRAY(MTHD_HANDLER_ARGS);
+	friend void NV097_SET_VERTEX_DATA2F_M(MTHD_HANDLER_ARGS);
+	friend void NV097_SET_VERTEX_DATA4UB(MTHD_HANDLER_ARGS);
+	friend void NV097_SET_VERTEX_DATA4F_M(MTHD_HANDLER_ARGS);
+	friend void NV097_SET_ZSTENCIL_CLEAR_VALUE(MTHD_HANDLER_ARGS);
+	friend void NV097_SET_COLOR_CLEAR_VALUE(MTHD_HANDLER_ARGS);
+	friend void NV097_CLEAR_SURFACE(MTHD_HANDLER_ARGS);
+	friend void NV097_SET_CLEAR_RECT_HORIZONTAL(MTHD_HANDLER_ARGS);
+	friend void NV097_SET_CLEAR_RECT_VERTICAL(MTHD_HANDLER_ARGS);
 
 	friend void dispatch_nv09f(MTHD_HANDLER_ARGS);
 	friend void nv09f_set_dma_obj(pgraph::ImplAlias *impl, uint32_t param, uint32_t gr_class, uint32_t idx);
 	friend void NV09F_SET_OBJECT(MTHD_HANDLER_ARGS);
 	friend void NV09F_SET_OPERATION(MTHD_HANDLER_ARGS);
+	friend void NV09F_CONTROL_POINT_IN(MTHD_HANDLER_ARGS);
+	friend void NV09F_CONTROL_POINT_OUT(MTHD_HANDLER_ARGS);
+	friend void NV09F_SIZE(MTHD_HANDLER_ARGS);
 
 private:
 	struct InputQueueEntry
@@ -132,16 +221,21 @@ private:
 	template<bool is_write>
 	auto getIoFunc(bool log, bool enabled, bool is_be);
 	void graphHandler(std::stop_token stok);
+	void clearBusy();
 	void submitMethod(uint32_t mthd, uint32_t param, uint32_t subchan, uint32_t ctx_switch);
 
 	uint8_t *m_ram;
+	uint32_t m_ramsize;
 	std::jthread m_jthr; // async graphics worker thread
 	std::atomic_flag m_graph_has_work;
 	std::atomic_flag m_ctx_switch_trig;
 	std::atomic_uint32_t m_is_enabled;
 	std::mutex m_graph_mtx;
-	dro::SPSCQueue<InputQueueEntry> m_input_queue{256};
+	std::unique_ptr<dro::SPSCQueue<InputQueueEntry>> m_input_queue;
+	uint32_t m_input_queue_size;
 	uint32_t m_should_exit; // 0: exit, 3: continue
+	// Number of times each method of each class was executed, indexed by class * PGRAPH_NUM_OF_MTHDS + method / 4. Empty unless enableMethodStats was called
+	std::vector<uint64_t> m_mthd_stats;
 	// classes states
 	struct
 	{
@@ -149,6 +243,15 @@ private:
 		uint32_t m_instance_addr;
 		uint32_t m_notification_addr;
 		bool m_notification_active[2];
+		uint32_t m_buffer_in_addr;
+		uint32_t m_buffer_out_addr;
+		uint32_t m_offset_in;
+		uint32_t m_offset_out;
+		int32_t m_pitch_in;
+		int32_t m_pitch_out;
+		uint32_t m_line_length;
+		uint32_t m_line_count;
+		uint32_t m_format;
 	} m_memcpy;
 	struct
 	{
@@ -156,6 +259,10 @@ private:
 		uint32_t m_instance_addr;
 		uint32_t m_img_src_addr;
 		uint32_t m_img_dst_addr;
+		uint32_t m_color_format;
+		uint32_t m_pitch; // src pitch in bits 0-15, dst pitch in bits 16-31
+		uint32_t m_src_offset;
+		uint32_t m_dst_offset;
 	} m_ctx_surfaces_2d;
 	struct
 	{
@@ -177,6 +284,47 @@ private:
 			// or with a relative address from the address register -> c[a0.x + n], where a0.x is a signed offset. Out of range reads always return (0.0, 0.0, 0.0, 0.0).
 			uint32_t m_const[NV2A_NUM_VTX_SHADER_CONST_REGS][4];
 		} m_vtx_shader;
+		struct
+		{
+			uint32_t m_clip_horizontal;
+			uint32_t m_clip_vertical;
+			uint32_t m_format;
+			uint32_t m_pitch;
+			uint32_t m_color_offset;
+			uint32_t m_zeta_offset;
+		} m_surface;
+		uint32_t m_cull_face_enable;
+		uint32_t m_depth_test_enable;
+		uint32_t m_depth_func;
+		uint32_t m_color_mask;
+		uint32_t m_depth_mask;
+		uint32_t m_shade_mode;
+		uint32_t m_cull_face;
+		uint32_t m_front_face;
+		uint32_t m_zstencil_clear_value;
+		uint32_t m_color_clear_value;
+		uint32_t m_clear_rect_horizontal;
+		uint32_t m_clear_rect_vertical;
+		bool m_raster_state_dirty; // the surfaces or the render state changed after the state of the rasterizer was last updated
+		struct
+		{
+			uint32_t m_offset[NV2A_NUM_VTX_ATTRS];
+			uint32_t m_format[NV2A_NUM_VTX_ATTRS];
+		} m_vtx_arrays;
+		// Current value of the vertex attributes. Used by the immediate mode methods, and for the attributes that are not fetched from the arrays
+		float m_vtx_attrs[NV2A_NUM_VTX_ATTRS][4];
+		struct
+		{
+			// Primitive being assembled between the two NV097_SET_BEGIN_END methods
+			uint32_t m_op; // NV097_SET_BEGIN_END_OP_*, END when there isn't a primitive
+			uint32_t m_num_of_vtx; // vertices received after NV097_SET_BEGIN_END
+			raster_vertex m_vtx[4]; // vertices that are not yet part of a triangle, and the first vertex of fans and polygons
+			DmaObj m_vtx_dma[2]; // dma objects of the vertex arrays, class_type is NV01_NULL when not bound
+			uint32_t m_inline_dwords[NV2A_NUM_VTX_ATTRS * 4]; // dwords of the vertex being received with NV097_INLINE_ARRAY
+			uint32_t m_num_of_inline_dwords;
+			uint32_t m_inline_vtx_size; // in dwords
+			uint32_t m_inline_attr_offset[NV2A_NUM_VTX_ATTRS]; // in dwords
+		} m_prim;
 	} m_kelvin;
 	struct
 	{
@@ -184,6 +332,8 @@ private:
 		uint32_t m_instance_addr;
 		uint32_t m_dma_obj_instance_addr[8];
 		uint32_t m_operation;
+		uint32_t m_point_in; // x in bits 0-15, y in bits 16-31
+		uint32_t m_point_out;
 	} m_img_blit;
 	// Make sure we can safely use memset on the method classes structs
 	static_assert(std::is_trivially_copyable_v<decltype(m_memcpy)>);
@@ -193,13 +343,19 @@ private:
 	// connected devices
 	pmc *m_pmc;
 	pramin *m_pramin;
+	ptimer *m_ptimer;
 	cpu_t *m_lc86cpu;
 	nv2a *m_nv2a;
+	rasterizer m_raster;
 	// atomic registers
 	std::atomic_uint32_t m_int_status;
 	std::atomic_uint32_t m_int_enabled;
 	std::atomic_uint32_t m_fifo_access;
-	std::atomic_uint32_t m_busy;
+	std::atomic_uint32_t m_busy; // also waited on by the fifo thread in waitForIdle
+	// Number of spins done by waitForIdle before sleeping, only accessed by the fifo thread
+	uint32_t m_idle_spin_limit;
+	// Time (in us) that the graph thread spent waiting for methods or for a context switch
+	std::atomic_uint64_t m_idle_time;
 	// registers
 	uint32_t m_regs[NV_PGRAPH_SIZE / 4];
 	const std::unordered_map<uint32_t, const std::string> m_regs_info =
@@ -236,190 +392,1062 @@ void unimplemented_method(MTHD_HANDLER_ARGS)
 	impl->m_graph_has_work.test_and_set();
 }
 
-void NV039_SET_OBJECT(MTHD_HANDLER_ARGS)
+void NV039_SET_OBJECT(MTHD_HANDLER_ARGS)
+{
+	// Binds the engine object to the subchannel
+
+	LOG_MTHD();
+	impl->m_memcpy.m_instance_addr = param;
+}
+
+void NV039_SET_CONTEXT_DMA_NOTIFIES(MTHD_HANDLER_ARGS)
+{
+	// param is the instance address of an array of two NvNotification structs. The first element is used by NV039_NOTIFY, and the second is used by NV039_BUFFER_NOTIFY.
+	// Both notifications need to be first activated with NV039_NOTIFY and NV039_BUFFER_NOTIFY respectively. Once activated, the first notification is populated by the
+	// gpu following the completion of the next method that is not a notification method itself
+
+	LOG_MTHD();
+	IMPL(m_memcpy);
+	class_impl->m_notification_addr = param;
+	class_impl->m_notification_active[NV039_NOTIFIERS_NOTIFY] = false;
+}
+
+void nv039_write_notification(pgraph::ImplAlias *impl, uint32_t mthd, uint32_t idx, uint16_t status)
+{
+	IMPL(m_memcpy);
+	if (class_impl->m_notification_addr == UNBOUND_OBJ_ADDR) {
+		return;
+	}
+
+	DmaObj obj = impl->m_nv2a->getDmaObj(class_impl->m_notification_addr);
+	uint64_t offset = idx * sizeof(NvNotification);
+	if ((obj.class_type == NV01_NULL) || ((offset + sizeof(NvNotification)) > ((uint64_t)obj.limit + 1)) ||
+		((obj.target_addr + offset + sizeof(NvNotification)) > impl->m_ramsize)) {
+		logger_en(warn, "Notification %" PRIu32 " is outside of its dma object, ignored", idx);
+		return;
+	}
+
+	NvNotification notification;
+	notification.timestamp = impl->m_ptimer->readTime();
+	notification.info32 = class_impl->m_instance_addr;
+	notification.info16 = mthd;
+	notification.status = status;
+	std::memcpy(impl->m_ram + obj.target_addr + offset, &notification, sizeof(NvNotification));
+}
+
+void NV039_NOTIFY(MTHD_HANDLER_ARGS)
+{
+	// Activates the first notification, which is written when the next transfer completes
+
+	LOG_MTHD();
+	if (param == NV039_NOTIFY_WRITE_THEN_AWAKEN) {
+		logger_en(warn, "Notify interrupts are not supported, the notification will only be written");
+	}
+	impl->m_memcpy.m_notification_active[NV039_NOTIFIERS_NOTIFY] = true;
+}
+
+void NV039_SET_CONTEXT_DMA_BUFFER_IN(MTHD_HANDLER_ARGS)
+{
+	// Sets the address of the dma object that translates the address of the src buffer
+
+	LOG_MTHD();
+	impl->m_memcpy.m_buffer_in_addr = param;
+}
+
+void NV039_SET_CONTEXT_DMA_BUFFER_OUT(MTHD_HANDLER_ARGS)
+{
+	// Sets the address of the dma object that translates the address of the dst buffer
+
+	LOG_MTHD();
+	impl->m_memcpy.m_buffer_out_addr = param;
+}
+
+void NV039_OFFSET_IN(MTHD_HANDLER_ARGS)
+{
+	// Sets the offset of the first line of the src buffer from the base of its dma object
+
+	LOG_MTHD();
+	impl->m_memcpy.m_offset_in = param;
+}
+
+void NV039_OFFSET_OUT(MTHD_HANDLER_ARGS)
+{
+	// Sets the offset of the first line of the dst buffer from the base of its dma object
+
+	LOG_MTHD();
+	impl->m_memcpy.m_offset_out = param;
+}
+
+void NV039_PITCH_IN(MTHD_HANDLER_ARGS)
+{
+	// Sets the distance in bytes between the lines of the src buffer. It's signed, so that the lines can be read bottom-up
+
+	LOG_MTHD();
+	impl->m_memcpy.m_pitch_in = (int32_t)param;
+}
+
+void NV039_PITCH_OUT(MTHD_HANDLER_ARGS)
+{
+	// Sets the distance in bytes between the lines of the dst buffer. It's signed, so that the lines can be written bottom-up
+
+	LOG_MTHD();
+	impl->m_memcpy.m_pitch_out = (int32_t)param;
+}
+
+void NV039_LINE_LENGTH_IN(MTHD_HANDLER_ARGS)
+{
+	// Sets the number of bytes to copy in each line
+
+	LOG_MTHD();
+	impl->m_memcpy.m_line_length = param;
+}
+
+void NV039_LINE_COUNT(MTHD_HANDLER_ARGS)
+{
+	// Sets the number of lines to copy
+
+	LOG_MTHD();
+	impl->m_memcpy.m_line_count = param;
+}
+
+void NV039_FORMAT(MTHD_HANDLER_ARGS)
+{
+	// Sets the distance in bytes between the bytes read (bits 0-2) and written (bits 8-10) in a line. Only 1 is used in practice
+
+	LOG_MTHD();
+	impl->m_memcpy.m_format = param;
+}
+
+void NV039_BUFFER_NOTIFY(MTHD_HANDLER_ARGS)
+{
+	// Starts the transfer with the current state, and then writes the second notification (and the first one too, if NV039_NOTIFY activated it)
+
+	LOG_MTHD();
+	IMPL(m_memcpy);
+	if (param == NV039_NOTIFY_WRITE_THEN_AWAKEN) {
+		logger_en(warn, "Notify interrupts are not supported, the notification will only be written");
+	}
+	if (class_impl->m_format != ((1 << 8) | 1)) {
+		logger_en(warn, "Transfer format 0x%08" PRIX32 " is not supported, the bytes will be copied contiguously", class_impl->m_format);
+	}
+
+	// Returns a pointer to the first line, or nullptr if any line is outside of the dma object of the buffer
+	uint32_t line_length = class_impl->m_line_length, line_count = class_impl->m_line_count;
+	auto get_buffer = [impl, line_length, line_count](uint32_t dma_addr, uint32_t offset, int32_t pitch) -> uint8_t *
+		{
+			if (dma_addr == UNBOUND_OBJ_ADDR) {
+				return nullptr;
+			}
+			DmaObj obj = impl->m_nv2a->getDmaObj(dma_addr);
+			int64_t last = (int64_t)(line_count - 1) * pitch;
+			int64_t start = offset + std::min<int64_t>(last, 0), end = offset + std::max<int64_t>(last, 0) + line_length;
+			if ((obj.class_type == NV01_NULL) || (start < 0) || (end > ((int64_t)obj.limit + 1)) || ((obj.target_addr + end) > impl->m_ramsize)) {
+				return nullptr;
+			}
+			return impl->m_ram + obj.target_addr + offset;
+		};
+
+	uint16_t status = NV039_NOTIFICATION_STATUS_DONE_SUCCESS;
+	if (line_length && line_count) {
+		const uint8_t *src = get_buffer(class_impl->m_buffer_in_addr, class_impl->m_offset_in, class_impl->m_pitch_in);
+		uint8_t *dst = get_buffer(class_impl->m_buffer_out_addr, class_impl->m_offset_out, class_impl->m_pitch_out);
+		if ((src == nullptr) || (dst == nullptr)) {
+			logger_en(warn, "Transfer of %" PRIu32 " lines of %" PRIu32 " bytes is outside of the src or dst buffer, ignored", line_count, line_length);
+			status = NV039_NOTIFICATION_STATUS_ERROR_PROTECTION_FAULT;
+		}
+		else {
+			// The buffers might be surfaces of kelvin, so its pending triangles need to be drawn first
+			impl->m_raster.flush();
+			copy_lines(dst, src, class_impl->m_pitch_out, class_impl->m_pitch_in, line_length, line_count);
+		}
+	}
+
+	nv039_write_notification(impl, mthd, NV039_NOTIFIERS_BUFFER_NOTIFY, status);
+	if (class_impl->m_notification_active[NV039_NOTIFIERS_NOTIFY]) {
+		class_impl->m_notification_active[NV039_NOTIFIERS_NOTIFY] = false;
+		nv039_write_notification(impl, mthd, NV039_NOTIFIERS_NOTIFY, status);
+	}
+}
+
+void NV062_SET_OBJECT(MTHD_HANDLER_ARGS)
+{
+	// Binds the engine object to the subchannel
+
+	LOG_MTHD();
+	impl->m_ctx_surfaces_2d.m_instance_addr = param;
+}
+
+void NV062_SET_CONTEXT_DMA_IMAGE_SOURCE(MTHD_HANDLER_ARGS)
+{
+	// Sets the address of the dma object that translates the address of the src image used during a blit
+
+	LOG_MTHD();
+	impl->m_ctx_surfaces_2d.m_img_src_addr = param;
+}
+
+void NV062_SET_CONTEXT_DMA_IMAGE_DESTIN(MTHD_HANDLER_ARGS)
+{
+	// Sets the address of the dma object that translates the address of the dst image used during a blit
+
+	LOG_MTHD();
+	impl->m_ctx_surfaces_2d.m_img_dst_addr = param;
+}
+
+void NV062_SET_COLOR_FORMAT(MTHD_HANDLER_ARGS)
+{
+	// Sets the color format of both the src and dst images
+
+	LOG_MTHD();
+	impl->m_ctx_surfaces_2d.m_color_format = param;
+}
+
+void NV062_SET_PITCH(MTHD_HANDLER_ARGS)
+{
+	// Sets the pitch of the src (bits 0-15) and dst (bits 16-31) images
+
+	LOG_MTHD();
+	impl->m_ctx_surfaces_2d.m_pitch = param;
+}
+
+void NV062_SET_OFFSET_SOURCE(MTHD_HANDLER_ARGS)
+{
+	// Sets the offset of the src image from the base of its dma object
+
+	LOG_MTHD();
+	impl->m_ctx_surfaces_2d.m_src_offset = param;
+}
+
+void NV062_SET_OFFSET_DESTIN(MTHD_HANDLER_ARGS)
+{
+	// Sets the offset of the dst image from the base of its dma object
+
+	LOG_MTHD();
+	impl->m_ctx_surfaces_2d.m_dst_offset = param;
+}
+
+void nv097_set_dma_obj(pgraph::ImplAlias *impl, uint32_t param, uint32_t idx)
+{
+	DmaObj obj = impl->m_nv2a->getDmaObj(param);
+	impl->m_kelvin.m_dma_obj_instance_addr[idx] = obj.class_type != NV01_NULL ? param : UNBOUND_OBJ_ADDR;
+	impl->m_kelvin.m_raster_state_dirty = true;
+}
+
+void NV097_SET_OBJECT(MTHD_HANDLER_ARGS)
+{
+	// Binds the engine object to the subchannel
+
+	LOG_MTHD();
+	impl->m_kelvin.m_instance_addr = param;
+}
+
+void NV097_SET_CONTEXT_DMA_NOTIFIES(MTHD_HANDLER_ARGS)
+{
+	// Same as NV039_SET_CONTEXT_DMA_NOTIFIES, but for nv97
+
+	LOG_MTHD();
+	IMPL(m_kelvin);
+	class_impl->m_dma_obj_instance_addr[NV097_OBJ_NOTIFIES_idx] = param;
+	class_impl->m_notification_active = false;
+}
+
+void NV097_SET_CONTEXT_DMA_A(MTHD_HANDLER_ARGS)
+{
+	LOG_MTHD();
+	nv097_set_dma_obj(impl, param, NV097_OBJ_A_idx);
+}
+
+void NV097_SET_CONTEXT_DMA_B(MTHD_HANDLER_ARGS)
+{
+	LOG_MTHD();
+	nv097_set_dma_obj(impl, param, NV097_OBJ_B_idx);
+}
+
+void NV097_SET_CONTEXT_DMA_STATE(MTHD_HANDLER_ARGS)
+{
+	LOG_MTHD();
+	nv097_set_dma_obj(impl, param, NV097_OBJ_STATE_idx);
+}
+
+void NV097_SET_CONTEXT_DMA_COLOR(MTHD_HANDLER_ARGS)
+{
+	// Sets the dma object of the color surface
+
+	LOG_MTHD();
+	nv097_set_dma_obj(impl, param, NV097_OBJ_COLOR_idx);
+}
+
+void NV097_SET_CONTEXT_DMA_ZETA(MTHD_HANDLER_ARGS)
+{
+	// Sets the dma object of the zeta (depth and stencil) surface
+
+	LOG_MTHD();
+	nv097_set_dma_obj(impl, param, NV097_OBJ_ZETA_idx);
+}
+
+void NV097_SET_CONTEXT_DMA_VERTEX_A(MTHD_HANDLER_ARGS)
+{
+	LOG_MTHD();
+	nv097_set_dma_obj(impl, param, NV097_OBJ_VTXA_idx);
+}
+
+void NV097_SET_CONTEXT_DMA_VERTEX_B(MTHD_HANDLER_ARGS)
+{
+	LOG_MTHD();
+	nv097_set_dma_obj(impl, param, NV097_OBJ_VTXB_idx);
+}
+
+void NV097_SET_CONTEXT_DMA_SEMAPHORE(MTHD_HANDLER_ARGS)
+{
+	// Sets up the semaphore dma object of pgraph
+
+	LOG_MTHD();
+	IMPL(m_kelvin);
+	DmaObj obj = impl->m_nv2a->getDmaObj(param);
+	if (obj.class_type != NV01_NULL) {
+		class_impl->m_dma_semaphore.base = impl->m_ram + obj.target_addr;
+		class_impl->m_dma_semaphore.limit = obj.limit;
+		class_impl->m_dma_obj_instance_addr[NV097_OBJ_SEMAPHORE_idx] = param;
+		return;
+	}
+
+	class_impl->m_dma_obj_instance_addr[NV097_OBJ_SEMAPHORE_idx] = UNBOUND_OBJ_ADDR;
+}
+
+void NV097_SET_CONTEXT_DMA_REPORT(MTHD_HANDLER_ARGS)
+{
+	// TODO: rendering stuff here
+	LOG_MTHD();
+	nv097_set_dma_obj(impl, param, NV097_OBJ_REPORT_idx);
+}
+
+void NV097_SET_EYE_POSITION(MTHD_HANDLER_ARGS)
+{
+	// Sets a single component of the eye position vector in the constant register file (fixed function pipeline only)
+
+	LOG_MTHD();
+	uint32_t component = (mthd - std::to_underlying(nv097::NV097_SET_EYE_POSITION)) >> 2;
+	assert(component < 4);
+	impl->m_kelvin.m_vtx_shader.m_const[NV_IGRAPH_XF_XFCTX_EYEP][component] = param;
+}
+
+void NV097_SET_FLAT_SHADE_OP(MTHD_HANDLER_ARGS)
+{
+	// Specifies which vertex to use for flat shading mode (either the first or the last). Xbox d3d always uses the first
+
+	LOG_MTHD();
+	assert(param == NV097_SET_FLAT_SHADE_OP_V_LAST_VTX || param == NV097_SET_FLAT_SHADE_OP_V_FIRST_VTX);
+	impl->m_kelvin.m_flat_shade_vtx = param;
+}
+
+void NV097_SET_EDGE_FLAG(MTHD_HANDLER_ARGS)
+{
+	// Toggles edge flag to hide specific lines of triangles, quads, and polygons -> same as glEdgeFlag
+
+	LOG_MTHD();
+	assert(param == NV097_SET_EDGE_FLAG_V_FALSE || param == NV097_SET_EDGE_FLAG_V_TRUE);
+	impl->m_kelvin.m_edge_flag = param;
+}
+
+void NV097_SET_SEMAPHORE_OFFSET(MTHD_HANDLER_ARGS)
+{
+	// Sets the offset, from the base of the semaphore dma object, to write the DWORD that signals the semaphore
+
+	LOG_MTHD();
+	IMPL(m_kelvin);
+	assert(param <= class_impl->m_dma_semaphore.limit);
+	class_impl->m_dma_semaphore.offset = param;
+}
+
+void NV097_BACK_END_WRITE_SEMAPHORE_RELEASE(MTHD_HANDLER_ARGS)
+{
+	// Writes param at the offset of the semaphore dma object
+
+	LOG_MTHD();
+	IMPL(m_kelvin);
+	assert(class_impl->m_dma_obj_instance_addr[NV097_OBJ_SEMAPHORE_idx] != UNBOUND_OBJ_ADDR);
+	impl->m_raster.flush(); // titles use the semaphore to know when the draws before it are done
+	uint8_t *addr = class_impl->m_dma_semaphore.base;
+	uint32_t offset = class_impl->m_dma_semaphore.offset;
+	*(uint32_t *)(addr + offset) = param;
+}
+
+void nv097_update_raster_state(pgraph::ImplAlias *impl)
+{
+	// Translates the kelvin state to the state of the rasterizer. The surfaces are checked against their dma objects, so that the rasterizer never writes
+	// outside of them
+
+	IMPL(m_kelvin);
+	class_impl->m_raster_state_dirty = false;
+	raster_state state{};
+	uint32_t format = class_impl->m_surface.m_format;
+	state.color_fmt = format & NV097_SET_SURFACE_FORMAT_COLOR;
+	state.zeta_fmt = (format & NV097_SET_SURFACE_FORMAT_ZETA) >> 4;
+	state.clip_x0 = class_impl->m_surface.m_clip_horizontal & 0xFFFF;
+	state.clip_y0 = class_impl->m_surface.m_clip_vertical & 0xFFFF;
+	state.clip_x1 = std::min(state.clip_x0 + (class_impl->m_surface.m_clip_horizontal >> 16), (uint32_t)RASTER_MAX_SURFACE_SIZE);
+	state.clip_y1 = std::min(state.clip_y0 + (class_impl->m_surface.m_clip_vertical >> 16), (uint32_t)RASTER_MAX_SURFACE_SIZE);
+	state.depth_func = class_impl->m_depth_func;
+	state.color_mask = class_impl->m_color_mask;
+	state.depth_write = class_impl->m_depth_mask != 0;
+
+	uint32_t type = (format & NV097_SET_SURFACE_FORMAT_TYPE) >> 8;
+	if (type == NV097_SET_SURFACE_FORMAT_TYPE_SWIZZLE) {
+		// The dimensions of swizzled surfaces are powers of two, specified as log2 in the format
+		uint32_t max_log2 = std::countr_zero((uint32_t)RASTER_MAX_SURFACE_SIZE);
+		state.swizzle_width = 1 << std::min((format & NV097_SET_SURFACE_FORMAT_WIDTH) >> 16, max_log2);
+		state.swizzle_height = 1 << std::min((format & NV097_SET_SURFACE_FORMAT_HEIGHT) >> 24, max_log2);
+		state.clip_x1 = std::min(state.clip_x1, state.swizzle_width);
+		state.clip_y1 = std::min(state.clip_y1, state.swizzle_height);
+	}
+	else if (type != NV097_SET_SURFACE_FORMAT_TYPE_PITCH) {
+		// Leave the surfaces unbound, so that nothing is drawn
+		logger_en(warn, "Unknown surface type %" PRIu32 ", format 0x%08" PRIX32, type, format);
+		impl->m_raster.setState(state);
+		return;
+	}
+
+	auto get_surface = [impl, class_impl, &state](uint32_t dma_idx, uint32_t offset, uint32_t pitch, uint32_t bpp) -> uint8_t *
+		{
+			if ((bpp == 0) || ((pitch == 0) && !state.swizzle_width) || (class_impl->m_dma_obj_instance_addr[dma_idx] == UNBOUND_OBJ_ADDR)) {
+				return nullptr;
+			}
+
+			DmaObj obj = impl->m_nv2a->getDmaObj(class_impl->m_dma_obj_instance_addr[dma_idx]);
+			uint64_t size = (uint64_t)obj.limit + 1;
+			if ((offset >= size) || ((obj.target_addr + size) > impl->m_ramsize)) {
+				logger_en(warn, "Surface at offset 0x%08" PRIX32 " is outside of its dma object or of ram", offset);
+				return nullptr;
+			}
+
+			if (state.swizzle_width) {
+				// A swizzled surface has no pitch, and the whole of it must fit, because its pixels are scattered over all of its size
+				if (((uint64_t)state.swizzle_width * state.swizzle_height * bpp) > (size - offset)) {
+					logger_en(warn, "Swizzled surface at offset 0x%08" PRIX32 " is larger than its dma object", offset);
+					return nullptr;
+				}
+			}
+			else {
+				state.clip_x1 = std::min(state.clip_x1, pitch / bpp);
+				state.clip_y1 = (uint32_t)std::min<uint64_t>(state.clip_y1, (size - offset) / pitch);
+			}
+			return impl->m_ram + obj.target_addr + offset;
+		};
+
+	state.color_pitch = class_impl->m_surface.m_pitch & 0xFFFF;
+	state.zeta_pitch = class_impl->m_surface.m_pitch >> 16;
+	uint32_t color_bpp = 0;
+	switch (state.color_fmt)
+	{
+	case NV097_SET_SURFACE_FORMAT_COLOR_LE_B8:
+		color_bpp = 1;
+		break;
+
+	case NV097_SET_SURFACE_FORMAT_COLOR_LE_X1R5G5B5_Z1R5G5B5:
+	case NV097_SET_SURFACE_FORMAT_COLOR_LE_X1R5G5B5_O1R5G5B5:
+	case NV097_SET_SURFACE_FORMAT_COLOR_LE_R5G6B5:
+	case NV097_SET_SURFACE_FORMAT_COLOR_LE_G8B8:
+		color_bpp = 2;
+		break;
+
+	case NV097_SET_SURFACE_FORMAT_COLOR_LE_X8R8G8B8_Z8R8G8B8:
+	case NV097_SET_SURFACE_FORMAT_COLOR_LE_X8R8G8B8_O8R8G8B8:
+	case NV097_SET_SURFACE_FORMAT_COLOR_LE_X1A7R8G8B8_Z1A7R8G8B8:
+	case NV097_SET_SURFACE_FORMAT_COLOR_LE_X1A7R8G8B8_O1A7R8G8B8:
+	case NV097_SET_SURFACE_FORMAT_COLOR_LE_A8R8G8B8:
+		color_bpp = 4;
+		break;
+	}
+	uint32_t zeta_bpp = state.zeta_fmt == NV097_SET_SURFACE_FORMAT_ZETA_Z16 ? 2 : (state.zeta_fmt == NV097_SET_SURFACE_FORMAT_ZETA_Z24S8 ? 4 : 0);
+	state.color_base = get_surface(NV097_OBJ_COLOR_idx, class_impl->m_surface.m_color_offset, state.color_pitch, color_bpp);
+	state.zeta_base = get_surface(NV097_OBJ_ZETA_idx, class_impl->m_surface.m_zeta_offset, state.zeta_pitch, zeta_bpp);
+	state.depth_test = class_impl->m_depth_test_enable && state.zeta_base;
+
+	if (class_impl->m_cull_face_enable) {
+		uint32_t front = class_impl->m_front_face == NV097_SET_FRONT_FACE_V_CCW ? RASTER_CULL_CCW : RASTER_CULL_CW;
+		uint32_t back = front ^ (RASTER_CULL_CW | RASTER_CULL_CCW);
+		switch (class_impl->m_cull_face)
+		{
+		case NV097_SET_CULL_FACE_V_FRONT:
+			state.cull = front;
+			break;
+
+		case NV097_SET_CULL_FACE_V_BACK:
+			state.cull = back;
+			break;
+
+		case NV097_SET_CULL_FACE_V_FRONT_AND_BACK:
+			state.cull = front | back;
+			break;
+		}
+	}
+
+	impl->m_raster.setState(state);
+}
+
+void nv097_draw_triangle(pgraph::ImplAlias *impl, const raster_vertex &v0, const raster_vertex &v1, const raster_vertex &v2, const raster_vertex &provoking)
+{
+	IMPL(m_kelvin);
+	if (class_impl->m_raster_state_dirty) {
+		nv097_update_raster_state(impl);
+	}
+
+	if (class_impl->m_shade_mode == NV097_SET_SHADE_MODE_V_FLAT) {
+		// All pixels get the color of the provoking vertex
+		raster_vertex flat_vtx[3] = { v0, v1, v2 };
+		for (auto &vtx : flat_vtx) {
+			std::copy(std::begin(provoking.color), std::end(provoking.color), std::begin(vtx.color));
+		}
+		impl->m_raster.drawTriangle(flat_vtx[0], flat_vtx[1], flat_vtx[2]);
+	}
+	else {
+		impl->m_raster.drawTriangle(v0, v1, v2);
+	}
+}
+
+void nv097_emit_vertex(pgraph::ImplAlias *impl, const raster_vertex &vtx)
+{
+	// Assembles the vertices of the current primitive in triangles. The winding of the triangles of strips is kept the same as the first one, and the
+	// provoking vertex (used for flat shading) follows NV097_SET_FLAT_SHADE_OP. Points and lines are not rasterized
+
+	IMPL(m_kelvin);
+	auto &prim = class_impl->m_prim;
+	raster_vertex *v = prim.m_vtx;
+	uint32_t n = prim.m_num_of_vtx++;
+	bool first_is_provoking = class_impl->m_flat_shade_vtx == NV097_SET_FLAT_SHADE_OP_V_FIRST_VTX;
+
+	switch (prim.m_op)
+	{
+	case NV097_SET_BEGIN_END_OP_TRIANGLES:
+		v[n % 3] = vtx;
+		if ((n % 3) == 2) {
+			nv097_draw_triangle(impl, v[0], v[1], v[2], first_is_provoking ? v[0] : v[2]);
+		}
+		break;
+
+	case NV097_SET_BEGIN_END_OP_TRIANGLE_STRIP:
+		if (n < 2) {
+			v[n] = vtx;
+			break;
+		}
+		if (n & 1) {
+			nv097_draw_triangle(impl, v[1], v[0], vtx, first_is_provoking ? v[0] : vtx);
+		}
+		else {
+			nv097_draw_triangle(impl, v[0], v[1], vtx, first_is_provoking ? v[0] : vtx);
+		}
+		v[0] = v[1];
+		v[1] = vtx;
+		break;
+
+	case NV097_SET_BEGIN_END_OP_TRIANGLE_FAN:
+	case NV097_SET_BEGIN_END_OP_POLYGON:
+		if (n < 2) {
+			v[n] = vtx;
+			break;
+		}
+		if (prim.m_op == NV097_SET_BEGIN_END_OP_POLYGON) {
+			nv097_draw_triangle(impl, v[0], v[1], vtx, v[0]);
+		}
+		else {
+			nv097_draw_triangle(impl, v[0], v[1], vtx, first_is_provoking ? v[1] : vtx);
+		}
+		v[1] = vtx;
+		break;
+
+	case NV097_SET_BEGIN_END_OP_QUADS:
+		v[n % 4] = vtx;
+		if ((n % 4) == 3) {
+			const raster_vertex &provoking = first_is_provoking ? v[0] : v[3];
+			nv097_draw_triangle(impl, v[0], v[1], v[2], provoking);
+			nv097_draw_triangle(impl, v[0], v[2], v[3], provoking);
+		}
+		break;
+
+	case NV097_SET_BEGIN_END_OP_QUAD_STRIP:
+		// Quad i is made of the vertices 2i, 2i + 1, 2i + 3 and 2i + 2
+		v[n < 4 ? n : 2 + (n & 1)] = vtx;
+		if ((n >= 3) && (n & 1)) {
+			const raster_vertex &provoking = first_is_provoking ? v[0] : v[3];
+			nv097_draw_triangle(impl, v[0], v[1], v[3], provoking);
+			nv097_draw_triangle(impl, v[0], v[3], v[2], provoking);
+			v[0] = v[2];
+			v[1] = v[3];
+		}
+		break;
+
+	default:
+		break;
+	}
+}
+
+void nv097_emit_current_vertex(pgraph::ImplAlias *impl)
+{
+	// Emits a vertex made of the current attribute values, after an immediate mode method wrote the position
+
+	IMPL(m_kelvin);
+	if (class_impl->m_prim.m_op != NV097_SET_BEGIN_END_OP_END) {
+		raster_vertex vtx;
+		std::copy_n(class_impl->m_vtx_attrs[NV097_VTX_ATTR_POSITION], 4, vtx.pos);
+		std::copy_n(class_impl->m_vtx_attrs[NV097_VTX_ATTR_DIFFUSE], 4, vtx.color);
+		nv097_emit_vertex(impl, vtx);
+	}
+}
+
+static uint32_t
+nv097_attr_size(uint32_t format)
+{
+	// Returns the size in bytes of a vertex attribute in memory, zero when the attribute is disabled
+	uint32_t size = (format & NV097_SET_VERTEX_DATA_ARRAY_FORMAT_SIZE) >> 4;
+	switch (format & NV097_SET_VERTEX_DATA_ARRAY_FORMAT_TYPE)
+	{
+	case NV097_SET_VERTEX_DATA_ARRAY_FORMAT_TYPE_UB_D3D:
+	case NV097_SET_VERTEX_DATA_ARRAY_FORMAT_TYPE_UB_OGL:
+		return size;
+
+	case NV097_SET_VERTEX_DATA_ARRAY_FORMAT_TYPE_S1:
+	case NV097_SET_VERTEX_DATA_ARRAY_FORMAT_TYPE_S32K:
+		return size * 2;
+
+	case NV097_SET_VERTEX_DATA_ARRAY_FORMAT_TYPE_F:
+		return size * 4;
+
+	case NV097_SET_VERTEX_DATA_ARRAY_FORMAT_TYPE_CMP:
+		return size ? 4 : 0;
+
+	default:
+		return 0;
+	}
+}
+
+static void
+nv097_decode_attr(float *attr, const uint8_t *data, uint32_t format)
+{
+	// Converts a vertex attribute to floats. The missing components are (0, 0, 0, 1)
+	uint32_t size = std::min((format & NV097_SET_VERTEX_DATA_ARRAY_FORMAT_SIZE) >> 4, 4u);
+	attr[0] = attr[1] = attr[2] = 0.0f;
+	attr[3] = 1.0f;
+
+	switch (format & NV097_SET_VERTEX_DATA_ARRAY_FORMAT_TYPE)
+	{
+	case NV097_SET_VERTEX_DATA_ARRAY_FORMAT_TYPE_UB_D3D:
+		if (size == 4) {
+			// D3DCOLOR, stored as B, G, R, A
+			attr[0] = data[2] / 255.0f;
+			attr[1] = data[1] / 255.0f;
+			attr[2] = data[0] / 255.0f;
+			attr[3] = data[3] / 255.0f;
+			break;
+		}
+		[[fallthrough]];
+
+	case NV097_SET_VERTEX_DATA_ARRAY_FORMAT_TYPE_UB_OGL:
+		for (uint32_t i = 0; i < size; ++i) {
+			attr[i] = data[i] / 255.0f;
+		}
+		break;
+
+	case NV097_SET_VERTEX_DATA_ARRAY_FORMAT_TYPE_S1:
+	case NV097_SET_VERTEX_DATA_ARRAY_FORMAT_TYPE_S32K:
+		for (uint32_t i = 0; i < size; ++i) {
+			int16_t value;
+			std::memcpy(&value, data + i * 2, 2);
+			attr[i] = (format & NV097_SET_VERTEX_DATA_ARRAY_FORMAT_TYPE) == NV097_SET_VERTEX_DATA_ARRAY_FORMAT_TYPE_S1 ? std::max(value / 32767.0f, -1.0f) : value;
+		}
+		break;
+
+	case NV097_SET_VERTEX_DATA_ARRAY_FORMAT_TYPE_F:
+		std::memcpy(attr, data, size * 4);
+		break;
+
+	case NV097_SET_VERTEX_DATA_ARRAY_FORMAT_TYPE_CMP: {
+		// Three signed normalized components of 11, 11 and 10 bits
+		uint32_t value;
+		std::memcpy(&value, data, 4);
+		attr[0] = std::max(int32_t(value << 21) / 1023.0f / (1 << 21), -1.0f);
+		attr[1] = std::max(int32_t((value >> 11) << 21) / 1023.0f / (1 << 21), -1.0f);
+		attr[2] = std::max(int32_t(value & ~0x3FFFFF) / 511.0f / (1 << 22), -1.0f);
+	}
+	break;
+	}
+}
+
+void nv097_fetch_vertex(pgraph::ImplAlias *impl, uint32_t index)
+{
+	// Builds a vertex from the vertex arrays. Only the attributes used by the rasterizer are fetched, and the ones without an array keep their current value
+
+	IMPL(m_kelvin);
+	raster_vertex vtx;
+	for (uint32_t slot : { NV097_VTX_ATTR_POSITION, NV097_VTX_ATTR_DIFFUSE }) {
+		float *attr = slot == NV097_VTX_ATTR_POSITION ? vtx.pos : vtx.color;
+		uint32_t format = class_impl->m_vtx_arrays.m_format[slot];
+		uint32_t offset = class_impl->m_vtx_arrays.m_offset[slot];
+		uint32_t size = nv097_attr_size(format);
+		const DmaObj &obj = class_impl->m_prim.m_vtx_dma[(offset & NV097_SET_VERTEX_DATA_ARRAY_OFFSET_CONTEXT_DMA) ? 1 : 0];
+		uint64_t addr = (offset & NV097_SET_VERTEX_DATA_ARRAY_OFFSET_OFFSET) + (uint64_t)index * (format >> 8);
+		if ((size == 0) || (obj.class_type == NV01_NULL) || ((addr + size) > ((uint64_t)obj.limit + 1)) || ((obj.target_addr + addr + size) > impl->m_ramsize)) {
+			std::copy_n(class_impl->m_vtx_attrs[slot], 4, attr);
+			continue;
+		}
+		nv097_decode_attr(attr, impl->m_ram + obj.target_addr + addr, format);
+	}
+
+	nv097_emit_vertex(impl, vtx);
+}
+
+void NV097_SET_SURFACE_CLIP_HORIZONTAL(MTHD_HANDLER_ARGS)
+{
+	// Sets the x (bits 0-15) and width (bits 16-31) of the surfaces
+
+	LOG_MTHD();
+	impl->m_kelvin.m_surface.m_clip_horizontal = param;
+	impl->m_kelvin.m_raster_state_dirty = true;
+}
+
+void NV097_SET_SURFACE_CLIP_VERTICAL(MTHD_HANDLER_ARGS)
+{
+	// Sets the y (bits 0-15) and height (bits 16-31) of the surfaces
+
+	LOG_MTHD();
+	impl->m_kelvin.m_surface.m_clip_vertical = param;
+	impl->m_kelvin.m_raster_state_dirty = true;
+}
+
+void NV097_SET_SURFACE_FORMAT(MTHD_HANDLER_ARGS)
+{
+	// Sets the color and zeta formats of the surfaces, and if they are swizzled
+
+	LOG_MTHD();
+	impl->m_kelvin.m_surface.m_format = param;
+	impl->m_kelvin.m_raster_state_dirty = true;
+}
+
+void NV097_SET_SURFACE_PITCH(MTHD_HANDLER_ARGS)
+{
+	// Sets the pitch of the color (bits 0-15) and zeta (bits 16-31) surfaces
+
+	LOG_MTHD();
+	impl->m_kelvin.m_surface.m_pitch = param;
+	impl->m_kelvin.m_raster_state_dirty = true;
+}
+
+void NV097_SET_SURFACE_COLOR_OFFSET(MTHD_HANDLER_ARGS)
+{
+	// Sets the offset of the color surface from the base of its dma object
+
+	LOG_MTHD();
+	impl->m_kelvin.m_surface.m_color_offset = param;
+	impl->m_kelvin.m_raster_state_dirty = true;
+}
+
+void NV097_SET_SURFACE_ZETA_OFFSET(MTHD_HANDLER_ARGS)
+{
+	// Sets the offset of the zeta surface from the base of its dma object
+
+	LOG_MTHD();
+	impl->m_kelvin.m_surface.m_zeta_offset = param;
+	impl->m_kelvin.m_raster_state_dirty = true;
+}
+
+void NV097_SET_CULL_FACE_ENABLE(MTHD_HANDLER_ARGS)
+{
+	LOG_MTHD();
+	impl->m_kelvin.m_cull_face_enable = param;
+	impl->m_kelvin.m_raster_state_dirty = true;
+}
+
+void NV097_SET_DEPTH_TEST_ENABLE(MTHD_HANDLER_ARGS)
 {
-	// Binds the engine object to the subchannel
-
 	LOG_MTHD();
-	impl->m_memcpy.m_instance_addr = param;
+	impl->m_kelvin.m_depth_test_enable = param;
+	impl->m_kelvin.m_raster_state_dirty = true;
 }
 
-void NV039_SET_CONTEXT_DMA_NOTIFIES(MTHD_HANDLER_ARGS)
+void NV097_SET_DEPTH_FUNC(MTHD_HANDLER_ARGS)
 {
-	// param is the instance address of an array of two NvNotification structs. The first element is used by NV039_NOTIFY, and the second is used by NV039_BUFFER_NOTIFY.
-	// Both notifications need to be first activated with NV039_NOTIFY and NV039_BUFFER_NOTIFY respectively. Once activated, the first notification is populated by the
-	// gpu following the completion of the next method that is not a notification method itself
+	// Sets the comparison of the depth test -> same as glDepthFunc
 
 	LOG_MTHD();
-	IMPL(m_memcpy);
-	class_impl->m_notification_addr = param;
-	class_impl->m_notification_active[NV039_NOTIFIERS_NOTIFY] = false;
+	impl->m_kelvin.m_depth_func = param;
+	impl->m_kelvin.m_raster_state_dirty = true;
 }
 
-void NV062_SET_OBJECT(MTHD_HANDLER_ARGS)
+void NV097_SET_COLOR_MASK(MTHD_HANDLER_ARGS)
 {
-	// Binds the engine object to the subchannel
+	// Enables/disables writes to the channels of the color surface -> same as glColorMask
 
 	LOG_MTHD();
-	impl->m_ctx_surfaces_2d.m_instance_addr = param;
+	impl->m_kelvin.m_color_mask = param;
+	impl->m_kelvin.m_raster_state_dirty = true;
 }
 
-void NV062_SET_CONTEXT_DMA_IMAGE_SOURCE(MTHD_HANDLER_ARGS)
+void NV097_SET_DEPTH_MASK(MTHD_HANDLER_ARGS)
 {
-	// Sets the address of the dma object that translates the address of the src image used during a blit
+	// Enables/disables writes to the depth buffer -> same as glDepthMask
 
 	LOG_MTHD();
-	impl->m_ctx_surfaces_2d.m_img_src_addr = param;
+	impl->m_kelvin.m_depth_mask = param;
+	impl->m_kelvin.m_raster_state_dirty = true;
 }
 
-void NV062_SET_CONTEXT_DMA_IMAGE_DESTIN(MTHD_HANDLER_ARGS)
+void NV097_SET_SHADE_MODE(MTHD_HANDLER_ARGS)
 {
-	// Sets the address of the dma object that translates the address of the dst image used during a blit
+	// Selects flat or smooth shading -> same as glShadeModel
 
 	LOG_MTHD();
-	impl->m_ctx_surfaces_2d.m_img_dst_addr = param;
+	impl->m_kelvin.m_shade_mode = param;
 }
 
-void nv097_set_dma_obj(pgraph::ImplAlias *impl, uint32_t param, uint32_t idx)
+void NV097_SET_CULL_FACE(MTHD_HANDLER_ARGS)
 {
-	DmaObj obj = impl->m_nv2a->getDmaObj(param);
-	impl->m_kelvin.m_dma_obj_instance_addr[idx] = obj.class_type != NV01_NULL ? param : UNBOUND_OBJ_ADDR;
+	// Selects which faces are culled -> same as glCullFace
+
+	LOG_MTHD();
+	impl->m_kelvin.m_cull_face = param;
+	impl->m_kelvin.m_raster_state_dirty = true;
 }
 
-void NV097_SET_OBJECT(MTHD_HANDLER_ARGS)
+void NV097_SET_FRONT_FACE(MTHD_HANDLER_ARGS)
 {
-	// Binds the engine object to the subchannel
+	// Selects the winding of the front faces -> same as glFrontFace
 
 	LOG_MTHD();
-	impl->m_kelvin.m_instance_addr = param;
+	impl->m_kelvin.m_front_face = param;
+	impl->m_kelvin.m_raster_state_dirty = true;
 }
 
-void NV097_SET_CONTEXT_DMA_NOTIFIES(MTHD_HANDLER_ARGS)
+void NV097_SET_VERTEX3F(MTHD_HANDLER_ARGS)
 {
-	// Same as NV039_SET_CONTEXT_DMA_NOTIFIES, but for nv97
+	// Sets a component of the position, writing z emits a vertex with w = 1
 
 	LOG_MTHD();
 	IMPL(m_kelvin);
-	class_impl->m_dma_obj_instance_addr[NV097_OBJ_NOTIFIES_idx] = param;
-	class_impl->m_notification_active = false;
+	uint32_t component = (mthd - std::to_underlying(nv097::NV097_SET_VERTEX3F)) >> 2;
+	class_impl->m_vtx_attrs[NV097_VTX_ATTR_POSITION][component] = std::bit_cast<float>(param);
+	if (component == 2) {
+		class_impl->m_vtx_attrs[NV097_VTX_ATTR_POSITION][3] = 1.0f;
+		nv097_emit_current_vertex(impl);
+	}
 }
 
-void NV097_SET_CONTEXT_DMA_A(MTHD_HANDLER_ARGS)
+void NV097_SET_VERTEX4F(MTHD_HANDLER_ARGS)
 {
+	// Sets a component of the position, writing w emits a vertex
+
 	LOG_MTHD();
-	nv097_set_dma_obj(impl, param, NV097_OBJ_A_idx);
+	IMPL(m_kelvin);
+	uint32_t component = (mthd - std::to_underlying(nv097::NV097_SET_VERTEX4F)) >> 2;
+	class_impl->m_vtx_attrs[NV097_VTX_ATTR_POSITION][component] = std::bit_cast<float>(param);
+	if (component == 3) {
+		nv097_emit_current_vertex(impl);
+	}
 }
 
-void NV097_SET_CONTEXT_DMA_B(MTHD_HANDLER_ARGS)
+void NV097_SET_VERTEX_DATA_ARRAY_OFFSET(MTHD_HANDLER_ARGS)
 {
+	// Sets the offset of the array of a vertex attribute, from the base of either the vertex A or B dma objects
+
 	LOG_MTHD();
-	nv097_set_dma_obj(impl, param, NV097_OBJ_B_idx);
+	impl->m_kelvin.m_vtx_arrays.m_offset[(mthd - std::to_underlying(nv097::NV097_SET_VERTEX_DATA_ARRAY_OFFSET)) >> 2] = param;
 }
 
-void NV097_SET_CONTEXT_DMA_STATE(MTHD_HANDLER_ARGS)
+void NV097_SET_VERTEX_DATA_ARRAY_FORMAT(MTHD_HANDLER_ARGS)
 {
+	// Sets the type, number of components and stride of the array of a vertex attribute. Zero components disables the array
+
 	LOG_MTHD();
-	nv097_set_dma_obj(impl, param, NV097_OBJ_STATE_idx);
+	impl->m_kelvin.m_vtx_arrays.m_format[(mthd - std::to_underlying(nv097::NV097_SET_VERTEX_DATA_ARRAY_FORMAT)) >> 2] = param;
 }
 
-void NV097_SET_CONTEXT_DMA_COLOR(MTHD_HANDLER_ARGS)
+void NV097_SET_BEGIN_END(MTHD_HANDLER_ARGS)
 {
-	// TODO: rendering stuff here
+	// Begins a primitive of type param, or ends the current one when param is zero -> same as glBegin/glEnd
+
 	LOG_MTHD();
-	nv097_set_dma_obj(impl, param, NV097_OBJ_COLOR_idx);
+	IMPL(m_kelvin);
+	auto &prim = class_impl->m_prim;
+	prim.m_op = param;
+	prim.m_num_of_vtx = 0;
+	prim.m_num_of_inline_dwords = 0;
+	if (param == NV097_SET_BEGIN_END_OP_END) {
+		return;
+	}
+
+	if (param < NV097_SET_BEGIN_END_OP_TRIANGLES) {
+		logger_en(debug, "Points and lines are not supported by the rasterizer, primitive %" PRIu32, param);
+	}
+
+	// The state can't change inside a primitive, so the dma objects of the arrays and the layout of the inline vertices are only decoded here
+	for (uint32_t i = 0; i < 2; ++i) {
+		uint32_t addr = class_impl->m_dma_obj_instance_addr[i ? NV097_OBJ_VTXB_idx : NV097_OBJ_VTXA_idx];
+		if (addr == UNBOUND_OBJ_ADDR) {
+			prim.m_vtx_dma[i] = DmaObj{ .class_type = NV01_NULL, .mem_type = 0, .target_addr = 0, .limit = 0 };
+		}
+		else {
+			prim.m_vtx_dma[i] = impl->m_nv2a->getDmaObj(addr);
+		}
+	}
+	prim.m_inline_vtx_size = 0;
+	for (uint32_t slot = 0; slot < NV2A_NUM_VTX_ATTRS; ++slot) {
+		prim.m_inline_attr_offset[slot] = prim.m_inline_vtx_size;
+		prim.m_inline_vtx_size += (nv097_attr_size(class_impl->m_vtx_arrays.m_format[slot]) + 3) >> 2;
+	}
+	if (prim.m_inline_vtx_size > std::size(prim.m_inline_dwords)) {
+		logger_en(warn, "Inline vertices of %" PRIu32 " dwords are too big, they will be ignored", prim.m_inline_vtx_size);
+		prim.m_inline_vtx_size = 0;
+	}
 }
 
-void NV097_SET_CONTEXT_DMA_ZETA(MTHD_HANDLER_ARGS)
+void NV097_ARRAY_ELEMENT16(MTHD_HANDLER_ARGS)
 {
-	// TODO: rendering stuff here
+	// Draws two vertices from the arrays, with the 16 bit indices in the low and high halves of param
+
 	LOG_MTHD();
-	nv097_set_dma_obj(impl, param, NV097_OBJ_ZETA_idx);
+	nv097_fetch_vertex(impl, param & 0xFFFF);
+	nv097_fetch_vertex(impl, param >> 16);
 }
 
-void NV097_SET_CONTEXT_DMA_VERTEX_A(MTHD_HANDLER_ARGS)
+void NV097_ARRAY_ELEMENT32(MTHD_HANDLER_ARGS)
 {
+	// Draws one vertex from the arrays, at index param
+
 	LOG_MTHD();
-	nv097_set_dma_obj(impl, param, NV097_OBJ_VTXA_idx);
+	nv097_fetch_vertex(impl, param);
 }
 
-void NV097_SET_CONTEXT_DMA_VERTEX_B(MTHD_HANDLER_ARGS)
+void NV097_DRAW_ARRAYS(MTHD_HANDLER_ARGS)
 {
+	// Draws consecutive vertices from the arrays, starting from index START_INDEX
+
 	LOG_MTHD();
-	nv097_set_dma_obj(impl, param, NV097_OBJ_VTXB_idx);
+	uint32_t start = param & NV097_DRAW_ARRAYS_START_INDEX;
+	uint32_t count = (param >> 24) + 1;
+	for (uint32_t i = 0; i < count; ++i) {
+		nv097_fetch_vertex(impl, start + i);
+	}
 }
 
-void NV097_SET_CONTEXT_DMA_SEMAPHORE(MTHD_HANDLER_ARGS)
+void NV097_INLINE_ARRAY(MTHD_HANDLER_ARGS)
 {
-	// Sets up the semaphore dma object of pgraph
+	// Sends the vertices in the pushbuffer, with the format of the arrays. Each attribute is padded to a dword, and the vertex is drawn when all its dwords
+	// were received
 
 	LOG_MTHD();
 	IMPL(m_kelvin);
-	DmaObj obj = impl->m_nv2a->getDmaObj(param);
-	if (obj.class_type != NV01_NULL) {
-		class_impl->m_dma_semaphore.base = impl->m_ram + obj.target_addr;
-		class_impl->m_dma_semaphore.limit = obj.limit;
-		class_impl->m_dma_obj_instance_addr[NV097_OBJ_SEMAPHORE_idx] = param;
+	auto &prim = class_impl->m_prim;
+	if (prim.m_inline_vtx_size == 0) {
 		return;
 	}
 
-	class_impl->m_dma_obj_instance_addr[NV097_OBJ_SEMAPHORE_idx] = UNBOUND_OBJ_ADDR;
+	prim.m_inline_dwords[prim.m_num_of_inline_dwords++] = param;
+	if (prim.m_num_of_inline_dwords == prim.m_inline_vtx_size) {
+		prim.m_num_of_inline_dwords = 0;
+		raster_vertex vtx;
+		for (uint32_t slot : { NV097_VTX_ATTR_POSITION, NV097_VTX_ATTR_DIFFUSE }) {
+			float *attr = slot == NV097_VTX_ATTR_POSITION ? vtx.pos : vtx.color;
+			uint32_t format = class_impl->m_vtx_arrays.m_format[slot];
+			if (nv097_attr_size(format)) {
+				nv097_decode_attr(attr, (const uint8_t *)&prim.m_inline_dwords[prim.m_inline_attr_offset[slot]], format);
+			}
+			else {
+				std::copy_n(class_impl->m_vtx_attrs[slot], 4, attr);
+			}
+		}
+		nv097_emit_vertex(impl, vtx);
+	}
 }
 
-void NV097_SET_CONTEXT_DMA_REPORT(MTHD_HANDLER_ARGS)
+void NV097_SET_VERTEX_DATA2F_M(MTHD_HANDLER_ARGS)
 {
-	// TODO: rendering stuff here
+	// Sets a component of a vertex attribute as (x, y, 0, 1), writing y of the position emits a vertex
+
 	LOG_MTHD();
-	nv097_set_dma_obj(impl, param, NV097_OBJ_REPORT_idx);
+	IMPL(m_kelvin);
+	uint32_t offset = mthd - std::to_underlying(nv097::NV097_SET_VERTEX_DATA2F_M);
+	uint32_t slot = offset >> 3, component = (offset >> 2) & 1;
+	float *attr = class_impl->m_vtx_attrs[slot];
+	attr[component] = std::bit_cast<float>(param);
+	if (component == 1) {
+		attr[2] = 0.0f;
+		attr[3] = 1.0f;
+		if (slot == NV097_VTX_ATTR_POSITION) {
+			nv097_emit_current_vertex(impl);
+		}
+	}
 }
 
-void NV097_SET_EYE_POSITION(MTHD_HANDLER_ARGS)
+void NV097_SET_VERTEX_DATA4UB(MTHD_HANDLER_ARGS)
 {
-	// Sets a single component of the eye position vector in the constant register file (fixed function pipeline only)
+	// Sets a vertex attribute from four unsigned normalized bytes, writing the position emits a vertex
 
 	LOG_MTHD();
-	uint32_t component = (mthd - std::to_underlying(nv097::NV097_SET_EYE_POSITION)) >> 2;
-	assert(component < 4);
-	impl->m_kelvin.m_vtx_shader.m_const[NV_IGRAPH_XF_XFCTX_EYEP][component] = param;
+	IMPL(m_kelvin);
+	uint32_t slot = (mthd - std::to_underlying(nv097::NV097_SET_VERTEX_DATA4UB)) >> 2;
+	for (uint32_t i = 0; i < 4; ++i) {
+		class_impl->m_vtx_attrs[slot][i] = ((param >> (i * 8)) & 0xFF) / 255.0f;
+	}
+	if (slot == NV097_VTX_ATTR_POSITION) {
+		nv097_emit_current_vertex(impl);
+	}
 }
 
-void NV097_SET_FLAT_SHADE_OP(MTHD_HANDLER_ARGS)
+void NV097_SET_VERTEX_DATA4F_M(MTHD_HANDLER_ARGS)
 {
-	// Specifies which vertex to use for flat shading mode (either the first or the last). Xbox d3d always uses the first
+	// Sets a component of a vertex attribute, writing w of the position emits a vertex
 
 	LOG_MTHD();
-	assert(param == NV097_SET_FLAT_SHADE_OP_V_LAST_VTX || param == NV097_SET_FLAT_SHADE_OP_V_FIRST_VTX);
-	impl->m_kelvin.m_flat_shade_vtx = param;
+	IMPL(m_kelvin);
+	uint32_t offset = mthd - std::to_underlying(nv097::NV097_SET_VERTEX_DATA4F_M);
+	uint32_t slot = offset >> 4, component = (offset >> 2) & 3;
+	class_impl->m_vtx_attrs[slot][component] = std::bit_cast<float>(param);
+	if ((component == 3) && (slot == NV097_VTX_ATTR_POSITION)) {
+		nv097_emit_current_vertex(impl);
+	}
 }
 
-void NV097_SET_EDGE_FLAG(MTHD_HANDLER_ARGS)
+void NV097_SET_ZSTENCIL_CLEAR_VALUE(MTHD_HANDLER_ARGS)
 {
-	// Toggles edge flag to hide specific lines of triangles, quads, and polygons -> same as glEdgeFlag
+	// Sets the value used to clear the zeta surface, in the format of the surface
 
 	LOG_MTHD();
-	assert(param == NV097_SET_EDGE_FLAG_V_FALSE || param == NV097_SET_EDGE_FLAG_V_TRUE);
-	impl->m_kelvin.m_edge_flag = param;
+	impl->m_kelvin.m_zstencil_clear_value = param;
 }
 
-void NV097_SET_SEMAPHORE_OFFSET(MTHD_HANDLER_ARGS)
+void NV097_SET_COLOR_CLEAR_VALUE(MTHD_HANDLER_ARGS)
 {
-	// Sets the offset, from the base of the semaphore dma object, to write the DWORD that signals the semaphore
+	// Sets the value used to clear the color surface, as A8R8G8B8
 
 	LOG_MTHD();
-	IMPL(m_kelvin);
-	assert(param <= class_impl->m_dma_semaphore.limit);
-	class_impl->m_dma_semaphore.offset = param;
+	impl->m_kelvin.m_color_clear_value = param;
 }
 
-void NV097_BACK_END_WRITE_SEMAPHORE_RELEASE(MTHD_HANDLER_ARGS)
+void NV097_CLEAR_SURFACE(MTHD_HANDLER_ARGS)
 {
-	// Writes param at the offset of the semaphore dma object
+	// Clears the channels selected by param of the surfaces, inside the clear rectangle
 
 	LOG_MTHD();
 	IMPL(m_kelvin);
-	assert(class_impl->m_dma_obj_instance_addr[NV097_OBJ_SEMAPHORE_idx] != UNBOUND_OBJ_ADDR);
-	uint8_t *addr = class_impl->m_dma_semaphore.base;
-	uint32_t offset = class_impl->m_dma_semaphore.offset;
-	*(uint32_t *)(addr + offset) = param;
+	if (class_impl->m_raster_state_dirty) {
+		nv097_update_raster_state(impl);
+	}
+	impl->m_raster.clearSurface(class_impl->m_clear_rect_horizontal & 0xFFFF, class_impl->m_clear_rect_horizontal >> 16,
+		class_impl->m_clear_rect_vertical & 0xFFFF, class_impl->m_clear_rect_vertical >> 16, param, class_impl->m_color_clear_value,
+		class_impl->m_zstencil_clear_value);
+}
+
+void NV097_SET_CLEAR_RECT_HORIZONTAL(MTHD_HANDLER_ARGS)
+{
+	// Sets the first (bits 0-15) and last (bits 16-31) columns cleared by NV097_CLEAR_SURFACE
+
+	LOG_MTHD();
+	impl->m_kelvin.m_clear_rect_horizontal = param;
+}
+
+void NV097_SET_CLEAR_RECT_VERTICAL(MTHD_HANDLER_ARGS)
+{
+	// Sets the first (bits 0-15) and last (bits 16-31) rows cleared by NV097_CLEAR_SURFACE
+
+	LOG_MTHD();
+	impl->m_kelvin.m_clear_rect_vertical = param;
 }
 
 void nv09f_set_dma_obj(pgraph::ImplAlias *impl, uint32_t param, uint32_t gr_class, uint32_t idx)
@@ -492,6 +1520,126 @@ void NV09F_SET_OPERATION(MTHD_HANDLER_ARGS)
 	impl->m_img_blit.m_operation = param;
 }
 
+void NV09F_CONTROL_POINT_IN(MTHD_HANDLER_ARGS)
+{
+	// Sets the top-left corner of the rectangle to copy in the src image, x in bits 0-15 and y in bits 16-31
+	LOG_MTHD();
+	impl->m_img_blit.m_point_in = param;
+}
+
+void NV09F_CONTROL_POINT_OUT(MTHD_HANDLER_ARGS)
+{
+	// Sets the top-left corner of the rectangle to write in the dst image, x in bits 0-15 and y in bits 16-31
+	LOG_MTHD();
+	impl->m_img_blit.m_point_out = param;
+}
+
+void NV09F_SIZE(MTHD_HANDLER_ARGS)
+{
+	// Sets the width (bits 0-15) and height (bits 16-31) of the rectangle to copy, and starts the blit. The src and dst images are the ones of the bound
+	// NV10_CONTEXT_SURFACES_2D, and they can overlap
+	LOG_MTHD();
+	IMPL(m_img_blit);
+	if (class_impl->m_dma_obj_instance_addr[NV09F_OBJ_SURFACES_idx] == UNBOUND_OBJ_ADDR) {
+		logger_en(warn, "Blit without a bound surfaces object, ignored");
+		return;
+	}
+
+	switch (class_impl->m_operation)
+	{
+	case NV09F_SET_OPERATION_SRCCOPY:
+		break;
+
+	case NV09F_SET_OPERATION_SRCCOPY_AND:
+	case NV09F_SET_OPERATION_SRCCOPY_PREMULT:
+		// Without color key and beta objects (which are not emulated), these are the same as SRCCOPY
+		if ((class_impl->m_dma_obj_instance_addr[NV09F_OBJ_COLOR_KEY_idx] != UNBOUND_OBJ_ADDR) ||
+			(class_impl->m_dma_obj_instance_addr[NV09F_OBJ_BETA1_idx] != UNBOUND_OBJ_ADDR) ||
+			(class_impl->m_dma_obj_instance_addr[NV09F_OBJ_BETA4_idx] != UNBOUND_OBJ_ADDR)) {
+			logger_en(warn, "Color keying and beta factors are not supported, the blit will be done as SRCCOPY");
+		}
+		break;
+
+	default:
+		logger_en(warn, "Blit operation %" PRIu32 " is not supported, the blit will be done as SRCCOPY", class_impl->m_operation);
+	}
+
+	// The unused bits of the X* formats are written as zero (Z) or one (O) in the dst image
+	auto surf = &impl->m_ctx_surfaces_2d;
+	uint32_t bpp, and_mask = 0xFFFFFFFF, or_mask = 0;
+	switch (surf->m_color_format)
+	{
+	case NV062_SET_COLOR_FORMAT_LE_Y8:
+		bpp = 1;
+		break;
+
+	case NV062_SET_COLOR_FORMAT_LE_X1R5G5B5_Z1R5G5B5:
+	case NV062_SET_COLOR_FORMAT_LE_X1R5G5B5_O1R5G5B5:
+		bpp = 2;
+		and_mask = 0x7FFF;
+		or_mask = surf->m_color_format == NV062_SET_COLOR_FORMAT_LE_X1R5G5B5_O1R5G5B5 ? 0x8000 : 0;
+		break;
+
+	case NV062_SET_COLOR_FORMAT_LE_R5G6B5:
+	case NV062_SET_COLOR_FORMAT_LE_Y16:
+		bpp = 2;
+		and_mask = 0xFFFF;
+		break;
+
+	case NV062_SET_COLOR_FORMAT_LE_X8R8G8B8_Z8R8G8B8:
+	case NV062_SET_COLOR_FORMAT_LE_X8R8G8B8_O8R8G8B8:
+		bpp = 4;
+		and_mask = 0x00FFFFFF;
+		or_mask = surf->m_color_format == NV062_SET_COLOR_FORMAT_LE_X8R8G8B8_O8R8G8B8 ? 0xFF000000 : 0;
+		break;
+
+	case NV062_SET_COLOR_FORMAT_LE_X1A7R8G8B8_Z1A7R8G8B8:
+	case NV062_SET_COLOR_FORMAT_LE_X1A7R8G8B8_O1A7R8G8B8:
+		bpp = 4;
+		and_mask = 0x7FFFFFFF;
+		or_mask = surf->m_color_format == NV062_SET_COLOR_FORMAT_LE_X1A7R8G8B8_O1A7R8G8B8 ? 0x80000000 : 0;
+		break;
+
+	case NV062_SET_COLOR_FORMAT_LE_A8R8G8B8:
+	case NV062_SET_COLOR_FORMAT_LE_Y32:
+		bpp = 4;
+		break;
+
+	default:
+		logger_en(warn, "Blit with unknown color format %" PRIu32 ", ignored", surf->m_color_format);
+		return;
+	}
+
+	uint32_t width = param & 0xFFFF, height = param >> 16;
+	if ((width == 0) || (height == 0)) {
+		return;
+	}
+
+	// Returns a pointer to the top-left pixel of the rectangle, or nullptr if the rectangle is not entirely inside the dma object of the image
+	auto get_rect = [impl, bpp, width, height](uint32_t dma_addr, uint32_t offset, uint32_t pitch, uint32_t point) -> uint8_t *
+		{
+			DmaObj obj = impl->m_nv2a->getDmaObj(dma_addr);
+			uint64_t start = offset + (uint64_t)(point >> 16) * pitch + (uint64_t)(point & 0xFFFF) * bpp;
+			uint64_t end = start + (uint64_t)(height - 1) * pitch + (uint64_t)width * bpp;
+			if ((obj.class_type == NV01_NULL) || (end > ((uint64_t)obj.limit + 1)) || ((obj.target_addr + end) > impl->m_ramsize)) {
+				return nullptr;
+			}
+			return impl->m_ram + obj.target_addr + start;
+		};
+
+	uint32_t src_pitch = surf->m_pitch & 0xFFFF, dst_pitch = surf->m_pitch >> 16;
+	const uint8_t *src = get_rect(surf->m_img_src_addr, surf->m_src_offset, src_pitch, class_impl->m_point_in);
+	uint8_t *dst = get_rect(surf->m_img_dst_addr, surf->m_dst_offset, dst_pitch, class_impl->m_point_out);
+	if ((src == nullptr) || (dst == nullptr)) {
+		logger_en(warn, "Blit of %" PRIu32 "x%" PRIu32 " pixels is outside of the src or dst image, ignored", width, height);
+		return;
+	}
+
+	// The images are often render targets of kelvin, so its pending triangles need to be drawn first
+	impl->m_raster.flush();
+	blit_rect(dst, src, dst_pitch, src_pitch, width * bpp, height, bpp, and_mask, or_mask);
+}
+
 /** Method table declarations **/
 // NOTE: msvc has a hard limit of 128 nesting levels while compiling code, which will be reached if putting all method cases
 // in a single function. To avoid that, we split the if/else statements in multiple functions after 100 methods
@@ -517,7 +1665,18 @@ template<typename EnumT>
 constexpr auto dispatch_func_nv039(uint32_t mthd)
 {
 	MTHD_BEGIN(NV039_SET_OBJECT)
+		MTHD_CASE(NV039_NOTIFY)
 		MTHD_CASE(NV039_SET_CONTEXT_DMA_NOTIFIES)
+		MTHD_CASE(NV039_SET_CONTEXT_DMA_BUFFER_IN)
+		MTHD_CASE(NV039_SET_CONTEXT_DMA_BUFFER_OUT)
+		MTHD_CASE(NV039_OFFSET_IN)
+		MTHD_CASE(NV039_OFFSET_OUT)
+		MTHD_CASE(NV039_PITCH_IN)
+		MTHD_CASE(NV039_PITCH_OUT)
+		MTHD_CASE(NV039_LINE_LENGTH_IN)
+		MTHD_CASE(NV039_LINE_COUNT)
+		MTHD_CASE(NV039_FORMAT)
+		MTHD_CASE(NV039_BUFFER_NOTIFY)
 	MTHD_END();
 }
 
@@ -527,6 +1686,10 @@ constexpr auto dispatch_func_nv062(uint32_t mthd)
 	MTHD_BEGIN(NV062_SET_OBJECT)
 		MTHD_CASE(NV062_SET_CONTEXT_DMA_IMAGE_SOURCE)
 		MTHD_CASE(NV062_SET_CONTEXT_DMA_IMAGE_DESTIN)
+		MTHD_CASE(NV062_SET_COLOR_FORMAT)
+		MTHD_CASE(NV062_SET_PITCH)
+		MTHD_CASE(NV062_SET_OFFSET_SOURCE)
+		MTHD_CASE(NV062_SET_OFFSET_DESTIN)
 	MTHD_END();
 }
 
@@ -544,11 +1707,42 @@ constexpr auto dispatch_func_nv097(uint32_t mthd)
 		MTHD_CASE(NV097_SET_CONTEXT_DMA_VERTEX_B)
 		MTHD_CASE(NV097_SET_CONTEXT_DMA_SEMAPHORE)
 		MTHD_CASE(NV097_SET_CONTEXT_DMA_REPORT)
+		MTHD_CASE(NV097_SET_SURFACE_CLIP_HORIZONTAL)
+		MTHD_CASE(NV097_SET_SURFACE_CLIP_VERTICAL)
+		MTHD_CASE(NV097_SET_SURFACE_FORMAT)
+		MTHD_CASE(NV097_SET_SURFACE_PITCH)
+		MTHD_CASE(NV097_SET_SURFACE_COLOR_OFFSET)
+		MTHD_CASE(NV097_SET_SURFACE_ZETA_OFFSET)
+		MTHD_CASE(NV097_SET_CULL_FACE_ENABLE)
+		MTHD_CASE(NV097_SET_DEPTH_TEST_ENABLE)
+		MTHD_CASE(NV097_SET_DEPTH_FUNC)
+		MTHD_CASE(NV097_SET_COLOR_MASK)
+		MTHD_CASE(NV097_SET_DEPTH_MASK)
+		MTHD_CASE(NV097_SET_SHADE_MODE)
+		MTHD_CASE(NV097_SET_CULL_FACE)
+		MTHD_CASE(NV097_SET_FRONT_FACE)
 		MTHD_RANGE(NV097_SET_EYE_POSITION, 4)
 		MTHD_CASE(NV097_SET_FLAT_SHADE_OP)
+		MTHD_RANGE(NV097_SET_VERTEX3F, 3)
+		MTHD_RANGE(NV097_SET_VERTEX4F, 4)
 		MTHD_CASE(NV097_SET_EDGE_FLAG)
+		MTHD_RANGE(NV097_SET_VERTEX_DATA_ARRAY_OFFSET, NV2A_NUM_VTX_ATTRS)
+		MTHD_RANGE(NV097_SET_VERTEX_DATA_ARRAY_FORMAT, NV2A_NUM_VTX_ATTRS)
+		MTHD_CASE(NV097_SET_BEGIN_END)
+		MTHD_RANGE(NV097_ARRAY_ELEMENT16, 2)
+		MTHD_RANGE(NV097_ARRAY_ELEMENT32, 2)
+		MTHD_CASE(NV097_DRAW_ARRAYS)
+		MTHD_CASE(NV097_INLINE_ARRAY)
+		MTHD_RANGE(NV097_SET_VERTEX_DATA2F_M, NV2A_NUM_VTX_ATTRS * 2)
+		MTHD_RANGE(NV097_SET_VERTEX_DATA4UB, NV2A_NUM_VTX_ATTRS)
+		MTHD_RANGE(NV097_SET_VERTEX_DATA4F_M, NV2A_NUM_VTX_ATTRS * 4)
 		MTHD_CASE(NV097_SET_SEMAPHORE_OFFSET)
 		MTHD_CASE(NV097_BACK_END_WRITE_SEMAPHORE_RELEASE)
+		MTHD_CASE(NV097_SET_ZSTENCIL_CLEAR_VALUE)
+		MTHD_CASE(NV097_SET_COLOR_CLEAR_VALUE)
+		MTHD_CASE(NV097_CLEAR_SURFACE)
+		MTHD_CASE(NV097_SET_CLEAR_RECT_HORIZONTAL)
+		MTHD_CASE(NV097_SET_CLEAR_RECT_VERTICAL)
 	MTHD_END();
 }
 
@@ -564,6 +1758,9 @@ constexpr auto dispatch_func_nv09f(uint32_t mthd)
 		MTHD_CASE(NV09F_SET_CONTEXT_BETA4)
 		MTHD_CASE(NV09F_SET_CONTEXT_SURFACES)
 		MTHD_CASE(NV09F_SET_OPERATION)
+		MTHD_CASE(NV09F_CONTROL_POINT_IN)
+		MTHD_CASE(NV09F_CONTROL_POINT_OUT)
+		MTHD_CASE(NV09F_SIZE)
 	MTHD_END();
 }
 
@@ -675,6 +1872,9 @@ void pgraph::Impl::write32(uint32_t addr, const uint32_t value)
 	if constexpr (log) {
 		logWrite(addr, value);
 	}
+	if (nv2a_capture::g_is_active.load(std::memory_order_relaxed)) [[unlikely]] {
+		nv2a_capture::record_write(nv2a_capture::record_type::pgraph_write, addr, value);
+	}
 
 	switch (addr)
 	{
@@ -765,18 +1965,114 @@ uint32_t pgraph::Impl::read32(uint32_t addr)
 void pgraph::Impl::submitMethod(uint32_t mthd, uint32_t param, uint32_t subchan, uint32_t ctx_switch)
 {
 	// called from the fifo thread
-	m_input_queue.emplace(mthd, param, subchan, ctx_switch); // blocks if the queue is full
+	m_input_queue->emplace(mthd, param, subchan, ctx_switch); // blocks if the queue is full
+	m_graph_has_work.test_and_set();
+	m_graph_has_work.notify_one();
+}
+
+void pgraph::Impl::submitMethods(const uint32_t *mthds, const uint32_t *params, uint32_t num_of_mthds, uint32_t subchan)
+{
+	// called from the fifo thread
+	// NOTE: a chunk must fit in the queue, because the graph thread is only notified after the whole chunk has been pushed
+	InputQueueEntry entries[PGRAPH_BATCH_SIZE];
+	uint32_t chunk_size = std::min(m_input_queue_size, (uint32_t)PGRAPH_BATCH_SIZE);
+	for (uint32_t i = 0; i < num_of_mthds; ) {
+		uint32_t num = std::min(num_of_mthds - i, chunk_size);
+		for (uint32_t j = 0; j < num; ++j) {
+			entries[j] = InputQueueEntry{ .m_mthd = mthds[i + j], .m_param = params[i + j], .m_subchan = subchan, .m_ctx_switch = 0 };
+		}
+		m_input_queue->push_n(entries, num); // blocks if the queue is full
+		m_graph_has_work.test_and_set();
+		m_graph_has_work.notify_one();
+		i += num;
+	}
+}
+
+void pgraph::Impl::clearBusy()
+{
+	m_busy.fetch_and(~NV_PGRAPH_STATUS_STATE);
+	m_busy.notify_all(); // wake up the fifo thread if it's in waitForIdle
+}
+
+void pgraph::Impl::waitForIdle()
+{
+	// Called by the puller before it switches to a different engine. Spin for a while first, because pgraph is often about to finish its batch, and then
+	// sleep on the status word until clearBusy wakes us up. The spin limit grows when spinning was enough and shrinks when it wasn't, so that a pgraph
+	// running long batches doesn't cost a core to the fifo thread
+	for (uint32_t i = 0; i < m_idle_spin_limit; ++i) {
+		if ((m_busy.load() & NV_PGRAPH_STATUS_STATE) == 0) {
+			m_idle_spin_limit = std::min(m_idle_spin_limit * 2, (uint32_t)PGRAPH_IDLE_SPIN_MAX);
+			return;
+		}
+		CPU_RELAX();
+	}
+
+	m_idle_spin_limit = std::max(m_idle_spin_limit / 2, (uint32_t)PGRAPH_IDLE_SPIN_MIN);
+	while (true) {
+		uint32_t busy = m_busy.load();
+		if ((busy & NV_PGRAPH_STATUS_STATE) == 0) {
+			break;
+		}
+		m_busy.wait(busy);
+	}
+}
+
+bool pgraph::Impl::isIdle()
+{
+	// The busy flag is set before the methods are taken from the queue, and it stays set while a batch taken from it isn't finished, so both being clear
+	// means that all submitted methods were executed
+	return m_input_queue->empty() && ((m_busy.load() & NV_PGRAPH_STATUS_STATE) == 0);
+}
+
+void pgraph::Impl::saveRegs(uint32_t *regs)
+{
+	std::unique_lock lock(m_graph_mtx);
+	std::copy(std::begin(m_regs), std::end(m_regs), regs);
+	regs[REGS_PGRAPH_idx(NV_PGRAPH_INTR)] = m_int_status;
+	regs[REGS_PGRAPH_idx(NV_PGRAPH_INTR_EN)] = m_int_enabled;
+	regs[REGS_PGRAPH_idx(NV_PGRAPH_FIFO)] = m_fifo_access;
+}
+
+void pgraph::Impl::loadRegs(const uint32_t *regs)
+{
+	std::unique_lock lock(m_graph_mtx);
+	std::copy(regs, regs + NV_PGRAPH_SIZE / 4, std::begin(m_regs));
+	m_int_status = regs[REGS_PGRAPH_idx(NV_PGRAPH_INTR)];
+	m_int_enabled = regs[REGS_PGRAPH_idx(NV_PGRAPH_INTR_EN)];
+	m_fifo_access = regs[REGS_PGRAPH_idx(NV_PGRAPH_FIFO)];
 	m_graph_has_work.test_and_set();
 	m_graph_has_work.notify_one();
 }
 
+void pgraph::Impl::enableMethodStats()
+{
+	std::unique_lock lock(m_graph_mtx);
+	m_mthd_stats.assign((HIGHEST_CLASS + 1) * PGRAPH_NUM_OF_MTHDS, 0);
+}
+
+std::vector<uint64_t> pgraph::Impl::getMethodStats()
+{
+	std::unique_lock lock(m_graph_mtx);
+	return m_mthd_stats;
+}
+
 void pgraph::Impl::graphHandler(std::stop_token stok)
 {
 	m_should_exit = 3;
+	InputQueueEntry batch[PGRAPH_BATCH_SIZE];
+	size_t batch_idx = 0, batch_size = 0;
+	const auto is_access_granted = [this]() {
+		uint32_t access_granted = (m_fifo_access & NV_PGRAPH_FIFO_ACCESS) // fifo access to graph is disabled, keep looping
+			| m_is_enabled // need to check this too because fifo will keep submitting methods even when this engine is disabled
+			& m_should_exit; // this thread encountered a fatal error
+		return access_granted == 3;
+		};
 
 	while (true) {
 		// Wait until the puller pushes some methods
+		uint64_t idle_start = timer::get_now();
 		m_graph_has_work.wait(false);
+		m_idle_time.fetch_add(timer::get_now() - idle_start, std::memory_order_relaxed);
 		std::unique_lock lock(m_graph_mtx);
 		m_graph_has_work.clear();
 
@@ -787,16 +2083,22 @@ void pgraph::Impl::graphHandler(std::stop_token stok)
 		// We are going to process methods, set the busy flag
 		m_busy |= NV_PGRAPH_STATUS_STATE;
 
-		while (!m_input_queue.empty()) {
-			if (uint32_t access_granted = (m_fifo_access & NV_PGRAPH_FIFO_ACCESS) // fifo access to graph is disabled, keep looping
-				| m_is_enabled // need to check this too because fifo will keep submitting methods even when this engine is disabled
-				& m_should_exit; // this thread encountered a fatal error
-				access_granted != 3) {
+		while (true) {
+			// Check the access before taking new methods from the queue, so that they stay there while the access is denied
+			if (!is_access_granted()) {
 				break;
 			}
 
-			InputQueueEntry elem;
-			m_input_queue.pop(elem);
+			if (batch_idx == batch_size) {
+				// Grab the next batch of methods, so that the queue indices are only synchronized with the fifo thread once per batch
+				batch_idx = 0;
+				batch_size = m_input_queue->pop_n(batch, PGRAPH_BATCH_SIZE);
+				if (batch_size == 0) {
+					break;
+				}
+			}
+
+			const InputQueueEntry &elem = batch[batch_idx++];
 
 			if (elem.m_ctx_switch & CTX_SWITCH_STATUS) {
 				// A context switch was requested, do it now
@@ -812,13 +2114,16 @@ void pgraph::Impl::graphHandler(std::stop_token stok)
 						m_should_exit = 0;
 						break;
 					}
-					m_busy &= ~NV_PGRAPH_STATUS_STATE; // clear the busy flag
+					m_raster.flush();
+					clearBusy();
 					SET_REG(NV_PGRAPH_TRAPPED_ADDR, NV_PGRAPH_TRAPPED_ADDR_CHID, target_chid << 20); // write channel exception data
 					m_int_status |= NV_PGRAPH_INTR_CONTEXT_SWITCH; // raise graph interrupt
 					m_ctx_switch_trig.test_and_set();
 					lock.unlock();
 					m_pmc->updateIrq();
+					uint64_t idle_start = timer::get_now();
 					m_ctx_switch_trig.wait(true); // wait until the title does the switch and clears the interrupt
+					m_idle_time.fetch_add(timer::get_now() - idle_start, std::memory_order_relaxed);
 					lock.lock();
 
 					if (stok.stop_requested()) [[unlikely]] {
@@ -853,18 +2158,33 @@ void pgraph::Impl::graphHandler(std::stop_token stok)
 			mthd_func func = s_method_table_classes[gr_class];
 			ASSUME(func);
 			func(this, elem.m_mthd, elem.m_param, elem.m_subchan);
+			size_t run_start = batch_idx - 1;
+
+			// The following methods for the same subchannel use the same object, so they can be dispatched without switching the context again
+			while ((batch_idx < batch_size) && is_access_granted() && (batch[batch_idx].m_subchan == elem.m_subchan) &&
+				((batch[batch_idx].m_ctx_switch & CTX_SWITCH_STATUS) == 0)) {
+				func(this, batch[batch_idx].m_mthd, batch[batch_idx].m_param, elem.m_subchan);
+				++batch_idx;
+			}
+
+			if (!m_mthd_stats.empty()) [[unlikely]] {
+				for (size_t i = run_start; i < batch_idx; ++i) {
+					++m_mthd_stats[gr_class * PGRAPH_NUM_OF_MTHDS + ((batch[i].m_mthd >> 2) & (PGRAPH_NUM_OF_MTHDS - 1))];
+				}
+			}
 		}
 
-		// Done with processing methods, clear the busy flag
-		m_busy &= ~NV_PGRAPH_STATUS_STATE;
+		// Done with processing methods, clear the busy flag. The binned triangles are drawn first, so that the surfaces are up to date when pgraph is idle.
+		// If the access was denied in the middle of a batch, the rest of the batch was already taken from the queue, so pgraph stays busy until it runs them
+		m_raster.flush();
+		if (batch_idx == batch_size) {
+			clearBusy();
+		}
 	}
 
 	// NOTE: it's safe to drain the queue only from the consumer thread
 	while (true) {
-		while (!m_input_queue.empty()) {
-			InputQueueEntry elem;
-			m_input_queue.pop(elem);
-		}
+		while (m_input_queue->pop_n(batch, PGRAPH_BATCH_SIZE)) {}
 		if (stok.stop_requested()) { // sync with pgraph::Impl::deinit
 			return;
 		}
@@ -879,7 +2199,7 @@ pgraph::Impl::logRead(uint32_t addr, uint32_t value)
 		if (util::in_range(addr, NV_PGRAPH_CTX_CACHE1(0), NV_PGRAPH_CTX_CACHE5(7) + 3)) {
 			uint32_t num = ((addr >> 5) & 7) - 2;
 			uint32_t subchannel = (addr & 0x1F) >> 2;
-			logger<log_lv::debug, log_module::pgraph, false>("Read at %s%u (0x%08X) of value 0x%08X (subchannel %u)", it->second, num, addr, value, subchannel);
+			logger<log_lv::debug, log_module::pgraph, false>("Read at %s%u (0x%08X) of value 0x%08X (subchannel %u)", it->second.c_str(), num, addr, value, subchannel);
 		}
 		else {
 			logger<log_lv::debug, log_module::pgraph, false>("Read at %s (0x%08X) of value 0x%08X", it->second.c_str(), addr, value);
@@ -898,7 +2218,7 @@ pgraph::Impl::logWrite(uint32_t addr, uint32_t value)
 		if (util::in_range(addr, NV_PGRAPH_CTX_CACHE1(0), NV_PGRAPH_CTX_CACHE5(7) + 3)) {
 			uint32_t num = ((addr >> 5) & 7) - 2;
 			uint32_t subchannel = (addr & 0x1F) >> 2;
-			logger<log_lv::debug, log_module::pgraph, false>("Write at %s%u (0x%08X) of value 0x%08X (subchannel %u)", it->second, num, addr, value, subchannel);
+			logger<log_lv::debug, log_module::pgraph, false>("Write at %s%u (0x%08X) of value 0x%08X (subchannel %u)", it->second.c_str(), num, addr, value, subchannel);
 		}
 		else {
 			logger<log_lv::debug, log_module::pgraph, false>("Write at %s (0x%08X) of value 0x%08X", it->second.c_str(), addr, value);
@@ -963,6 +2283,8 @@ void pgraph::Impl::reset()
 	m_int_enabled = 0;
 	m_fifo_access = 0;
 	m_busy = 0;
+	m_idle_spin_limit = PGRAPH_IDLE_SPIN_MIN;
+	m_idle_time = 0;
 	std::fill(std::begin(m_regs), std::end(m_regs), 0);
 	m_graph_has_work.clear();
 
@@ -973,23 +2295,47 @@ void pgraph::Impl::reset()
 	std::memset(&m_img_blit, 0, sizeof(m_img_blit));
 	// All classes are unbound at the beginning
 	m_memcpy.m_instance_addr = UNBOUND_OBJ_ADDR;
+	m_memcpy.m_notification_addr = UNBOUND_OBJ_ADDR;
+	m_memcpy.m_buffer_in_addr = UNBOUND_OBJ_ADDR;
+	m_memcpy.m_buffer_out_addr = UNBOUND_OBJ_ADDR;
+	m_memcpy.m_format = (1 << 8) | 1;
 	m_ctx_surfaces_2d.m_instance_addr = UNBOUND_OBJ_ADDR;
 	m_kelvin.m_instance_addr = UNBOUND_OBJ_ADDR;
 	std::fill(std::begin(m_kelvin.m_dma_obj_instance_addr), std::end(m_kelvin.m_dma_obj_instance_addr), UNBOUND_OBJ_ADDR);
 	m_img_blit.m_instance_addr = UNBOUND_OBJ_ADDR;
 	std::fill(std::begin(m_img_blit.m_dma_obj_instance_addr), std::end(m_img_blit.m_dma_obj_instance_addr), UNBOUND_OBJ_ADDR);
+	// Default render state of kelvin, same as the initial state of OpenGL
+	m_kelvin.m_depth_func = NV097_SET_DEPTH_FUNC_V_LESS;
+	m_kelvin.m_color_mask = NV097_SET_COLOR_MASK_ALPHA_WRITE_ENABLE | NV097_SET_COLOR_MASK_RED_WRITE_ENABLE | NV097_SET_COLOR_MASK_GREEN_WRITE_ENABLE |
+		NV097_SET_COLOR_MASK_BLUE_WRITE_ENABLE;
+	m_kelvin.m_depth_mask = 1;
+	m_kelvin.m_shade_mode = NV097_SET_SHADE_MODE_V_SMOOTH;
+	m_kelvin.m_cull_face = NV097_SET_CULL_FACE_V_BACK;
+	m_kelvin.m_front_face = NV097_SET_FRONT_FACE_V_CCW;
+	m_kelvin.m_raster_state_dirty = true;
+	for (auto &attr : m_kelvin.m_vtx_attrs) {
+		attr[3] = 1.0f;
+	}
+	std::fill_n(m_kelvin.m_vtx_attrs[NV097_VTX_ATTR_DIFFUSE], 4, 1.0f);
 }
 
 void pgraph::Impl::init(cpu *cpu, nv2a *gpu)
 {
 	m_pmc = gpu->getPmc();
 	m_pramin = gpu->getPramin();
+	m_ptimer = gpu->getPtimer();
 	m_lc86cpu = cpu->get86cpu();
 	m_nv2a = gpu;
 	reset();
 	updateIo(false);
 
+	m_input_queue_size = std::clamp(get_settings()->get_uint32_value("core", "pgraph_queue_size", PGRAPH_QUEUE_DEFAULT_SIZE), (uint32_t)PGRAPH_QUEUE_MIN_SIZE,
+		(uint32_t)PGRAPH_QUEUE_MAX_SIZE);
+	m_input_queue = std::make_unique<dro::SPSCQueue<InputQueueEntry>>(m_input_queue_size);
+
 	m_ram = get_ram_ptr(m_lc86cpu);
+	m_ramsize = cpu->getRamsize();
+	m_raster.init(get_settings()->get_uint32_value("core", "raster_threads", 0));
 	m_jthr = std::jthread(std::bind_front(&pgraph::Impl::graphHandler, this));
 }
 
@@ -1002,6 +2348,7 @@ void pgraph::Impl::deinit()
 	m_graph_has_work.test_and_set();
 	m_graph_has_work.notify_one();
 	m_jthr.join();
+	m_raster.deinit();
 }
 
 /** Public interface implementation **/
@@ -1041,6 +2388,46 @@ void pgraph::submitMethod(uint32_t mthd, uint32_t param, uint32_t subchan, uint3
 	m_impl->submitMethod<is_mthd_zero>(mthd, param, subchan, chid);
 }
 
+void pgraph::submitMethods(const uint32_t *mthds, const uint32_t *params, uint32_t num_of_mthds, uint32_t subchan)
+{
+	m_impl->submitMethods(mthds, params, num_of_mthds, subchan);
+}
+
+void pgraph::waitForIdle()
+{
+	m_impl->waitForIdle();
+}
+
+uint64_t pgraph::getIdleTime()
+{
+	return m_impl->getIdleTime();
+}
+
+bool pgraph::isIdle()
+{
+	return m_impl->isIdle();
+}
+
+void pgraph::saveRegs(uint32_t *regs)
+{
+	m_impl->saveRegs(regs);
+}
+
+void pgraph::loadRegs(const uint32_t *regs)
+{
+	m_impl->loadRegs(regs);
+}
+
+void pgraph::enableMethodStats()
+{
+	m_impl->enableMethodStats();
+}
+
+std::vector<uint64_t> pgraph::getMethodStats()
+{
+	return m_impl->getMethodStats();
+}
+
 pgraph::pgraph() : m_impl{std::make_unique<pgraph::Impl>()} {}
 pgraph::~pgraph() {}
 
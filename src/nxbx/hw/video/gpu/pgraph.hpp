@@ -5,6 +5,7 @@
 
 #include <cstdint>
 #include <memory>
+#include <vector>
 #include "nv2a_defs.hpp"
 
 #define NV_PGRAPH 0x00400000
@@ -12,6 +13,7 @@
 #define NV_PGRAPH_SIZE 0x2000
 #define REGS_PGRAPH_idx(x) ((x - NV_PGRAPH_BASE) >> 2)
 #define REG_PGRAPH(r) (m_regs[REGS_PGRAPH_idx(r)])
+#define PGRAPH_NUM_OF_MTHDS 2048 // number of methods of each class, since they are all multiples of four
 
 #define NV_PGRAPH_DEBUG_3 (NV2A_REGISTER_BASE + 0x0040008C) // debug flags 3
 #define NV_PGRAPH_DEBUG_3_HW_CONTEXT_SWITCH (1 << 2) // hw context switch, enabled=1
@@ -64,6 +66,15 @@ public:
 	void write32(uint32_t addr, const uint32_t value);
 	template<bool is_mthd_zero>
 	void submitMethod(uint32_t mthd, uint32_t param, uint32_t subchan, uint32_t chid);
+	void submitMethods(const uint32_t *mthds, const uint32_t *params, uint32_t num_of_mthds, uint32_t subchan); // methods >= 0x100 for the same subchannel
+	void waitForIdle(); // blocks until pgraph clears its busy flag, only called from the fifo thread
+	uint64_t getIdleTime(); // total time (in us) that the graph thread was idle
+	bool isIdle(); // true when all the submitted methods were executed
+	// Used by the gpu capture and replay, the registers are an array of NV_PGRAPH_SIZE bytes
+	void saveRegs(uint32_t *regs);
+	void loadRegs(const uint32_t *regs);
+	void enableMethodStats();
+	std::vector<uint64_t> getMethodStats(); // indexed by class * PGRAPH_NUM_OF_MTHDS + method / 4
 
 private:
 	class Impl;
@@ -2,7 +2,6 @@
 // SPDX-FileCopyrightText: 2024 ergo720
 
 #include "lib86cpu.hpp"
-#include "clock.hpp"
 #include "pmc.hpp"
 #include "ptimer.hpp"
 #include "pramdac.hpp"
@@ -33,18 +32,19 @@ private:
 	template<bool is_write, typename T>
 	auto getIoFunc(bool log, bool is_be);
 
-	uint64_t m_core_freq; // gpu frequency
+	std::atomic_uint64_t m_core_freq; // gpu frequency, also read by the graph thread through ptimer::readTime
 	// connected devices
 	pmc *m_pmc;
 	ptimer *m_ptimer;
-	cpu *m_cpu;
 	cpu_t *m_lc86cpu;
 	// registers
 	uint32_t m_nvpll_coeff, m_mpll_coeff, m_vpll_coeff;
+	uint32_t m_general_control;
 	const std::unordered_map<uint32_t, const std::string> m_regs_info = {
 		{ NV_PRAMDAC_NVPLL_COEFF, "NV_PRAMDAC_NVPLL_COEFF" },
 		{ NV_PRAMDAC_MPLL_COEFF, "NV_PRAMDAC_MPLL_COEFF" },
-		{ NV_PRAMDAC_VPLL_COEFF, "NV_PRAMDAC_VPLL_COEFF" }
+		{ NV_PRAMDAC_VPLL_COEFF, "NV_PRAMDAC_VPLL_COEFF" },
+		{ NV_PRAMDAC_GENERAL_CONTROL, "NV_PRAMDAC_GENERAL_CONTROL" }
 	};
 };
 
@@ -66,7 +66,6 @@ void pramdac::Impl::write32(uint32_t addr, const uint32_t value)
 		m_core_freq = m ? ((NV2A_CRYSTAL_FREQ * n) / (1ULL << p) / m) : 0;
 		if (m_ptimer->isCounterOn()) {
 			m_ptimer->setCounterPeriod(m_ptimer->counterToUs());
-			cpu_set_timeout(m_lc86cpu, m_cpu->checkPeriodicEvents(timer::get_now()));
 		}
 	}
 	break;
@@ -79,6 +78,10 @@ void pramdac::Impl::write32(uint32_t addr, const uint32_t value)
 		m_vpll_coeff = value;
 		break;
 
+	case NV_PRAMDAC_GENERAL_CONTROL:
+		m_general_control = value;
+		break;
+
 	default:
 		nxbx_fatal("Unhandled write at address 0x%" PRIX32 " with value 0x%" PRIX32, addr, value);
 	}
@@ -103,6 +106,10 @@ uint32_t pramdac::Impl::read32(uint32_t addr)
 		value = m_vpll_coeff;
 		break;
 
+	case NV_PRAMDAC_GENERAL_CONTROL:
+		value = m_general_control;
+		break;
+
 	default:
 		nxbx_fatal("Unhandled %s read at address 0x%" PRIX32, addr);
 	}
@@ -185,6 +192,7 @@ void pramdac::Impl::reset()
 	m_nvpll_coeff = 0x00011C01;
 	m_mpll_coeff = 0x00007702;
 	m_vpll_coeff = 0x0003C20D;
+	m_general_control = 0;
 }
 
 void pramdac::Impl::init(cpu *cpu, nv2a *gpu)
@@ -192,7 +200,6 @@ void pramdac::Impl::init(cpu *cpu, nv2a *gpu)
 	m_pmc = gpu->getPmc();
 	m_ptimer = gpu->getPtimer();
 	m_lc86cpu = cpu->get86cpu();
-	m_cpu = cpu;
 	reset();
 	updateIo(false);
 }
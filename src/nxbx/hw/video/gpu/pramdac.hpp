@@ -17,6 +17,8 @@
 #define NV_PRAMDAC_NVPLL_COEFF_PDIV 0x00070000
 #define NV_PRAMDAC_MPLL_COEFF (NV2A_REGISTER_BASE + 0x00680504) // memory pll (phase-locked loop) coefficients
 #define NV_PRAMDAC_VPLL_COEFF (NV2A_REGISTER_BASE + 0x00680508) // video pll (phase-locked loop) coefficients
+#define NV_PRAMDAC_GENERAL_CONTROL (NV2A_REGISTER_BASE + 0x00680600) // dac configuration
+#define NV_PRAMDAC_GENERAL_CONTROL_ALT_MODE_SEL (1 << 12) // 16 bpp framebuffers are R5G6B5 when set, and X1R5G5B5 otherwise
 
 
 class cpu;
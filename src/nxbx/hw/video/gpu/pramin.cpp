@@ -4,6 +4,8 @@
 #include "lib86cpu.hpp"
 #include "pramin.hpp"
 #include "pmc.hpp"
+#include "pfifo.hpp"
+#include "nv2a_capture.hpp"
 // Must be included last because of the template functions nv2a_read/write, which require a complete definition for the engine objects
 #include "nv2a.hpp"
 
@@ -37,6 +39,7 @@ private:
 	uint32_t m_ramsize;
 	// connected devices
 	pmc *m_pmc;
+	pfifo *m_pfifo; // notified of the writes to ramin, to keep its ramht cache coherent
 	cpu_t *m_lc86cpu;
 };
 
@@ -62,6 +65,13 @@ void pramin::Impl::write(uint32_t addr, const T value)
 
 	uint8_t *ram_ptr = m_ram + ramin_to_ram_addr(addr - NV_PRAMIN_BASE);
 	*(T *)ram_ptr = value;
+	m_pfifo->invalidateRamht(addr - NV_PRAMIN_BASE);
+
+	if (nv2a_capture::g_is_active.load(std::memory_order_relaxed)) [[unlikely]] {
+		// Smaller writes are recorded as a write of the whole dword that contains them
+		uint32_t offset = (addr - NV_PRAMIN_BASE) & ~3;
+		nv2a_capture::record_write(nv2a_capture::record_type::pramin_write, offset, *(uint32_t *)(m_ram + ramin_to_ram_addr(offset)));
+	}
 }
 
 uint32_t pramin::Impl::read32(uint32_t offset)
@@ -74,6 +84,7 @@ void pramin::Impl::write32(uint32_t offset, const uint32_t value)
 {
 	uint8_t *ram_ptr = m_ram + ramin_to_ram_addr(offset);
 	*(uint32_t *)ram_ptr = value;
+	m_pfifo->invalidateRamht(offset);
 }
 
 uint32_t
@@ -152,6 +163,7 @@ void pramin::Impl::init(cpu *cpu, nv2a *gpu)
 	*/
 
 	m_pmc = gpu->getPmc();
+	m_pfifo = gpu->getPfifo();
 	m_lc86cpu = cpu->get86cpu();
 	// Store ram size in this object. This way, we don't need to query NV_PFB_CSTATUS in ramin_to_ram_addr (which is accessed from the fifo thread from getDmaObj)
 	m_ram = get_ram_ptr(m_lc86cpu);
@@ -0,0 +1,183 @@
+// SPDX-License-Identifier: GPL-3.0-only
+// SPDX-FileCopyrightText: 2026 ergo720
+
+#include "host.hpp"
+#include "presenter.hpp"
+#include "../vga.hpp"
+#include "../vga_scanline.hpp"
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <functional>
+
+#define PRESENTER_FRAME_NEW (1 << 2) // set in m_ready_idx when the frame there wasn't taken by the frontend yet
+
+
+/** Private device implementation **/
+class presenter::Impl
+{
+public:
+	void init(uint8_t *ram, uint32_t ram_size, vga *vga);
+	void deinit();
+	void vblank(const presenter_mode &mode);
+	const presenter_frame *acquireFrame();
+
+private:
+	void presenterHandler(std::stop_token stok);
+	bool convert(const presenter_mode &mode, presenter_frame &frame);
+
+	std::jthread m_jthr; // async presenter worker thread
+	// connected devices
+	vga *m_vga;
+	uint8_t *m_ram;
+	uint32_t m_ramsize;
+	// The mode of the last vblank. m_vblank_num is incremented at every vblank, and the presenter thread waits on it
+	std::mutex m_mode_mtx;
+	presenter_mode m_mode;
+	std::atomic_uint64_t m_vblank_num;
+	uint64_t m_vga_frame_num; // number of the last frame taken from vga
+	// Triple buffer: the presenter thread owns m_frames[m_write_idx] and the frontend owns m_frames[m_read_idx]. The remaining one is the newest complete
+	// frame, and it's swapped with the one of the thread that wants it
+	presenter_frame m_frames[3];
+	uint32_t m_write_idx;
+	uint32_t m_read_idx;
+	std::atomic_uint32_t m_ready_idx;
+};
+
+bool presenter::Impl::convert(const presenter_mode &mode, presenter_frame &frame)
+{
+	if (mode.bpp == 0) {
+		// Standard vga mode, the frame was already drawn by vga at this vblank
+		return m_vga->getFrame(frame.pixels, frame.width, frame.height, m_vga_frame_num);
+	}
+
+	// 8 bpp framebuffers would need the dac palette, but they are not used by the xbox
+	if (((mode.bpp != 16) && (mode.bpp != 32)) || (mode.width == 0) || (mode.height == 0)) {
+		return false;
+	}
+	uint32_t row_size = mode.width * (mode.bpp / 8);
+	if (((uint64_t)mode.fb_addr + (uint64_t)mode.pitch * (mode.height - 1) + row_size) > m_ramsize) {
+		return false;
+	}
+
+	// The guest can write to the framebuffer while it's read here, which can tear the frame, like on the real hardware
+	frame.pixels.resize(mode.width * mode.height);
+	frame.width = mode.width;
+	frame.height = mode.height;
+	const uint8_t *src = m_ram + mode.fb_addr;
+	uint32_t *dst = frame.pixels.data();
+	for (uint32_t y = 0; y < mode.height; ++y, src += mode.pitch, dst += mode.width) {
+		if (mode.bpp == 32) {
+			vga_draw_32bpp(dst, src, mode.width);
+		}
+		else if (mode.is_565) {
+			vga_draw_16bpp(dst, src, mode.width);
+		}
+		else {
+			vga_draw_15bpp(dst, src, mode.width);
+		}
+	}
+
+	return true;
+}
+
+void presenter::Impl::presenterHandler(std::stop_token stok)
+{
+	uint64_t vblank_num = 0;
+	while (!stok.stop_requested()) {
+		m_vblank_num.wait(vblank_num);
+		if (stok.stop_requested()) [[unlikely]] {
+			break;
+		}
+
+		presenter_mode mode;
+		{
+			std::unique_lock lock(m_mode_mtx);
+			mode = m_mode;
+			vblank_num = m_vblank_num;
+		}
+
+		if (convert(mode, m_frames[m_write_idx])) {
+			// Publish the frame, and take back the one it replaces. The frontend is only notified when it took the previous frame, so that at most one
+			// notification is pending at any time
+			uint32_t old_idx = m_ready_idx.exchange(m_write_idx | PRESENTER_FRAME_NEW);
+			m_write_idx = old_idx & 3;
+			if (!(old_idx & PRESENTER_FRAME_NEW)) {
+				Host::SignalFrameReady();
+			}
+		}
+	}
+}
+
+void presenter::Impl::vblank(const presenter_mode &mode)
+{
+	{
+		// The presenter thread only holds the lock to copy the mode, so this doesn't wait for the conversion
+		std::unique_lock lock(m_mode_mtx);
+		m_mode = mode;
+		++m_vblank_num;
+	}
+	m_vblank_num.notify_one();
+}
+
+const presenter_frame *presenter::Impl::acquireFrame()
+{
+	if (!(m_ready_idx.load() & PRESENTER_FRAME_NEW)) {
+		return nullptr;
+	}
+
+	m_read_idx = m_ready_idx.exchange(m_read_idx) & 3;
+	return &m_frames[m_read_idx];
+}
+
+void presenter::Impl::init(uint8_t *ram, uint32_t ram_size, vga *vga)
+{
+	m_vga = vga;
+	m_ram = ram;
+	m_ramsize = ram_size;
+	m_mode = {};
+	m_vblank_num = 0;
+	m_vga_frame_num = 0;
+	for (presenter_frame &frame : m_frames) {
+		frame.pixels.clear();
+		frame.width = frame.height = 0;
+	}
+	m_write_idx = 0;
+	m_read_idx = 1;
+	m_ready_idx = 2;
+	m_jthr = std::jthread(std::bind_front(&presenter::Impl::presenterHandler, this));
+}
+
+void presenter::Impl::deinit()
+{
+	if (m_jthr.joinable()) {
+		m_jthr.request_stop();
+		++m_vblank_num;
+		m_vblank_num.notify_one();
+		m_jthr.join();
+	}
+}
+
+/** Public interface implementation **/
+void presenter::init(uint8_t *ram, uint32_t ram_size, vga *vga)
+{
+	m_impl->init(ram, ram_size, vga);
+}
+
+void presenter::deinit()
+{
+	m_impl->deinit();
+}
+
+void presenter::vblank(const presenter_mode &mode)
+{
+	m_impl->vblank(mode);
+}
+
+const presenter_frame *presenter::acquireFrame()
+{
+	return m_impl->acquireFrame();
+}
+
+presenter::presenter() : m_impl{std::make_unique<presenter::Impl>()} {}
+presenter::~presenter() {}
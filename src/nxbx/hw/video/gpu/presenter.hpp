@@ -0,0 +1,50 @@
+// SPDX-License-Identifier: GPL-3.0-only
+// SPDX-FileCopyrightText: 2026 ergo720
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+
+class vga;
+
+// The framebuffer scanned out by the crtc, sampled by pcrtc at a vblank
+struct presenter_mode
+{
+	uint32_t fb_addr; // NV_PCRTC_START
+	uint32_t width; // in pixels
+	uint32_t height;
+	uint32_t pitch; // in bytes
+	uint32_t bpp; // 16 or 32, or zero in the standard vga modes, in which case the frame drawn by vga is shown instead
+	bool is_565; // 16 bpp framebuffers are R5G6B5 when true, and X1R5G5B5 otherwise
+};
+
+// A frame ready to be shown, in A8R8G8B8 format
+struct presenter_frame
+{
+	std::vector<uint32_t> pixels;
+	uint32_t width;
+	uint32_t height;
+};
+
+// Converts the framebuffer to a presenter_frame at every vblank, on its own thread, and hands it to the frontend through a triple buffer. The cpu thread only
+// publishes the mode and never waits for the conversion, and the presenter thread never waits for the frontend: when the frontend falls behind, the frames it
+// didn't take yet are replaced by the newer ones, instead of being queued
+class presenter
+{
+public:
+	presenter();
+	~presenter();
+	void init(uint8_t *ram, uint32_t ram_size, vga *vga); // ram is the guest ram, where the framebuffers are
+	void deinit();
+	void vblank(const presenter_mode &mode); // only called by pcrtc on the cpu thread
+	// Only called by the frontend. Returns the newest frame, or nullptr when there isn't a new one since the last call. The frame stays valid until the
+	// next call
+	const presenter_frame *acquireFrame();
+
+private:
+	class Impl;
+	std::unique_ptr<Impl> m_impl;
+};
@@ -29,11 +29,13 @@ public:
 	template<bool log, engine_enabled enabled>
 	void write32(uint32_t addr, const uint32_t value);
 	uint8_t isCounterOn() { return counter_active; }
-	void setCounterPeriod(uint64_t new_period) { counter_period = new_period; }
+	void setCounterPeriod(uint64_t new_period);
 	uint64_t counterToUs();
+	uint64_t readTime();
 
 private:
 	void updateIo(bool is_update);
+	uint64_t getCounter();
 	template<bool is_write>
 	auto getIoFunc(bool log, bool enabled, bool is_be);
 
@@ -42,18 +44,19 @@ private:
 	pramdac *m_pramdac;
 	cpu *m_cpu;
 	cpu_t *m_lc86cpu;
+	uint32_t m_alarm_event;
 	// Host time when the last alarm interrupt was triggered
 	uint64_t last_alarm_time;
 	// Time in us before the alarm triggers
 	uint64_t counter_period;
 	// Bias added/subtracted to counter before an alarm is due
 	int64_t counter_bias;
-	// Counter is running if not zero
-	uint8_t counter_active;
+	// Counter is running if not zero. This and the two below are atomic because readTime also reads them from the graph thread
+	std::atomic_uint8_t counter_active;
 	// Offset added to counter
-	uint64_t counter_offset;
+	std::atomic_uint64_t counter_offset;
 	// Counter value when it was stopped
-	uint64_t counter_when_stopped;
+	std::atomic_uint64_t counter_when_stopped;
 	// atomic registers
 	std::atomic_uint32_t m_int_status;
 	std::atomic_uint32_t m_int_enabled;
@@ -99,6 +102,26 @@ uint64_t ptimer::Impl::getNextAlarmTime(uint64_t now)
 	return std::numeric_limits<uint64_t>::max();
 }
 
+uint64_t ptimer::Impl::getCounter()
+{
+	// Returns the 56 bit counter
+	uint64_t counter_base = counter_active ? timer::get_dev_now(m_pramdac->getCoreFreq()) : counter_when_stopped.load();
+	return (counter_offset + counter_base) & 0x00FFFFFFFFFFFFFF;
+}
+
+uint64_t ptimer::Impl::readTime()
+{
+	// Same values of NV_PTIMER_TIME_1 and NV_PTIMER_TIME_0, but from a single sample of the counter, so that the low bits can't wrap between the two reads
+	uint64_t counter = getCounter();
+	return ((counter >> 27) << 32) | ((counter & 0x7FFFFFF) << 5);
+}
+
+void ptimer::Impl::setCounterPeriod(uint64_t new_period)
+{
+	counter_period = new_period;
+	m_cpu->updateTimedEvent(m_alarm_event, timer::get_now());
+}
+
 template<bool log, engine_enabled enabled>
 void ptimer::Impl::write32(uint32_t addr, const uint32_t value)
 {
@@ -119,13 +142,14 @@ void ptimer::Impl::write32(uint32_t addr, const uint32_t value)
 	case NV_PTIMER_INTR_EN_0:
 		m_int_enabled = value;
 		m_pmc->updateIrq();
+		m_cpu->updateTimedEvent(m_alarm_event, timer::get_now());
 		break;
 
 	case NV_PTIMER_NUMERATOR:
 		divider = value & NV_PTIMER_NUMERATOR_MASK;
 		if (counter_active) {
 			counter_period = counterToUs();
-			cpu_set_timeout(m_lc86cpu, m_cpu->checkPeriodicEvents(timer::get_now()));
+			m_cpu->updateTimedEvent(m_alarm_event, timer::get_now());
 		}
 		break;
 
@@ -137,16 +161,19 @@ void ptimer::Impl::write32(uint32_t addr, const uint32_t value)
 			nxbx_fatal("Invalid ratio multiplier -> multiplier > divider (the real hardware would hang here)");
 			break;
 		}
-		counter_active = multiplier ? COUNTER_ON : COUNTER_OFF; // A multiplier of zero stops the 56 bit counter
+		// A multiplier of zero stops the 56 bit counter. The stop value is stored before the counter is flagged as stopped, so that readTime never sees
+		// a stopped counter with a stale stop value
+		uint8_t is_active = multiplier ? COUNTER_ON : COUNTER_OFF;
 		uint64_t now = timer::get_now();
-		if (counter_active) {
+		if (is_active) {
 			counter_period = counterToUs();
 			last_alarm_time = now;
 		}
 		else {
 			counter_when_stopped = timer::get_dev_now(m_pramdac->getCoreFreq()) & 0x00FFFFFFFFFFFFFF;
 		}
-		cpu_set_timeout(m_lc86cpu, m_cpu->checkPeriodicEvents(now));
+		counter_active = is_active;
+		m_cpu->updateTimedEvent(m_alarm_event, now);
 	}
 	break;
 
@@ -176,7 +203,7 @@ void ptimer::Impl::write32(uint32_t addr, const uint32_t value)
 		int64_t new_alarm = alarm >> 5;
 		counter_bias = new_alarm - old_alarm;
 		if (counter_active) {
-			cpu_set_timeout(m_lc86cpu, m_cpu->checkPeriodicEvents(timer::get_now()));
+			m_cpu->updateTimedEvent(m_alarm_event, timer::get_now());
 		}
 	}
 	break;
@@ -213,19 +240,15 @@ uint32_t ptimer::Impl::read32(uint32_t addr)
 		value = multiplier;
 		break;
 
-	case NV_PTIMER_TIME_0: {
+	case NV_PTIMER_TIME_0:
 		// Returns the low 27 bits of the 56 bit counter
-		uint64_t counter_base = counter_active ? timer::get_dev_now(m_pramdac->getCoreFreq()) : counter_when_stopped;
-		value = uint32_t(((counter_offset + counter_base) & 0x7FFFFFF) << 5);
-	}
-	break;
+		value = uint32_t((getCounter() & 0x7FFFFFF) << 5);
+		break;
 
-	case NV_PTIMER_TIME_1: {
+	case NV_PTIMER_TIME_1:
 		// Returns the high 29 bits of the 56 bit counter
-		uint64_t counter_base = counter_active ? timer::get_dev_now(m_pramdac->getCoreFreq()) : counter_when_stopped;
-		value = uint32_t(((counter_offset + counter_base) >> 27) & 0x1FFFFFFF);
-	}
-	break;
+		value = uint32_t(getCounter() >> 27);
+		break;
 
 	case NV_PTIMER_ALARM_0:
 		value = alarm;
@@ -301,7 +324,7 @@ ptimer::Impl::reset()
 	counter_active = COUNTER_ON;
 	counter_offset = 0;
 	counter_bias = 0;
-	cpu_set_timeout(m_lc86cpu, m_cpu->checkPeriodicEvents(timer::get_now()));
+	m_cpu->updateTimedEvent(m_alarm_event, timer::get_now());
 }
 
 void ptimer::Impl::init(cpu *cpu, nv2a *gpu)
@@ -310,6 +333,7 @@ void ptimer::Impl::init(cpu *cpu, nv2a *gpu)
 	m_pramdac = gpu->getPramdac();
 	m_lc86cpu = cpu->get86cpu();
 	m_cpu = cpu;
+	m_alarm_event = m_cpu->addTimedEvent(cpu_timed_event<ptimer::Impl, &ptimer::Impl::getNextAlarmTime>, this);
 	reset();
 	updateIo(false);
 }
@@ -340,11 +364,6 @@ void ptimer::write32(uint32_t addr, const uint32_t value)
 	m_impl->write32<false, on>(addr, value);
 }
 
-uint64_t ptimer::getNextAlarmTime(uint64_t now)
-{
-	return m_impl->getNextAlarmTime(now);
-}
-
 uint8_t ptimer::isCounterOn()
 {
 	return m_impl->isCounterOn();
@@ -360,5 +379,10 @@ uint64_t ptimer::counterToUs()
 	return m_impl->counterToUs();
 }
 
+uint64_t ptimer::readTime()
+{
+	return m_impl->readTime();
+}
+
 ptimer::ptimer() : m_impl{std::make_unique<ptimer::Impl>()} {}
 ptimer::~ptimer() {}
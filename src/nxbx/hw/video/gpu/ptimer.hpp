@@ -38,12 +38,12 @@ public:
 	void init(cpu *cpu, nv2a *gpu);
 	void reset();
 	void updateIo();
-	uint64_t getNextAlarmTime(uint64_t now);
 	uint32_t read32(uint32_t addr);
 	void write32(uint32_t addr, const uint32_t value);
 	uint8_t isCounterOn();
 	void setCounterPeriod(uint64_t new_period);
 	uint64_t counterToUs();
+	uint64_t readTime(); // NV_PTIMER_TIME_1 and NV_PTIMER_TIME_0 as a single 64 bit value, sampled at once. This can also be called by the graph thread
 
 private:
 	class Impl;
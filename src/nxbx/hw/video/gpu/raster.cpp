@@ -0,0 +1,779 @@
+// SPDX-License-Identifier: GPL-3.0-only
+// SPDX-FileCopyrightText: 2026 ergo720
+
+#include "raster.hpp"
+#include "swizzle.hpp"
+#include "nv2a_classes.hpp"
+#include "logger.hpp"
+#include <vector>
+#include <thread>
+#include <functional>
+#include <atomic>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <cassert>
+#include <cinttypes>
+#if defined(__x86_64__) || defined(_M_X64)
+#include <emmintrin.h>
+#define RASTER_HAS_SSE2
+#endif
+
+#define MODULE_NAME pgraph
+
+#define RASTER_SUBPIXEL_BITS 4 // vertex positions are snapped to 1/16 of a pixel
+#define RASTER_SUBPIXEL_SIZE (1 << RASTER_SUBPIXEL_BITS)
+// Triangles with a vertex farther than this (in pixels) from the surface origin are dropped. This keeps the edge functions inside a tile within 32 bits
+#define RASTER_GUARD_BAND 8192.0f
+#define RASTER_NUM_OF_TILES_X (RASTER_MAX_SURFACE_SIZE / RASTER_TILE_SIZE)
+#define RASTER_NUM_OF_TILES (RASTER_NUM_OF_TILES_X * RASTER_NUM_OF_TILES_X)
+#define RASTER_MAX_BATCH_SIZE 16384 // max number of triangles binned before they are flushed
+#define RASTER_MAX_THREADS 16
+
+
+/** Private device implementation **/
+class rasterizer::Impl
+{
+public:
+	void init(uint32_t num_of_threads);
+	void deinit();
+	void setState(const raster_state &state);
+	void drawTriangle(const raster_vertex &v0, const raster_vertex &v1, const raster_vertex &v2);
+	void clearSurface(uint32_t x0, uint32_t x1, uint32_t y0, uint32_t y1, uint32_t flags, uint32_t color, uint32_t zstencil);
+	void flush();
+
+private:
+	// A triangle after setup. The edge functions are in fixed point, with RASTER_SUBPIXEL_BITS of fraction, and they are >= 0 inside the triangle. The
+	// attributes are interpolated linearly in window coordinates with the plane equation value = [0] + [1] * x + [2] * y, where x and y are pixel indices
+	struct tri_t
+	{
+		int32_t edge_dx[3]; // step of the edge functions for one pixel in x
+		int32_t edge_dy[3]; // step of the edge functions for one pixel in y
+		int64_t edge_c[3]; // edge functions at the center of pixel (0, 0), with the fill rule bias applied
+		float z[3];
+		float color[4][3];
+		int32_t min_x; // bounding box in pixels, inclusive and already clipped
+		int32_t min_y;
+		int32_t max_x;
+		int32_t max_y;
+		uint32_t state_idx;
+	};
+
+	void worker(std::stop_token stok);
+	void work();
+	void rasterTile(uint32_t tile);
+	void rasterRect(const tri_t &tri, const raster_state &state, int32_t x0, int32_t y0, int32_t x1, int32_t y1, const int32_t *edge_c, const int32_t *edge_dx,
+		const int32_t *edge_dy);
+	bool testDepth(const raster_state &state, int32_t x, int32_t y, float z);
+	void shadePixel(const tri_t &tri, const raster_state &state, int32_t x, int32_t y);
+
+	std::vector<std::jthread> m_workers;
+	std::atomic_uint32_t m_generation; // incremented every time the workers are woken up by flush
+	std::atomic_uint32_t m_workers_busy; // workers that didn't finish the current flush yet
+	std::atomic_uint32_t m_next_tile; // index in m_active_tiles of the next tile to rasterize
+	std::vector<tri_t> m_tris;
+	std::vector<raster_state> m_states; // the last one is the current state
+	std::vector<std::vector<uint32_t>> m_bins; // indices in m_tris of the triangles that touch each tile, in the order they were drawn
+	std::vector<uint32_t> m_active_tiles; // tiles with at least one triangle
+	uint64_t m_num_of_dropped_tris;
+};
+
+static uint32_t
+color_bpp(uint32_t fmt)
+{
+	switch (fmt)
+	{
+	case NV097_SET_SURFACE_FORMAT_COLOR_LE_B8:
+		return 1;
+
+	case NV097_SET_SURFACE_FORMAT_COLOR_LE_X1R5G5B5_Z1R5G5B5:
+	case NV097_SET_SURFACE_FORMAT_COLOR_LE_X1R5G5B5_O1R5G5B5:
+	case NV097_SET_SURFACE_FORMAT_COLOR_LE_R5G6B5:
+	case NV097_SET_SURFACE_FORMAT_COLOR_LE_G8B8:
+		return 2;
+
+	case NV097_SET_SURFACE_FORMAT_COLOR_LE_X8R8G8B8_Z8R8G8B8:
+	case NV097_SET_SURFACE_FORMAT_COLOR_LE_X8R8G8B8_O8R8G8B8:
+	case NV097_SET_SURFACE_FORMAT_COLOR_LE_X1A7R8G8B8_Z1A7R8G8B8:
+	case NV097_SET_SURFACE_FORMAT_COLOR_LE_X1A7R8G8B8_O1A7R8G8B8:
+	case NV097_SET_SURFACE_FORMAT_COLOR_LE_A8R8G8B8:
+		return 4;
+
+	default:
+		return 0;
+	}
+}
+
+static uint64_t
+surface_offset(const raster_state &state, uint32_t pitch, uint32_t bpp, uint32_t x, uint32_t y)
+{
+	// The color and zeta surfaces are either both pitch or both swizzled, with the same dimensions
+	if (state.swizzle_width) {
+		return (uint64_t)swizzle_index(x, y, 0, state.swizzle_width, state.swizzle_height, 1) * bpp;
+	}
+	return (uint64_t)y * pitch + x * bpp;
+}
+
+static uint32_t
+pack_color(uint32_t fmt, uint32_t r, uint32_t g, uint32_t b, uint32_t a)
+{
+	switch (fmt)
+	{
+	case NV097_SET_SURFACE_FORMAT_COLOR_LE_B8:
+		return b;
+
+	case NV097_SET_SURFACE_FORMAT_COLOR_LE_X1R5G5B5_Z1R5G5B5:
+		return ((r >> 3) << 10) | ((g >> 3) << 5) | (b >> 3);
+
+	case NV097_SET_SURFACE_FORMAT_COLOR_LE_X1R5G5B5_O1R5G5B5:
+		return 0x8000 | ((r >> 3) << 10) | ((g >> 3) << 5) | (b >> 3);
+
+	case NV097_SET_SURFACE_FORMAT_COLOR_LE_R5G6B5:
+		return ((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3);
+
+	case NV097_SET_SURFACE_FORMAT_COLOR_LE_G8B8:
+		return (g << 8) | b;
+
+	case NV097_SET_SURFACE_FORMAT_COLOR_LE_X8R8G8B8_Z8R8G8B8:
+		return (r << 16) | (g << 8) | b;
+
+	case NV097_SET_SURFACE_FORMAT_COLOR_LE_X8R8G8B8_O8R8G8B8:
+		return 0xFF000000 | (r << 16) | (g << 8) | b;
+
+	case NV097_SET_SURFACE_FORMAT_COLOR_LE_X1A7R8G8B8_Z1A7R8G8B8:
+		return ((a & 0x7F) << 24) | (r << 16) | (g << 8) | b;
+
+	case NV097_SET_SURFACE_FORMAT_COLOR_LE_X1A7R8G8B8_O1A7R8G8B8:
+		return ((a | 0x80) << 24) | (r << 16) | (g << 8) | b;
+
+	case NV097_SET_SURFACE_FORMAT_COLOR_LE_A8R8G8B8:
+		return (a << 24) | (r << 16) | (g << 8) | b;
+
+	default:
+		return 0;
+	}
+}
+
+static uint32_t
+color_write_mask(uint32_t fmt, uint32_t color_mask)
+{
+	// Converts a NV097_SET_COLOR_MASK value to the bits of a pixel of the surface that can be written
+	uint32_t mask_r = 0, mask_g = 0, mask_b = 0, mask_a = 0;
+	switch (fmt)
+	{
+	case NV097_SET_SURFACE_FORMAT_COLOR_LE_B8:
+		mask_b = 0xFF;
+		break;
+
+	case NV097_SET_SURFACE_FORMAT_COLOR_LE_X1R5G5B5_Z1R5G5B5:
+	case NV097_SET_SURFACE_FORMAT_COLOR_LE_X1R5G5B5_O1R5G5B5:
+		mask_a = 0x8000;
+		mask_r = 0x7C00;
+		mask_g = 0x03E0;
+		mask_b = 0x001F;
+		break;
+
+	case NV097_SET_SURFACE_FORMAT_COLOR_LE_R5G6B5:
+		mask_r = 0xF800;
+		mask_g = 0x07E0;
+		mask_b = 0x001F;
+		break;
+
+	case NV097_SET_SURFACE_FORMAT_COLOR_LE_G8B8:
+		mask_g = 0xFF00;
+		mask_b = 0x00FF;
+		break;
+
+	default:
+		mask_a = 0xFF000000;
+		mask_r = 0x00FF0000;
+		mask_g = 0x0000FF00;
+		mask_b = 0x000000FF;
+	}
+
+	return ((color_mask & NV097_SET_COLOR_MASK_ALPHA_WRITE_ENABLE) ? mask_a : 0) |
+		((color_mask & NV097_SET_COLOR_MASK_RED_WRITE_ENABLE) ? mask_r : 0) |
+		((color_mask & NV097_SET_COLOR_MASK_GREEN_WRITE_ENABLE) ? mask_g : 0) |
+		((color_mask & NV097_SET_COLOR_MASK_BLUE_WRITE_ENABLE) ? mask_b : 0);
+}
+
+static void
+write_pixel(uint8_t *pixel, uint32_t bpp, uint32_t value, uint32_t mask)
+{
+	switch (bpp)
+	{
+	case 1:
+		*pixel = (*pixel & ~mask) | (value & mask);
+		break;
+
+	case 2: {
+		uint16_t old_value;
+		std::memcpy(&old_value, pixel, 2);
+		uint16_t new_value = (old_value & ~mask) | (value & mask);
+		std::memcpy(pixel, &new_value, 2);
+	}
+	break;
+
+	case 4: {
+		uint32_t old_value;
+		std::memcpy(&old_value, pixel, 4);
+		uint32_t new_value = (old_value & ~mask) | (value & mask);
+		std::memcpy(pixel, &new_value, 4);
+	}
+	break;
+	}
+}
+
+static bool
+depth_test(uint32_t func, uint32_t z, uint32_t old_z)
+{
+	switch (func)
+	{
+	case NV097_SET_DEPTH_FUNC_V_NEVER:
+		return false;
+
+	case NV097_SET_DEPTH_FUNC_V_LESS:
+		return z < old_z;
+
+	case NV097_SET_DEPTH_FUNC_V_EQUAL:
+		return z == old_z;
+
+	case NV097_SET_DEPTH_FUNC_V_LEQUAL:
+		return z <= old_z;
+
+	case NV097_SET_DEPTH_FUNC_V_GREATER:
+		return z > old_z;
+
+	case NV097_SET_DEPTH_FUNC_V_NOTEQUAL:
+		return z != old_z;
+
+	case NV097_SET_DEPTH_FUNC_V_GEQUAL:
+		return z >= old_z;
+
+	default:
+		return true;
+	}
+}
+
+static uint32_t
+to_unorm8(float value)
+{
+	return (uint32_t)(std::clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+}
+
+#ifdef RASTER_HAS_SSE2
+static uint32_t
+depth_test_quad(const raster_state &state, uint8_t *pixels, __m128 z, uint32_t mask)
+{
+	// Same as testDepth, but for four adjacent pixels of a row of a pitch surface. Only the pixels in mask are tested and written, while the others are
+	// written back unchanged, which is safe because the four pixels are in the same tile. Returns the pixels that passed the test. The depth values are
+	// less than 2^24, so the signed compares of sse2 work for them
+	const __m128i zero = _mm_setzero_si128(), ones = _mm_set1_epi32(-1);
+	bool is_z16 = state.zeta_fmt == NV097_SET_SURFACE_FORMAT_ZETA_Z16;
+	__m128 z_max = _mm_set1_ps(is_z16 ? 65535.0f : 16777215.0f);
+	__m128i new_z = _mm_cvttps_epi32(_mm_add_ps(_mm_min_ps(_mm_max_ps(z, _mm_setzero_ps()), z_max), _mm_set1_ps(0.5f)));
+	__m128i old_values = is_z16 ? _mm_loadl_epi64((const __m128i *)pixels) : _mm_loadu_si128((const __m128i *)pixels);
+	__m128i old_z = is_z16 ? _mm_unpacklo_epi16(old_values, zero) : _mm_srli_epi32(old_values, 8);
+
+	__m128i pass;
+	switch (state.depth_func)
+	{
+	case NV097_SET_DEPTH_FUNC_V_NEVER:
+		pass = zero;
+		break;
+
+	case NV097_SET_DEPTH_FUNC_V_LESS:
+		pass = _mm_cmplt_epi32(new_z, old_z);
+		break;
+
+	case NV097_SET_DEPTH_FUNC_V_EQUAL:
+		pass = _mm_cmpeq_epi32(new_z, old_z);
+		break;
+
+	case NV097_SET_DEPTH_FUNC_V_LEQUAL:
+		pass = _mm_andnot_si128(_mm_cmpgt_epi32(new_z, old_z), ones);
+		break;
+
+	case NV097_SET_DEPTH_FUNC_V_GREATER:
+		pass = _mm_cmpgt_epi32(new_z, old_z);
+		break;
+
+	case NV097_SET_DEPTH_FUNC_V_NOTEQUAL:
+		pass = _mm_andnot_si128(_mm_cmpeq_epi32(new_z, old_z), ones);
+		break;
+
+	case NV097_SET_DEPTH_FUNC_V_GEQUAL:
+		pass = _mm_andnot_si128(_mm_cmplt_epi32(new_z, old_z), ones);
+		break;
+
+	default:
+		pass = ones;
+	}
+
+	uint32_t pass_mask = _mm_movemask_ps(_mm_castsi128_ps(pass)) & mask;
+	if (state.depth_write && pass_mask) {
+		const __m128i lane_bits = _mm_setr_epi32(1, 2, 4, 8);
+		__m128i write = _mm_cmpeq_epi32(_mm_and_si128(_mm_set1_epi32(pass_mask), lane_bits), lane_bits);
+		if (is_z16) {
+			// Sse2 can only pack with signed saturation, so the values are biased to the signed range before packing, and unbiased after it
+			const __m128i bias32 = _mm_set1_epi32(0x8000), bias16 = _mm_set1_epi16((int16_t)0x8000);
+			__m128i packed = _mm_xor_si128(_mm_packs_epi32(_mm_sub_epi32(new_z, bias32), zero), bias16);
+			write = _mm_packs_epi32(write, zero);
+			_mm_storel_epi64((__m128i *)pixels, _mm_or_si128(_mm_and_si128(write, packed), _mm_andnot_si128(write, old_values)));
+		}
+		else {
+			// The stencil is not touched
+			__m128i new_values = _mm_or_si128(_mm_slli_epi32(new_z, 8), _mm_and_si128(old_values, _mm_set1_epi32(0xFF)));
+			_mm_storeu_si128((__m128i *)pixels, _mm_or_si128(_mm_and_si128(write, new_values), _mm_andnot_si128(write, old_values)));
+		}
+	}
+
+	return pass_mask;
+}
+#endif
+
+bool rasterizer::Impl::testDepth(const raster_state &state, int32_t x, int32_t y, float z)
+{
+	// Returns true if the pixel passes the depth test, and writes its depth when it does. Always passes when there's no depth test
+	if (state.zeta_base && state.depth_test) {
+		if (state.zeta_fmt == NV097_SET_SURFACE_FORMAT_ZETA_Z16) {
+			uint8_t *pixel = state.zeta_base + surface_offset(state, state.zeta_pitch, 2, x, y);
+			uint16_t old_z;
+			std::memcpy(&old_z, pixel, 2);
+			uint16_t new_z = (uint16_t)(std::clamp(z, 0.0f, 65535.0f) + 0.5f);
+			if (!depth_test(state.depth_func, new_z, old_z)) {
+				return false;
+			}
+			if (state.depth_write) {
+				std::memcpy(pixel, &new_z, 2);
+			}
+		}
+		else {
+			uint8_t *pixel = state.zeta_base + surface_offset(state, state.zeta_pitch, 4, x, y);
+			uint32_t old_zs;
+			std::memcpy(&old_zs, pixel, 4);
+			uint32_t new_z = (uint32_t)(std::clamp(z, 0.0f, 16777215.0f) + 0.5f);
+			if (!depth_test(state.depth_func, new_z, old_zs >> 8)) {
+				return false;
+			}
+			if (state.depth_write) {
+				uint32_t new_zs = (new_z << 8) | (old_zs & 0xFF); // the stencil is not touched
+				std::memcpy(pixel, &new_zs, 4);
+			}
+		}
+	}
+
+	return true;
+}
+
+void rasterizer::Impl::shadePixel(const tri_t &tri, const raster_state &state, int32_t x, int32_t y)
+{
+	if (state.color_base) {
+		uint32_t bpp = color_bpp(state.color_fmt);
+		uint32_t rgba[4];
+		for (unsigned i = 0; i < 4; ++i) {
+			rgba[i] = to_unorm8(tri.color[i][0] + tri.color[i][1] * x + tri.color[i][2] * y);
+		}
+		write_pixel(state.color_base + surface_offset(state, state.color_pitch, bpp, x, y), bpp, pack_color(state.color_fmt, rgba[0], rgba[1], rgba[2],
+			rgba[3]), color_write_mask(state.color_fmt, state.color_mask));
+	}
+}
+
+void rasterizer::Impl::rasterRect(const tri_t &tri, const raster_state &state, int32_t x0, int32_t y0, int32_t x1, int32_t y1, const int32_t *edge_c,
+	const int32_t *edge_dx, const int32_t *edge_dy)
+{
+	// Rasterizes the rectangle [x0, x1] x [y0, y1], which is inside a single tile, four pixels at a time. edge_c are the edge functions at (x0, y0). All
+	// edge function values in the rectangle fit in 32 bits, because rasterTile passes a zero step for the edges that contain the whole rectangle
+#ifdef RASTER_HAS_SSE2
+	__m128i row[3], step_x[3];
+	for (unsigned i = 0; i < 3; ++i) {
+		row[i] = _mm_add_epi32(_mm_set1_epi32(edge_c[i]), _mm_setr_epi32(0, edge_dx[i], edge_dx[i] * 2, edge_dx[i] * 3));
+		step_x[i] = _mm_set1_epi32(edge_dx[i] * 4);
+	}
+	const __m128 lane_f = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+	const __m128 z_dx = _mm_set1_ps(tri.z[1]);
+	const bool has_depth_test = state.zeta_base && state.depth_test;
+	const uint32_t zeta_bpp = state.zeta_fmt == NV097_SET_SURFACE_FORMAT_ZETA_Z16 ? 2 : 4;
+
+	for (int32_t y = y0; y <= y1; ++y) {
+		__m128i e0 = row[0], e1 = row[1], e2 = row[2];
+		float z_row = tri.z[0] + tri.z[2] * y;
+		for (int32_t x = x0; x <= x1; x += 4) {
+			// A pixel is inside when all three edge functions are >= 0, that is, when the sign bit of their or is clear
+			uint32_t mask = ~_mm_movemask_ps(_mm_castsi128_ps(_mm_or_si128(_mm_or_si128(e0, e1), e2))) & 0xF;
+			if ((x1 - x) < 3) {
+				mask &= (1 << (x1 - x + 1)) - 1;
+			}
+			if (mask && has_depth_test) {
+				// The depth of a whole quad is tested at once, unless it's cut by the end of the rectangle, because the pixels after it can belong to
+				// another tile, or unless the surface is swizzled, because then the pixels of the quad are not adjacent in memory
+				__m128 z = _mm_add_ps(_mm_set1_ps(z_row + tri.z[1] * x), _mm_mul_ps(lane_f, z_dx));
+				if (!state.swizzle_width && ((x1 - x) >= 3)) {
+					mask = depth_test_quad(state, state.zeta_base + surface_offset(state, state.zeta_pitch, zeta_bpp, x, y), z, mask);
+				}
+				else {
+					alignas(16) float z_quad[4];
+					_mm_store_ps(z_quad, z);
+					for (unsigned i = 0; i < 4; ++i) {
+						if ((mask & (1 << i)) && !testDepth(state, x + i, y, z_quad[i])) {
+							mask &= ~(1 << i);
+						}
+					}
+				}
+			}
+			if (mask && state.color_base) {
+				for (unsigned i = 0; i < 4; ++i) {
+					if (mask & (1 << i)) {
+						shadePixel(tri, state, x + i, y);
+					}
+				}
+			}
+			e0 = _mm_add_epi32(e0, step_x[0]);
+			e1 = _mm_add_epi32(e1, step_x[1]);
+			e2 = _mm_add_epi32(e2, step_x[2]);
+		}
+		row[0] = _mm_add_epi32(row[0], _mm_set1_epi32(edge_dy[0]));
+		row[1] = _mm_add_epi32(row[1], _mm_set1_epi32(edge_dy[1]));
+		row[2] = _mm_add_epi32(row[2], _mm_set1_epi32(edge_dy[2]));
+	}
+#else
+	int32_t row[3] = { edge_c[0], edge_c[1], edge_c[2] };
+	for (int32_t y = y0; y <= y1; ++y) {
+		int32_t e[3] = { row[0], row[1], row[2] };
+		float z_row = tri.z[0] + tri.z[2] * y;
+		for (int32_t x = x0; x <= x1; ++x) {
+			if (((e[0] | e[1] | e[2]) >= 0) && testDepth(state, x, y, z_row + tri.z[1] * x)) {
+				shadePixel(tri, state, x, y);
+			}
+			e[0] += edge_dx[0];
+			e[1] += edge_dx[1];
+			e[2] += edge_dx[2];
+		}
+		row[0] += edge_dy[0];
+		row[1] += edge_dy[1];
+		row[2] += edge_dy[2];
+	}
+#endif
+}
+
+void rasterizer::Impl::rasterTile(uint32_t tile)
+{
+	int32_t tile_x = (tile % RASTER_NUM_OF_TILES_X) << RASTER_TILE_SHIFT;
+	int32_t tile_y = (tile / RASTER_NUM_OF_TILES_X) << RASTER_TILE_SHIFT;
+
+	for (uint32_t tri_idx : m_bins[tile]) {
+		const tri_t &tri = m_tris[tri_idx];
+		int32_t x0 = std::max(tri.min_x, tile_x), x1 = std::min(tri.max_x, tile_x + RASTER_TILE_SIZE - 1);
+		int32_t y0 = std::max(tri.min_y, tile_y), y1 = std::min(tri.max_y, tile_y + RASTER_TILE_SIZE - 1);
+
+		// Classify the part of the bounding box inside this tile against each edge. If it's all outside an edge, the triangle doesn't touch it, and if it's
+		// all inside, the edge doesn't need to be tested for the pixels of the rectangle
+		int32_t edge_c[3], edge_dx[3], edge_dy[3];
+		bool is_outside = false;
+		for (unsigned i = 0; i < 3; ++i) {
+			int64_t e = tri.edge_c[i] + (int64_t)tri.edge_dx[i] * x0 + (int64_t)tri.edge_dy[i] * y0;
+			int64_t e_x = (int64_t)tri.edge_dx[i] * (x1 - x0), e_y = (int64_t)tri.edge_dy[i] * (y1 - y0);
+			int64_t e_min = e + std::min(e_x, (int64_t)0) + std::min(e_y, (int64_t)0);
+			int64_t e_max = e + std::max(e_x, (int64_t)0) + std::max(e_y, (int64_t)0);
+			if (e_max < 0) {
+				is_outside = true;
+				break;
+			}
+			if (e_min >= 0) {
+				edge_c[i] = edge_dx[i] = edge_dy[i] = 0;
+			}
+			else {
+				edge_c[i] = (int32_t)e;
+				edge_dx[i] = tri.edge_dx[i];
+				edge_dy[i] = tri.edge_dy[i];
+			}
+		}
+
+		if (!is_outside) {
+			rasterRect(tri, m_states[tri.state_idx], x0, y0, x1, y1, edge_c, edge_dx, edge_dy);
+		}
+	}
+}
+
+void rasterizer::Impl::work()
+{
+	// Tiles are independent of each other, so they can be taken in any order. The triangles of a tile are instead always rasterized in the order they
+	// were drawn, which is what keeps the depth test and the overdraw correct
+	while (true) {
+		uint32_t idx = m_next_tile.fetch_add(1, std::memory_order_relaxed);
+		if (idx >= m_active_tiles.size()) {
+			break;
+		}
+		rasterTile(m_active_tiles[idx]);
+	}
+}
+
+void rasterizer::Impl::worker(std::stop_token stok)
+{
+	uint32_t generation = 0;
+
+	while (true) {
+		m_generation.wait(generation);
+		if (stok.stop_requested()) {
+			break;
+		}
+
+		// NOTE: flush doesn't start another generation until all workers are done with the current one, so none is ever skipped
+		generation = m_generation.load();
+		work();
+		if (m_workers_busy.fetch_sub(1) == 1) {
+			m_workers_busy.notify_one();
+		}
+	}
+}
+
+void rasterizer::Impl::flush()
+{
+	if (m_tris.empty()) {
+		return;
+	}
+
+	m_next_tile = 0;
+	m_workers_busy = (uint32_t)m_workers.size();
+	if (!m_workers.empty()) {
+		m_generation.fetch_add(1);
+		m_generation.notify_all();
+	}
+
+	// The graph thread takes part in the rasterization too, instead of sleeping until the workers are done
+	work();
+
+	for (uint32_t busy = m_workers_busy.load(); busy; busy = m_workers_busy.load()) {
+		m_workers_busy.wait(busy);
+	}
+
+	for (uint32_t tile : m_active_tiles) {
+		m_bins[tile].clear();
+	}
+	m_active_tiles.clear();
+	m_tris.clear();
+	raster_state state = m_states.back();
+	m_states.clear();
+	m_states.push_back(state);
+}
+
+void rasterizer::Impl::setState(const raster_state &state)
+{
+	if (m_states.back() != state) {
+		if (m_tris.empty() || (m_tris.back().state_idx != (m_states.size() - 1))) {
+			// No triangle uses the current state, so it can be replaced
+			m_states.back() = state;
+		}
+		else {
+			m_states.push_back(state);
+		}
+	}
+}
+
+void rasterizer::Impl::drawTriangle(const raster_vertex &v0, const raster_vertex &v1, const raster_vertex &v2)
+{
+	const raster_state &state = m_states.back();
+	if (!state.color_base && !(state.zeta_base && state.depth_test && state.depth_write)) {
+		return; // the triangle can't change any surface
+	}
+
+	const raster_vertex *v[3] = { &v0, &v1, &v2 };
+	int32_t x[3], y[3];
+	for (unsigned i = 0; i < 3; ++i) {
+		// NOTE: this also drops triangles with a NaN coordinate
+		if (!((std::fabs(v[i]->pos[0]) < RASTER_GUARD_BAND) && (std::fabs(v[i]->pos[1]) < RASTER_GUARD_BAND))) {
+			if (m_num_of_dropped_tris++ == 0) {
+				logger_en(warn, "Dropped a triangle outside the guard band of the rasterizer");
+			}
+			return;
+		}
+		x[i] = (int32_t)std::lround(v[i]->pos[0] * RASTER_SUBPIXEL_SIZE);
+		y[i] = (int32_t)std::lround(v[i]->pos[1] * RASTER_SUBPIXEL_SIZE);
+	}
+
+	// A positive area means that the triangle is clockwise on the screen, because y grows downwards in window coordinates
+	int64_t area = (int64_t)(x[1] - x[0]) * (y[2] - y[0]) - (int64_t)(y[1] - y[0]) * (x[2] - x[0]);
+	if ((area == 0) || (state.cull & (area > 0 ? RASTER_CULL_CW : RASTER_CULL_CCW))) {
+		return;
+	}
+	if (area < 0) {
+		std::swap(x[1], x[2]);
+		std::swap(y[1], y[2]);
+		std::swap(v[1], v[2]);
+		area = -area;
+	}
+
+	tri_t tri;
+	tri.min_x = std::max(std::min({ x[0], x[1], x[2] }) >> RASTER_SUBPIXEL_BITS, (int32_t)state.clip_x0);
+	tri.min_y = std::max(std::min({ y[0], y[1], y[2] }) >> RASTER_SUBPIXEL_BITS, (int32_t)state.clip_y0);
+	tri.max_x = std::min({ std::max({ x[0], x[1], x[2] }) >> RASTER_SUBPIXEL_BITS, (int32_t)state.clip_x1 - 1, RASTER_MAX_SURFACE_SIZE - 1 });
+	tri.max_y = std::min({ std::max({ y[0], y[1], y[2] }) >> RASTER_SUBPIXEL_BITS, (int32_t)state.clip_y1 - 1, RASTER_MAX_SURFACE_SIZE - 1 });
+	if ((tri.min_x > tri.max_x) || (tri.min_y > tri.max_y)) {
+		return;
+	}
+
+	for (unsigned i = 0; i < 3; ++i) {
+		// Edge i goes from vertex i + 1 to vertex i + 2, and it's >= 0 on the side of vertex i. Pixels exactly on an edge belong to the triangle only if it's a
+		// top or left edge, so that pixels shared by adjacent triangles are drawn once
+		int32_t xa = x[(i + 1) % 3], ya = y[(i + 1) % 3], xb = x[(i + 2) % 3], yb = y[(i + 2) % 3];
+		int64_t dx = ya - yb, dy = xb - xa;
+		int64_t c = (int64_t)xa * yb - (int64_t)ya * xb;
+		bool is_top_left = ((ya == yb) && (xb > xa)) || (yb < ya);
+		tri.edge_dx[i] = (int32_t)(dx * RASTER_SUBPIXEL_SIZE);
+		tri.edge_dy[i] = (int32_t)(dy * RASTER_SUBPIXEL_SIZE);
+		tri.edge_c[i] = dx * (RASTER_SUBPIXEL_SIZE / 2) + dy * (RASTER_SUBPIXEL_SIZE / 2) + c - (is_top_left ? 0 : 1);
+	}
+
+	double fx[3], fy[3];
+	for (unsigned i = 0; i < 3; ++i) {
+		fx[i] = double(x[i]) / RASTER_SUBPIXEL_SIZE;
+		fy[i] = double(y[i]) / RASTER_SUBPIXEL_SIZE;
+	}
+	double det = double(area) / (RASTER_SUBPIXEL_SIZE * RASTER_SUBPIXEL_SIZE);
+	auto setup_plane = [&](float a0, float a1, float a2, float *plane)
+		{
+			double a_dx = ((a1 - a0) * (fy[2] - fy[0]) - (a2 - a0) * (fy[1] - fy[0])) / det;
+			double a_dy = ((a2 - a0) * (fx[1] - fx[0]) - (a1 - a0) * (fx[2] - fx[0])) / det;
+			plane[0] = float(a0 + a_dx * (0.5 - fx[0]) + a_dy * (0.5 - fy[0])); // sampled at the pixel centers
+			plane[1] = float(a_dx);
+			plane[2] = float(a_dy);
+		};
+	setup_plane(v[0]->pos[2], v[1]->pos[2], v[2]->pos[2], tri.z);
+	for (unsigned i = 0; i < 4; ++i) {
+		setup_plane(v[0]->color[i], v[1]->color[i], v[2]->color[i], tri.color[i]);
+	}
+	tri.state_idx = (uint32_t)m_states.size() - 1;
+
+	uint32_t tri_idx = (uint32_t)m_tris.size();
+	m_tris.push_back(tri);
+	for (int32_t tile_y = tri.min_y >> RASTER_TILE_SHIFT; tile_y <= (tri.max_y >> RASTER_TILE_SHIFT); ++tile_y) {
+		for (int32_t tile_x = tri.min_x >> RASTER_TILE_SHIFT; tile_x <= (tri.max_x >> RASTER_TILE_SHIFT); ++tile_x) {
+			uint32_t tile = tile_y * RASTER_NUM_OF_TILES_X + tile_x;
+			if (m_bins[tile].empty()) {
+				m_active_tiles.push_back(tile);
+			}
+			m_bins[tile].push_back(tri_idx);
+		}
+	}
+
+	if (m_tris.size() == RASTER_MAX_BATCH_SIZE) {
+		flush();
+	}
+}
+
+void rasterizer::Impl::clearSurface(uint32_t x0, uint32_t x1, uint32_t y0, uint32_t y1, uint32_t flags, uint32_t color, uint32_t zstencil)
+{
+	flush(); // the clear must happen after the triangles drawn before it
+
+	const raster_state &state = m_states.back();
+	x0 = std::max(x0, state.clip_x0);
+	y0 = std::max(y0, state.clip_y0);
+	x1 = std::min(x1 + 1, state.clip_x1);
+	y1 = std::min(y1 + 1, state.clip_y1);
+	if ((x0 >= x1) || (y0 >= y1)) {
+		return;
+	}
+
+	if (state.color_base && (flags & (NV097_CLEAR_SURFACE_R | NV097_CLEAR_SURFACE_G | NV097_CLEAR_SURFACE_B | NV097_CLEAR_SURFACE_A))) {
+		// The clear color is always A8R8G8B8, so convert it to the format of the surface
+		uint32_t bpp = color_bpp(state.color_fmt);
+		uint32_t value = pack_color(state.color_fmt, (color >> 16) & 0xFF, (color >> 8) & 0xFF, color & 0xFF, color >> 24);
+		uint32_t mask = color_write_mask(state.color_fmt,
+			((flags & NV097_CLEAR_SURFACE_R) ? NV097_SET_COLOR_MASK_RED_WRITE_ENABLE : 0) |
+			((flags & NV097_CLEAR_SURFACE_G) ? NV097_SET_COLOR_MASK_GREEN_WRITE_ENABLE : 0) |
+			((flags & NV097_CLEAR_SURFACE_B) ? NV097_SET_COLOR_MASK_BLUE_WRITE_ENABLE : 0) |
+			((flags & NV097_CLEAR_SURFACE_A) ? NV097_SET_COLOR_MASK_ALPHA_WRITE_ENABLE : 0));
+		for (uint32_t y = y0; y < y1; ++y) {
+			for (uint32_t x = x0; x < x1; ++x) {
+				write_pixel(state.color_base + surface_offset(state, state.color_pitch, bpp, x, y), bpp, value, mask);
+			}
+		}
+	}
+
+	if (state.zeta_base && (flags & (NV097_CLEAR_SURFACE_Z | NV097_CLEAR_SURFACE_STENCIL))) {
+		uint32_t bpp, mask;
+		if (state.zeta_fmt == NV097_SET_SURFACE_FORMAT_ZETA_Z16) {
+			bpp = 2;
+			mask = (flags & NV097_CLEAR_SURFACE_Z) ? 0xFFFF : 0;
+		}
+		else {
+			bpp = 4;
+			mask = ((flags & NV097_CLEAR_SURFACE_Z) ? 0xFFFFFF00 : 0) | ((flags & NV097_CLEAR_SURFACE_STENCIL) ? 0xFF : 0);
+		}
+		for (uint32_t y = y0; y < y1; ++y) {
+			for (uint32_t x = x0; x < x1; ++x) {
+				write_pixel(state.zeta_base + surface_offset(state, state.zeta_pitch, bpp, x, y), bpp, zstencil, mask);
+			}
+		}
+	}
+}
+
+void rasterizer::Impl::init(uint32_t num_of_threads)
+{
+	if (num_of_threads == 0) {
+		num_of_threads = std::clamp(std::thread::hardware_concurrency() / 2, 1U, (unsigned)RASTER_MAX_THREADS);
+	}
+	num_of_threads = std::min(num_of_threads, (uint32_t)RASTER_MAX_THREADS);
+
+	m_bins.resize(RASTER_NUM_OF_TILES);
+	m_tris.reserve(RASTER_MAX_BATCH_SIZE);
+	m_states.assign(1, raster_state{});
+	m_num_of_dropped_tris = 0;
+	m_generation = 0;
+	m_workers_busy = 0;
+	m_next_tile = 0;
+
+	// The graph thread also rasterizes, so it counts as one of the threads
+	for (uint32_t i = 1; i < num_of_threads; ++i) {
+		m_workers.emplace_back(std::bind_front(&rasterizer::Impl::worker, this));
+	}
+	logger_en(info, "Software rasterizer uses %" PRIu32 " threads", num_of_threads);
+}
+
+void rasterizer::Impl::deinit()
+{
+	for (auto &worker : m_workers) {
+		worker.request_stop();
+	}
+	m_generation.fetch_add(1);
+	m_generation.notify_all();
+	m_workers.clear(); // jthread's destructor joins
+	m_bins.clear();
+	m_active_tiles.clear();
+	m_tris.clear();
+	m_states.clear();
+}
+
+/** Public interface implementation **/
+void rasterizer::init(uint32_t num_of_threads)
+{
+	m_impl->init(num_of_threads);
+}
+
+void rasterizer::deinit()
+{
+	m_impl->deinit();
+}
+
+void rasterizer::setState(const raster_state &state)
+{
+	m_impl->setState(state);
+}
+
+void rasterizer::drawTriangle(const raster_vertex &v0, const raster_vertex &v1, const raster_vertex &v2)
+{
+	m_impl->drawTriangle(v0, v1, v2);
+}
+
+void rasterizer::clearSurface(uint32_t x0, uint32_t x1, uint32_t y0, uint32_t y1, uint32_t flags, uint32_t color, uint32_t zstencil)
+{
+	m_impl->clearSurface(x0, x1, y0, y1, flags, color, zstencil);
+}
+
+void rasterizer::flush()
+{
+	m_impl->flush();
+}
+
+rasterizer::rasterizer() : m_impl{std::make_unique<rasterizer::Impl>()} {}
+rasterizer::~rasterizer() {}
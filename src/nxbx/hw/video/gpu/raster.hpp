@@ -0,0 +1,65 @@
+// SPDX-License-Identifier: GPL-3.0-only
+// SPDX-FileCopyrightText: 2026 ergo720
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+
+#define RASTER_TILE_SHIFT 5
+#define RASTER_TILE_SIZE (1 << RASTER_TILE_SHIFT) // triangles are binned in square tiles of this size, and each tile is rasterized by a single thread
+#define RASTER_MAX_SURFACE_SIZE 4096 // max width and height of a surface, because they are specified as log2 in NV097_SET_SURFACE_FORMAT
+#define RASTER_CULL_CW (1 << 0) // cull triangles that are clockwise in window coordinates
+#define RASTER_CULL_CCW (1 << 1) // cull triangles that are counter-clockwise in window coordinates
+
+
+// A vertex after transformation, that is, in window coordinates
+struct raster_vertex
+{
+	float pos[4]; // x and y in pixels from the origin of the surface, z in units of the zeta surface, w is unused
+	float color[4]; // diffuse color as r, g, b, a in [0, 1]
+};
+
+// The render state used by a triangle. Each triangle uses the state that was set when it was drawn
+struct raster_state
+{
+	uint8_t *color_base; // nullptr when there's no color surface to write to
+	uint8_t *zeta_base; // nullptr when there's no zeta surface to use
+	uint32_t color_pitch;
+	uint32_t zeta_pitch;
+	uint32_t swizzle_width; // 0 for pitch surfaces, otherwise the dimensions of the swizzled surfaces, whose pitches are then unused
+	uint32_t swizzle_height;
+	uint32_t color_fmt; // NV097_SET_SURFACE_FORMAT_COLOR_LE_*
+	uint32_t zeta_fmt; // NV097_SET_SURFACE_FORMAT_ZETA_*
+	uint32_t clip_x0; // clip rectangle in pixels, x1 and y1 are exclusive
+	uint32_t clip_y0;
+	uint32_t clip_x1;
+	uint32_t clip_y1;
+	uint32_t depth_func; // NV097_SET_DEPTH_FUNC_V_*
+	uint32_t color_mask; // NV097_SET_COLOR_MASK
+	uint32_t cull; // RASTER_CULL_*
+	bool depth_test;
+	bool depth_write;
+
+	bool operator==(const raster_state &other) const = default;
+};
+
+// Cpu rasterizer for the triangles drawn by NV20_KELVIN_PRIMITIVE. Triangles are binned into tiles when they are drawn, and the tiles are rasterized in
+// parallel by a pool of worker threads when the triangles are flushed. Only the graph thread is allowed to call these functions
+class rasterizer
+{
+public:
+	rasterizer();
+	~rasterizer();
+	void init(uint32_t num_of_threads); // 0 means to choose the number of threads automatically
+	void deinit();
+	void setState(const raster_state &state);
+	void drawTriangle(const raster_vertex &v0, const raster_vertex &v1, const raster_vertex &v2);
+	// Fills the rectangle [x0, x1] x [y0, y1] of the surfaces of the current state, flags are the channels to clear as in NV097_CLEAR_SURFACE
+	void clearSurface(uint32_t x0, uint32_t x1, uint32_t y0, uint32_t y1, uint32_t flags, uint32_t color, uint32_t zstencil);
+	void flush(); // rasterizes all the triangles drawn so far, and waits until they are written to the surfaces
+
+private:
+	class Impl;
+	std::unique_ptr<Impl> m_impl;
+};
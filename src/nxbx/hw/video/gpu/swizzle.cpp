@@ -0,0 +1,397 @@
+// SPDX-License-Identifier: GPL-3.0-only
+// SPDX-FileCopyrightText: 2026 ergo720
+
+#include "swizzle.hpp"
+#include "cpu_features.hpp"
+#include <vector>
+#include <cstring>
+#if defined(HOST_CPU_X86)
+#define SWIZZLE_HAS_SSE2
+#endif
+
+#define SWIZZLE_BLOCK_SIZE 4 // texels of a side of a block converted with simd
+
+
+// The fast path doesn't interleave the bits of every texel. Instead, the bits of a coordinate are scattered once per row/column with the masks of the
+// swizzled index that belong to that coordinate, and the index of a texel becomes the or of three table entries. Furthermore, when both the width and the
+// height are at least four and depth is one, the 4x4 blocks of texels aligned to four are stored contiguously in Morton order, so they are converted with
+// a few shuffles instead of one texel at a time. When the width is also at least eight, two horizontally adjacent blocks are contiguous too, and the AVX2
+// kernels convert such pairs at once
+struct swizzle_tables
+{
+	swizzle_tables(uint32_t width, uint32_t height, uint32_t depth);
+	std::vector<uint32_t> x_off; // swizzled index of each x coordinate, in texels
+	std::vector<uint32_t> y_off;
+	std::vector<uint32_t> z_off;
+	bool has_blocks;
+	bool has_block_pairs;
+};
+
+static std::vector<uint32_t>
+scatter_bits(uint32_t size, uint32_t mask)
+{
+	// Generates pdep(i, mask) for all i < size, by incrementing the value with the carry propagated through the holes of the mask
+	std::vector<uint32_t> table(size);
+	uint32_t value = 0;
+	for (uint32_t i = 0; i < size; ++i) {
+		table[i] = value;
+		value = (value - mask) & mask;
+	}
+	return table;
+}
+
+swizzle_tables::swizzle_tables(uint32_t width, uint32_t height, uint32_t depth)
+{
+	uint32_t mask_x = 0, mask_y = 0, mask_z = 0, bit = 1;
+	for (uint32_t i = 1; (i < width) || (i < height) || (i < depth); i <<= 1) {
+		if (i < width) {
+			mask_x |= bit;
+			bit <<= 1;
+		}
+		if (i < height) {
+			mask_y |= bit;
+			bit <<= 1;
+		}
+		if (i < depth) {
+			mask_z |= bit;
+			bit <<= 1;
+		}
+	}
+
+	x_off = scatter_bits(width, mask_x);
+	y_off = scatter_bits(height, mask_y);
+	z_off = scatter_bits(depth, mask_z);
+	// The low four bits of the index must be x0, y0, x1, y1 for a 4x4 block to be contiguous
+	has_blocks = ((mask_x & 0xF) == 0x5) && ((mask_y & 0xF) == 0xA);
+	// And the next bit must be x2 for the block at x + 4 to follow the one at x
+	has_block_pairs = has_blocks && (mask_x & 0x10);
+}
+
+uint32_t
+swizzle_index(uint32_t x, uint32_t y, uint32_t z, uint32_t width, uint32_t height, uint32_t depth)
+{
+	uint32_t index = 0, bit = 0;
+	for (uint32_t i = 1; (i < width) || (i < height) || (i < depth); i <<= 1) {
+		if (i < width) {
+			index |= (x & 1) << bit++;
+			x >>= 1;
+		}
+		if (i < height) {
+			index |= (y & 1) << bit++;
+			y >>= 1;
+		}
+		if (i < depth) {
+			index |= (z & 1) << bit++;
+			z >>= 1;
+		}
+	}
+	return index;
+}
+
+#ifdef SWIZZLE_HAS_SSE2
+// A swizzled 4x4 block stores the texels in the order (0,0) (1,0) (0,1) (1,1) (2,0) (3,0) (2,1) (3,1) (0,2) (1,2) (0,3) (1,3) (2,2) (3,2) (2,3) (3,3),
+// that is, it's made of four 2x2 quads. These functions convert a block to and from four linear rows
+template<uint32_t bpp>
+static void
+unswizzle_block(uint8_t *linear, uint32_t pitch, const uint8_t *block)
+{
+	if constexpr (bpp == 4) {
+		// Each register is a quad, and a row is the low or high half of two quads
+		__m128i q0 = _mm_loadu_si128((const __m128i *)block);
+		__m128i q1 = _mm_loadu_si128((const __m128i *)(block + 16));
+		__m128i q2 = _mm_loadu_si128((const __m128i *)(block + 32));
+		__m128i q3 = _mm_loadu_si128((const __m128i *)(block + 48));
+		_mm_storeu_si128((__m128i *)linear, _mm_unpacklo_epi64(q0, q1));
+		_mm_storeu_si128((__m128i *)(linear + pitch), _mm_unpackhi_epi64(q0, q1));
+		_mm_storeu_si128((__m128i *)(linear + pitch * 2), _mm_unpacklo_epi64(q2, q3));
+		_mm_storeu_si128((__m128i *)(linear + pitch * 3), _mm_unpackhi_epi64(q2, q3));
+	}
+	else if constexpr (bpp == 2) {
+		// Each register is two quads, and a row is made of the dwords 0 and 2, or 1 and 3
+		__m128i q01 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)block), _MM_SHUFFLE(3, 1, 2, 0));
+		__m128i q23 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)(block + 16)), _MM_SHUFFLE(3, 1, 2, 0));
+		_mm_storel_epi64((__m128i *)linear, q01);
+		_mm_storel_epi64((__m128i *)(linear + pitch), _mm_unpackhi_epi64(q01, q01));
+		_mm_storel_epi64((__m128i *)(linear + pitch * 2), q23);
+		_mm_storel_epi64((__m128i *)(linear + pitch * 3), _mm_unpackhi_epi64(q23, q23));
+	}
+	else {
+		// The register is the whole block, and a row is made of the words 0 and 2, 1 and 3, 4 and 6, or 5 and 7
+		__m128i rows = _mm_loadu_si128((const __m128i *)block);
+		rows = _mm_shufflehi_epi16(_mm_shufflelo_epi16(rows, _MM_SHUFFLE(3, 1, 2, 0)), _MM_SHUFFLE(3, 1, 2, 0));
+		for (uint32_t i = 0; i < 4; ++i) {
+			uint32_t row = _mm_cvtsi128_si32(rows);
+			std::memcpy(linear + pitch * i, &row, 4);
+			rows = _mm_srli_si128(rows, 4);
+		}
+	}
+}
+
+template<uint32_t bpp>
+static void
+swizzle_block(uint8_t *block, const uint8_t *linear, uint32_t pitch)
+{
+	// Same as unswizzle_block, but the other way around. The permutations are their own inverse, so only the loads and stores change
+	if constexpr (bpp == 4) {
+		__m128i r0 = _mm_loadu_si128((const __m128i *)linear);
+		__m128i r1 = _mm_loadu_si128((const __m128i *)(linear + pitch));
+		__m128i r2 = _mm_loadu_si128((const __m128i *)(linear + pitch * 2));
+		__m128i r3 = _mm_loadu_si128((const __m128i *)(linear + pitch * 3));
+		_mm_storeu_si128((__m128i *)block, _mm_unpacklo_epi64(r0, r1));
+		_mm_storeu_si128((__m128i *)(block + 16), _mm_unpackhi_epi64(r0, r1));
+		_mm_storeu_si128((__m128i *)(block + 32), _mm_unpacklo_epi64(r2, r3));
+		_mm_storeu_si128((__m128i *)(block + 48), _mm_unpackhi_epi64(r2, r3));
+	}
+	else if constexpr (bpp == 2) {
+		__m128i r01 = _mm_unpacklo_epi64(_mm_loadl_epi64((const __m128i *)linear), _mm_loadl_epi64((const __m128i *)(linear + pitch)));
+		__m128i r23 = _mm_unpacklo_epi64(_mm_loadl_epi64((const __m128i *)(linear + pitch * 2)), _mm_loadl_epi64((const __m128i *)(linear + pitch * 3)));
+		_mm_storeu_si128((__m128i *)block, _mm_shuffle_epi32(r01, _MM_SHUFFLE(3, 1, 2, 0)));
+		_mm_storeu_si128((__m128i *)(block + 16), _mm_shuffle_epi32(r23, _MM_SHUFFLE(3, 1, 2, 0)));
+	}
+	else {
+		uint32_t row[4];
+		for (uint32_t i = 0; i < 4; ++i) {
+			std::memcpy(&row[i], linear + pitch * i, 4);
+		}
+		__m128i rows = _mm_loadu_si128((const __m128i *)row);
+		rows = _mm_shufflehi_epi16(_mm_shufflelo_epi16(rows, _MM_SHUFFLE(3, 1, 2, 0)), _MM_SHUFFLE(3, 1, 2, 0));
+		_mm_storeu_si128((__m128i *)block, rows);
+	}
+}
+
+// Same as unswizzle_block and swizzle_block, but for two contiguous blocks, which are eight texels wide. The first block is in the low lane of the
+// registers after the loads, and the second one in the high lane, so a row is made of the low and high lanes of the same row of the two blocks
+template<uint32_t bpp>
+TARGET_AVX2 static void
+unswizzle_block_pair(uint8_t *linear, uint32_t pitch, const uint8_t *blocks)
+{
+	if constexpr (bpp == 4) {
+		// Each register is two quads of a block, after the permute a lane is the half row of a quad pair
+		__m256i a01 = _mm256_permute4x64_epi64(_mm256_loadu_si256((const __m256i *)blocks), _MM_SHUFFLE(3, 1, 2, 0));
+		__m256i a23 = _mm256_permute4x64_epi64(_mm256_loadu_si256((const __m256i *)(blocks + 32)), _MM_SHUFFLE(3, 1, 2, 0));
+		__m256i b01 = _mm256_permute4x64_epi64(_mm256_loadu_si256((const __m256i *)(blocks + 64)), _MM_SHUFFLE(3, 1, 2, 0));
+		__m256i b23 = _mm256_permute4x64_epi64(_mm256_loadu_si256((const __m256i *)(blocks + 96)), _MM_SHUFFLE(3, 1, 2, 0));
+		_mm256_storeu_si256((__m256i *)linear, _mm256_permute2x128_si256(a01, b01, 0x20));
+		_mm256_storeu_si256((__m256i *)(linear + pitch), _mm256_permute2x128_si256(a01, b01, 0x31));
+		_mm256_storeu_si256((__m256i *)(linear + pitch * 2), _mm256_permute2x128_si256(a23, b23, 0x20));
+		_mm256_storeu_si256((__m256i *)(linear + pitch * 3), _mm256_permute2x128_si256(a23, b23, 0x31));
+	}
+	else if constexpr (bpp == 2) {
+		// Each register is a block, after the permute it's made of its four half rows
+		const __m256i idx = _mm256_setr_epi32(0, 2, 1, 3, 4, 6, 5, 7);
+		__m256i a = _mm256_permutevar8x32_epi32(_mm256_loadu_si256((const __m256i *)blocks), idx);
+		__m256i b = _mm256_permutevar8x32_epi32(_mm256_loadu_si256((const __m256i *)(blocks + 32)), idx);
+		__m256i r02 = _mm256_unpacklo_epi64(a, b);
+		__m256i r13 = _mm256_unpackhi_epi64(a, b);
+		_mm_storeu_si128((__m128i *)linear, _mm256_castsi256_si128(r02));
+		_mm_storeu_si128((__m128i *)(linear + pitch), _mm256_castsi256_si128(r13));
+		_mm_storeu_si128((__m128i *)(linear + pitch * 2), _mm256_extracti128_si256(r02, 1));
+		_mm_storeu_si128((__m128i *)(linear + pitch * 3), _mm256_extracti128_si256(r13, 1));
+	}
+	else {
+		// The register is both blocks, and each lane is shuffled to its four rows like in unswizzle_block
+		__m256i rows = _mm256_loadu_si256((const __m256i *)blocks);
+		rows = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(rows, _MM_SHUFFLE(3, 1, 2, 0)), _MM_SHUFFLE(3, 1, 2, 0));
+		__m128i r01 = _mm_unpacklo_epi32(_mm256_castsi256_si128(rows), _mm256_extracti128_si256(rows, 1));
+		__m128i r23 = _mm_unpackhi_epi32(_mm256_castsi256_si128(rows), _mm256_extracti128_si256(rows, 1));
+		_mm_storel_epi64((__m128i *)linear, r01);
+		_mm_storel_epi64((__m128i *)(linear + pitch), _mm_unpackhi_epi64(r01, r01));
+		_mm_storel_epi64((__m128i *)(linear + pitch * 2), r23);
+		_mm_storel_epi64((__m128i *)(linear + pitch * 3), _mm_unpackhi_epi64(r23, r23));
+	}
+}
+
+template<uint32_t bpp>
+TARGET_AVX2 static void
+swizzle_block_pair(uint8_t *blocks, const uint8_t *linear, uint32_t pitch)
+{
+	if constexpr (bpp == 4) {
+		__m256i r0 = _mm256_loadu_si256((const __m256i *)linear);
+		__m256i r1 = _mm256_loadu_si256((const __m256i *)(linear + pitch));
+		__m256i r2 = _mm256_loadu_si256((const __m256i *)(linear + pitch * 2));
+		__m256i r3 = _mm256_loadu_si256((const __m256i *)(linear + pitch * 3));
+		_mm256_storeu_si256((__m256i *)blocks, _mm256_permute4x64_epi64(_mm256_permute2x128_si256(r0, r1, 0x20), _MM_SHUFFLE(3, 1, 2, 0)));
+		_mm256_storeu_si256((__m256i *)(blocks + 32), _mm256_permute4x64_epi64(_mm256_permute2x128_si256(r2, r3, 0x20), _MM_SHUFFLE(3, 1, 2, 0)));
+		_mm256_storeu_si256((__m256i *)(blocks + 64), _mm256_permute4x64_epi64(_mm256_permute2x128_si256(r0, r1, 0x31), _MM_SHUFFLE(3, 1, 2, 0)));
+		_mm256_storeu_si256((__m256i *)(blocks + 96), _mm256_permute4x64_epi64(_mm256_permute2x128_si256(r2, r3, 0x31), _MM_SHUFFLE(3, 1, 2, 0)));
+	}
+	else if constexpr (bpp == 2) {
+		const __m256i idx = _mm256_setr_epi32(0, 2, 1, 3, 4, 6, 5, 7);
+		__m256i r02 = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)linear)),
+			_mm_loadu_si128((const __m128i *)(linear + pitch * 2)), 1);
+		__m256i r13 = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)(linear + pitch))),
+			_mm_loadu_si128((const __m128i *)(linear + pitch * 3)), 1);
+		_mm256_storeu_si256((__m256i *)blocks, _mm256_permutevar8x32_epi32(_mm256_unpacklo_epi64(r02, r13), idx));
+		_mm256_storeu_si256((__m256i *)(blocks + 32), _mm256_permutevar8x32_epi32(_mm256_unpackhi_epi64(r02, r13), idx));
+	}
+	else {
+		__m128i r01 = _mm_unpacklo_epi64(_mm_loadl_epi64((const __m128i *)linear), _mm_loadl_epi64((const __m128i *)(linear + pitch)));
+		__m128i r23 = _mm_unpacklo_epi64(_mm_loadl_epi64((const __m128i *)(linear + pitch * 2)), _mm_loadl_epi64((const __m128i *)(linear + pitch * 3)));
+		// Gather the rows of the first block in the low lane and the ones of the second block in the high lane, then shuffle them like swizzle_block
+		r01 = _mm_shuffle_epi32(r01, _MM_SHUFFLE(3, 1, 2, 0));
+		r23 = _mm_shuffle_epi32(r23, _MM_SHUFFLE(3, 1, 2, 0));
+		__m128i a = _mm_unpacklo_epi64(r01, r23);
+		__m128i b = _mm_unpackhi_epi64(r01, r23);
+		__m256i rows = _mm256_inserti128_si256(_mm256_castsi128_si256(a), b, 1);
+		rows = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(rows, _MM_SHUFFLE(3, 1, 2, 0)), _MM_SHUFFLE(3, 1, 2, 0));
+		_mm256_storeu_si256((__m256i *)blocks, rows);
+	}
+}
+
+static const bool s_use_avx2 = has_avx2();
+#endif
+
+template<bool to_swizzled, uint32_t bpp>
+static void
+convert(uint8_t *swizzled, uint8_t *linear, uint32_t linear_pitch, uint32_t slice_pitch, const swizzle_tables &tables, uint32_t x0, uint32_t y0,
+	uint32_t rect_width, uint32_t rect_height, uint32_t depth, uint32_t texel_size)
+{
+	// bpp is zero when the texel size is not one of the sizes with a dedicated kernel, and then texel_size is used instead
+	auto copy_texel = [](uint8_t *dst, const uint8_t *src, uint32_t size)
+		{
+			if constexpr (bpp) {
+				std::memcpy(dst, src, bpp);
+			}
+			else {
+				std::memcpy(dst, src, size);
+			}
+		};
+
+	uint32_t x1 = x0 + rect_width, y1 = y0 + rect_height;
+	for (uint32_t z = 0; z < depth; ++z) {
+		uint8_t *linear_slice = linear + (uint64_t)z * slice_pitch;
+		uint32_t z_off = tables.z_off[z];
+		uint32_t y = y0;
+
+#ifdef SWIZZLE_HAS_SSE2
+		if constexpr (bpp) {
+			if (tables.has_blocks) {
+				// Convert the blocks fully inside the rectangle with simd, and leave the borders to the scalar loop below
+				uint32_t bx0 = (x0 + SWIZZLE_BLOCK_SIZE - 1) & ~(SWIZZLE_BLOCK_SIZE - 1), bx1 = x1 & ~(SWIZZLE_BLOCK_SIZE - 1);
+				uint32_t by0 = (y0 + SWIZZLE_BLOCK_SIZE - 1) & ~(SWIZZLE_BLOCK_SIZE - 1), by1 = y1 & ~(SWIZZLE_BLOCK_SIZE - 1);
+				if ((bx0 < bx1) && (by0 < by1)) {
+					for (; y < by0; ++y) {
+						for (uint32_t x = x0; x < x1; ++x) {
+							uint8_t *swz = swizzled + (uint64_t)(tables.x_off[x] | tables.y_off[y] | z_off) * bpp;
+							uint8_t *lin = linear_slice + (uint64_t)(y - y0) * linear_pitch + (x - x0) * bpp;
+							to_swizzled ? copy_texel(swz, lin, bpp) : copy_texel(lin, swz, bpp);
+						}
+					}
+					for (; y < by1; y += SWIZZLE_BLOCK_SIZE) {
+						for (uint32_t dy = 0; dy < SWIZZLE_BLOCK_SIZE; ++dy) {
+							for (uint32_t x = x0; x < bx0; ++x) {
+								uint8_t *swz = swizzled + (uint64_t)(tables.x_off[x] | tables.y_off[y + dy] | z_off) * bpp;
+								uint8_t *lin = linear_slice + (uint64_t)(y + dy - y0) * linear_pitch + (x - x0) * bpp;
+								to_swizzled ? copy_texel(swz, lin, bpp) : copy_texel(lin, swz, bpp);
+							}
+							for (uint32_t x = bx1; x < x1; ++x) {
+								uint8_t *swz = swizzled + (uint64_t)(tables.x_off[x] | tables.y_off[y + dy] | z_off) * bpp;
+								uint8_t *lin = linear_slice + (uint64_t)(y + dy - y0) * linear_pitch + (x - x0) * bpp;
+								to_swizzled ? copy_texel(swz, lin, bpp) : copy_texel(lin, swz, bpp);
+							}
+						}
+						uint32_t x = bx0;
+						auto convert_blocks = [&](uint32_t x_end, uint32_t x_step, auto &&func)
+							{
+								for (; (x + x_step) <= x_end; x += x_step) {
+									uint8_t *swz = swizzled + (uint64_t)(tables.x_off[x] | tables.y_off[y] | z_off) * bpp;
+									uint8_t *lin = linear_slice + (uint64_t)(y - y0) * linear_pitch + (x - x0) * bpp;
+									to_swizzled ? func(swz, lin) : func(lin, swz);
+								}
+							};
+						auto convert_block = [linear_pitch](uint8_t *dst, const uint8_t *src)
+							{
+								if constexpr (to_swizzled) {
+									swizzle_block<bpp>(dst, src, linear_pitch);
+								}
+								else {
+									unswizzle_block<bpp>(dst, linear_pitch, src);
+								}
+							};
+						if (s_use_avx2 && tables.has_block_pairs) {
+							// A pair starts at a multiple of eight, so convert the first block alone when it doesn't
+							convert_blocks(x + (x & SWIZZLE_BLOCK_SIZE), SWIZZLE_BLOCK_SIZE, convert_block);
+							convert_blocks(bx1, SWIZZLE_BLOCK_SIZE * 2, [linear_pitch](uint8_t *dst, const uint8_t *src)
+								{
+									if constexpr (to_swizzled) {
+										swizzle_block_pair<bpp>(dst, src, linear_pitch);
+									}
+									else {
+										unswizzle_block_pair<bpp>(dst, linear_pitch, src);
+									}
+								});
+						}
+						convert_blocks(bx1, SWIZZLE_BLOCK_SIZE, convert_block);
+					}
+				}
+			}
+		}
+#endif
+
+		for (; y < y1; ++y) {
+			uint32_t yz_off = tables.y_off[y] | z_off;
+			uint8_t *lin = linear_slice + (uint64_t)(y - y0) * linear_pitch;
+			for (uint32_t x = x0; x < x1; ++x, lin += texel_size) {
+				uint8_t *swz = swizzled + (uint64_t)(tables.x_off[x] | yz_off) * texel_size;
+				to_swizzled ? copy_texel(swz, lin, texel_size) : copy_texel(lin, swz, texel_size);
+			}
+		}
+	}
+}
+
+template<bool to_swizzled>
+static void
+convert(uint8_t *swizzled, uint8_t *linear, uint32_t linear_pitch, uint32_t slice_pitch, uint32_t width, uint32_t height, uint32_t depth, uint32_t bpp,
+	uint32_t x, uint32_t y, uint32_t rect_width, uint32_t rect_height)
+{
+	if ((rect_width == 0) || (rect_height == 0) || (depth == 0)) {
+		return;
+	}
+
+	swizzle_tables tables(width, height, depth);
+	switch (bpp)
+	{
+	case 1:
+		convert<to_swizzled, 1>(swizzled, linear, linear_pitch, slice_pitch, tables, x, y, rect_width, rect_height, depth, 1);
+		break;
+
+	case 2:
+		convert<to_swizzled, 2>(swizzled, linear, linear_pitch, slice_pitch, tables, x, y, rect_width, rect_height, depth, 2);
+		break;
+
+	case 4:
+		convert<to_swizzled, 4>(swizzled, linear, linear_pitch, slice_pitch, tables, x, y, rect_width, rect_height, depth, 4);
+		break;
+
+	default:
+		convert<to_swizzled, 0>(swizzled, linear, linear_pitch, slice_pitch, tables, x, y, rect_width, rect_height, depth, bpp);
+	}
+}
+
+void
+swizzle_rect(uint8_t *swizzled, const uint8_t *linear, uint32_t linear_pitch, uint32_t width, uint32_t height, uint32_t bpp, uint32_t x, uint32_t y,
+	uint32_t rect_width, uint32_t rect_height)
+{
+	convert<true>(swizzled, const_cast<uint8_t *>(linear), linear_pitch, 0, width, height, 1, bpp, x, y, rect_width, rect_height);
+}
+
+void
+unswizzle_rect(uint8_t *linear, const uint8_t *swizzled, uint32_t linear_pitch, uint32_t width, uint32_t height, uint32_t bpp, uint32_t x, uint32_t y,
+	uint32_t rect_width, uint32_t rect_height)
+{
+	convert<false>(const_cast<uint8_t *>(swizzled), linear, linear_pitch, 0, width, height, 1, bpp, x, y, rect_width, rect_height);
+}
+
+void
+swizzle_box(uint8_t *swizzled, const uint8_t *linear, uint32_t linear_pitch, uint32_t slice_pitch, uint32_t width, uint32_t height, uint32_t depth,
+	uint32_t bpp)
+{
+	convert<true>(swizzled, const_cast<uint8_t *>(linear), linear_pitch, slice_pitch, width, height, depth, bpp, 0, 0, width, height);
+}
+
+void
+unswizzle_box(uint8_t *linear, const uint8_t *swizzled, uint32_t linear_pitch, uint32_t slice_pitch, uint32_t width, uint32_t height, uint32_t depth,
+	uint32_t bpp)
+{
+	convert<false>(const_cast<uint8_t *>(swizzled), linear, linear_pitch, slice_pitch, width, height, depth, bpp, 0, 0, width, height);
+}
@@ -0,0 +1,26 @@
+// SPDX-License-Identifier: GPL-3.0-only
+// SPDX-FileCopyrightText: 2026 ergo720
+
+#pragma once
+
+#include <cstdint>
+
+
+// Conversions between the linear layout and the swizzled layout used by nv2a for textures and swizzled surfaces. In the swizzled layout, the bits of the
+// x, y and z coordinates of a texel are interleaved (x first) to form its index, and a dimension stops contributing bits once they are all used. This
+// requires dimensions that are powers of two. bpp is the size in bytes of a texel, and the pitches are the ones of the linear image
+
+// Reference implementation: returns the index of texel (x, y, z) in a swizzled image, by interleaving the bits one at a time
+uint32_t swizzle_index(uint32_t x, uint32_t y, uint32_t z, uint32_t width, uint32_t height, uint32_t depth);
+
+// Writes the linear rectangle of rect_width x rect_height texels to the swizzled 2d image at (x, y)
+void swizzle_rect(uint8_t *swizzled, const uint8_t *linear, uint32_t linear_pitch, uint32_t width, uint32_t height, uint32_t bpp, uint32_t x, uint32_t y,
+	uint32_t rect_width, uint32_t rect_height);
+// Reads the rectangle of rect_width x rect_height texels at (x, y) of the swizzled 2d image to the linear image
+void unswizzle_rect(uint8_t *linear, const uint8_t *swizzled, uint32_t linear_pitch, uint32_t width, uint32_t height, uint32_t bpp, uint32_t x, uint32_t y,
+	uint32_t rect_width, uint32_t rect_height);
+// Same as swizzle_rect and unswizzle_rect, but for whole 3d images made of depth slices that are slice_pitch bytes apart
+void swizzle_box(uint8_t *swizzled, const uint8_t *linear, uint32_t linear_pitch, uint32_t slice_pitch, uint32_t width, uint32_t height, uint32_t depth,
+	uint32_t bpp);
+void unswizzle_box(uint8_t *linear, const uint8_t *swizzled, uint32_t linear_pitch, uint32_t slice_pitch, uint32_t width, uint32_t height, uint32_t depth,
+	uint32_t bpp);
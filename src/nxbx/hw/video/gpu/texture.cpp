@@ -0,0 +1,314 @@
+// SPDX-License-Identifier: GPL-3.0-only
+// SPDX-FileCopyrightText: 2026 ergo720
+
+#include "texture.hpp"
+#include "swizzle.hpp"
+#include "nv2a_classes.hpp"
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#if defined(__x86_64__) || defined(_M_X64)
+#include <emmintrin.h>
+#define TEXTURE_HAS_SSE2
+#endif
+
+
+static uint32_t
+dxt_block_size(uint32_t format)
+{
+	return format == NV097_SET_TEXTURE_FORMAT_COLOR_L_DXT1_A1R5G5B5 ? 8 : 16;
+}
+
+static uint32_t
+expand_565(uint16_t color)
+{
+	uint32_t r = (color >> 11) & 0x1F, g = (color >> 5) & 0x3F, b = color & 0x1F;
+	return (((r << 3) | (r >> 2)) << 16) | (((g << 2) | (g >> 4)) << 8) | ((b << 3) | (b >> 2));
+}
+
+static uint32_t
+lerp_color(uint32_t c0, uint32_t c1, uint32_t w0, uint32_t w1)
+{
+	// Weighted average of the rgb channels of two colors, rounded down like the reference decoders do
+	uint32_t color = 0;
+	for (uint32_t shift = 0; shift < 24; shift += 8) {
+		color |= ((((c0 >> shift) & 0xFF) * w0 + ((c1 >> shift) & 0xFF) * w1) / (w0 + w1)) << shift;
+	}
+	return color;
+}
+
+static void
+decode_dxt_block(uint32_t *texels, const uint8_t *block, uint32_t format)
+{
+	// Decodes a 4x4 block to 16 texels, in row order
+	const uint8_t *color_block = format == NV097_SET_TEXTURE_FORMAT_COLOR_L_DXT1_A1R5G5B5 ? block : block + 8;
+	uint16_t c0, c1;
+	uint32_t indices;
+	std::memcpy(&c0, color_block, 2);
+	std::memcpy(&c1, color_block + 2, 2);
+	std::memcpy(&indices, color_block + 4, 4);
+
+	// DXT1 has a three color mode with transparent black when c0 <= c1, while DXT3 and DXT5 always use four colors
+	uint32_t palette[4];
+	palette[0] = expand_565(c0) | 0xFF000000;
+	palette[1] = expand_565(c1) | 0xFF000000;
+	if ((c0 > c1) || (format != NV097_SET_TEXTURE_FORMAT_COLOR_L_DXT1_A1R5G5B5)) {
+		palette[2] = lerp_color(palette[0], palette[1], 2, 1) | 0xFF000000;
+		palette[3] = lerp_color(palette[0], palette[1], 1, 2) | 0xFF000000;
+	}
+	else {
+		palette[2] = lerp_color(palette[0], palette[1], 1, 1) | 0xFF000000;
+		palette[3] = 0;
+	}
+	for (uint32_t i = 0; i < 16; ++i) {
+		texels[i] = palette[(indices >> (i * 2)) & 3];
+	}
+
+	if (format == NV097_SET_TEXTURE_FORMAT_COLOR_L_DXT23_A8R8G8B8) {
+		// Explicit 4 bit alpha
+		uint64_t alpha;
+		std::memcpy(&alpha, block, 8);
+		for (uint32_t i = 0; i < 16; ++i) {
+			texels[i] = (texels[i] & 0x00FFFFFF) | ((uint32_t)((alpha >> (i * 4)) & 0xF) * 17) << 24;
+		}
+	}
+	else if (format == NV097_SET_TEXTURE_FORMAT_COLOR_L_DXT45_A8R8G8B8) {
+		// Interpolated alpha, with eight values when a0 > a1, and six values plus zero and 255 otherwise
+		uint32_t alpha_palette[8];
+		alpha_palette[0] = block[0];
+		alpha_palette[1] = block[1];
+		if (alpha_palette[0] > alpha_palette[1]) {
+			for (uint32_t i = 1; i < 7; ++i) {
+				alpha_palette[i + 1] = ((7 - i) * alpha_palette[0] + i * alpha_palette[1]) / 7;
+			}
+		}
+		else {
+			for (uint32_t i = 1; i < 5; ++i) {
+				alpha_palette[i + 1] = ((5 - i) * alpha_palette[0] + i * alpha_palette[1]) / 5;
+			}
+			alpha_palette[6] = 0;
+			alpha_palette[7] = 255;
+		}
+		uint64_t alpha_indices = 0;
+		std::memcpy(&alpha_indices, block + 2, 6);
+		for (uint32_t i = 0; i < 16; ++i) {
+			texels[i] = (texels[i] & 0x00FFFFFF) | (alpha_palette[(alpha_indices >> (i * 3)) & 7] << 24);
+		}
+	}
+}
+
+static void
+decode_dxt(uint32_t *dst, uint32_t dst_pitch, const uint8_t *src, uint32_t format, uint32_t width, uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1)
+{
+	// Only the blocks that overlap the rectangle are decoded. A block is decoded to a temporary, and then the part inside the rectangle is copied
+	uint32_t block_size = dxt_block_size(format);
+	uint32_t blocks_per_row = std::max((width + 3) / 4, 1u);
+	for (uint32_t by = y0 / 4; by <= (y1 - 1) / 4; ++by) {
+		for (uint32_t bx = x0 / 4; bx <= (x1 - 1) / 4; ++bx) {
+			uint32_t texels[16];
+			decode_dxt_block(texels, src + ((uint64_t)by * blocks_per_row + bx) * block_size, format);
+			uint32_t tx0 = std::max(bx * 4, x0), tx1 = std::min(bx * 4 + 4, x1);
+			uint32_t ty0 = std::max(by * 4, y0), ty1 = std::min(by * 4 + 4, y1);
+			for (uint32_t ty = ty0; ty < ty1; ++ty) {
+				std::memcpy((uint8_t *)dst + (uint64_t)(ty - y0) * dst_pitch + (tx0 - x0) * 4, &texels[(ty & 3) * 4 + (tx0 & 3)], (tx1 - tx0) * 4);
+			}
+		}
+	}
+}
+
+static void
+decode_p8(uint32_t *dst, uint32_t dst_pitch, const uint8_t *src, uint32_t width, uint32_t height, uint32_t x, uint32_t y, uint32_t rect_width,
+	uint32_t rect_height, const uint32_t *palette, uint32_t palette_size)
+{
+	// The indices are swizzled, so they are first unswizzled to a linear buffer. The lookup itself is a gather, which sse2 can't do better than scalar loads
+	std::vector<uint8_t> indices((uint64_t)rect_width * rect_height);
+	unswizzle_rect(indices.data(), src, rect_width, width, height, 1, x, y, rect_width, rect_height);
+
+	// Indices past the end of the palette read black, instead of reading outside of it
+	uint32_t full_palette[256] = {};
+	std::copy_n(palette, std::min(palette_size, 256u), full_palette);
+	for (uint32_t row = 0; row < rect_height; ++row) {
+		const uint8_t *index = indices.data() + (uint64_t)row * rect_width;
+		uint32_t *texel = (uint32_t *)((uint8_t *)dst + (uint64_t)row * dst_pitch);
+		for (uint32_t i = 0; i < rect_width; ++i) {
+			texel[i] = full_palette[index[i]];
+		}
+	}
+}
+
+static uint8_t
+clamp_to_u8(int32_t value)
+{
+	return (uint8_t)std::clamp(value, 0, 255);
+}
+
+static uint32_t
+yuv_to_argb(int32_t y, int32_t u, int32_t v)
+{
+	// BT.601 with studio range, in 8 bit fixed point. The simd kernel below does exactly the same integer math
+	int32_t c = y - 16, d = u - 128, e = v - 128;
+	uint32_t r = clamp_to_u8((298 * c + 409 * e + 128) >> 8);
+	uint32_t g = clamp_to_u8((298 * c - 100 * d - 208 * e + 128) >> 8);
+	uint32_t b = clamp_to_u8((298 * c + 516 * d + 128) >> 8);
+	return 0xFF000000 | (r << 16) | (g << 8) | b;
+}
+
+#ifdef TEXTURE_HAS_SSE2
+static void
+decode_yuv_sse2(uint32_t *dst, const uint8_t *src, uint32_t num_of_pairs, bool is_uyvy)
+{
+	// Converts 8 texels (16 bytes of YUY2 or UYVY) per iteration. The products don't fit in 16 bits, so they are done in 32 bits with madd, which also
+	// adds the two terms of each pair
+	const __m128i low_bytes = _mm_set1_epi16(0xFF);
+	const __m128i y_bias = _mm_set1_epi16(16), uv_bias = _mm_set1_epi16(128);
+	const __m128i coeff_r = _mm_setr_epi16(298, 409, 298, 409, 298, 409, 298, 409);
+	const __m128i coeff_g_yu = _mm_setr_epi16(298, -100, 298, -100, 298, -100, 298, -100);
+	const __m128i coeff_g_v = _mm_setr_epi16(-208, 0, -208, 0, -208, 0, -208, 0);
+	const __m128i coeff_b = _mm_setr_epi16(298, 516, 298, 516, 298, 516, 298, 516);
+	const __m128i round = _mm_set1_epi32(128);
+	const __m128i alpha = _mm_set1_epi8((char)0xFF);
+	const __m128i zero = _mm_setzero_si128();
+
+	auto channel = [round](__m128i ab_lo, __m128i ab_hi, __m128i coeff)
+		{
+			__m128i lo = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(ab_lo, coeff), round), 8);
+			__m128i hi = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(ab_hi, coeff), round), 8);
+			return _mm_packs_epi32(lo, hi);
+		};
+
+	for (uint32_t i = 0; i + 4 <= num_of_pairs; i += 4) {
+		__m128i bytes = _mm_loadu_si128((const __m128i *)(src + i * 4));
+		__m128i luma = is_uyvy ? _mm_srli_epi16(bytes, 8) : _mm_and_si128(bytes, low_bytes);
+		__m128i chroma = is_uyvy ? _mm_and_si128(bytes, low_bytes) : _mm_srli_epi16(bytes, 8); // u0 v0 u1 v1 u2 v2 u3 v3
+		__m128i u = _mm_shufflehi_epi16(_mm_shufflelo_epi16(chroma, _MM_SHUFFLE(2, 2, 0, 0)), _MM_SHUFFLE(2, 2, 0, 0));
+		__m128i v = _mm_shufflehi_epi16(_mm_shufflelo_epi16(chroma, _MM_SHUFFLE(3, 3, 1, 1)), _MM_SHUFFLE(3, 3, 1, 1));
+		__m128i c = _mm_sub_epi16(luma, y_bias), d = _mm_sub_epi16(u, uv_bias), e = _mm_sub_epi16(v, uv_bias);
+
+		__m128i r = channel(_mm_unpacklo_epi16(c, e), _mm_unpackhi_epi16(c, e), coeff_r);
+		__m128i b = channel(_mm_unpacklo_epi16(c, d), _mm_unpackhi_epi16(c, d), coeff_b);
+		__m128i g_lo = _mm_add_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(c, d), coeff_g_yu), _mm_madd_epi16(_mm_unpacklo_epi16(e, zero), coeff_g_v));
+		__m128i g_hi = _mm_add_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(c, d), coeff_g_yu), _mm_madd_epi16(_mm_unpackhi_epi16(e, zero), coeff_g_v));
+		__m128i g = _mm_packs_epi32(_mm_srai_epi32(_mm_add_epi32(g_lo, round), 8), _mm_srai_epi32(_mm_add_epi32(g_hi, round), 8));
+
+		// Saturate to bytes and interleave them as b, g, r, a
+		__m128i bg = _mm_unpacklo_epi8(_mm_packus_epi16(b, b), _mm_packus_epi16(g, g));
+		__m128i ra = _mm_unpacklo_epi8(_mm_packus_epi16(r, r), alpha);
+		_mm_storeu_si128((__m128i *)(dst + i * 2), _mm_unpacklo_epi16(bg, ra));
+		_mm_storeu_si128((__m128i *)(dst + i * 2 + 4), _mm_unpackhi_epi16(bg, ra));
+	}
+}
+#endif
+
+static void
+decode_yuv(uint32_t *dst, uint32_t dst_pitch, const uint8_t *src, uint32_t src_pitch, bool is_uyvy, uint32_t width, uint32_t x0, uint32_t y0, uint32_t x1,
+	uint32_t y1)
+{
+	// Two texels share the chroma, so the decoding starts and ends at even texels, and the texels outside of the rectangle are then discarded. When the
+	// width is odd, the last texel of a row only has the first half of its pair, so it's decoded apart, without reading past the end of the row
+	uint32_t pair0 = x0 / 2, pair1 = (x1 + 1) / 2;
+	uint32_t num_of_pairs = std::min(pair1, width / 2) - pair0;
+	bool has_half_pair = pair1 > (width / 2);
+	std::vector<uint32_t> row_texels((pair1 - pair0) * 2);
+	for (uint32_t y = y0; y < y1; ++y) {
+		const uint8_t *pairs = src + (uint64_t)y * src_pitch + pair0 * 4;
+		uint32_t done = 0;
+#ifdef TEXTURE_HAS_SSE2
+		done = num_of_pairs & ~3;
+		decode_yuv_sse2(row_texels.data(), pairs, done, is_uyvy);
+#endif
+		for (uint32_t i = done; i < num_of_pairs; ++i) {
+			const uint8_t *pair = pairs + i * 4;
+			uint32_t ya = pair[is_uyvy ? 1 : 0], yb = pair[is_uyvy ? 3 : 2], u = pair[is_uyvy ? 0 : 1], v = pair[is_uyvy ? 2 : 3];
+			row_texels[i * 2] = yuv_to_argb(ya, u, v);
+			row_texels[i * 2 + 1] = yuv_to_argb(yb, u, v);
+		}
+		if (has_half_pair) {
+			// The v of the half pair is outside of the row, so the one of the previous pair is used instead, or a neutral one if there's no such pair
+			const uint8_t *pair = pairs + num_of_pairs * 4;
+			uint32_t ya = pair[is_uyvy ? 1 : 0], u = pair[is_uyvy ? 0 : 1], v = width > 1 ? pair[is_uyvy ? -2 : -1] : 128;
+			row_texels[num_of_pairs * 2] = yuv_to_argb(ya, u, v);
+		}
+		std::memcpy((uint8_t *)dst + (uint64_t)(y - y0) * dst_pitch, &row_texels[x0 & 1], (x1 - x0) * 4);
+	}
+}
+
+bool
+texture_is_supported(uint32_t format)
+{
+	switch (format)
+	{
+	case NV097_SET_TEXTURE_FORMAT_COLOR_SZ_I8_A8R8G8B8:
+	case NV097_SET_TEXTURE_FORMAT_COLOR_L_DXT1_A1R5G5B5:
+	case NV097_SET_TEXTURE_FORMAT_COLOR_L_DXT23_A8R8G8B8:
+	case NV097_SET_TEXTURE_FORMAT_COLOR_L_DXT45_A8R8G8B8:
+	case NV097_SET_TEXTURE_FORMAT_COLOR_LC_IMAGE_CR8YB8CB8YA8:
+	case NV097_SET_TEXTURE_FORMAT_COLOR_LC_IMAGE_YB8CR8YA8CB8:
+		return true;
+
+	default:
+		return false;
+	}
+}
+
+uint64_t
+texture_level_offset(uint32_t format, uint32_t width, uint32_t height, uint32_t level)
+{
+	uint64_t offset = 0;
+	for (uint32_t i = 0; i < level; ++i) {
+		switch (format)
+		{
+		case NV097_SET_TEXTURE_FORMAT_COLOR_L_DXT1_A1R5G5B5:
+		case NV097_SET_TEXTURE_FORMAT_COLOR_L_DXT23_A8R8G8B8:
+		case NV097_SET_TEXTURE_FORMAT_COLOR_L_DXT45_A8R8G8B8:
+			offset += (uint64_t)std::max((width + 3) / 4, 1u) * std::max((height + 3) / 4, 1u) * dxt_block_size(format);
+			break;
+
+		case NV097_SET_TEXTURE_FORMAT_COLOR_SZ_I8_A8R8G8B8:
+			offset += (uint64_t)width * height;
+			break;
+
+		default:
+			// Linear formats don't have mip levels
+			return 0;
+		}
+		width = std::max(width / 2, 1u);
+		height = std::max(height / 2, 1u);
+	}
+	return offset;
+}
+
+bool
+texture_decode(uint32_t *dst, uint32_t dst_pitch, const uint8_t *src, uint32_t src_pitch, uint32_t format, uint32_t width, uint32_t height, uint32_t x,
+	uint32_t y, uint32_t rect_width, uint32_t rect_height, const uint32_t *palette, uint32_t palette_size)
+{
+	if (!texture_is_supported(format)) {
+		return false;
+	}
+
+	rect_width = std::min(rect_width, width > x ? width - x : 0);
+	rect_height = std::min(rect_height, height > y ? height - y : 0);
+	if ((rect_width == 0) || (rect_height == 0)) {
+		return true;
+	}
+
+	switch (format)
+	{
+	case NV097_SET_TEXTURE_FORMAT_COLOR_SZ_I8_A8R8G8B8:
+		decode_p8(dst, dst_pitch, src, width, height, x, y, rect_width, rect_height, palette, palette_size);
+		break;
+
+	case NV097_SET_TEXTURE_FORMAT_COLOR_L_DXT1_A1R5G5B5:
+	case NV097_SET_TEXTURE_FORMAT_COLOR_L_DXT23_A8R8G8B8:
+	case NV097_SET_TEXTURE_FORMAT_COLOR_L_DXT45_A8R8G8B8:
+		decode_dxt(dst, dst_pitch, src, format, width, x, y, x + rect_width, y + rect_height);
+		break;
+
+	case NV097_SET_TEXTURE_FORMAT_COLOR_LC_IMAGE_CR8YB8CB8YA8:
+	case NV097_SET_TEXTURE_FORMAT_COLOR_LC_IMAGE_YB8CR8YA8CB8:
+		decode_yuv(dst, dst_pitch, src, src_pitch, format == NV097_SET_TEXTURE_FORMAT_COLOR_LC_IMAGE_YB8CR8YA8CB8, width, x, y, x + rect_width,
+			y + rect_height);
+		break;
+	}
+
+	return true;
+}
@@ -0,0 +1,21 @@
+// SPDX-License-Identifier: GPL-3.0-only
+// SPDX-FileCopyrightText: 2026 ergo720
+
+#pragma once
+
+#include <cstdint>
+
+
+// Decoders of the nv2a texture formats that can't be used as they are by a cpu renderer, a texture viewer or a dump: S3TC (DXT1, DXT3 and DXT5),
+// swizzled 8 bit indices into a palette (the one set with NV097_SET_TEXTURE_PALETTE) and YUV 4:2:2. Texels are decoded to A8R8G8B8, the same format
+// of the color surfaces, and only the rectangle requested is decoded, so that a partial update doesn't pay for the whole texture
+
+// Returns true if the NV097_SET_TEXTURE_FORMAT_COLOR format is supported by texture_decode
+bool texture_is_supported(uint32_t format);
+// Returns the offset in bytes of the mip level from the start of a 2d texture with these dimensions (the ones of level zero)
+uint64_t texture_level_offset(uint32_t format, uint32_t width, uint32_t height, uint32_t level);
+// Decodes the rectangle of rect_width x rect_height texels at (x, y) of a mip level of width x height texels, which starts at src, to dst. src_pitch is
+// only used by the linear formats (the YUV ones), and palette_size is the number of entries of palette, which is only used by the indexed format.
+// Returns false if the format is not supported
+bool texture_decode(uint32_t *dst, uint32_t dst_pitch, const uint8_t *src, uint32_t src_pitch, uint32_t format, uint32_t width, uint32_t height, uint32_t x,
+	uint32_t y, uint32_t rect_width, uint32_t rect_height, const uint32_t *palette, uint32_t palette_size);
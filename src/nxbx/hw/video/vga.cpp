@@ -3,20 +3,19 @@
 // SPDX-FileCopyrightText: 2020 Halfix devs
 // This code is derived from https://github.com/nepx/halfix/blob/master/src/hardware/vga.c
 
-#include "lib86cpu.hpp"
-#include "gpu/pcrtc.hpp"
-// Must be included last because of the template functions nv2a_read/write, which require a complete definition for the engine objects
-#include "gpu/nv2a.hpp"
 #include "vga.hpp"
+#include "vga_scanline.hpp"
 #include "host.hpp"
 #include <cstring>
 #include <cinttypes>
 #include <vector>
+#include <mutex>
 
 #define MODULE_NAME vga
 
 #define MASK(n) (uint8_t)(~n)
 #define DO_MASK(n) xor_ ^= mask_enabled& n ? value& lut32[n] : mask& lut32[n]
+#define SCANLINE_STALE 3 // the scanline must be redrawn in both host frame buffers, one bit for each buffer
 
 
 enum {
@@ -43,8 +42,9 @@ enum {
 class vga::Impl
 {
 public:
-	void init(cpu *cpu, nv2a *gpu);
+	void init(uint8_t *vram, uint32_t vram_size);
 	void reset();
+	void setStart(uint32_t addr);
 	uint8_t ioRead8(uint32_t addr);
 	void ioWrite8(uint32_t addr, const uint8_t value);
 	void ioWrite16(uint32_t addr, const uint16_t value);
@@ -53,19 +53,25 @@ public:
 	void memWrite8(uint32_t addr, const uint8_t value);
 	void memWrite16(uint32_t addr, const uint16_t value);
 	void update();
+	bool getFrame(std::vector<uint32_t> &pixels, uint32_t &width, uint32_t &height, uint64_t &frame_num);
+	void getCrtcMode(uint32_t &width, uint32_t &height, uint32_t &pitch, uint32_t &bpp);
 
 private:
+	void display_set_resolution(uint32_t width, uint32_t height);
+	void *display_get_pixels();
+	void display_update();
 	void update_size();
 	void change_renderer();
+	void restart_frame();
 	void complete_redraw();
+	void invalidate();
 	void update_mem_access();
 	void update_all_dac_entries();
 	void update_one_dac_entry(int i);
 	void change_attr_cache(int i);
 	uint8_t alu_rotate(uint8_t value);
 
-	// connected devices
-	pcrtc *m_pcrtc;
+	uint32_t m_start = 0; // NV_PCRTC_START, the address of the framebuffer in vram
 	// CRT Controller
 	uint8_t crt[256], crt_index;
 	// Attribute Controller
@@ -119,22 +125,67 @@ private:
 
 	// Screen data cannot change if memory_modified is zero.
 	int memory_modified;
+
+	// Host frame buffers, in A8R8G8B8 format. The renderer draws to the back buffer, which is swapped with the front buffer when a frame is complete. Only the
+	// front buffer is shared with the frontend, and it's protected by m_frame_mtx together with the variables below it
+	std::vector<uint32_t> m_frames[2];
+	uint32_t m_back_idx;
+	bool m_frame_pending; // a complete frame is in the back buffer, but it couldn't be published yet
+	std::mutex m_frame_mtx;
+	uint32_t m_front_width, m_front_height;
+	uint64_t m_front_num = 0;
+
+	vga_palette_luts m_luts; // palettes of the graphics renderers, rebuilt at every drawn frame
 };
 
-static void display_set_resolution(uint32_t width, uint32_t height)
+void vga::Impl::display_set_resolution(uint32_t width, uint32_t height)
 {
-	// TODO: this should update the size of the rendering window
+	// The front buffer keeps the size of the frame it holds, and it's resized when it becomes the back buffer again
+	m_frames[m_back_idx].resize(width * height, 255 << 24);
+	m_frame_pending = false;
 }
 
-static void *display_get_pixels()
+void *vga::Impl::display_get_pixels()
 {
-	// TODO: this should get the rendering target used by the rendering window
-	return nullptr;
+	return m_frames[m_back_idx].data();
 }
 
-static void display_update()
+void vga::Impl::display_update()
 {
-	// TODO: this should redraw the image shown in the rendering window
+	// Never wait for the frontend here, because this runs on the cpu thread. If the frontend is still copying the front buffer, the frame is published at
+	// the next vblank instead
+	std::unique_lock lock(m_frame_mtx, std::try_to_lock);
+	if (!lock.owns_lock()) {
+		m_frame_pending = true;
+		return;
+	}
+
+	m_back_idx ^= 1;
+	m_front_width = total_width;
+	m_front_height = total_height;
+	++m_front_num;
+	lock.unlock();
+
+	// The new back buffer holds the previous frame, so only the scanlines that are stale in it need to be redrawn
+	m_frame_pending = false;
+	m_frames[m_back_idx].resize(total_width * total_height, 255 << 24);
+	framebuffer = (uint32_t *)display_get_pixels();
+}
+
+bool vga::Impl::getFrame(std::vector<uint32_t> &pixels, uint32_t &width, uint32_t &height, uint64_t &frame_num)
+{
+	std::unique_lock lock(m_frame_mtx);
+	if (m_front_num == frame_num) {
+		return false;
+	}
+
+	const std::vector<uint32_t> &front = m_frames[m_back_idx ^ 1];
+	pixels.assign(front.begin(), front.begin() + m_front_width * m_front_height);
+	width = m_front_width;
+	height = m_front_height;
+	frame_num = m_front_num;
+
+	return true;
 }
 
 static void expand32_alt(uint8_t *ptr, int v4)
@@ -181,11 +232,6 @@ static inline uint32_t do_mask(uint32_t value, uint32_t mask, int mask_enabled)
 	return xor_;
 }
 
-static uint8_t bpp4_to_offset(uint8_t i, uint8_t j, uint8_t k)
-{
-	return ((i & (0x80 >> j)) != 0) ? 1 << k : 0;
-}
-
 static uint32_t char_map_address(int b)
 {
 	return b << 13;
@@ -251,7 +297,18 @@ void vga::Impl::update_mem_access()
 	logger_en(debug, "Updating Memory Access Constants: write=%" PRIu8 " [mode=%" PRIu8 "], read=%" PRIu8, write_access, write_mode, read_access);
 }
 
-void vga::Impl::complete_redraw()
+void vga::Impl::getCrtcMode(uint32_t &width, uint32_t &height, uint32_t &pitch, uint32_t &bpp)
+{
+	// The extended registers add bit 8 of the horizontal display end (CR2D bit 1), bit 10 of the vertical display end (CR25 bit 1) and bits 8-10 of the
+	// line offset (CR19 and CR25, like in update()). CR28 bits 0-1 select the pixel depth
+	width = (crt[1] + 1 + ((crt[0x2D] & 2) << 7)) * 8;
+	height = (crt[0x12] | ((crt[0x07] & 2) << 7) | ((crt[0x07] & 0x40) << 3) | ((crt[0x25] & 2) << 9)) + 1;
+	pitch = (((crt[0x25] & 0x20) << 6) | ((crt[0x19] & 0xE0) << 3) | crt[0x13]) << 3;
+	constexpr uint32_t depth[4] = { 0, 8, 16, 32 };
+	bpp = depth[crt[0x28] & 3];
+}
+
+void vga::Impl::restart_frame()
 {
 	current_scanline = 0;
 	character_scanline = crt[8] & 0x1F;
@@ -260,10 +317,21 @@ void vga::Impl::complete_redraw()
 	framebuffer_offset = 0;
 
 	// On nv2a, the framebuffer address is fetched from PCRTC. The address is already byte-addressed, so it doesn't need the extra multiplication here
-	vram_addr = m_pcrtc->read32(NV_PCRTC_START);
+	vram_addr = m_start;
+}
+
+void vga::Impl::complete_redraw()
+{
+	restart_frame();
 
 	// Force a complete redraw of the screen, and to do that, pretend that memory has been written.
+	invalidate();
+}
+
+void vga::Impl::invalidate()
+{
 	memory_modified = 3;
+	std::fill(vbe_scanlines_modified.begin(), vbe_scanlines_modified.end(), SCANLINE_STALE);
 }
 
 void vga::Impl::change_renderer()
@@ -325,9 +393,10 @@ void vga::Impl::update_size()
 	total_width = width;
 
 	vbe_scanlines_modified.resize(total_height);
-	memset(vbe_scanlines_modified.data(), 1, total_height);
+	memset(vbe_scanlines_modified.data(), SCANLINE_STALE, total_height);
 
-	scanlines_to_update = height >> 1;
+	// A whole frame is drawn at every vblank
+	scanlines_to_update = height;
 }
 
 void vga::Impl::ioWrite8(uint32_t addr, const uint8_t value)
@@ -337,6 +406,9 @@ void vga::Impl::ioWrite8(uint32_t addr, const uint8_t value)
 		return;
 	}
 
+	// Most registers change how the screen looks (palette, panning, cursor...), so redraw it after any register write
+	invalidate();
+
 	uint8_t diffxor;
 	switch (addr)
 	{
@@ -979,21 +1051,21 @@ void vga::Impl::memWrite8(uint32_t addr, const uint8_t value)
 	*vram_ptr = do_mask(*vram_ptr, data32, plane);
 
 	// Update scanline
-	uint32_t offs = (plane_addr << 2) - m_pcrtc->read32(NV_PCRTC_START),
+	uint32_t offs = (plane_addr << 2) - m_start,
 		offset_between_lines = (((crt[0x25] & 0x20) << 6) | ((crt[0x19] & 0xE0) << 3) | crt[0x13]) << 3;
 
-	unsigned int scanline = offs / offset_between_lines;
+	unsigned int scanline = offset_between_lines ? offs / offset_between_lines : 0;
 	if (total_height > scanline) {
 		switch (renderer >> 1)
 		{
 		case MODE_13H_RENDERER >> 1:
 			// Determine the scanline that it has been written to.
-			vbe_scanlines_modified[scanline] = 1;
+			vbe_scanlines_modified[scanline] = SCANLINE_STALE;
 			break;
 
 		case RENDER_4BPP >> 1:
 			// todo: what about bit13 replacement?
-			vbe_scanlines_modified[scanline] = 1;
+			vbe_scanlines_modified[scanline] = SCANLINE_STALE;
 			break;
 		}
 	}
@@ -1061,12 +1133,17 @@ uint16_t vga::Impl::memRead16(uint32_t addr)
 
 void vga::Impl::update()
 {
-	// TODO: this function is supposed to be called at the refresh rate of the monitor. Currently, it's not being called by anything because
-	// there's no gui yet
+	// Called by pcrtc at every vblank, and it draws a whole frame to the back buffer
 
 	// Note: This function should NOT modify any VGA registers or memory!
 
 	framectr = (framectr + 1) & 0x3F;
+	if (((renderer & ~1) == ALPHANUMERIC_RENDERER) && ((framectr & 0x1F) == 0)) {
+		memory_modified = 3; // the cursor blinks, so the text must be redrawn even if memory didn't change
+	}
+	if (vram_addr != m_start) {
+		complete_redraw(); // the framebuffer was moved
+	}
 	uint32_t scanlines_to_update1 = scanlines_to_update; // XXX
 
 	// Text Mode state
@@ -1112,9 +1189,24 @@ void vga::Impl::update()
 		break;
 	}
 	if (!memory_modified) {
+		// Nothing changed, so the last frame is still good. It only needs to be published if that didn't happen yet
+		if (m_frame_pending) {
+			display_update();
+		}
 		return;
 	}
-	memory_modified &= ~(1 << (int)(current_scanline != 0));
+	memory_modified = 0;
+	vga_build_luts(m_luts, dac_palette, dac_mask, attr_palette);
+
+	// In the graphics modes, the lines of vram written since the back buffer was last drawn are marked in vbe_scanlines_modified, so the other ones can be
+	// skipped because the back buffer already has them
+	const uint8_t back_bit = 1 << m_back_idx;
+	const uint32_t frame_start = vram_addr;
+	auto is_line_stale = [&]()
+		{
+			uint32_t line = offset_between_lines ? (vram_addr - frame_start) / offset_between_lines : 0;
+			return (line >= vbe_scanlines_modified.size()) || (vbe_scanlines_modified[line] & back_bit);
+		};
 
 	uint32_t
 		//current = current_scanline,
@@ -1147,7 +1239,7 @@ void vga::Impl::update()
 		// Therefore, we can come to the conclusion that if scanline doubling is enabled, then all odd scanlines are simply copies of the one preceding them
 		if ((current_scanline & 1) && (crt[9] & 0x80)) {
 			// See above for
-			memcpy(&framebuffer[framebuffer_offset], &framebuffer[framebuffer_offset - total_width], total_width);
+			memcpy(&framebuffer[framebuffer_offset], &framebuffer[framebuffer_offset - total_width], total_width * sizeof(uint32_t));
 		}
 		else {
 			if (current_scanline < total_height) {
@@ -1233,132 +1325,53 @@ void vga::Impl::update()
 				}
 				break;
 
-				case MODE_13H_RENDERER: {
-					//if(!vbe_scanlines_modified[current_scanline]) break;
-					// CHAIN4 Memory Layout:
-					//  Plane 0: AA 00 00 00 AA 00 00 00
-					//  Plane 1: BB 00 00 00 BB 00 00 00
-					//  Plane 2: CC 00 00 00 CC 00 00 00
-					//  Plane 3: DD 00 00 00 DD 00 00 00
-					// Draw four clumps of pixels together
-					// XXX: What if screen isn't a multiple of four pixels wide?
-					for (unsigned i = 0; i < total_width; i += 4, vram_addr1 += 16) {
-						for (int j = 0; j < 4; j++) { // hopefully, compiler unrolls loop
-							framebuffer[fboffset + j] = dac_palette[vram[vram_addr1 | j] & dac_mask];
-						}
-						fboffset += 4;
-					}
-					//vbe_scanlines_modified[current_scanline] = 0;	
-				}
-				break;
-
+				case MODE_13H_RENDERER:
 				case MODE_13H_RENDERER | 1:
-					//if(!vbe_scanlines_modified[current_scanline]) break;
-					for (unsigned int i = 0; i < total_width; i += 8, vram_addr1 += 4) {
-						for (int j = 0, k = 0; j < 4; j++, k += 2) {
-							framebuffer[fboffset + k] = framebuffer[fboffset + k + 1] = dac_palette[vram[vram_addr1 | j] & dac_mask];
-						}
-						fboffset += 8;
+					if (!is_line_stale()) {
+						break;
 					}
-					//vbe_scanlines_modified[current_scanline] = 0;
+					vga_draw_13h(&framebuffer[fboffset], vram, vram_addr1, total_width, renderer & 1, m_luts);
 					break;
 
-				case RENDER_4BPP: {
-					//if(!vbe_scanlines_modified[current_scanline]) break;
-					uint32_t addr = vram_addr1;
-					if (character_scanline & address_bit_mapping) {
-						addr |= 0x8000;
-					}
-					uint8_t p0 = vram[addr | 0];
-					uint8_t p1 = vram[addr | 1];
-					uint8_t p2 = vram[addr | 2];
-					uint8_t p3 = vram[addr | 3];
-
-					for (unsigned x = 0, px = current_pixel_panning; x < total_width; x++, fboffset++, px++) {
-						if (px > 7) {
-							px = 0;
-							addr += 4;
-							p0 = vram[addr | 0];
-							p1 = vram[addr | 1];
-							p2 = vram[addr | 2];
-							p3 = vram[addr | 3];
-						}
-						int pixel = bpp4_to_offset(p0, px, 0) | bpp4_to_offset(p1, px, 1) | bpp4_to_offset(p2, px, 2) | bpp4_to_offset(p3, px, 3);
-						pixel &= enableMask;
-						framebuffer[fboffset] = dac_palette[dac_mask & attr_palette[pixel]];
-					}
-					//vbe_scanlines_modified[current_scanline] = 0;
-					break;
-				}
+				case RENDER_4BPP:
 				case RENDER_4BPP | 1: {
-					// 4BPP rendering mode, but lower resolution
-					//if(!vbe_scanlines_modified[current_scanline]) break;
+					if (!is_line_stale()) {
+						break;
+					}
 					uint32_t addr = vram_addr1;
-					uint8_t p0 = vram[addr | 0];
-					uint8_t p1 = vram[addr | 1];
-					uint8_t p2 = vram[addr | 2];
-					uint8_t p3 = vram[addr | 3];
-					for (unsigned int x = 0, px = current_pixel_panning; x < total_width; x += 2, fboffset += 2, px++) {
-						if (px > 7) {
-							px = 0;
-							addr += 4;
-							p0 = vram[addr | 0];
-							p1 = vram[addr | 1];
-							p2 = vram[addr | 2];
-							p3 = vram[addr | 3];
-						}
-						int pixel = bpp4_to_offset(p0, px, 0) | bpp4_to_offset(p1, px, 1) | bpp4_to_offset(p2, px, 2) | bpp4_to_offset(p3, px, 3);
-						pixel &= enableMask;
-						uint32_t result = dac_palette[dac_mask & attr_palette[pixel]];
-						framebuffer[fboffset] = result;
-						framebuffer[fboffset + 1] = result;
+					if ((renderer == RENDER_4BPP) && (character_scanline & address_bit_mapping)) {
+						addr |= 0x8000;
 					}
-					//vbe_scanlines_modified[current_scanline] = 0;
+					vga_draw_4bpp(&framebuffer[fboffset], vram, addr, total_width, renderer & 1, current_pixel_panning, enableMask, m_luts);
 				}
 				break;
 
 				case RENDER_32BPP:
-					if (!vbe_scanlines_modified[current_scanline]) {
+					if (!(vbe_scanlines_modified[current_scanline] & back_bit)) {
 						break;
 					}
-					for (unsigned int i = 0; i < total_width; i++, vram_addr1 += 4) {
-						framebuffer[fboffset++] = *((uint32_t *)&vram[vram_addr1]) | 0xFF000000;
-					}
-					vbe_scanlines_modified[current_scanline] = 0;
+					vga_draw_32bpp(&framebuffer[fboffset], &vram[vram_addr1], total_width);
 					break;
 
 				case RENDER_8BPP:
-					if (!vbe_scanlines_modified[current_scanline]) {
+					if (!(vbe_scanlines_modified[current_scanline] & back_bit)) {
 						break;
 					}
-					for (unsigned int i = 0; i < total_width; i++, vram_addr1++) {
-						framebuffer[fboffset++] = dac_palette[vram[vram_addr1]];
-					}
-					vbe_scanlines_modified[current_scanline] = 0;
+					vga_draw_8bpp(&framebuffer[fboffset], &vram[vram_addr1], total_width, dac_palette);
 					break;
 
 				case RENDER_16BPP:
-					if (!vbe_scanlines_modified[current_scanline]) {
+					if (!(vbe_scanlines_modified[current_scanline] & back_bit)) {
 						break;
 					}
-					for (unsigned int i = 0; i < total_width; i++, vram_addr1 += 2) {
-						uint16_t word = *((uint16_t *)&vram[vram_addr1]);
-						int red = word >> 11 << 3, green = (word >> 5 & 63) << 2, /* Note: 6 bits for green */ blue = (word & 31) << 3;
-						framebuffer[fboffset++] = red << 16 | green << 8 | blue << 0 | 0xFF000000;
-					}
-
-					vbe_scanlines_modified[current_scanline] = 0;
+					vga_draw_16bpp(&framebuffer[fboffset], &vram[vram_addr1], total_width);
 					break;
 
 				case RENDER_24BPP:
-					if (!vbe_scanlines_modified[current_scanline]) {
+					if (!(vbe_scanlines_modified[current_scanline] & back_bit)) {
 						break;
 					}
-					for (uint32_t i = 0; i < total_width; i++, vram_addr1 += 3) {
-						uint8_t blue = vram[vram_addr1], green = vram[vram_addr1 + 1], red = vram[vram_addr1 + 2];
-						framebuffer[fboffset++] = (blue) | (green << 8) | (red << 16) | 0xFF000000;
-					}
-					vbe_scanlines_modified[current_scanline] = 0;
+					vga_draw_24bpp(&framebuffer[fboffset], &vram[vram_addr1], total_width);
 					break;
 				}
 				if ((crt[9] & 0x1F) == character_scanline) {
@@ -1375,10 +1388,13 @@ void vga::Impl::update()
 		if (current_scanline >= total_height) {
 			// Technically, we should draw output to the value specified by the CRT Vertical Total Register, but why bother?
 
-			// Update the display when all the scanlines have been drawn
+			// Update the display when all the scanlines have been drawn. They are all up to date in the back buffer now
+			for (uint8_t &line : vbe_scanlines_modified) {
+				line &= ~back_bit;
+			}
 			display_update();
 
-			complete_redraw(); // contrary to its name, it only resets drawing state
+			restart_frame();
 			//current = 0;
 
 			total_scanlines_drawn = 0;
@@ -1422,21 +1438,34 @@ void vga::Impl::reset()
 	memory_modified = 0;
 	vbe_scanlines_modified.resize(0);
 	complete_redraw();
+
+	std::unique_lock lock(m_frame_mtx);
+	m_frames[0].clear();
+	m_frames[1].clear();
+	m_back_idx = 0;
+	m_frame_pending = false;
+	m_front_width = m_front_height = 0;
+	++m_front_num;
 }
 
-void vga::Impl::init(cpu *cpu, nv2a *gpu)
+void vga::Impl::init(uint8_t *ram, uint32_t ram_size)
 {
-	m_pcrtc = gpu->getPcrtc();
-	vram_size = cpu->getRamsize();
-	vram = get_ram_ptr(cpu->get86cpu());
-	
+	vram = ram;
+	vram_size = ram_size;
+
 	reset();
 }
 
+void vga::Impl::setStart(uint32_t addr)
+{
+	// The new framebuffer is drawn at the next update
+	m_start = addr;
+}
+
 /** Public interface implementation **/
-void vga::init(cpu *cpu, nv2a *gpu)
+void vga::init(uint8_t *vram, uint32_t vram_size)
 {
-	m_impl->init(cpu, gpu);
+	m_impl->init(vram, vram_size);
 }
 
 void vga::reset()
@@ -1444,11 +1473,26 @@ void vga::reset()
 	m_impl->reset();
 }
 
+void vga::setStart(uint32_t addr)
+{
+	m_impl->setStart(addr);
+}
+
 void vga::update()
 {
 	m_impl->update();
 }
 
+bool vga::getFrame(std::vector<uint32_t> &pixels, uint32_t &width, uint32_t &height, uint64_t &frame_num)
+{
+	return m_impl->getFrame(pixels, width, height, frame_num);
+}
+
+void vga::getCrtcMode(uint32_t &width, uint32_t &height, uint32_t &pitch, uint32_t &bpp)
+{
+	m_impl->getCrtcMode(width, height, pitch, bpp);
+}
+
 uint8_t vga::ioRead8(uint32_t addr)
 {
 	return m_impl->ioRead8(addr);
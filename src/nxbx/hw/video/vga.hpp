@@ -5,18 +5,18 @@
 
 #include <cstdint>
 #include <memory>
+#include <vector>
 
 
-class cpu;
-class nv2a;
-
 class vga
 {
 public:
 	vga();
 	~vga();
-	void init(cpu *cpu, nv2a *gpu);
+	// vram is the memory scanned out by the crtc, which on the xbox is the guest ram
+	void init(uint8_t *vram, uint32_t vram_size);
 	void reset();
+	void setStart(uint32_t addr); // called by pcrtc when NV_PCRTC_START changes
 	uint8_t ioRead8(uint32_t addr);
 	void ioWrite8(uint32_t addr, const uint8_t value);
 	void ioWrite16(uint32_t addr, const uint16_t value);
@@ -25,8 +25,14 @@ public:
 	void memWrite8(uint32_t addr, const uint8_t value);
 	void memWrite16(uint32_t addr, const uint16_t value);
 	void update();
+	// Copies the last frame drawn by update() to pixels, in A8R8G8B8 format. Returns false when there isn't a new frame since the one identified by frame_num,
+	// which is then updated to the number of the returned frame. Meant to be called by the frontend, and it never makes the cpu thread wait
+	bool getFrame(std::vector<uint32_t> &pixels, uint32_t &width, uint32_t &height, uint64_t &frame_num);
+	// Returns the size of the screen and the pitch of the framebuffer in bytes, as set in the extended crtc registers of nv2a. bpp is the pixel depth (8, 16
+	// or 32), or zero when the crtc is in a standard vga mode, which is drawn by update() instead
+	void getCrtcMode(uint32_t &width, uint32_t &height, uint32_t &pitch, uint32_t &bpp);
 
 private:
 	class Impl;
 	std::unique_ptr<Impl> m_impl;
-};
\ No newline at end of file
+};
\ No newline at end of file
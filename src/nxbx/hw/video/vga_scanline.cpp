@@ -0,0 +1,415 @@
+// SPDX-License-Identifier: GPL-3.0-only
+// SPDX-FileCopyrightText: 2026 ergo720
+// SPDX-FileCopyrightText: 2020 Halfix devs
+// The reference renderers are derived from https://github.com/nepx/halfix/blob/master/src/hardware/vga.c
+
+#include "vga_scanline.hpp"
+#include "cpu_features.hpp"
+#include <array>
+#include <cstring>
+#if defined(HOST_CPU_X86)
+#define VGA_HAS_SSE2
+#endif
+
+#define VGA_ALPHA 0xFF000000
+
+
+// Scatters the bits of a byte of a 4bpp plane to the nibbles of the pixels they belong to: the msb goes to bit 0 of the first pixel (nibble 0), and so on.
+// The indices of eight pixels are then the or of the entries of the four planes, each one shifted by the number of its plane
+static constexpr auto s_plane_lut = []
+	{
+		std::array<uint32_t, 256> lut{};
+		for (uint32_t i = 0; i < 256; ++i) {
+			for (uint32_t px = 0; px < 8; ++px) {
+				if (i & (0x80 >> px)) {
+					lut[i] |= 1 << (px * 4);
+				}
+			}
+		}
+		return lut;
+	}();
+
+static uint8_t
+bpp4_to_offset(uint8_t i, uint8_t j, uint8_t k)
+{
+	return ((i & (0x80 >> j)) != 0) ? 1 << k : 0;
+}
+
+static uint32_t
+load32(const uint8_t *src)
+{
+	uint32_t value;
+	std::memcpy(&value, src, 4);
+	return value;
+}
+
+#ifdef VGA_HAS_SSE2
+// AVX2 versions of the packed modes, which convert twice the pixels of the sse2 loops per iteration. They return the number of pixels converted, and the
+// sse2 loops and the reference convert the rest of the line. The 8bpp mode has none, because it's bound by the palette lookups, and the AVX2 gathers are
+// not faster than scalar loads on many cpus
+template<bool is_565>
+TARGET_AVX2 static void
+expand_16bpp_avx2(uint32_t *dst, const uint8_t *src)
+{
+	// Same shifts of the sse2 loops of vga_draw_15bpp and vga_draw_16bpp, but the words are zero extended with a single instruction
+	__m256i pixels = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)src));
+	__m256i red = _mm256_slli_epi32(_mm256_and_si256(pixels, _mm256_set1_epi32(is_565 ? 0xF800 : 0x7C00)), is_565 ? 8 : 9);
+	__m256i green = _mm256_slli_epi32(_mm256_and_si256(pixels, _mm256_set1_epi32(is_565 ? 0x07E0 : 0x03E0)), is_565 ? 5 : 6);
+	__m256i blue = _mm256_slli_epi32(_mm256_and_si256(pixels, _mm256_set1_epi32(0x001F)), 3);
+	_mm256_storeu_si256((__m256i *)dst, _mm256_or_si256(_mm256_or_si256(red, green), _mm256_or_si256(blue, _mm256_set1_epi32((int)VGA_ALPHA))));
+}
+
+template<bool is_565>
+TARGET_AVX2 static uint32_t
+draw_16bpp_avx2(uint32_t *dst, const uint8_t *src, uint32_t width)
+{
+	uint32_t i = 0;
+	for (; (i + 16) <= width; i += 16) {
+		expand_16bpp_avx2<is_565>(&dst[i], &src[i * 2]);
+		expand_16bpp_avx2<is_565>(&dst[i + 8], &src[i * 2 + 16]);
+	}
+	return i;
+}
+
+TARGET_AVX2 static uint32_t
+draw_24bpp_avx2(uint32_t *dst, const uint8_t *src, uint32_t width)
+{
+	// Each lane loads 16 bytes, and pshufb moves the first 12 to four pixels. The load of the second lane reads four bytes past the pixels it converts, so
+	// like in the sse2 loop, the last pixels are left to the other loops
+	const __m256i shuffle = _mm256_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+	const __m256i alpha = _mm256_set1_epi32((int)VGA_ALPHA);
+	uint32_t i = 0;
+	for (; (i + 10) <= width; i += 8) {
+		__m256i bytes = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)&src[i * 3])),
+			_mm_loadu_si128((const __m128i *)&src[i * 3 + 12]), 1);
+		_mm256_storeu_si256((__m256i *)&dst[i], _mm256_or_si256(_mm256_shuffle_epi8(bytes, shuffle), alpha));
+	}
+	return i;
+}
+
+TARGET_AVX2 static uint32_t
+draw_32bpp_avx2(uint32_t *dst, const uint8_t *src, uint32_t width)
+{
+	const __m256i alpha = _mm256_set1_epi32((int)VGA_ALPHA);
+	uint32_t i = 0;
+	for (; (i + 8) <= width; i += 8) {
+		_mm256_storeu_si256((__m256i *)&dst[i], _mm256_or_si256(_mm256_loadu_si256((const __m256i *)&src[i * 4]), alpha));
+	}
+	return i;
+}
+
+static const bool s_use_avx2 = has_avx2();
+#endif
+
+void
+vga_build_luts(vga_palette_luts &luts, const uint32_t *dac_palette, uint8_t dac_mask, const uint8_t *attr_palette)
+{
+	for (uint32_t i = 0; i < 256; ++i) {
+		luts.chain4[i] = dac_palette[i & dac_mask];
+	}
+
+	uint32_t planar[16];
+	for (uint32_t i = 0; i < 16; ++i) {
+		planar[i] = dac_palette[dac_mask & attr_palette[i]];
+	}
+	for (uint32_t i = 0; i < 256; ++i) {
+		luts.planar_pairs[i] = ((uint64_t)planar[i >> 4] << 32) | planar[i & 15];
+	}
+}
+
+void
+vga_draw_13h_ref(uint32_t *dst, const uint8_t *vram, uint32_t addr, uint32_t width, bool is_double, const uint32_t *dac_palette, uint8_t dac_mask)
+{
+	// CHAIN4 Memory Layout:
+	//  Plane 0: AA 00 00 00 AA 00 00 00
+	//  Plane 1: BB 00 00 00 BB 00 00 00
+	//  Plane 2: CC 00 00 00 CC 00 00 00
+	//  Plane 3: DD 00 00 00 DD 00 00 00
+	// Draw four clumps of pixels together
+	// XXX: What if screen isn't a multiple of four pixels wide?
+	if (is_double) {
+		for (uint32_t i = 0; i < width; i += 8, addr += 4) {
+			for (int j = 0, k = 0; j < 4; j++, k += 2) {
+				dst[i + k] = dst[i + k + 1] = dac_palette[vram[addr | j] & dac_mask];
+			}
+		}
+	}
+	else {
+		for (uint32_t i = 0; i < width; i += 4, addr += 16) {
+			for (int j = 0; j < 4; j++) {
+				dst[i + j] = dac_palette[vram[addr | j] & dac_mask];
+			}
+		}
+	}
+}
+
+void
+vga_draw_13h(uint32_t *dst, const uint8_t *vram, uint32_t addr, uint32_t width, bool is_double, const vga_palette_luts &luts)
+{
+	// Sse2 has no gathers, so the four lookups of a group are scalar, and only the stores (and the doubling of the pixels) use simd
+	if (is_double) {
+		for (uint32_t i = 0; i < width; i += 8, addr += 4) {
+			uint32_t bytes = load32(&vram[addr]);
+#ifdef VGA_HAS_SSE2
+			__m128i pixels = _mm_setr_epi32(luts.chain4[bytes & 0xFF], luts.chain4[(bytes >> 8) & 0xFF], luts.chain4[(bytes >> 16) & 0xFF],
+				luts.chain4[bytes >> 24]);
+			_mm_storeu_si128((__m128i *)&dst[i], _mm_unpacklo_epi32(pixels, pixels));
+			_mm_storeu_si128((__m128i *)&dst[i + 4], _mm_unpackhi_epi32(pixels, pixels));
+#else
+			for (uint32_t j = 0; j < 4; ++j) {
+				dst[i + j * 2] = dst[i + j * 2 + 1] = luts.chain4[(bytes >> (j * 8)) & 0xFF];
+			}
+#endif
+		}
+	}
+	else {
+		for (uint32_t i = 0; i < width; i += 4, addr += 16) {
+			uint32_t bytes = load32(&vram[addr]);
+#ifdef VGA_HAS_SSE2
+			_mm_storeu_si128((__m128i *)&dst[i], _mm_setr_epi32(luts.chain4[bytes & 0xFF], luts.chain4[(bytes >> 8) & 0xFF],
+				luts.chain4[(bytes >> 16) & 0xFF], luts.chain4[bytes >> 24]));
+#else
+			for (uint32_t j = 0; j < 4; ++j) {
+				dst[i + j] = luts.chain4[(bytes >> (j * 8)) & 0xFF];
+			}
+#endif
+		}
+	}
+}
+
+void
+vga_draw_4bpp_ref(uint32_t *dst, const uint8_t *vram, uint32_t addr, uint32_t width, bool is_double, uint32_t pixel_panning, uint8_t enable_mask,
+	const uint32_t *dac_palette, uint8_t dac_mask, const uint8_t *attr_palette)
+{
+	uint8_t p0 = vram[addr | 0];
+	uint8_t p1 = vram[addr | 1];
+	uint8_t p2 = vram[addr | 2];
+	uint8_t p3 = vram[addr | 3];
+
+	for (uint32_t x = 0, px = pixel_panning; x < width; x += (is_double ? 2 : 1), px++) {
+		if (px > 7) {
+			px = 0;
+			addr += 4;
+			p0 = vram[addr | 0];
+			p1 = vram[addr | 1];
+			p2 = vram[addr | 2];
+			p3 = vram[addr | 3];
+		}
+		int pixel = bpp4_to_offset(p0, px, 0) | bpp4_to_offset(p1, px, 1) | bpp4_to_offset(p2, px, 2) | bpp4_to_offset(p3, px, 3);
+		pixel &= enable_mask;
+		uint32_t result = dac_palette[dac_mask & attr_palette[pixel]];
+		dst[x] = result;
+		if (is_double) {
+			dst[x + 1] = result;
+		}
+	}
+}
+
+void
+vga_draw_4bpp(uint32_t *dst, const uint8_t *vram, uint32_t addr, uint32_t width, bool is_double, uint32_t pixel_panning, uint8_t enable_mask,
+	const vga_palette_luts &luts)
+{
+	// The planes of eight pixels are merged into their attribute indices with four table lookups, and then the pixels are converted two at a time with
+	// planar_pairs. Only the groups cut by the panning or by the end of the line are converted one pixel at a time
+	const uint32_t step = is_double ? 2 : 1;
+	const uint32_t nibble_mask = (enable_mask & 15) * 0x11111111u;
+	uint32_t px = pixel_panning;
+	if (px > 7) {
+		px = 0;
+		addr += 4;
+	}
+
+	for (uint32_t x = 0; x < width; px = 0, addr += 4) {
+		uint32_t planes = load32(&vram[addr]);
+		uint32_t indices = (s_plane_lut[planes & 0xFF] | (s_plane_lut[(planes >> 8) & 0xFF] << 1) | (s_plane_lut[(planes >> 16) & 0xFF] << 2) |
+			(s_plane_lut[planes >> 24] << 3)) & nibble_mask;
+
+		if ((px == 0) && ((x + 8 * step) <= width)) {
+#ifdef VGA_HAS_SSE2
+			__m128i pixels01 = _mm_set_epi64x(luts.planar_pairs[(indices >> 8) & 0xFF], luts.planar_pairs[indices & 0xFF]);
+			__m128i pixels23 = _mm_set_epi64x(luts.planar_pairs[indices >> 24], luts.planar_pairs[(indices >> 16) & 0xFF]);
+			if (is_double) {
+				_mm_storeu_si128((__m128i *)&dst[x], _mm_unpacklo_epi32(pixels01, pixels01));
+				_mm_storeu_si128((__m128i *)&dst[x + 4], _mm_unpackhi_epi32(pixels01, pixels01));
+				_mm_storeu_si128((__m128i *)&dst[x + 8], _mm_unpacklo_epi32(pixels23, pixels23));
+				_mm_storeu_si128((__m128i *)&dst[x + 12], _mm_unpackhi_epi32(pixels23, pixels23));
+			}
+			else {
+				_mm_storeu_si128((__m128i *)&dst[x], pixels01);
+				_mm_storeu_si128((__m128i *)&dst[x + 4], pixels23);
+			}
+#else
+			for (uint32_t i = 0; i < 8; ++i) {
+				uint32_t result = (uint32_t)luts.planar_pairs[(indices >> (i * 4)) & 15];
+				dst[x + i * step] = result;
+				dst[x + i * step + step - 1] = result;
+			}
+#endif
+			x += 8 * step;
+		}
+		else {
+			for (; (px < 8) && (x < width); ++px, x += step) {
+				uint32_t result = (uint32_t)luts.planar_pairs[(indices >> (px * 4)) & 15];
+				dst[x] = result;
+				if (is_double) {
+					dst[x + 1] = result;
+				}
+			}
+		}
+	}
+}
+
+void
+vga_draw_8bpp_ref(uint32_t *dst, const uint8_t *src, uint32_t width, const uint32_t *dac_palette)
+{
+	for (uint32_t i = 0; i < width; i++) {
+		dst[i] = dac_palette[src[i]];
+	}
+}
+
+void
+vga_draw_8bpp(uint32_t *dst, const uint8_t *src, uint32_t width, const uint32_t *dac_palette)
+{
+	uint32_t i = 0;
+#ifdef VGA_HAS_SSE2
+	for (; (i + 4) <= width; i += 4) {
+		uint32_t bytes = load32(&src[i]);
+		_mm_storeu_si128((__m128i *)&dst[i], _mm_setr_epi32(dac_palette[bytes & 0xFF], dac_palette[(bytes >> 8) & 0xFF], dac_palette[(bytes >> 16) & 0xFF],
+			dac_palette[bytes >> 24]));
+	}
+#endif
+	vga_draw_8bpp_ref(&dst[i], &src[i], width - i, dac_palette);
+}
+
+void
+vga_draw_15bpp_ref(uint32_t *dst, const uint8_t *src, uint32_t width)
+{
+	for (uint32_t i = 0; i < width; i++) {
+		uint16_t word;
+		std::memcpy(&word, &src[i * 2], 2);
+		int red = (word >> 10 & 31) << 3, green = (word >> 5 & 31) << 3, blue = (word & 31) << 3;
+		dst[i] = red << 16 | green << 8 | blue << 0 | VGA_ALPHA;
+	}
+}
+
+void
+vga_draw_15bpp(uint32_t *dst, const uint8_t *src, uint32_t width)
+{
+	uint32_t i = 0;
+#ifdef VGA_HAS_SSE2
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i red_mask = _mm_set1_epi32(0x7C00), green_mask = _mm_set1_epi32(0x03E0), blue_mask = _mm_set1_epi32(0x001F);
+	const __m128i alpha = _mm_set1_epi32((int)VGA_ALPHA);
+	auto expand = [&](__m128i words)
+		{
+			__m128i red = _mm_slli_epi32(_mm_and_si128(words, red_mask), 9);
+			__m128i green = _mm_slli_epi32(_mm_and_si128(words, green_mask), 6);
+			__m128i blue = _mm_slli_epi32(_mm_and_si128(words, blue_mask), 3);
+			return _mm_or_si128(_mm_or_si128(red, green), _mm_or_si128(blue, alpha));
+		};
+	if (s_use_avx2) {
+		i = draw_16bpp_avx2<false>(dst, src, width);
+	}
+	for (; (i + 8) <= width; i += 8) {
+		__m128i words = _mm_loadu_si128((const __m128i *)&src[i * 2]);
+		_mm_storeu_si128((__m128i *)&dst[i], expand(_mm_unpacklo_epi16(words, zero)));
+		_mm_storeu_si128((__m128i *)&dst[i + 4], expand(_mm_unpackhi_epi16(words, zero)));
+	}
+#endif
+	vga_draw_15bpp_ref(&dst[i], &src[i * 2], width - i);
+}
+
+void
+vga_draw_16bpp_ref(uint32_t *dst, const uint8_t *src, uint32_t width)
+{
+	for (uint32_t i = 0; i < width; i++) {
+		uint16_t word;
+		std::memcpy(&word, &src[i * 2], 2);
+		int red = word >> 11 << 3, green = (word >> 5 & 63) << 2, /* Note: 6 bits for green */ blue = (word & 31) << 3;
+		dst[i] = red << 16 | green << 8 | blue << 0 | VGA_ALPHA;
+	}
+}
+
+void
+vga_draw_16bpp(uint32_t *dst, const uint8_t *src, uint32_t width)
+{
+	uint32_t i = 0;
+#ifdef VGA_HAS_SSE2
+	// R5G6B5 -> A8R8G8B8 without replicating the high bits to the low ones, like the reference: each channel is just shifted to the top of its byte
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i red_mask = _mm_set1_epi32(0xF800), green_mask = _mm_set1_epi32(0x07E0), blue_mask = _mm_set1_epi32(0x001F);
+	const __m128i alpha = _mm_set1_epi32((int)VGA_ALPHA);
+	auto expand = [&](__m128i words)
+		{
+			__m128i red = _mm_slli_epi32(_mm_and_si128(words, red_mask), 8);
+			__m128i green = _mm_slli_epi32(_mm_and_si128(words, green_mask), 5);
+			__m128i blue = _mm_slli_epi32(_mm_and_si128(words, blue_mask), 3);
+			return _mm_or_si128(_mm_or_si128(red, green), _mm_or_si128(blue, alpha));
+		};
+	if (s_use_avx2) {
+		i = draw_16bpp_avx2<true>(dst, src, width);
+	}
+	for (; (i + 8) <= width; i += 8) {
+		__m128i words = _mm_loadu_si128((const __m128i *)&src[i * 2]);
+		_mm_storeu_si128((__m128i *)&dst[i], expand(_mm_unpacklo_epi16(words, zero)));
+		_mm_storeu_si128((__m128i *)&dst[i + 4], expand(_mm_unpackhi_epi16(words, zero)));
+	}
+#endif
+	vga_draw_16bpp_ref(&dst[i], &src[i * 2], width - i);
+}
+
+void
+vga_draw_24bpp_ref(uint32_t *dst, const uint8_t *src, uint32_t width)
+{
+	for (uint32_t i = 0; i < width; i++, src += 3) {
+		uint8_t blue = src[0], green = src[1], red = src[2];
+		dst[i] = (blue) | (green << 8) | (red << 16) | VGA_ALPHA;
+	}
+}
+
+void
+vga_draw_24bpp(uint32_t *dst, const uint8_t *src, uint32_t width)
+{
+	uint32_t i = 0;
+#ifdef VGA_HAS_SSE2
+	// Four pixels are extracted from the 12 bytes at the start of a 16 bytes load with byte shifts, because sse2 has no byte shuffles. The load must stay
+	// inside the line, so the last pixels are done by the reference
+	const __m128i rgb_mask = _mm_set1_epi32(0x00FFFFFF);
+	const __m128i alpha = _mm_set1_epi32((int)VGA_ALPHA);
+	if (s_use_avx2) {
+		i = draw_24bpp_avx2(dst, src, width);
+	}
+	for (; (i + 6) <= width; i += 4) {
+		__m128i bytes = _mm_loadu_si128((const __m128i *)&src[i * 3]);
+		__m128i pixels01 = _mm_unpacklo_epi32(bytes, _mm_srli_si128(bytes, 3));
+		__m128i pixels23 = _mm_unpacklo_epi32(_mm_srli_si128(bytes, 6), _mm_srli_si128(bytes, 9));
+		__m128i pixels = _mm_unpacklo_epi64(pixels01, pixels23);
+		_mm_storeu_si128((__m128i *)&dst[i], _mm_or_si128(_mm_and_si128(pixels, rgb_mask), alpha));
+	}
+#endif
+	vga_draw_24bpp_ref(&dst[i], &src[i * 3], width - i);
+}
+
+void
+vga_draw_32bpp_ref(uint32_t *dst, const uint8_t *src, uint32_t width)
+{
+	for (uint32_t i = 0; i < width; i++) {
+		dst[i] = load32(&src[i * 4]) | VGA_ALPHA;
+	}
+}
+
+void
+vga_draw_32bpp(uint32_t *dst, const uint8_t *src, uint32_t width)
+{
+	uint32_t i = 0;
+#ifdef VGA_HAS_SSE2
+	const __m128i alpha = _mm_set1_epi32((int)VGA_ALPHA);
+	if (s_use_avx2) {
+		i = draw_32bpp_avx2(dst, src, width);
+	}
+	for (; (i + 4) <= width; i += 4) {
+		_mm_storeu_si128((__m128i *)&dst[i], _mm_or_si128(_mm_loadu_si128((const __m128i *)&src[i * 4]), alpha));
+	}
+#endif
+	vga_draw_32bpp_ref(&dst[i], &src[i * 4], width - i);
+}
@@ -0,0 +1,43 @@
+// SPDX-License-Identifier: GPL-3.0-only
+// SPDX-FileCopyrightText: 2026 ergo720
+// SPDX-FileCopyrightText: 2020 Halfix devs
+
+#pragma once
+
+#include <cstdint>
+
+
+// Renderers for one scanline of the vga graphics modes, which convert width pixels read from vram to A8R8G8B8 in dst. The vram addresses are multiples
+// of four, as they are for the lines of the vga renderer. Every mode has a reference version (suffix _ref), which converts one pixel at a time like
+// halfix does, and a fast version, which produces the same pixels
+
+// Palette tables used by the fast renderers. They depend on the dac and attribute palettes, so they must be rebuilt when those change
+struct vga_palette_luts
+{
+	uint32_t chain4[256]; // dac palette indexed by a byte of vram, with the dac mask applied
+	uint64_t planar_pairs[256]; // two adjacent 4bpp pixels, indexed by their attribute indices (the first pixel is in the low nibble)
+};
+
+void vga_build_luts(vga_palette_luts &luts, const uint32_t *dac_palette, uint8_t dac_mask, const uint8_t *attr_palette);
+
+// Mode 13h: four pixels are read from each group of 16 bytes. When is_double is true, each pixel is drawn twice, and the groups are four bytes apart instead
+void vga_draw_13h_ref(uint32_t *dst, const uint8_t *vram, uint32_t addr, uint32_t width, bool is_double, const uint32_t *dac_palette, uint8_t dac_mask);
+void vga_draw_13h(uint32_t *dst, const uint8_t *vram, uint32_t addr, uint32_t width, bool is_double, const vga_palette_luts &luts);
+// 4bpp planar: each group of four bytes holds one bit plane of eight pixels, and the first pixel_panning pixels are skipped. When is_double is true, each
+// pixel is drawn twice
+void vga_draw_4bpp_ref(uint32_t *dst, const uint8_t *vram, uint32_t addr, uint32_t width, bool is_double, uint32_t pixel_panning, uint8_t enable_mask,
+	const uint32_t *dac_palette, uint8_t dac_mask, const uint8_t *attr_palette);
+void vga_draw_4bpp(uint32_t *dst, const uint8_t *vram, uint32_t addr, uint32_t width, bool is_double, uint32_t pixel_panning, uint8_t enable_mask,
+	const vga_palette_luts &luts);
+// Vbe modes: the pixels are packed, and the 8bpp mode indexes the dac palette without the dac mask. The 15bpp mode (X1R5G5B5) isn't a vbe mode, but it's
+// used by the nv2a framebuffers
+void vga_draw_8bpp_ref(uint32_t *dst, const uint8_t *src, uint32_t width, const uint32_t *dac_palette);
+void vga_draw_8bpp(uint32_t *dst, const uint8_t *src, uint32_t width, const uint32_t *dac_palette);
+void vga_draw_15bpp_ref(uint32_t *dst, const uint8_t *src, uint32_t width);
+void vga_draw_15bpp(uint32_t *dst, const uint8_t *src, uint32_t width);
+void vga_draw_16bpp_ref(uint32_t *dst, const uint8_t *src, uint32_t width);
+void vga_draw_16bpp(uint32_t *dst, const uint8_t *src, uint32_t width);
+void vga_draw_24bpp_ref(uint32_t *dst, const uint8_t *src, uint32_t width);
+void vga_draw_24bpp(uint32_t *dst, const uint8_t *src, uint32_t width);
+void vga_draw_32bpp_ref(uint32_t *dst, const uint8_t *src, uint32_t width);
+void vga_draw_32bpp(uint32_t *dst, const uint8_t *src, uint32_t width);
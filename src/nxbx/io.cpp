@@ -6,11 +6,13 @@
 #include "io.hpp"
 #include "logger.hpp"
 #include "cpu.hpp"
+#include "machine.hpp"
 #include "kernel.hpp"
 #include "xdvdfs.hpp"
 #include "fatx.hpp"
 #include "console.hpp"
 #include "paths.hpp"
+#include "io_backend.hpp"
 #include <thread>
 #include <deque>
 #include <map>
@@ -35,6 +37,24 @@
 #define IO_GET_DISPOSITION(type) ((uint32_t)(type) & 0x00000007)
 #define IO_GET_DEV(type) (((uint32_t)(type) >> 23) & 0x0000001F)
 
+// Guest page tables, as self-mapped by nboxkrnl (and by cpu::init during boot)
+#define IO_PTE_BASE 0xC0000000
+#define IO_PDE_BASE 0xC0300000
+#define IO_PAGE_PRESENT (1 << 0)
+#define IO_PAGE_LARGE (1 << 7)
+#define IO_PAGE_SIZE 0x1000
+#define IO_LARGE_PAGE_SIZE 0x400000
+
+// Shared memory rings
+#define IO_RING_NUM_OF_ENTRIES 32 // must be a power of two
+#define IO_RING_MASK (IO_RING_NUM_OF_ENTRIES - 1)
+#define IO_RING_FLAG_CQ_OVERFLOW (1 << 0) // ring_header_t::flags, the host has completions that didn't fit in the cq
+#define IO_RING_FLAG_SQ_INVALID (1 << 1) // ring_header_t::flags, sq_tail was more than IO_RING_NUM_OF_ENTRIES ahead of sq_head and the sq was ignored
+#define IO_RING_CQ_NEEDS_QUERY (1 << 0) // cq_entry_t::flags, the guest must still use IO_QUERY to get the result of the request
+
+// Completion interrupt, same line used by the ide controller on real hw
+#define IO_IRQ_NUM 14
+
 namespace io {
 	// These definitions are the same used by nboxkrnl to submit I/O request, and should be kept synchronized with those
 	enum request_type_t : uint32_t {
@@ -126,10 +146,42 @@ namespace io {
 	static_assert(sizeof(packed_request_t) == 44);
 	static_assert(sizeof(info_block_oc_t) == 36);
 
+#pragma pack(1)
+	// Optional shared memory rings, placed by the kernel in a page of contiguous memory and registered with the IO_RING_SETUP port. Indices are free running
+	// and only ever incremented, and each one is written by a single side: sq_tail and cq_head by the guest, sq_head and cq_tail by the host.
+	// The kernel writes a packed_request_t at sq_tail and then increments it, and it only needs to write to IO_RING_DOORBELL when the sq was empty before its
+	// post. The doorbell is handled synchronously on the cpu thread and always drains the whole sq, so the guest can't race with the host while it's doing it.
+	// Completions are written by the host at cq_tail from the I/O threads, so the guest must read cq_tail before reading the entries
+	struct ring_header_t {
+		uint32_t sq_head;
+		uint32_t sq_tail;
+		uint32_t cq_head;
+		uint32_t cq_tail;
+		uint32_t flags;
+		uint32_t reserved[11];
+	};
+
+	struct cq_entry_t {
+		info_block_oc_t info; // result of the request, for non-open requests only the header is valid
+		uint32_t flags;
+	};
+
+	struct ring_page_t {
+		ring_header_t header;
+		packed_request_t sq[IO_RING_NUM_OF_ENTRIES];
+		cq_entry_t cq[IO_RING_NUM_OF_ENTRIES];
+	};
+#pragma pack()
+
+	static_assert(sizeof(ring_header_t) == 64);
+	static_assert(sizeof(ring_page_t) <= IO_PAGE_SIZE);
+
 	// Type layout of io_request
 	// io_request_type - dev_type - io_flags - disposition
 	// 31 - 28           27 - 23    22 - 3     2 - 0
 
+	struct file_info_base_t;
+
 	// Host version of io_request
 	struct request_t {
 		~request_t();
@@ -148,6 +200,8 @@ namespace io {
 		uint32_t handle; // file handle
 		uint32_t timestamp; // file timestamp
 		info_block_oc_t info; // holds the result of the transfer
+		bool from_ring; // submitted through the shared memory rings
+		bool drain_pending; // completed but not yet drained by the guest, guarded by s_completed_io_mtx
 	};
 
 	struct request_oc_t : public request_t {
@@ -156,20 +210,33 @@ namespace io {
 		uint32_t create_options; // how the create the file
 	};
 
+	// Part of a read that must be written to the guest through lib86cpu when the request completes. Either it couldn't be done directly in guest ram, and
+	// it's copied from request_rw_t::buffer, or it was, and it's written onto itself, so that lib86cpu invalidates the code translated from its pages
+	struct guest_span_t {
+		uint32_t address; // guest virtual address
+		uint32_t size;
+		const char *host; // data of the span, in request_rw_t::buffer or in guest ram
+	};
+
 	struct request_rw_t : public request_t {
-		std::unique_ptr<char[]> buffer; // holds the data to be transferred
+		std::unique_ptr<char[]> buffer; // holds the data to be transferred, or only the bounced parts of a read
+		std::vector<backend::segment_t> segments; // host memory used by the transfer, in guest buffer order
+		std::vector<guest_span_t> guest_spans; // parts of a read that must be written to the guest at completion
+		file_info_base_t *file_info; // file targeted by a transfer in flight on the io backend
+		native_file_cache::file_ptr file; // keeps the host file open while the transfer is in flight, even if it's evicted from the cache
 	};
 
 	// Basic info about an opened file
 	struct file_info_base_t {
-		file_info_base_t(std::fstream &&f, std::string p) : fs(std::move(f)), path(p) {};
-		std::fstream fs; // fs of a file
+		file_info_base_t(std::filesystem::path h, std::string p) : host_path(h), path(p), pending_io(0) {};
+		std::filesystem::path host_path; // host file, opened through g_native_file_cache when needed. Empty for directories and device handles
 		std::string path; // same relative path returned by io::parse_path()
+		std::atomic_uint32_t pending_io; // number of transfers in flight on the io backend for this file
 	};
 
 	// file_info_base_t that holds additional info about a fatx file
 	struct file_info_fatx_t : public file_info_base_t {
-		file_info_fatx_t(std::fstream &&f, std::string p, uint64_t o, fatx::DIRENT d) : file_info_base_t(std::move(f), p), dirent_offset(o), dirent(d) {};
+		file_info_fatx_t(std::filesystem::path h, std::string p, uint64_t o, fatx::DIRENT d) : file_info_base_t(h, p), dirent_offset(o), dirent(d) {};
 		uint64_t dirent_offset; // dirent offset in metadata.bin
 		fatx::DIRENT dirent; // a cached copy of the dirent
 		void last_access_time(uint32_t time) { dirent.last_access_time = time; };
@@ -179,7 +246,7 @@ namespace io {
 
 	// file_info_base_t that holds additional info about a xdvdfs file
 	struct file_info_xdvdfs_t : public file_info_base_t  {
-		file_info_xdvdfs_t(std::fstream &&f, std::string p, uint64_t o) : file_info_base_t(std::move(f), p), offset(o) {};
+		file_info_xdvdfs_t(std::filesystem::path h, std::string p, uint64_t o) : file_info_base_t(h, p), offset(o) {};
 		uint64_t offset; // offset of the file inside the xiso image
 	};
 
@@ -193,6 +260,9 @@ namespace io {
 	}
 
 	static cpu_t *s_lc86cpu;
+	static machine *s_machine;
+	static uint8_t *s_ram;
+	static uint32_t s_ramsize;
 	static std::jthread s_jthr;
 	static std::deque<std::unique_ptr<request_t>> s_curr_io_queue;
 	static std::vector<std::unique_ptr<request_t>> s_pending_io_vec;
@@ -201,6 +271,12 @@ namespace io {
 	static std::mutex s_queue_mtx;
 	static std::mutex s_completed_io_mtx;
 	static std::atomic_flag s_pending_io;
+	static ring_page_t *s_ring; // nullptr when the kernel doesn't use the rings
+	static std::deque<cq_entry_t> s_cq_overflow;
+	static std::mutex s_ring_mtx;
+	static uint32_t s_num_drain_pending; // number of requests in s_completed_io_info with drain_pending set, guarded by s_completed_io_mtx
+	static bool s_irq_enabled; // guarded by s_completed_io_mtx
+	static bool s_irq_raised; // guarded by s_completed_io_mtx
 
 
 	static void
@@ -221,18 +297,20 @@ namespace io {
 	static void
 	add_device_handles()
 	{
-		const auto &lambda = [](std::filesystem::path resolved_path, uint32_t handle) {
-			auto pair = s_xbox_handle_map[handle].emplace(handle, std::move(std::make_unique<file_info_base_t>(std::move(std::fstream()), resolved_path.string())));
+		const auto &lambda = [](std::filesystem::path resolved_path, uint32_t handle, std::filesystem::path host_path) {
+			auto pair = s_xbox_handle_map[handle].emplace(handle, std::move(std::make_unique<file_info_base_t>(host_path, resolved_path.string())));
 			assert(pair.second == true);
 			};
 
 		if (g_dvd_input_type == input_t::xiso) {
-			lambda(combine_file_paths(emu_path::g_dvd_dir, xdvdfs::driver::get().m_xiso_name), CDROM_HANDLE);
+			// Reads of xiso files are done on the xiso image itself, so the backend needs its host file when the image couldn't be mapped
+			std::filesystem::path xiso_path = combine_file_paths(emu_path::g_dvd_dir, xdvdfs::driver::get().m_xiso_name);
+			lambda(xiso_path, CDROM_HANDLE, xdvdfs::driver::get().is_mapped() ? std::filesystem::path() : xiso_path);
 		}
 
 		for (unsigned i = 0; i < XBOX_NUM_OF_HDD_PARTITIONS; ++i) {
 			std::filesystem::path curr_partition_dir = combine_file_paths(emu_path::g_hdd_dir, ("Partition" + std::to_string(i) + ".bin"));
-			lambda(curr_partition_dir, PARTITION0_HANDLE + i);
+			lambda(curr_partition_dir, PARTITION0_HANDLE + i, std::filesystem::path());
 		}
 	}
 
@@ -272,6 +350,168 @@ namespace io {
 		return resolved_str;
 	}
 
+	static bool
+	push_completion(const cq_entry_t &entry)
+	{
+		// Must be called with s_ring_mtx held
+		uint32_t tail = std::atomic_ref(s_ring->header.cq_tail).load(std::memory_order_relaxed);
+		if ((tail - std::atomic_ref(s_ring->header.cq_head).load(std::memory_order_acquire)) == IO_RING_NUM_OF_ENTRIES) {
+			return false;
+		}
+		s_ring->cq[tail & IO_RING_MASK] = entry;
+		std::atomic_ref(s_ring->header.cq_tail).store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	static void
+	post_completion(const cq_entry_t &entry)
+	{
+		// If the guest is slow to consume the cq, keep the completions here until the next doorbell. Completions must be posted in order, so once a completion
+		// overflows, all the following ones are queued too
+		std::unique_lock lock(s_ring_mtx);
+		if (s_ring == nullptr) [[unlikely]] {
+			return;
+		}
+		if (!s_cq_overflow.empty() || !push_completion(entry)) {
+			s_cq_overflow.push_back(entry);
+			std::atomic_ref(s_ring->header.flags).fetch_or(IO_RING_FLAG_CQ_OVERFLOW, std::memory_order_release);
+		}
+	}
+
+	static void
+	complete_io_request(std::unique_ptr<request_t> host_io_request)
+	{
+		uint32_t id = host_io_request->id;
+		bool from_ring = host_io_request->from_ring;
+		bool needs_query = true;
+		cq_entry_t entry;
+
+		if (from_ring) {
+			std::fill_n((char *)&entry, sizeof(entry), 0);
+			if (IO_GET_TYPE(host_io_request->type) == open) {
+				entry.info = host_io_request->info;
+			} else {
+				entry.info.header = host_io_request->info.header;
+			}
+			entry.info.header.id = id;
+			entry.info.header.ready = 1;
+
+			// Reads need the cpu thread to write their data through lib86cpu, so the guest must still query them
+			needs_query = (IO_GET_TYPE(host_io_request->type) == read) && (host_io_request->info.header.status == STATUS_SUCCESS) &&
+				!static_cast<request_rw_t *>(host_io_request.get())->guest_spans.empty();
+			if (needs_query) {
+				entry.info.header.ready = 0;
+				entry.flags = IO_RING_CQ_NEEDS_QUERY;
+			}
+		}
+
+		if (needs_query) {
+			// The pending flag lives in the request itself, so the completions not yet drained can never outnumber the ones not yet queried
+			s_completed_io_mtx.lock();
+			host_io_request->drain_pending = s_irq_enabled;
+			if (s_completed_io_info.try_emplace(id, std::move(host_io_request)).second && s_irq_enabled) {
+				++s_num_drain_pending;
+			}
+			s_completed_io_mtx.unlock();
+		}
+
+		if (from_ring) {
+			post_completion(entry);
+		}
+
+		// Raise the irq only after the result is visible to the guest, otherwise its isr could run before that and miss the completion
+		s_completed_io_mtx.lock();
+		if (s_irq_enabled && !s_irq_raised) {
+			s_irq_raised = true;
+			s_machine->raise_irq(IO_IRQ_NUM);
+		}
+		s_completed_io_mtx.unlock();
+	}
+
+	static void
+	wait_for_pending_io(file_info_base_t *file_info)
+	{
+		// Closing or deleting a file must wait until all its transfers still in flight on the backend are done
+		for (uint32_t pending = file_info->pending_io.load(); pending; pending = file_info->pending_io.load()) {
+			file_info->pending_io.wait(pending);
+		}
+	}
+
+	static void
+	complete_rw_request(void *opaque, int64_t result)
+	{
+		// NOTE: this runs on a backend thread, so it must not touch the handle maps or the fatx metadata
+		std::unique_ptr<request_t> host_io_request(static_cast<request_rw_t *>(opaque));
+		request_rw_t *curr_rw_request = static_cast<request_rw_t *>(host_io_request.get());
+		file_info_base_t *file_info = curr_rw_request->file_info;
+		const char *op_str = IO_GET_TYPE(curr_rw_request->type) == read ? "Read" : "Write";
+		info_block_t io_result;
+		std::fill_n((char *)&io_result, sizeof(io_result), 0);
+
+		if (result >= 0) {
+			io_result.status = STATUS_SUCCESS;
+			io_result.info = static_cast<info_t>(result);
+			logger_en(info, "%s operation to file handle 0x%08" PRIX32 ", offset=0x%016" PRIX64 ", size=0x%08" PRIX32 ", actual bytes transferred=0x%08" PRIX32 " -> %s",
+				op_str, curr_rw_request->handle, curr_rw_request->offset, curr_rw_request->size, io_result.info, (result == curr_rw_request->size) ? "OK!" : "EOF!");
+		} else {
+			io_result.status = STATUS_IO_DEVICE_ERROR;
+			io_result.info = no_data;
+			logger_en(info, "%s operation to file handle 0x%08" PRIX32 " with path %s, offset=0x%016" PRIX64 ", size=0x%08" PRIX32 " -> FAILED!",
+				op_str, curr_rw_request->handle, file_info->path.c_str(), curr_rw_request->offset, curr_rw_request->size);
+		}
+
+		host_io_request->info.header = io_result;
+		curr_rw_request->file.reset(); // the request might wait a while for the guest to collect it, so don't keep the file open until then
+		complete_io_request(std::move(host_io_request));
+
+		if (file_info->pending_io.fetch_sub(1) == 1) {
+			file_info->pending_io.notify_all();
+		}
+	}
+
+	static void
+	submit_to_backend(std::unique_ptr<request_t> host_io_request, file_info_base_t *file_info, native_file_cache::file_ptr file, uint64_t offset)
+	{
+		// Ownership of the request passes to the backend until complete_rw_request is called
+		request_rw_t *curr_rw_request = static_cast<request_rw_t *>(host_io_request.release());
+		curr_rw_request->file_info = file_info;
+		curr_rw_request->file = std::move(file);
+		file_info->pending_io.fetch_add(1);
+		backend::submit({
+			.file = curr_rw_request->file.get(),
+			.offset = curr_rw_request->offset + offset,
+			.segments = curr_rw_request->segments,
+			.is_write = IO_GET_TYPE(curr_rw_request->type) == write,
+			.completion = &complete_rw_request,
+			.opaque = curr_rw_request
+			});
+	}
+
+	static int64_t
+	read_mapped_xiso(char *buffer, uint32_t size, uint64_t offset)
+	{
+		return xdvdfs::driver::get().read_image(offset, size, buffer);
+	}
+
+	static void
+	read_from_mapped_xiso(std::unique_ptr<request_t> host_io_request, file_info_base_t *file_info, uint64_t offset)
+	{
+		// The xiso image is mapped in memory, so a read is only a memcpy, but it page faults to the disk when the mapping is cold. It's handed to the backend
+		// like the other reads, so that the requests of the other files don't queue behind it
+		request_rw_t *curr_rw_request = static_cast<request_rw_t *>(host_io_request.release());
+		curr_rw_request->file_info = file_info;
+		file_info->pending_io.fetch_add(1);
+		backend::submit({
+			.file = nullptr,
+			.offset = curr_rw_request->offset + offset,
+			.segments = curr_rw_request->segments,
+			.is_write = false,
+			.completion = &complete_rw_request,
+			.opaque = curr_rw_request,
+			.read_fn = &read_mapped_xiso
+			});
+	}
+
 	static void
 	worker(std::stop_token stok)
 	{
@@ -282,15 +522,18 @@ namespace io {
 
 			// Check to see if we need to terminate this thread
 			if (stok.stop_requested()) [[unlikely]] {
+				backend::deinit();
 				flush_all_files();
 				fatx::driver::flush();
 				g_pending_packets = false;
 				s_curr_io_queue.clear();
 				s_completed_io_info.clear();
+				s_num_drain_pending = 0;
 				for (auto &handle_map : s_xbox_handle_map) {
 					handle_map.clear();
 				}
 				s_pending_io_vec.clear();
+				g_native_file_cache.clear();
 				return;
 			}
 
@@ -298,6 +541,8 @@ namespace io {
 			if (s_curr_io_queue.empty()) {
 				s_pending_io.clear();
 				s_queue_mtx.unlock();
+				// We are out of work, so write back the FAT changes done by the requests processed until now
+				fatx::driver::write_back();
 				continue;
 			}
 			std::unique_ptr<request_t> host_io_request = std::move(s_curr_io_queue.front());
@@ -319,7 +564,7 @@ namespace io {
 
 				if (dev == DEV_CDROM) {
 					xdvdfs::file_info_t file_info;
-					std::optional<std::fstream> opt = std::fstream();
+					std::filesystem::path host_path;
 					if (g_dvd_input_type == input_t::xiso) {
 						file_info = xdvdfs::driver::get().search_file(relative_path); // search for the file in the xiso
 					} else {
@@ -329,13 +574,12 @@ namespace io {
 						if (file_info.exists) {
 							file_info.offset = file_info.size = file_info.timestamp = 0;
 							if (!file_info.is_directory) {
-								if (opt = open_file(resolved_path, &file_info.size); opt) {
-									std::error_code ec;
-									file_info.size = std::filesystem::file_size(resolved_path, ec);
-									if (ec) {
-										file_info.exists = false; // make the request fail
-									}
+								std::error_code ec;
+								file_info.size = std::filesystem::file_size(resolved_path, ec);
+								if (ec || !g_native_file_cache.acquire(resolved_path)) {
+									file_info.exists = false; // make the request fail
 								}
+								host_path = resolved_path;
 							}
 						}
 					}
@@ -355,17 +599,17 @@ namespace io {
 							io_result.header.info = opened;
 							io_result.file_size = file_info.size;
 							io_result.xdvdfs_timestamp = file_info.timestamp;
-							s_xbox_handle_map[dev].emplace(curr_oc_request->handle, std::move(std::make_unique<file_info_xdvdfs_t>(std::move(*opt), relative_path, file_info.offset)));
+							s_xbox_handle_map[dev].emplace(curr_oc_request->handle, std::move(std::make_unique<file_info_xdvdfs_t>(host_path, relative_path, file_info.offset)));
 							logger_en(info, "Opened %s with handle 0x%08" PRIX32 " and path %s", file_info.is_directory ? "directory" : "file", curr_oc_request->handle, relative_path.c_str());
 						}
 					}
 				}
 				else {
-					const auto add_to_map = [curr_oc_request, dev, &relative_path](auto &&opt, info_block_oc_t *io_result, uint64_t dirent_offset, fatx::DIRENT &io_dirent) {
+					const auto add_to_map = [curr_oc_request, dev, &relative_path](std::filesystem::path host_path, info_block_oc_t *io_result, uint64_t dirent_offset, fatx::DIRENT &io_dirent) {
 							// NOTE: this insertion will fail when the guest creates a new handle to the same file. This, because it will pass the same host handle, and std::unordered_map
-							// doesn't allow duplicated keys. This is ok though, because we can reuse the same std::fstream for the same file and it will have the same path too
-							logger_en(info, "Opened %s with handle 0x%08" PRIX32 " and path %s", opt->is_open() ? "file" : "directory", curr_oc_request->handle, relative_path.c_str());
-							s_xbox_handle_map[dev].emplace(curr_oc_request->handle, std::move(std::make_unique<file_info_fatx_t>(std::move(*opt), relative_path, dirent_offset, io_dirent)));
+							// doesn't allow duplicated keys. This is ok though, because the same file will have the same host path and relative path too
+							logger_en(info, "Opened %s with handle 0x%08" PRIX32 " and path %s", host_path.empty() ? "directory" : "file", curr_oc_request->handle, relative_path.c_str());
+							s_xbox_handle_map[dev].emplace(curr_oc_request->handle, std::move(std::make_unique<file_info_fatx_t>(host_path, relative_path, dirent_offset, io_dirent)));
 							io_result->header.status = STATUS_SUCCESS;
 							io_result->file_size = io_dirent.size;
 							io_result->fatx.creation_time = io_dirent.creation_time;
@@ -392,7 +636,7 @@ namespace io {
 						io_dirent.last_access_time = curr_oc_request->timestamp;
 
 						io_result.header.info = opened;
-						add_to_map(std::make_optional<std::fstream>(), &io_result, 0, io_dirent);
+						add_to_map(std::filesystem::path(), &io_result, 0, io_dirent);
 					}
 					else if (fatx_search_status == STATUS_SUCCESS) {
 						if (!file_exists(emu_path::g_nxbx_dir, relative_path, resolved_path)) {
@@ -414,12 +658,12 @@ namespace io {
 									if (is_directory) {
 										// Open directory: nothing to do
 										io_result.header.info = opened;
-										add_to_map(std::make_optional<std::fstream>(), &io_result, dirent_offset, io_dirent);
+										add_to_map(std::filesystem::path(), &io_result, dirent_offset, io_dirent);
 									} else {
 										// Open file
-										if (auto opt = open_file(resolved_path); opt) {
+										if (g_native_file_cache.acquire(resolved_path)) {
 											io_result.header.info = opened;
-											add_to_map(opt, &io_result, dirent_offset, io_dirent);
+											add_to_map(resolved_path, &io_result, dirent_offset, io_dirent);
 										}
 									}
 								}
@@ -435,14 +679,14 @@ namespace io {
 										// Create directory: already exists
 										if (fatx::driver::get(dev).overwrite_dirent_for_file(io_dirent, 0, "") == STATUS_SUCCESS) {
 											io_result.header.info = exists;
-											add_to_map(std::make_optional<std::fstream>(), &io_result, dirent_offset, io_dirent);
+											add_to_map(std::filesystem::path(), &io_result, dirent_offset, io_dirent);
 										}
 									} else {
 										// Create file
-										if (auto opt = create_file(resolved_path, curr_oc_request->initial_size); opt) {
+										if (create_file(resolved_path, curr_oc_request->initial_size) && g_native_file_cache.acquire(resolved_path)) {
 											if (fatx::driver::get(dev).overwrite_dirent_for_file(io_dirent, curr_oc_request->initial_size, relative_path) == STATUS_SUCCESS) {
 												io_result.header.info = (disposition == IO_SUPERSEDE) ? superseded : overwritten;
-												add_to_map(opt, &io_result, dirent_offset, io_dirent);
+												add_to_map(resolved_path, &io_result, dirent_offset, io_dirent);
 											}
 										}
 									}
@@ -482,16 +726,16 @@ namespace io {
 										io_dirent.size = 0;
 										if (fatx::driver::get(dev).create_dirent_for_file(io_dirent, relative_path) == status_t::STATUS_SUCCESS) {
 											io_result.header.info = created;
-											add_to_map(std::make_optional<std::fstream>(), &io_result, dirent_offset, io_dirent);
+											add_to_map(std::filesystem::path(), &io_result, dirent_offset, io_dirent);
 										}
 									}
 								} else {
 									// Create file
-									if (auto opt = create_file(resolved_path, curr_oc_request->initial_size); opt) {
+									if (create_file(resolved_path, curr_oc_request->initial_size) && g_native_file_cache.acquire(resolved_path)) {
 										io_dirent.size = curr_oc_request->initial_size;
 										if (fatx::driver::get(dev).create_dirent_for_file(io_dirent, relative_path) == status_t::STATUS_SUCCESS) {
 											io_result.header.info = created;
-											add_to_map(opt, &io_result, dirent_offset, io_dirent);
+											add_to_map(resolved_path, &io_result, dirent_offset, io_dirent);
 										}
 									}
 								}
@@ -512,9 +756,7 @@ namespace io {
 				}
 
 				curr_oc_request->info = io_result;
-				s_completed_io_mtx.lock();
-				s_completed_io_info.emplace(curr_oc_request->id, std::move(host_io_request));
-				s_completed_io_mtx.unlock();
+				complete_io_request(std::move(host_io_request));
 				continue;
 			}
 
@@ -524,16 +766,15 @@ namespace io {
 			if (it == s_xbox_handle_map[dev].end()) [[unlikely]] {
 				logger_en(warn, "Handle 0x%08" PRIX32 " not found", host_io_request->handle); // this should not happen...
 				io_result.status = STATUS_IO_DEVICE_ERROR;
-				s_completed_io_mtx.lock();
-				s_completed_io_info.emplace(host_io_request->id, std::move(host_io_request));
-				s_completed_io_mtx.unlock();
+				host_io_request->info.header = io_result;
+				complete_io_request(std::move(host_io_request));
 				continue;
 			}
 
-			std::fstream *fs = &it->second->fs;
 			switch (io_type)
 			{
 			case request_type_t::close:
+				wait_for_pending_io(it->second.get());
 				if (dev != DEV_CDROM) {
 					file_info_fatx_t *file_info_fatx = (file_info_fatx_t *)(it->second.get());
 					if (file_info_fatx->dirent.name[0] != '\\') { // the root directory hasn't a dirent to flush
@@ -573,31 +814,32 @@ namespace io {
 					}
 				}
 				else {
+					const std::filesystem::path *host_path = &it->second->host_path;
 					uint64_t offset = 0;
 					if ((dev == DEV_CDROM) && (g_dvd_input_type == input_t::xiso)) {
-						fs = &xdvdfs::driver::get().m_xiso_fs;
-						offset = xdvdfs::driver::get().m_xiso_offset + static_cast<file_info_xdvdfs_t &&>(*it->second).offset;
+						file_info_xdvdfs_t *file_info_xdvdfs = (file_info_xdvdfs_t *)(it->second.get());
+						// NOTE: the offset of the file already includes the offset of the game partition
+						if (xdvdfs::driver::get().is_mapped()) {
+							read_from_mapped_xiso(std::move(host_io_request), it->second.get(), file_info_xdvdfs->offset);
+							continue;
+						}
+						host_path = &s_xbox_handle_map[DEV_CDROM][CDROM_HANDLE]->host_path;
+						offset = file_info_xdvdfs->offset;
 					}
-					if (!fs->is_open()) [[unlikely]] {
+					if (host_path->empty()) [[unlikely]] {
 						// Read operation on a directory (this should not happen...)
 						logger_en(warn, "Read operation to directory handle 0x%08" PRIX32 " with path %s", it->first, it->second->path.c_str());
 						break;
 					}
-					fs->seekg(curr_rw_request->offset + offset);
-					fs->read(curr_rw_request->buffer.get(), curr_rw_request->size);
-					if (fs->good() || fs->eof()) {
-						if (dev != DEV_CDROM) {
-							static_cast<file_info_fatx_t &&>(*it->second).last_access_time(curr_rw_request->timestamp);
-						}
-						io_result.status = STATUS_SUCCESS;
-						io_result.info = static_cast<info_t>(fs->gcount());
-						logger_en(info, "Read operation to file handle 0x%08" PRIX32 ", offset=0x%016" PRIX64 ", size=0x%08" PRIX32 ", actual bytes transferred=0x%08" PRIX32 " -> %s",
-							it->first, curr_rw_request->offset, curr_rw_request->size, io_result.info, fs->good() ? "OK!" : "EOF!");
-					} else {
-						logger_en(info, "Read operation to file handle 0x%08" PRIX32 " with path %s, offset=0x%016" PRIX64 ", size=0x%08" PRIX32 " -> FAILED!",
-							it->first, it->second->path.c_str(), curr_rw_request->offset, curr_rw_request->size);
+					native_file_cache::file_ptr file = g_native_file_cache.acquire(*host_path);
+					if (!file) [[unlikely]] {
+						break;
+					}
+					if (dev != DEV_CDROM) {
+						static_cast<file_info_fatx_t &&>(*it->second).last_access_time(curr_rw_request->timestamp);
 					}
-					fs->clear();
+					submit_to_backend(std::move(host_io_request), it->second.get(), std::move(file), offset);
+					continue;
 				}
 			}
 			break;
@@ -632,26 +874,24 @@ namespace io {
 						logger_en(error, "Unexpected dvd file write; offset=0x%016" PRIX64 ", size=0x%08" PRIX32 " -> IGNORED!",
 							curr_rw_request->offset, curr_rw_request->size);
 					} else {
-						if (!fs->is_open()) [[unlikely]] {
+						if (it->second->host_path.empty()) [[unlikely]] {
 							// Write operation on a directory (this should not happen...)
 							logger_en(warn, "Write operation to directory handle 0x%08" PRIX32 " with path %s", it->first, it->second->path.c_str());
 							break;
 						}
-						fs->seekg(curr_rw_request->offset);
-						fs->write(curr_rw_request->buffer.get(), curr_rw_request->size);
+						// The fatx metadata is only ever touched by this thread, so grow the cluster chain here and let the backend do the data transfer
 						fatx::DIRENT file_dirent = static_cast<file_info_fatx_t &&>(*it->second).dirent;
-						if (!fs->good() || (fatx::driver::get(dev).append_clusters_to_file(file_dirent, curr_rw_request->offset, curr_rw_request->size, it->second->path) != STATUS_SUCCESS)) {
-							fs->clear();
+						if (fatx::driver::get(dev).append_clusters_to_file(file_dirent, curr_rw_request->offset, curr_rw_request->size, it->second->path) != STATUS_SUCCESS) {
 							logger_en(info, "Write operation to file handle 0x%08" PRIX32 " with path %s, offset=0x%016" PRIX64 ", size=0x%08" PRIX32 " -> FAILED!",
 								it->first, it->second->path.c_str(), curr_rw_request->offset, curr_rw_request->size);
 						} else {
 							static_cast<file_info_fatx_t &&>(*it->second).set_dirent(file_dirent);
 							static_cast<file_info_fatx_t &&>(*it->second).last_access_time(curr_rw_request->timestamp);
 							static_cast<file_info_fatx_t &&>(*it->second).last_write_time(curr_rw_request->timestamp);
-							io_result.status = STATUS_SUCCESS;
-							io_result.info = static_cast<info_t>(curr_rw_request->size);
-							logger_en(info, "Write operation to file handle 0x%08" PRIX32 ", offset=0x%016" PRIX64 ", size=0x%08" PRIX32 " -> OK!",
-								it->first, curr_rw_request->offset, curr_rw_request->size);
+							if (native_file_cache::file_ptr file = g_native_file_cache.acquire(it->second->host_path); file) {
+								submit_to_backend(std::move(host_io_request), it->second.get(), std::move(file), 0);
+								continue;
+							}
 						}
 					}
 				}
@@ -664,6 +904,7 @@ namespace io {
 					io_result.status = STATUS_IO_DEVICE_ERROR;
 					logger_en(error, "Unexpected dvd file delete operation -> IGNORED!");
 				} else {
+					wait_for_pending_io(it->second.get());
 					file_info_fatx_t *file_info_fatx = (file_info_fatx_t *)(it->second.get());
 					fatx::driver::get(dev).delete_dirent_for_file(file_info_fatx->dirent);
 
@@ -677,17 +918,19 @@ namespace io {
 			}
 
 			host_io_request->info.header = io_result;
-			s_completed_io_mtx.lock();
-			s_completed_io_info.emplace(host_io_request->id, std::move(host_io_request));
-			s_completed_io_mtx.unlock();
+			complete_io_request(std::move(host_io_request));
 		}
 	}
 
 	static void
 	enqueue_io_packet(std::unique_ptr<request_t> host_io_request)
 	{
-		// If the I/O thread is currently holding the lock, we won't wait and instead retry the operation later
-		if (s_queue_mtx.try_lock()) {
+		// If the I/O thread is currently holding the lock, we won't wait and instead retry the operation later. Requests from the rings don't have a retry
+		// mechanism, so they always wait instead (the I/O thread only holds the lock for a very short time)
+		if (host_io_request->from_ring) {
+			s_queue_mtx.lock();
+		}
+		if (host_io_request->from_ring || s_queue_mtx.try_lock()) {
 			s_curr_io_queue.push_back(std::move(host_io_request));
 			// Signal that there's a new packet to process
 			s_pending_io.test_and_set();
@@ -700,14 +943,86 @@ namespace io {
 		}
 	}
 
-	void
-	submit_io_packet(uint32_t addr)
+	static char *
+	guest_virt_to_host(uint32_t addr, uint32_t &page_size)
 	{
-		packed_request_t io_request;
-		mem_read_block_virt(s_lc86cpu, addr, sizeof(packed_request_t), (uint8_t *)&io_request);
+		// Walks the guest page tables through their self-mapping, and returns nullptr when the page is not present or is not backed by ram (e.g. mmio)
+		uint32_t pde;
+		page_size = IO_PAGE_SIZE;
+		if (!LC86_SUCCESS(mem_read_block_virt(s_lc86cpu, IO_PDE_BASE + (addr >> 22) * 4, 4, (uint8_t *)&pde)) || !(pde & IO_PAGE_PRESENT)) {
+			return nullptr;
+		}
+
+		uint32_t phys_addr;
+		if (pde & IO_PAGE_LARGE) {
+			page_size = IO_LARGE_PAGE_SIZE;
+			phys_addr = (pde & ~(IO_LARGE_PAGE_SIZE - 1)) | (addr & (IO_LARGE_PAGE_SIZE - 1));
+		} else {
+			uint32_t pte;
+			if (!LC86_SUCCESS(mem_read_block_virt(s_lc86cpu, IO_PTE_BASE + (addr >> 12) * 4, 4, (uint8_t *)&pte)) || !(pte & IO_PAGE_PRESENT)) {
+				return nullptr;
+			}
+			phys_addr = (pte & ~(IO_PAGE_SIZE - 1)) | (addr & (IO_PAGE_SIZE - 1));
+		}
 
+		uint32_t page_end = (phys_addr & ~(page_size - 1)) + page_size;
+		return (page_end <= s_ramsize) ? (char *)(s_ram + phys_addr) : nullptr;
+	}
+
+	static void
+	map_guest_buffer(request_rw_t *host_io_request)
+	{
+		// This splits the guest buffer of a read in host segments, so that the backend can read directly in guest ram. Physically contiguous pages are merged
+		// in a single segment, and the pages that can't be reached from the host are bounced through the request buffer instead.
+		// NOTE: lib86cpu doesn't see the writes of the backend, so code already translated from the same pages would not be invalidated, and would still run
+		// after e.g. a section is reloaded in them. The direct segments are then also written onto themselves through lib86cpu when the request completes
+		struct span_t {
+			char *host; // nullptr for bounced spans
+			uint32_t address;
+			uint32_t size;
+		};
+		std::vector<span_t> spans;
+		uint32_t addr = host_io_request->address, size_left = host_io_request->size, bounce_size = 0;
+		while (size_left) {
+			uint32_t page_size;
+			char *host = guest_virt_to_host(addr, page_size);
+			uint32_t size = std::min(size_left, page_size - (addr & (page_size - 1)));
+			if (host == nullptr) {
+				bounce_size += size;
+			}
+			if (!spans.empty() && (((spans.back().host == nullptr) && (host == nullptr)) ||
+				(spans.back().host && host && ((spans.back().host + spans.back().size) == host)))) {
+				spans.back().size += size;
+			} else {
+				spans.emplace_back(host, addr, size);
+			}
+			addr += size;
+			size_left -= size;
+		}
+
+		if (bounce_size) {
+			host_io_request->buffer = std::make_unique_for_overwrite<char[]>(bounce_size);
+		}
+		uint32_t bounce_offset = 0;
+		host_io_request->segments.reserve(spans.size());
+		for (const span_t &span : spans) {
+			if (span.host) {
+				host_io_request->segments.emplace_back(span.host, span.size);
+				host_io_request->guest_spans.emplace_back(span.address, span.size, span.host);
+			} else {
+				host_io_request->segments.emplace_back(host_io_request->buffer.get() + bounce_offset, span.size);
+				host_io_request->guest_spans.emplace_back(span.address, span.size, host_io_request->buffer.get() + bounce_offset);
+				bounce_offset += span.size;
+			}
+		}
+	}
+
+	static void
+	submit_io_request(const packed_request_t &io_request, bool from_ring)
+	{
 		if (request_type_t io_type = IO_GET_TYPE(io_request.header.type); io_type == open) {
 			std::unique_ptr<request_oc_t> host_io_request = std::make_unique<request_oc_t>();
+			host_io_request->from_ring = from_ring;
 			host_io_request->id = io_request.header.id;
 			host_io_request->type = io_request.header.type;
 			host_io_request->initial_size = io_request.m_oc.initial_size;
@@ -725,6 +1040,7 @@ namespace io {
 		else {
 			if ((io_type == write) || (io_type == read)) {
 				std::unique_ptr<request_rw_t> host_io_request = std::make_unique<request_rw_t>();
+				host_io_request->from_ring = from_ring;
 				host_io_request->id = io_request.header.id;
 				host_io_request->type = io_request.header.type;
 				host_io_request->offset = io_request.m_rw.offset;
@@ -732,13 +1048,24 @@ namespace io {
 				host_io_request->size = io_request.m_rw.size;
 				host_io_request->handle = io_request.m_rw.handle;
 				host_io_request->timestamp = io_request.m_rw.timestamp;
-				host_io_request->buffer = std::make_unique_for_overwrite<char[]>(host_io_request->size);
-				if (io_type == write) {
-					mem_read_block_virt(s_lc86cpu, host_io_request->address, host_io_request->size, reinterpret_cast<uint8_t *>(host_io_request->buffer.get()));
+				if ((io_type == read) && !IS_DEV_HANDLE(host_io_request->handle)) {
+					// Raw device reads are done with the buffer by the I/O thread, so only file reads can go straight to guest ram
+					map_guest_buffer(host_io_request.get());
+				} else {
+					host_io_request->buffer = std::make_unique_for_overwrite<char[]>(host_io_request->size);
+					if (host_io_request->size) {
+						host_io_request->segments.emplace_back(host_io_request->buffer.get(), host_io_request->size);
+					}
+					if (io_type == write) {
+						mem_read_block_virt(s_lc86cpu, host_io_request->address, host_io_request->size, reinterpret_cast<uint8_t *>(host_io_request->buffer.get()));
+					} else {
+						host_io_request->guest_spans.emplace_back(host_io_request->address, host_io_request->size, host_io_request->buffer.get());
+					}
 				}
 				enqueue_io_packet(std::move(host_io_request));
 			} else {
 				std::unique_ptr<request_t> host_io_request = std::make_unique<request_t>();
+				host_io_request->from_ring = from_ring;
 				host_io_request->id = io_request.header.id;
 				host_io_request->type = io_request.header.type;
 				host_io_request->handle = io_request.m_xx.handle;
@@ -747,6 +1074,125 @@ namespace io {
 		}
 	}
 
+	void
+	submit_io_packet(uint32_t addr)
+	{
+		packed_request_t io_request;
+		mem_read_block_virt(s_lc86cpu, addr, sizeof(packed_request_t), (uint8_t *)&io_request);
+		submit_io_request(io_request, false);
+	}
+
+	void
+	setup_ring(uint32_t addr)
+	{
+		// addr is the physical address of the page holding the rings, or zero to stop using them. Requests already submitted through the rings that complete
+		// after they are disabled are only reported through IO_QUERY
+		std::unique_lock lock(s_ring_mtx);
+		s_cq_overflow.clear();
+		if (addr == 0) {
+			s_ring = nullptr;
+			logger_en(info, "Shared memory rings disabled");
+			return;
+		}
+
+		if ((addr & (IO_PAGE_SIZE - 1)) || (addr >= s_ramsize)) [[unlikely]] {
+			s_ring = nullptr;
+			logger_en(error, "Invalid address 0x%08" PRIX32 " for the shared memory rings", addr);
+			return;
+		}
+
+		s_ring = reinterpret_cast<ring_page_t *>(s_ram + addr);
+		std::fill_n((char *)&s_ring->header, sizeof(ring_header_t), 0);
+		logger_en(info, "Shared memory rings enabled at physical address 0x%08" PRIX32, addr);
+	}
+
+	void
+	ring_doorbell()
+	{
+		if (s_ring == nullptr) [[unlikely]] {
+			return;
+		}
+
+		// Move the completions that previously didn't fit in the cq first, since the kernel also uses the doorbell after it has made room for them
+		s_ring_mtx.lock();
+		while (!s_cq_overflow.empty() && push_completion(s_cq_overflow.front())) {
+			s_cq_overflow.pop_front();
+		}
+		if (s_cq_overflow.empty()) {
+			std::atomic_ref(s_ring->header.flags).fetch_and(~IO_RING_FLAG_CQ_OVERFLOW, std::memory_order_release);
+		}
+		s_ring_mtx.unlock();
+
+		// sq_tail is written by the guest, so it can't be trusted to be within the sq. A tail too far ahead would make this read past the posted requests and
+		// submit stale or garbage entries, so the whole sq is rejected instead, and the guest must reset the rings with IO_RING_SETUP
+		uint32_t head = s_ring->header.sq_head;
+		uint32_t tail = std::atomic_ref(s_ring->header.sq_tail).load(std::memory_order_acquire);
+		if ((tail - head) > IO_RING_NUM_OF_ENTRIES) [[unlikely]] {
+			std::atomic_ref(s_ring->header.flags).fetch_or(IO_RING_FLAG_SQ_INVALID, std::memory_order_release);
+			logger_en(error, "Invalid sq indices, head=%" PRIu32 " tail=%" PRIu32 ", ignoring the submissions", head, tail);
+			return;
+		}
+		while (head != tail) {
+			packed_request_t io_request = s_ring->sq[head & IO_RING_MASK];
+			++head;
+			std::atomic_ref(s_ring->header.sq_head).store(head, std::memory_order_release); // the slot can be reused by the guest now
+			submit_io_request(io_request, true);
+		}
+	}
+
+	void
+	enable_completion_irq(uint32_t enable)
+	{
+		std::unique_lock lock(s_completed_io_mtx);
+		s_irq_enabled = enable;
+		if (!s_irq_enabled) {
+			for (auto &[id, request] : s_completed_io_info) {
+				request->drain_pending = false;
+			}
+			s_num_drain_pending = 0;
+			if (s_irq_raised) {
+				s_irq_raised = false;
+				s_machine->lower_irq(IO_IRQ_NUM);
+			}
+		}
+		logger_en(info, "I/O completion irq %s", s_irq_enabled ? "enabled" : "disabled");
+	}
+
+	void
+	drain_completions(uint32_t addr)
+	{
+		// addr points to a guest buffer with the layout uint32_t capacity, uint32_t count, uint32_t ids[capacity]. This writes up to capacity ids of completed
+		// requests to it, and their results can then be read with IO_QUERY without polling. If some ids didn't fit, the irq fires again
+		uint32_t capacity;
+		mem_read_block_virt(s_lc86cpu, addr, 4, (uint8_t *)&capacity);
+
+		std::unique_lock lock(s_completed_io_mtx);
+		uint32_t max_count = std::min(capacity, s_num_drain_pending);
+		std::vector<uint32_t> ids;
+		ids.reserve(max_count);
+		for (auto it = s_completed_io_info.begin(); (it != s_completed_io_info.end()) && (ids.size() < max_count); ++it) {
+			if (it->second->drain_pending) {
+				it->second->drain_pending = false;
+				ids.push_back(it->first);
+			}
+		}
+		uint32_t count = (uint32_t)ids.size();
+		s_num_drain_pending -= count;
+		if (count) {
+			mem_write_block_virt(s_lc86cpu, addr + 8, count * 4, ids.data());
+		}
+		mem_write_block_virt(s_lc86cpu, addr + 4, 4, &count);
+
+		if (s_irq_raised) {
+			s_machine->lower_irq(IO_IRQ_NUM);
+			if (s_num_drain_pending == 0) {
+				s_irq_raised = false;
+			} else {
+				s_machine->raise_irq(IO_IRQ_NUM); // new edge for the remaining ids
+			}
+		}
+	}
+
 	void
 	flush_pending_packets()
 	{
@@ -777,9 +1223,12 @@ namespace io {
 				uint64_t size_of_request;
 				request_t *request = it->second.get();
 				if ((IO_GET_TYPE(request->type) == read) && (request->info.header.status == STATUS_SUCCESS)) {
-					// Do the transfer here instead of the IO thread to avoid races with the cpu thread
+					// Do the transfer of the bounced parts, and the invalidation of the code in the direct parts, here instead of the IO thread to avoid races with
+					// the cpu thread
 					request_rw_t *request_rw = (request_rw_t *)request;
-					mem_write_block_virt(s_lc86cpu, request_rw->address, request_rw->size, request_rw->buffer.get());
+					for (const guest_span_t &span : request_rw->guest_spans) {
+						mem_write_block_virt(s_lc86cpu, span.address, span.size, span.host);
+					}
 				}
 				if (IO_GET_TYPE(request->type) == open) {
 					block = request->info;
@@ -790,6 +1239,9 @@ namespace io {
 				}
 				block.header.ready = 1;
 				mem_write_block_virt(s_lc86cpu, addr, size_of_request, &block);
+				if (request->drain_pending) {
+					--s_num_drain_pending; // queried before it was drained, so the guest doesn't need its id anymore
+				}
 				s_completed_io_info.erase(it);
 			}
 			s_completed_io_mtx.unlock();
@@ -834,16 +1286,22 @@ namespace io {
 	}
 
 	void
-	init(cpu_t *cpu)
+	init(machine *machine)
 	{
-		s_lc86cpu = cpu;
+		s_machine = machine;
+		s_lc86cpu = machine->get86cpu();
+		s_ram = get_ram_ptr(s_lc86cpu);
+		s_ramsize = machine->getCpu()->getRamsize();
 		add_device_handles();
+		backend::init();
 		s_jthr = std::jthread(&io::worker);
 	}
 
 	void
 	stop()
 	{
+		setup_ring(0);
+		enable_completion_irq(0);
 		if (s_jthr.joinable()) {
 			// Signal the I/O thread that it needs to exit
 			s_jthr.request_stop();
@@ -43,7 +43,7 @@
 #define IO_FILE_DIRECTORY 0x10
 
 
-class cpu_t;
+class machine;
 
 namespace io {
 	// These definitions are the same used by nboxkrnl to report the final ntstatus of I/O requests
@@ -72,9 +72,13 @@ namespace io {
 	inline input_t g_dvd_input_type;
 
 	bool setup_paths(const init_info_t &init_info);
-	void init(cpu_t *cpu);
+	void init(machine *machine);
 	void stop();
 	void submit_io_packet(uint32_t addr);
 	void flush_pending_packets();
 	void query_io_packet(uint32_t addr);
+	void setup_ring(uint32_t addr);
+	void ring_doorbell();
+	void enable_completion_irq(uint32_t enable);
+	void drain_completions(uint32_t addr);
 }
@@ -0,0 +1,343 @@
+// SPDX-License-Identifier: GPL-3.0-only
+
+// SPDX-FileCopyrightText: 2026 ergo720
+
+#include "io_backend.hpp"
+#include "logger.hpp"
+#include <thread>
+#include <deque>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <algorithm>
+#if defined(NXBX_HAS_IO_URING)
+#include <semaphore>
+#include <unordered_set>
+#include <cerrno>
+#include <liburing.h>
+#endif
+
+#define MODULE_NAME io
+
+#define IO_URING_QUEUE_DEPTH 64 // max number of transfers that can be in flight at the same time with io_uring
+#define IO_POOL_MIN_THREADS 2 // also the threads started with io_uring, for the transfers done with transfer_t::read_fn
+#define IO_POOL_MAX_THREADS 8
+
+
+namespace io::backend {
+	static std::atomic_uint32_t s_inflight; // transfers submitted but not yet completed
+
+	// Thread pool backend, used when io_uring is not available
+	static std::vector<std::jthread> s_pool;
+	static std::deque<transfer_t> s_pool_queue;
+	static std::mutex s_pool_mtx;
+	static std::condition_variable_any s_pool_cv;
+
+#if defined(NXBX_HAS_IO_URING)
+	// io_uring backend
+	struct uring_op_t {
+		transfer_t transfer;
+		size_t segment_idx; // segment currently being transferred
+		uint32_t segment_done; // bytes of the current segment already transferred, used to resubmit short transfers
+		uint64_t total_done; // bytes of the whole transfer already transferred
+	};
+
+	static io_uring s_ring;
+	static bool s_has_ring = false;
+	static std::atomic_bool s_use_uring = false; // cleared by the reaper when it can't wait for completions anymore
+	static std::jthread s_reaper;
+	static std::mutex s_sq_mtx;
+	static std::counting_semaphore<IO_URING_QUEUE_DEPTH> s_sq_slots(IO_URING_QUEUE_DEPTH);
+	static std::unordered_set<uring_op_t *> s_uring_ops; // ops not completed yet, protected by s_sq_mtx
+	static char s_discarded_sqe; // user data of the sqes that failed to submit, which the reaper ignores
+#endif
+
+
+	static void
+	complete(completion_t completion, void *opaque, int64_t result)
+	{
+		completion(opaque, result);
+		if (s_inflight.fetch_sub(1) == 1) {
+			s_inflight.notify_all();
+		}
+	}
+
+	static int64_t
+	do_transfer(const transfer_t &transfer)
+	{
+		uint64_t total_done = 0;
+		for (const segment_t &segment : transfer.segments) {
+			int64_t result = transfer.is_write ? transfer.file->write_at(segment.buffer, segment.size, transfer.offset + total_done) :
+				transfer.read_fn ? transfer.read_fn(segment.buffer, segment.size, transfer.offset + total_done) :
+				transfer.file->read_at(segment.buffer, segment.size, transfer.offset + total_done);
+			if (result < 0) {
+				return -1;
+			}
+			total_done += result;
+			if (result < segment.size) {
+				break; // reached the end of the file
+			}
+		}
+
+		return total_done;
+	}
+
+	static void
+	pool_queue(const transfer_t &transfer)
+	{
+		s_pool_mtx.lock();
+		s_pool_queue.push_back(transfer);
+		s_pool_mtx.unlock();
+		s_pool_cv.notify_one();
+	}
+
+	static void
+	pool_worker(std::stop_token stok)
+	{
+		while (true) {
+			std::unique_lock lock(s_pool_mtx);
+			if (!s_pool_cv.wait(lock, stok, [] { return !s_pool_queue.empty(); })) {
+				return; // stop requested
+			}
+			transfer_t transfer = s_pool_queue.front();
+			s_pool_queue.pop_front();
+			lock.unlock();
+
+			complete(transfer.completion, transfer.opaque, do_transfer(transfer));
+		}
+	}
+
+	static void
+	pool_start(bool is_backend)
+	{
+		// The pool is also started with io_uring, but with the minimum number of threads, since it then only does the transfers that io_uring can't do
+		unsigned num_of_threads = is_backend ? std::clamp(std::thread::hardware_concurrency() / 2, (unsigned)IO_POOL_MIN_THREADS, (unsigned)IO_POOL_MAX_THREADS) :
+			IO_POOL_MIN_THREADS;
+		for (unsigned i = s_pool.size(); i < num_of_threads; ++i) {
+			s_pool.emplace_back(&pool_worker);
+		}
+		if (is_backend) {
+			logger_en(info, "Using thread pool backend with %u threads for file transfers", num_of_threads);
+		}
+	}
+
+#if defined(NXBX_HAS_IO_URING)
+	static void
+	uring_finish(uring_op_t *op, int64_t result)
+	{
+		s_sq_mtx.lock();
+		s_uring_ops.erase(op);
+		s_sq_mtx.unlock();
+		completion_t completion = op->transfer.completion;
+		void *opaque = op->transfer.opaque;
+		delete op;
+		s_sq_slots.release();
+		complete(completion, opaque, result);
+	}
+
+	static io_uring_sqe *
+	uring_get_sqe()
+	{
+		// NOTE: s_sq_slots never allows more than IO_URING_QUEUE_DEPTH ops in flight, so io_uring_get_sqe can only fail when the queue is full of sqes that
+		// failed to submit. Try to flush them first
+		io_uring_sqe *sqe = io_uring_get_sqe(&s_ring);
+		if (sqe == nullptr) [[unlikely]] {
+			io_uring_submit(&s_ring);
+			sqe = io_uring_get_sqe(&s_ring);
+		}
+
+		return sqe;
+	}
+
+	static void
+	uring_queue(uring_op_t *op)
+	{
+		// This is called by both the I/O thread and the reaper thread (to resubmit short transfers), so access to the submission queue must be serialized
+		std::unique_lock lock(s_sq_mtx);
+		if (!s_use_uring.load(std::memory_order_relaxed)) [[unlikely]] {
+			// The reaper failed after the op was counted in s_sq_slots. Only new ops get here, because ops that were resubmitted are failed by the reaper itself
+			lock.unlock();
+			transfer_t transfer = op->transfer;
+			delete op;
+			s_sq_slots.release();
+			pool_queue(transfer);
+			return;
+		}
+
+		io_uring_sqe *sqe = uring_get_sqe();
+		if (sqe == nullptr) [[unlikely]] {
+			lock.unlock();
+			logger_en(error, "The io_uring submission queue is full, failing the transfer");
+			uring_finish(op, -1);
+			return;
+		}
+		s_uring_ops.insert(op);
+		const transfer_t &transfer = op->transfer;
+		const segment_t &segment = transfer.segments[op->segment_idx];
+		if (transfer.is_write) {
+			io_uring_prep_write(sqe, transfer.file->get(), segment.buffer + op->segment_done, segment.size - op->segment_done, transfer.offset + op->total_done);
+		} else {
+			io_uring_prep_read(sqe, transfer.file->get(), segment.buffer + op->segment_done, segment.size - op->segment_done, transfer.offset + op->total_done);
+		}
+		io_uring_sqe_set_data(sqe, op);
+		while (true) {
+			int ret = io_uring_submit(&s_ring);
+			if ((ret == -EINTR) || (ret == -EAGAIN) || (ret == -EBUSY)) {
+				std::this_thread::yield();
+				continue;
+			}
+			if (ret < 0) [[unlikely]] {
+				// The kernel didn't consume the sqe, but it's already in the queue, and it would be submitted by the next successful call. Turn it into a nop that
+				// the reaper ignores, and fail the transfer now
+				logger_en(error, "Failed to submit io_uring transfer, the error was %d", -ret);
+				io_uring_prep_nop(sqe);
+				io_uring_sqe_set_data(sqe, &s_discarded_sqe);
+				lock.unlock();
+				uring_finish(op, -1);
+			}
+			break;
+		}
+	}
+
+	static void
+	uring_reaper()
+	{
+		while (true) {
+			io_uring_cqe *cqe;
+			if (int ret = io_uring_wait_cqe(&s_ring, &cqe); ret < 0) {
+				if (ret == -EINTR) {
+					continue;
+				}
+				// Without the reaper, the ops in flight would never complete, and deinit would wait for them forever. Fail them, and send the new transfers to
+				// the thread pool instead
+				// NOTE: the kernel can still finish the failed ops later, but the callers can't wait for them anymore
+				logger_en(error, "Failed to wait for io_uring completions, the error was %d. Falling back to the thread pool backend", -ret);
+				std::unordered_set<uring_op_t *> ops;
+				s_sq_mtx.lock();
+				s_use_uring.store(false, std::memory_order_relaxed);
+				ops.swap(s_uring_ops);
+				s_sq_mtx.unlock();
+				pool_start(true);
+				for (uring_op_t *op : ops) {
+					uring_finish(op, -1);
+				}
+				return;
+			}
+			void *data = io_uring_cqe_get_data(cqe);
+			int32_t res = cqe->res;
+			io_uring_cqe_seen(&s_ring, cqe);
+
+			if (data == nullptr) {
+				return; // nop submitted by deinit to wake us up
+			}
+			if (data == &s_discarded_sqe) {
+				continue;
+			}
+			uring_op_t *op = static_cast<uring_op_t *>(data);
+
+			if ((res == -EINTR) || (res == -EAGAIN)) {
+				uring_queue(op);
+				continue;
+			}
+
+			if (res > 0) {
+				// Segments are transferred one after the other. A short transfer queues the remaining part of the segment, and for reads, a following zero-length
+				// result means we reached the end of the file
+				op->segment_done += res;
+				op->total_done += res;
+				if (op->segment_done == op->transfer.segments[op->segment_idx].size) {
+					++op->segment_idx;
+					op->segment_done = 0;
+				}
+				if (op->segment_idx < op->transfer.segments.size()) {
+					uring_queue(op);
+					continue;
+				}
+			}
+
+			uring_finish(op, ((res < 0) || ((res == 0) && op->transfer.is_write)) ? -1 : op->total_done);
+		}
+	}
+#endif
+
+	void
+	init()
+	{
+#if defined(NXBX_HAS_IO_URING)
+		if (int ret = io_uring_queue_init(IO_URING_QUEUE_DEPTH, &s_ring, 0); ret == 0) {
+			s_has_ring = true;
+			s_use_uring = true;
+			s_reaper = std::jthread(&uring_reaper);
+			pool_start(false);
+			logger_en(info, "Using io_uring backend for file transfers");
+			return;
+		}
+		else {
+			// This can happen if the host kernel is too old or io_uring was disabled (e.g. by a seccomp filter)
+			logger_en(info, "io_uring is not available (error was %d), falling back to the thread pool backend", -ret);
+		}
+#endif
+
+		pool_start(true);
+	}
+
+	void
+	deinit()
+	{
+		// Wait for all transfers still in flight, because they reference files and buffers owned by the caller
+		for (uint32_t inflight = s_inflight.load(); inflight; inflight = s_inflight.load()) {
+			s_inflight.wait(inflight);
+		}
+
+#if defined(NXBX_HAS_IO_URING)
+		if (s_has_ring) {
+			// The reaper might have already exited after a failure, in which case it started the thread pool, which is stopped below
+			s_sq_mtx.lock();
+			io_uring_sqe *sqe = uring_get_sqe();
+			int ret = -EBUSY;
+			if (sqe) {
+				io_uring_prep_nop(sqe);
+				io_uring_sqe_set_data(sqe, nullptr);
+				ret = io_uring_submit(&s_ring);
+			}
+			s_sq_mtx.unlock();
+			if (ret < 0) [[unlikely]] {
+				// The reaper can't be woken up, so leave it blocked and leak the ring, instead of freeing the ring under it
+				logger_en(error, "Failed to stop the io_uring reaper, the error was %d", -ret);
+				s_reaper.detach();
+			}
+			else {
+				s_reaper.join();
+				io_uring_queue_exit(&s_ring);
+			}
+			s_has_ring = false;
+			s_use_uring = false;
+		}
+#endif
+
+		s_pool.clear(); // jthread's destructor requests a stop and then joins
+		s_pool_queue.clear();
+	}
+
+	void
+	submit(const transfer_t &transfer)
+	{
+		s_inflight.fetch_add(1);
+
+		if (transfer.segments.empty()) [[unlikely]] {
+			complete(transfer.completion, transfer.opaque, 0);
+			return;
+		}
+
+#if defined(NXBX_HAS_IO_URING)
+		if (!transfer.read_fn && s_use_uring.load(std::memory_order_relaxed)) {
+			s_sq_slots.acquire(); // blocks the I/O thread while the ring is full
+			uring_queue(new uring_op_t{ transfer, 0, 0, 0 });
+			return;
+		}
+#endif
+
+		pool_queue(transfer);
+	}
+}
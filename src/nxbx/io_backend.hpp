@@ -0,0 +1,40 @@
+// SPDX-License-Identifier: GPL-3.0-only
+
+// SPDX-FileCopyrightText: 2026 ergo720
+
+#pragma once
+
+#include "files.hpp"
+#include <cstdint>
+#include <span>
+
+
+namespace io::backend {
+	// A piece of host memory that is the source/destination of a transfer
+	struct segment_t {
+		char *buffer;
+		uint32_t size;
+	};
+
+	// Called from a backend thread when a transfer is done. result is the number of bytes transferred, or -1 on failure
+	using completion_t = void(*)(void *opaque, int64_t result);
+
+	// Reads from a source that isn't a host file, like a mapped file, with the same results of native_file::read_at
+	using read_t = int64_t(*)(char *buffer, uint32_t size, uint64_t offset);
+
+	// A single positional read or write of a host file, scattered/gathered over the segments in order. The file and the segments must stay valid until the
+	// completion function is called
+	struct transfer_t {
+		const native_file *file; // nullptr for reads done with read_fn
+		uint64_t offset;
+		std::span<const segment_t> segments;
+		bool is_write;
+		completion_t completion;
+		void *opaque; // passed back to the completion function
+		read_t read_fn = nullptr; // used instead of file, always runs on a thread of the pool, because it can block without being a file transfer
+	};
+
+	void init();
+	void deinit();
+	void submit(const transfer_t &transfer);
+}
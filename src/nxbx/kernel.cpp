@@ -110,6 +110,22 @@ namespace kernel
 			io::query_io_packet(value);
 			break;
 
+		case IO_RING_SETUP:
+			io::setup_ring(value);
+			break;
+
+		case IO_RING_DOORBELL:
+			io::ring_doorbell();
+			break;
+
+		case IO_IRQ_ENABLE:
+			io::enable_completion_irq(value);
+			break;
+
+		case IO_DRAIN_COMPLETIONS:
+			io::drain_completions(value);
+			break;
+
 		case XE_DVD_XBE_ADDR:
 			mem_write_block_virt(static_cast<cpu_t *>(opaque), value, (uint32_t)emu_path::g_xbe_path_xbox.size(), emu_path::g_xbe_path_xbox.c_str());
 			break;
@@ -30,6 +30,10 @@ namespace kernel {
 		XE_DVD_XBE_ADDR,
 		ACPI_TIME_LOW,
 		ACPI_TIME_HIGH,
+		IO_RING_SETUP,
+		IO_RING_DOORBELL,
+		IO_IRQ_ENABLE,
+		IO_DRAIN_COMPLETIONS,
 		IO_END
 	};
 	constexpr inline size_t IO_SIZE = IO_END - IO_BASE;
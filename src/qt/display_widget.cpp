@@ -0,0 +1,51 @@
+// SPDX-License-Identifier: GPL-3.0-only
+
+// SPDX-FileCopyrightText: 2026 ergo720
+
+#include "display_widget.hpp"
+#include <QtGui/QPainter>
+#include <cstring>
+
+
+DisplayWidget::DisplayWidget(QWidget *parent) : QWidget(parent)
+{
+	// The whole widget is painted at every frame, so Qt doesn't need to clear it first
+	setAttribute(Qt::WA_OpaquePaintEvent);
+}
+
+void DisplayWidget::setFrame(const uint32_t *pixels, uint32_t width, uint32_t height)
+{
+	if ((width == 0) || (height == 0)) {
+		clear();
+		return;
+	}
+
+	// The alpha channel is ignored, because the guest doesn't necessarily set it in the framebuffer
+	if ((m_image.width() != (int)width) || (m_image.height() != (int)height)) {
+		m_image = QImage(width, height, QImage::Format_RGB32);
+	}
+	for (uint32_t y = 0; y < height; ++y) {
+		std::memcpy(m_image.scanLine(y), &pixels[y * width], width * 4);
+	}
+	update();
+}
+
+void DisplayWidget::clear()
+{
+	m_image = QImage();
+	update();
+}
+
+void DisplayWidget::paintEvent(QPaintEvent *event)
+{
+	QPainter painter(this);
+	painter.fillRect(rect(), Qt::black);
+	if (m_image.isNull()) {
+		return;
+	}
+
+	QSize size = m_image.size().scaled(this->size(), Qt::KeepAspectRatio);
+	QRect target((width() - size.width()) / 2, (height() - size.height()) / 2, size.width(), size.height());
+	painter.setRenderHint(QPainter::SmoothPixmapTransform);
+	painter.drawImage(target, m_image);
+}
@@ -0,0 +1,29 @@
+// SPDX-License-Identifier: GPL-3.0-only
+
+// SPDX-FileCopyrightText: 2026 ergo720
+
+#pragma once
+
+#include <QtGui/QImage>
+#include <QtWidgets/QWidget>
+#include <cstdint>
+
+
+// Shows the frames of the emulated screen, scaled to fit the widget while keeping their aspect ratio
+class DisplayWidget final : public QWidget
+{
+	Q_OBJECT
+
+public:
+	explicit DisplayWidget(QWidget *parent = nullptr);
+
+	// Copies the frame, so the caller can reuse the pixels right after. The pixels are in A8R8G8B8 format
+	void setFrame(const uint32_t *pixels, uint32_t width, uint32_t height);
+	void clear();
+
+protected:
+	void paintEvent(QPaintEvent *event) override;
+
+private:
+	QImage m_image;
+};
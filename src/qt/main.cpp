@@ -305,6 +305,10 @@ main(int argc, char **argv)
 		return 1;
 	}
 
+	// Start the thread that formats and writes the log messages
+	log_sink::init(get_settings()->get_string_value("core", "log_file", ""),
+		static_cast<log_sink::policy_t>(get_settings()->get_long_value("core", "log_policy", std::to_underlying(log_sink::policy_t::drop))));
+
 	// Find the kernel, in the case its path wasn't passed from the command line
 	init_info.kernel_path = Host::SetupKernelPath(init_info.kernel_path);
 	if (init_info.kernel_path.empty()) {
@@ -359,6 +363,7 @@ main(int argc, char **argv)
 	delete g_console;
 
 	save_settings();
+	log_sink::deinit();
 
 	return result;
 }
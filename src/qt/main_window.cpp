@@ -8,6 +8,11 @@
 #include "qthost.hpp"
 #include "console.hpp"
 #include "paths.hpp"
+#include "display_widget.hpp"
+#include "video/gpu/pcrtc.hpp"
+#include "video/gpu/presenter.hpp"
+// Must be included last because of the template functions nv2a_read/write, which require a complete definition for the engine objects
+#include "video/gpu/nv2a.hpp"
 #include <assert.h>
 
 #include <QtWidgets/QFileDialog>
@@ -97,18 +102,33 @@ bool MainWindow::requestShutdown(bool allow_confirm, bool allow_save_to_state, b
 void MainWindow::onMachineStopped()
 {
 	s_valid_machine = false;
+	m_display_widget->clear();
 	updateEmulationActions(false, false, false);
 	if (Host::InNoGUIMode()) {
 		QGuiApplication::quit();
 	}
 }
 
+void MainWindow::onFrameReady()
+{
+	// The frame belongs to the presenter of the machine, so it can only be taken while the machine is still there
+	if (!s_valid_machine || !g_console) {
+		return;
+	}
+
+	presenter* gpu_presenter = g_console->get_machine()->getGpu()->getPcrtc()->getPresenter();
+	if (const presenter_frame* frame = gpu_presenter->acquireFrame(); frame) {
+		m_display_widget->setFrame(frame->pixels.data(), frame->width, frame->height);
+	}
+}
+
 void MainWindow::doStartFile(const QString& path)
 {
 	if (const auto exp = Host::validate_input_file(path.toStdString()); exp) {
 		emu_path::update_after_reboot(exp.value(), path.toStdString());
 		boot_params params = g_console->get_boot_params();
 		s_valid_machine = false;
+		m_display_widget->clear();
 		g_console->exit(true);
 		delete g_console;
 		g_console = new console(params);
@@ -130,6 +150,9 @@ void MainWindow::setupAdditionalUi()
 {
 	makeIconsMasks(menuBar());
 
+	m_display_widget = new DisplayWidget(this);
+	setCentralWidget(m_display_widget);
+
 	const bool toolbar_visible = get_settings()->get_bool_value("ui", "show_toolbar", true);
 	m_ui.actionViewToolbar->setChecked(toolbar_visible);
 	m_ui.toolBar->setVisible(toolbar_visible);
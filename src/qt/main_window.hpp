@@ -8,6 +8,8 @@
 #include <QtWidgets/QMenu>
 #include "ui_main_window.h"
 
+class DisplayWidget;
+
 
 class MainWindow final : public QMainWindow
 {
@@ -32,6 +34,7 @@ private Q_SLOTS:
 
 	void onMachineStarted();
 	void onMachineStopped();
+	void onFrameReady();
 	bool requestShutdown(bool allow_confirm = true, bool allow_save_to_state = true, bool default_save_to_state = true);
 
 private:
@@ -42,6 +45,7 @@ private:
 	void updateWindowState(bool force_visible = false);
 
 	Ui::MainWindow m_ui;
+	DisplayWidget* m_display_widget = nullptr;
 };
 
 extern MainWindow* g_main_window;
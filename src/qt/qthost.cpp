@@ -45,3 +45,8 @@ void Host::SignalStop()
 {
 	QMetaObject::invokeMethod(g_main_window, "onMachineStopped", Qt::QueuedConnection);
 }
+
+void Host::SignalFrameReady()
+{
+	QMetaObject::invokeMethod(g_main_window, "onFrameReady", Qt::QueuedConnection);
+}
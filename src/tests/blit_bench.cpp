@@ -0,0 +1,80 @@
+// SPDX-License-Identifier: GPL-3.0-only
+
+// SPDX-FileCopyrightText: 2026 ergo720
+
+#include "harness.hpp"
+#include "video/gpu/blit.hpp"
+#include <vector>
+#include <cstring>
+#include <cstdio>
+
+#define WIDTH 640
+#define HEIGHT 480
+#define TILE_SIZE 64
+
+
+// The copies of NV15_IMAGE_BLIT: whole 640x480 surfaces, the 64x64 tiles of the sprites and of the texture atlases, and the overlapping copies of a scroll
+NXBX_CASE(blit_bench)
+{
+	std::vector<uint8_t> src(WIDTH * HEIGHT * 4), dst(src.size());
+	harness::rng().fill(src.data(), src.size());
+	uint32_t pitch = WIDTH * 4;
+
+	harness::benchmark("memcpy 640x480x32 (reference)", WIDTH * HEIGHT * 4, [&]() {
+		std::memcpy(dst.data(), src.data(), src.size());
+		});
+	harness::benchmark("blit_rect 640x480x32", WIDTH * HEIGHT * 4, [&]() {
+		blit_rect(dst.data(), src.data(), pitch, pitch, WIDTH * 4, HEIGHT, 4, 0xFFFFFFFF, 0);
+		});
+	harness::benchmark("blit_rect 640x480x32 masked", WIDTH * HEIGHT * 4, [&]() {
+		blit_rect(dst.data(), src.data(), pitch, pitch, WIDTH * 4, HEIGHT, 4, 0x00FFFFFF, 0xFF000000);
+		});
+	harness::benchmark("blit_rect 640x480x16 masked", WIDTH * HEIGHT * 2, [&]() {
+		blit_rect(dst.data(), src.data(), WIDTH * 2, WIDTH * 2, WIDTH * 2, HEIGHT, 2, 0x7FFF, 0x8000);
+		});
+	harness::benchmark("blit_rect 640x480x32 scroll by one row", WIDTH * (HEIGHT - 1) * 4, [&]() {
+		blit_rect(dst.data(), dst.data() + pitch, pitch, pitch, WIDTH * 4, HEIGHT - 1, 4, 0xFFFFFFFF, 0);
+		});
+
+	// The tiles are copied between different places of the two surfaces, so that the rows are not contiguous
+	harness::benchmark("blit_rect 64x64x32 tile", TILE_SIZE * TILE_SIZE * 4, [&]() {
+		blit_rect(dst.data() + 100 * pitch + 200 * 4, src.data() + 30 * pitch + 60 * 4, pitch, pitch, TILE_SIZE * 4, TILE_SIZE, 4, 0xFFFFFFFF, 0);
+		});
+	harness::benchmark("blit_rect 64x64x32 tile masked", TILE_SIZE * TILE_SIZE * 4, [&]() {
+		blit_rect(dst.data() + 100 * pitch + 200 * 4, src.data() + 30 * pitch + 60 * 4, pitch, pitch, TILE_SIZE * 4, TILE_SIZE, 4, 0x00FFFFFF,
+			0xFF000000);
+		});
+	harness::benchmark("blit_rect 64x64x16 tile masked", TILE_SIZE * TILE_SIZE * 2, [&]() {
+		blit_rect(dst.data() + 100 * pitch + 200 * 2, src.data() + 30 * pitch + 60 * 2, pitch, pitch, TILE_SIZE * 2, TILE_SIZE, 2, 0x7FFF, 0x8000);
+		});
+}
+
+// The transfers of NV03_MEMORY_TO_MEMORY_FORMAT: contiguous lines, which are copied at once, and are written around the caches when they are large,
+// strided lines, and lines copied upwards with negative pitches
+NXBX_CASE(copy_lines_bench)
+{
+	std::vector<uint8_t> src(8 * 1024 * 1024), dst(src.size());
+	harness::rng().fill(src.data(), src.size());
+
+	for (uint32_t size : { 64 * 1024, 1024 * 1024, 8 * 1024 * 1024 }) {
+		char name[64];
+		std::snprintf(name, sizeof(name), "memcpy %u KiB (reference)", size / 1024);
+		harness::benchmark(name, size, [&]() {
+			std::memcpy(dst.data(), src.data(), size);
+			});
+		std::snprintf(name, sizeof(name), "copy_lines %u KiB contiguous", size / 1024);
+		harness::benchmark(name, size, [&]() {
+			copy_lines(dst.data(), src.data(), 1024, 1024, 1024, size / 1024);
+			});
+	}
+
+	harness::benchmark("copy_lines 480 lines of 2560 B, pitch 4096", 480 * 2560, [&]() {
+		copy_lines(dst.data(), src.data(), 4096, 4096, 2560, 480);
+		});
+	harness::benchmark("copy_lines 480 lines of 2560 B, negative pitch", 480 * 2560, [&]() {
+		copy_lines(dst.data() + 479 * 4096, src.data() + 479 * 4096, -4096, -4096, 2560, 480);
+		});
+	harness::benchmark("copy_lines 4096 lines of 64 B, pitch 256", 4096 * 64, [&]() {
+		copy_lines(dst.data(), src.data(), 256, 256, 64, 4096);
+		});
+}
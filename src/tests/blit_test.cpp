@@ -0,0 +1,220 @@
+// SPDX-License-Identifier: GPL-3.0-only
+
+// SPDX-FileCopyrightText: 2026 ergo720
+
+#include "harness.hpp"
+#include "video/gpu/blit.hpp"
+#include <vector>
+#include <cstring>
+#include <algorithm>
+#include <cstdlib>
+
+#define NUM_OF_RANDOM_BLITS 300 // for each mask
+#define MAX_ROW_SIZE 300 // in bytes, so that the rows have several 16 byte chunks and a tail
+#define MAX_HEIGHT 12
+#define NUM_OF_RANDOM_COPIES 2000
+#define MAX_LINE_LENGTH 200
+#define MAX_LINE_COUNT 10
+#define NT_COPY_SIZE (1024 * 1024) // smallest copy that uses non-temporal stores
+
+
+struct blit_mask_t {
+	uint32_t bpp;
+	uint32_t and_mask;
+	uint32_t or_mask;
+};
+
+// Plain copies, the X1R5G5B5 and X8R8G8B8 masks that force the unused bit(s) to zero or one, and masks with one bpp, which must be ignored
+static constexpr blit_mask_t s_masks[] = {
+	{ 1, 0, 0xFF },
+	{ 2, 0xFFFF, 0 },
+	{ 2, 0x7FFF, 0 },
+	{ 2, 0x7FFF, 0x8000 },
+	{ 4, 0xFFFFFFFF, 0 },
+	{ 4, 0x00FFFFFF, 0 },
+	{ 4, 0x00FFFFFF, 0xFF000000 },
+};
+
+// Reads the whole source rectangle before writing anything, which is what blit_rect must do when the two rectangles overlap
+static void
+reference_blit(uint8_t *dst, const uint8_t *src, uint32_t dst_pitch, uint32_t src_pitch, uint32_t row_size, uint32_t height, const blit_mask_t &mask)
+{
+	std::vector<uint8_t> rect(row_size * height);
+	for (uint32_t y = 0; y < height; ++y) {
+		std::memcpy(&rect[y * row_size], src + y * src_pitch, row_size);
+	}
+
+	for (uint32_t y = 0; y < height; ++y) {
+		for (uint32_t x = 0; x < row_size; x += mask.bpp) {
+			uint32_t pixel = 0;
+			std::memcpy(&pixel, &rect[y * row_size + x], mask.bpp);
+			if (mask.bpp > 1) {
+				pixel = (pixel & mask.and_mask) | mask.or_mask;
+			}
+			std::memcpy(dst + y * dst_pitch + x, &pixel, mask.bpp);
+		}
+	}
+}
+
+// Blits in a single buffer, which is filled with random bytes, so that the rectangles overlap when their offsets are close, and checks that blit_rect and the
+// reference leave the same bytes in all of the buffer
+static void
+check_blit(harness::rng &rng, size_t dst_offset, size_t src_offset, uint32_t dst_pitch, uint32_t src_pitch, uint32_t row_size, uint32_t height,
+	const blit_mask_t &mask)
+{
+	size_t size = std::max(dst_offset + (size_t)dst_pitch * height, src_offset + (size_t)src_pitch * height) + 16;
+	std::vector<uint8_t> buffer(size), expected;
+	rng.fill(buffer.data(), buffer.size());
+	expected = buffer;
+
+	reference_blit(&expected[dst_offset], &expected[src_offset], dst_pitch, src_pitch, row_size, height, mask);
+	blit_rect(&buffer[dst_offset], &buffer[src_offset], dst_pitch, src_pitch, row_size, height, mask.bpp, mask.and_mask, mask.or_mask);
+	CHECK(buffer == expected);
+}
+
+static uint32_t
+random_row_size(harness::rng &rng, uint32_t bpp)
+{
+	// Rows shorter than a 16 byte chunk, exactly one chunk, and longer ones with a tail
+	switch (rng.next(3))
+	{
+	case 0:
+		return (rng.next(16 / bpp) + 1) * bpp;
+
+	case 1:
+		return 16;
+
+	default:
+		return (rng.next(MAX_ROW_SIZE / bpp) + 1) * bpp;
+	}
+}
+
+NXBX_CASE(blit_rect_matches_reference)
+{
+	harness::rng rng;
+	for (const blit_mask_t &mask : s_masks) {
+		for (uint32_t i = 0; i < NUM_OF_RANDOM_BLITS; ++i) {
+			// Rectangles that don't overlap, with pitches larger than the rows, to catch copies that assume they are contiguous
+			uint32_t row_size = random_row_size(rng, mask.bpp), height = rng.next(MAX_HEIGHT) + 1;
+			uint32_t dst_pitch = row_size + rng.next(4) * mask.bpp, src_pitch = row_size + rng.next(4) * mask.bpp;
+			size_t src_offset = rng.next(16), dst_offset = src_offset + (size_t)std::max(dst_pitch, src_pitch) * height + rng.next(16);
+			if (rng.next(2)) {
+				std::swap(src_offset, dst_offset);
+			}
+			check_blit(rng, dst_offset, src_offset, dst_pitch, src_pitch, row_size, height, mask);
+			if (harness::has_failed()) {
+				logger("  with bpp=%u and_mask=0x%X or_mask=0x%X row_size=%u height=%u dst_pitch=%u src_pitch=%u dst_offset=%zu src_offset=%zu", mask.bpp,
+					mask.and_mask, mask.or_mask, row_size, height, dst_pitch, src_pitch, dst_offset, src_offset);
+				return;
+			}
+		}
+	}
+}
+
+NXBX_CASE(blit_rect_overlapping_matches_reference)
+{
+	harness::rng rng;
+	for (const blit_mask_t &mask : s_masks) {
+		for (uint32_t i = 0; i < NUM_OF_RANDOM_BLITS; ++i) {
+			// Scrolls of up to two rows up or down, plus shifts inside the rows of less than a 16 byte chunk to the left or to the right, so that the
+			// dst is both before and after the src
+			uint32_t row_size = random_row_size(rng, mask.bpp), height = rng.next(MAX_HEIGHT) + 1;
+			uint32_t pitch = row_size + rng.next(4) * mask.bpp;
+			int32_t dy = (int32_t)rng.next(5) - 2, dx = ((int32_t)rng.next(31 / mask.bpp) - (int32_t)(15 / mask.bpp)) * (int32_t)mask.bpp;
+			if (rng.next(4) == 0) {
+				dy = 0; // only an in-row shift
+			}
+			size_t src_offset = 2 * pitch + 16;
+			size_t dst_offset = src_offset + (int64_t)dy * pitch + dx;
+			check_blit(rng, dst_offset, src_offset, pitch, pitch, row_size, height, mask);
+			if (harness::has_failed()) {
+				logger("  with bpp=%u and_mask=0x%X or_mask=0x%X row_size=%u height=%u pitch=%u dx=%d dy=%d", mask.bpp, mask.and_mask, mask.or_mask,
+					row_size, height, pitch, dx, dy);
+				return;
+			}
+		}
+	}
+}
+
+// Copies the lines one at a time, in order, like copy_lines promises to do for any pitch and overlap
+static void
+reference_copy_lines(uint8_t *dst, const uint8_t *src, int32_t dst_pitch, int32_t src_pitch, uint32_t line_length, uint32_t line_count)
+{
+	for (uint32_t i = 0; i < line_count; ++i) {
+		std::memmove(dst + (int64_t)i * dst_pitch, src + (int64_t)i * src_pitch, line_length);
+	}
+}
+
+// Same as check_blit, but for copy_lines. The offsets are those of the first lines, and the lines of negative pitches are before them in the buffer
+static void
+check_copy_lines(harness::rng &rng, size_t size, size_t dst_offset, size_t src_offset, int32_t dst_pitch, int32_t src_pitch, uint32_t line_length,
+	uint32_t line_count)
+{
+	std::vector<uint8_t> buffer(size), expected;
+	rng.fill(buffer.data(), buffer.size());
+	expected = buffer;
+
+	reference_copy_lines(&expected[dst_offset], &expected[src_offset], dst_pitch, src_pitch, line_length, line_count);
+	copy_lines(&buffer[dst_offset], &buffer[src_offset], dst_pitch, src_pitch, line_length, line_count);
+	CHECK(buffer == expected);
+}
+
+static int32_t
+random_pitch(harness::rng &rng, uint32_t line_length)
+{
+	// Contiguous lines, which are copied at once when the buffers don't overlap, padded lines, and both of them upwards
+	int32_t pitch = line_length + (rng.next(2) ? 0 : rng.next(8));
+	return rng.next(3) ? pitch : -pitch;
+}
+
+NXBX_CASE(copy_lines_matches_reference)
+{
+	harness::rng rng;
+	for (uint32_t i = 0; i < NUM_OF_RANDOM_COPIES; ++i) {
+		uint32_t line_length = rng.next(MAX_LINE_LENGTH) + 1, line_count = rng.next(MAX_LINE_COUNT) + 1;
+		int32_t dst_pitch = random_pitch(rng, line_length), src_pitch = random_pitch(rng, line_length);
+		// Enough room for all the lines of both buffers around a first line placed in the middle, so that the two buffers overlap when their first lines
+		// are close, and don't when they are a whole span apart
+		size_t span = (size_t)std::max(std::abs(dst_pitch), std::abs(src_pitch)) * line_count + line_length;
+		size_t src_offset = 2 * span, dst_offset;
+		if (rng.next(2)) {
+			dst_offset = src_offset + rng.next(2 * line_length + 1) - line_length;
+		}
+		else {
+			dst_offset = rng.next(2) ? src_offset + span : src_offset - span;
+		}
+		check_copy_lines(rng, 4 * span + 16, dst_offset, src_offset, dst_pitch, src_pitch, line_length, line_count);
+		if (harness::has_failed()) {
+			logger("  with line_length=%u line_count=%u dst_pitch=%d src_pitch=%d dst_offset=%zu src_offset=%zu", line_length, line_count, dst_pitch,
+				src_pitch, dst_offset, src_offset);
+			return;
+		}
+	}
+}
+
+NXBX_CASE(copy_lines_large_matches_reference)
+{
+	// Copies of at least NT_COPY_SIZE bytes in a single line or in contiguous lines, with a dst that is not 16 bytes aligned and a size that is not a
+	// multiple of 16, so that the non-temporal path also copies a head and a tail. The last ones overlap, and must not use that path
+	harness::rng rng;
+	struct large_copy_t {
+		uint32_t line_length, line_count;
+		size_t dst_offset, src_offset;
+	};
+	static constexpr large_copy_t copies[] = {
+		{ NT_COPY_SIZE + 13, 1, NT_COPY_SIZE + 64 + 5, 3 },
+		{ NT_COPY_SIZE + 13, 1, 9, NT_COPY_SIZE + 64 },
+		{ 4096 + 3, 260, 4096 * 270 + 1, 0 },
+		{ 4096 + 3, 260, 7, 4096 * 270 + 2 },
+		{ NT_COPY_SIZE + 13, 1, 4 + 16 * 3, 4 },
+		{ 4096 + 3, 260, 11, 4 },
+	};
+	for (const large_copy_t &copy : copies) {
+		size_t size = std::max(copy.dst_offset, copy.src_offset) + (size_t)copy.line_length * copy.line_count + 16;
+		check_copy_lines(rng, size, copy.dst_offset, copy.src_offset, copy.line_length, copy.line_length, copy.line_length, copy.line_count);
+		if (harness::has_failed()) {
+			logger("  with line_length=%u line_count=%u dst_offset=%zu src_offset=%zu", copy.line_length, copy.line_count, copy.dst_offset, copy.src_offset);
+			return;
+		}
+	}
+}
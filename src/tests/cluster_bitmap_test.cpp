@@ -0,0 +1,111 @@
+// SPDX-License-Identifier: GPL-3.0-only
+
+// SPDX-FileCopyrightText: 2026 ergo720
+
+#include "harness.hpp"
+#include "cpu_features.hpp"
+#include "cluster_bitmap.hpp"
+#include <vector>
+#include <algorithm>
+
+#define NUM_OF_OPS 4000 // random allocations and frees per bitmap
+#define NUM_OF_QUERIES 300 // random searches per bitmap
+
+
+// Fat made of runs of free and used entries, so that there are full groups that the summary skips, and free runs long enough to cross words and groups
+template<typename T>
+static std::vector<T>
+random_fat(harness::rng &rng, uint32_t num_of_entries, uint32_t max_run)
+{
+	std::vector<T> fat(num_of_entries);
+	bool is_free = rng.next(2);
+	for (uint32_t idx = 0; idx < num_of_entries; is_free = !is_free) {
+		uint32_t run = std::min(rng.next(max_run) + 1, num_of_entries - idx);
+		for (uint32_t i = 0; i < run; ++i, ++idx) {
+			fat[idx] = is_free ? 0 : (T)(rng.next() | 1);
+		}
+	}
+	return fat;
+}
+
+static uint32_t
+naive_find_free_run(const std::vector<bool> &is_free, uint32_t start, uint32_t end, uint32_t num_of_bits)
+{
+	end = std::min(end, (uint32_t)is_free.size());
+	for (uint32_t idx = start, run = 0; idx < end; ++idx) {
+		run = is_free[idx] ? run + 1 : 0;
+		if (run == num_of_bits) {
+			return idx + 1 - num_of_bits;
+		}
+	}
+	return fatx::cluster_bitmap::npos;
+}
+
+// Checks the bitmap against a naive one, after init and then after random allocations and frees
+template<typename T>
+static void
+check_bitmap(harness::rng &rng, uint32_t num_of_entries, uint32_t max_run)
+{
+	std::vector<T> fat = random_fat<T>(rng, num_of_entries, max_run);
+	std::vector<bool> is_free(num_of_entries);
+	uint64_t num_of_free = 0;
+	for (uint32_t idx = 0; idx < num_of_entries; ++idx) {
+		is_free[idx] = fat[idx] == 0;
+		num_of_free += is_free[idx];
+	}
+	fatx::cluster_bitmap bitmap;
+	bitmap.init(fat.data(), num_of_entries);
+
+	CHECK(bitmap.count_free() == num_of_free);
+	for (uint32_t idx = 0; idx < num_of_entries; ++idx) {
+		CHECK(bitmap.is_free(idx) == is_free[idx]);
+	}
+
+	for (uint32_t round = 0; round < 2; ++round) {
+		for (uint32_t i = 0; i < NUM_OF_QUERIES; ++i) {
+			// Mostly ranges up to the end, like the allocations of the fatx driver, but also ranges that stop early or past the end
+			uint32_t start = rng.next(num_of_entries + 64);
+			uint32_t end = rng.next(4) ? num_of_entries : (rng.next(2) ? start + rng.next(num_of_entries / 4 + 1) : ~0u);
+			uint32_t num_of_bits = rng.next(4) ? rng.next(64) + 1 : rng.next(3 << CLUSTER_BITMAP_GROUP_SHIFT) + 1;
+			CHECK(bitmap.find_free(start, end) == naive_find_free_run(is_free, start, end, 1));
+			CHECK(bitmap.find_free_run(start, end, num_of_bits) == naive_find_free_run(is_free, start, end, num_of_bits));
+			if (harness::has_failed()) {
+				logger("  with num_of_entries=%u start=%u end=%u num_of_bits=%u", num_of_entries, start, end, num_of_bits);
+				return;
+			}
+		}
+
+		// Allocate and free clusters, in runs like the fatx driver does
+		for (uint32_t i = 0; (round == 0) && (i < NUM_OF_OPS); ++i) {
+			uint32_t first = rng.next(num_of_entries), count = std::min(rng.next(rng.next(2) ? 16 : 4096) + 1, num_of_entries - first);
+			bool set_free = rng.next(2);
+			for (uint32_t idx = first; idx < first + count; ++idx) {
+				set_free ? bitmap.set_free(idx) : bitmap.set_used(idx);
+				num_of_free += set_free && !is_free[idx];
+				num_of_free -= !set_free && is_free[idx];
+				is_free[idx] = set_free;
+			}
+		}
+		CHECK(bitmap.count_free() == num_of_free);
+	}
+}
+
+NXBX_CASE(cluster_bitmap_matches_naive_scan)
+{
+#if defined(HOST_CPU_X86)
+	logger("  avx2 kernels: %s", has_avx2() ? "yes" : "no");
+#endif
+
+	harness::rng rng;
+	// Sizes below a word, not a multiple of the words of the kernels, and across several groups, with short and long runs
+	for (uint32_t num_of_entries : { 1u, 63u, 64u, 65u, 1000u, (1u << CLUSTER_BITMAP_GROUP_SHIFT) + 129u, (5u << CLUSTER_BITMAP_GROUP_SHIFT) + 77u }) {
+		for (uint32_t max_run : { 4u, 200u, 3u << CLUSTER_BITMAP_GROUP_SHIFT }) {
+			check_bitmap<uint16_t>(rng, num_of_entries, max_run);
+			check_bitmap<uint32_t>(rng, num_of_entries, max_run);
+			if (harness::has_failed()) {
+				logger("  with max_run=%u", max_run);
+				return;
+			}
+		}
+	}
+}
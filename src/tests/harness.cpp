@@ -0,0 +1,105 @@
+// SPDX-License-Identifier: GPL-3.0-only
+
+// SPDX-FileCopyrightText: 2026 ergo720
+
+#include "harness.hpp"
+#include "host.hpp"
+#include <vector>
+#include <cstring>
+#include <cstdarg>
+#include <atomic>
+
+#define MAX_REPORTED_FAILURES 10 // per case, so that a broken kernel doesn't flood the output
+
+
+namespace harness {
+	struct case_t {
+		const char *name;
+		void(*func)();
+	};
+
+	static std::vector<case_t> &
+	get_cases()
+	{
+		// Function local, because the cases register themselves from the static initializers of the other translation units
+		static std::vector<case_t> s_cases;
+		return s_cases;
+	}
+
+	static uint32_t s_num_of_failures;
+
+	bool
+	register_case(const char *name, void(*func)())
+	{
+		get_cases().emplace_back(name, func);
+		return true;
+	}
+
+	void
+	report_failure(const char *file, int line, const char *expr)
+	{
+		if (s_num_of_failures++ < MAX_REPORTED_FAILURES) {
+			logger("  %s:%d: CHECK(%s) failed", file, line, expr);
+		}
+	}
+
+	bool
+	has_failed()
+	{
+		return s_num_of_failures != 0;
+	}
+
+	static std::atomic_uint32_t s_num_of_frame_signals;
+
+	uint32_t
+	num_of_frame_signals()
+	{
+		return s_num_of_frame_signals;
+	}
+}
+
+// The tested modules stop the emulation with nxbx_fatal when they reach a state they can't handle. Here, that fails the case that is running instead
+void
+Host::Fatal(log_module name, const char *msg, ...)
+{
+	std::va_list args;
+	va_start(args, msg);
+	logger<log_lv::highest, false>(name, msg, args);
+	va_end(args);
+	harness::report_failure(__FILE__, __LINE__, "nxbx_fatal");
+}
+
+void
+Host::SignalFrameReady()
+{
+	++harness::s_num_of_frame_signals;
+}
+
+int
+main(int argc, char **argv)
+{
+	if (argc > 2) {
+		logger("usage: %s [filter]\nRuns the cases whose name contains filter, or all of them", argv[0]);
+		return 1;
+	}
+
+	const char *filter = argc == 2 ? argv[1] : "";
+	uint32_t num_of_cases = 0, num_of_failed = 0;
+	for (const harness::case_t &test_case : harness::get_cases()) {
+		if (std::strstr(test_case.name, filter) == nullptr) {
+			continue;
+		}
+
+		logger("%s", test_case.name);
+		harness::s_num_of_failures = 0;
+		test_case.func();
+		++num_of_cases;
+		if (harness::s_num_of_failures) {
+			logger("  FAILED (%u failures)", harness::s_num_of_failures);
+			++num_of_failed;
+		}
+	}
+
+	logger("%u cases run, %u failed", num_of_cases, num_of_failed);
+	return num_of_failed ? 1 : 0;
+}
@@ -0,0 +1,80 @@
+// SPDX-License-Identifier: GPL-3.0-only
+
+// SPDX-FileCopyrightText: 2026 ergo720
+
+#pragma once
+
+#include "logger.hpp"
+#include <cstdint>
+#include <chrono>
+#include <vector>
+
+
+// Minimal harness shared by nxbx-tests and nxbx-bench. The cases register themselves at startup with NXBX_CASE, and main runs the ones whose name contains the
+// filter passed on the command line, or all of them when there's none. A test case fails when one of its CHECKs fails, while the benchmark cases only
+// report their timings
+
+#define NXBX_CASE(name) \
+	static void name(); \
+	[[maybe_unused]] static const bool name##_is_registered = harness::register_case(#name, &name); \
+	static void name()
+
+// Fails the case and returns from the current function
+#define CHECK(expr) do { if (!(expr)) { harness::report_failure(__FILE__, __LINE__, #expr); return; } } while(0)
+
+namespace harness {
+	bool register_case(const char *name, void(*func)());
+	void report_failure(const char *file, int line, const char *expr);
+	bool has_failed(); // true if the case that is running had a failure
+	uint32_t num_of_frame_signals(); // calls to Host::SignalFrameReady, made by the presenter thread
+
+	// Deterministic pseudo random numbers, so that a failure can be reproduced
+	class rng
+	{
+	public:
+		rng(uint64_t seed = 0x9E3779B97F4A7C15) : m_state(seed) {}
+		uint32_t next()
+		{
+			m_state ^= m_state << 13;
+			m_state ^= m_state >> 7;
+			m_state ^= m_state << 17;
+			return (uint32_t)(m_state >> 16);
+		}
+		uint32_t next(uint32_t bound) { return next() % bound; } // in [0, bound)
+		void fill(void *buffer, size_t size)
+		{
+			uint8_t *ptr = (uint8_t *)buffer;
+			for (size_t i = 0; i < size; ++i) {
+				ptr[i] = (uint8_t)next();
+			}
+		}
+
+	private:
+		uint64_t m_state;
+	};
+
+	// Calls func until at least 200 ms have passed, and logs the average time of a call, and the throughput when each call processes bytes bytes
+	template<typename F>
+	void benchmark(const char *name, uint64_t bytes, F &&func)
+	{
+		using clock = std::chrono::steady_clock;
+		func(); // warm up the caches
+		uint64_t num_of_calls = 0;
+		clock::time_point start = clock::now(), now;
+		do {
+			for (uint32_t i = 0; i < 8; ++i) {
+				func();
+			}
+			num_of_calls += 8;
+			now = clock::now();
+		} while ((now - start) < std::chrono::milliseconds(200));
+
+		double us = std::chrono::duration<double, std::micro>(now - start).count() / num_of_calls;
+		if (bytes) {
+			logger("  %-40s %10.2f us %10.1f MiB/s", name, us, bytes / us * 1000000.0 / (1024 * 1024));
+		}
+		else {
+			logger("  %-40s %10.2f us", name, us);
+		}
+	}
+}
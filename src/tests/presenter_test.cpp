@@ -0,0 +1,123 @@
+// SPDX-License-Identifier: GPL-3.0-only
+
+// SPDX-FileCopyrightText: 2026 ergo720
+
+#include "harness.hpp"
+#include "video/gpu/presenter.hpp"
+#include "video/vga_scanline.hpp"
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include <cstring>
+
+#define WIDTH 64
+#define HEIGHT 32
+#define FB_SIZE (WIDTH * HEIGHT * 4)
+#define NUM_OF_FRAMES 50 // framebuffers in ram, each one filled with its own color
+#define WAIT_TIMEOUT std::chrono::seconds(5)
+
+
+// The framebuffers don't change after they are filled, so that the presenter thread never reads them while they are written
+static std::vector<uint8_t>
+make_ram()
+{
+	std::vector<uint8_t> ram((size_t)FB_SIZE * NUM_OF_FRAMES);
+	for (uint32_t i = 0; i < NUM_OF_FRAMES; ++i) {
+		uint32_t color = 0x00010203 * (i + 1);
+		for (uint32_t j = 0; j < WIDTH * HEIGHT; ++j) {
+			std::memcpy(&ram[(size_t)i * FB_SIZE + j * 4], &color, 4);
+		}
+	}
+	return ram;
+}
+
+static presenter_mode
+fb_mode(uint32_t fb_num)
+{
+	return presenter_mode{ .fb_addr = fb_num * FB_SIZE, .width = WIDTH, .height = HEIGHT, .pitch = WIDTH * 4, .bpp = 32, .is_565 = false };
+}
+
+// Returns the number of the framebuffer the frame was converted from, or -1 if its pixels don't all come from the same framebuffer
+static int32_t
+frame_num(const std::vector<uint8_t> &ram, const presenter_frame &frame)
+{
+	if ((frame.width != WIDTH) || (frame.height != HEIGHT) || (frame.pixels.size() != WIDTH * HEIGHT)) {
+		return -1;
+	}
+	for (uint32_t i = 0; i < NUM_OF_FRAMES; ++i) {
+		uint32_t pixel;
+		vga_draw_32bpp(&pixel, &ram[(size_t)i * FB_SIZE], 1);
+		if (std::all_of(frame.pixels.begin(), frame.pixels.end(), [pixel](uint32_t p) { return p == pixel; })) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+// Polls acquireFrame like the frontend does after a notification, until there's a new frame
+static const presenter_frame *
+wait_frame(presenter &dev)
+{
+	auto start = std::chrono::steady_clock::now();
+	do {
+		if (const presenter_frame *frame = dev.acquireFrame()) {
+			return frame;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	} while ((std::chrono::steady_clock::now() - start) < WAIT_TIMEOUT);
+	return nullptr;
+}
+
+static void
+check_triple_buffer(presenter &dev, const std::vector<uint8_t> &ram)
+{
+	uint32_t num_of_acquired = 0, first_signals = harness::num_of_frame_signals();
+	CHECK(dev.acquireFrame() == nullptr);
+
+	// A vblank publishes one frame, which is taken once
+	dev.vblank(fb_mode(0));
+	const presenter_frame *held = wait_frame(dev);
+	CHECK(held != nullptr);
+	++num_of_acquired;
+	CHECK(frame_num(ram, *held) == 0);
+	CHECK(dev.acquireFrame() == nullptr);
+
+	// Many vblanks while the frontend holds the frame and doesn't take the new ones. They are a bit apart, so that most of them are converted and published.
+	// The held frame must not be touched, and the frames that are not taken are replaced by the newer ones
+	for (uint32_t i = 1; i < NUM_OF_FRAMES; ++i) {
+		dev.vblank(fb_mode(i));
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	CHECK(frame_num(ram, *held) == 0);
+
+	// The frames taken now are newer and newer, until the last one. The frames in between were dropped
+	int32_t last_num = 0;
+	uint32_t num_of_late = 0;
+	while (last_num != NUM_OF_FRAMES - 1) {
+		const presenter_frame *frame = wait_frame(dev);
+		CHECK(frame != nullptr);
+		++num_of_acquired;
+		++num_of_late;
+		int32_t num = frame_num(ram, *frame);
+		if (num <= last_num) {
+			logger("  frame %d taken after frame %d", num, last_num);
+		}
+		CHECK(num > last_num);
+		last_num = num;
+	}
+	CHECK(num_of_late < NUM_OF_FRAMES - 1);
+	CHECK(dev.acquireFrame() == nullptr);
+
+	// The frontend is notified only when a frame is published after it took the previous one, so there's one notification for each frame taken
+	CHECK((harness::num_of_frame_signals() - first_signals) == num_of_acquired);
+}
+
+NXBX_CASE(presenter_publishes_newest_frame)
+{
+	std::vector<uint8_t> ram = make_ram();
+	presenter dev;
+	dev.init(ram.data(), ram.size(), nullptr);
+	check_triple_buffer(dev, ram);
+	dev.deinit();
+}
@@ -0,0 +1,62 @@
+// SPDX-License-Identifier: GPL-3.0-only
+
+// SPDX-FileCopyrightText: 2026 ergo720
+
+#include "harness.hpp"
+#include "video/gpu/raster.hpp"
+#include "video/gpu/nv2a_classes.hpp"
+#include <vector>
+
+#define WIDTH 640
+#define HEIGHT 480
+#define NUM_OF_TRIS 2000
+
+
+// Draws the same random triangles, of about 1000 pixels each, to a 640x480 A8R8G8B8 surface with a Z24S8 zeta surface, and flushes them. The depth
+// only pass is the one of the games that lay down the depth before the colors
+NXBX_CASE(raster_bench)
+{
+	harness::rng rng;
+	std::vector<raster_vertex> vertices;
+	for (uint32_t i = 0; i < NUM_OF_TRIS; ++i) {
+		float x = float(rng.next(WIDTH - 40)), y = float(rng.next(HEIGHT - 40)), z = float(rng.next(1 << 24));
+		vertices.push_back({ { x, y, z, 1.0f }, { 1.0f, 0.0f, 0.0f, 1.0f } });
+		vertices.push_back({ { x + 45.0f, y + 5.0f, z, 1.0f }, { 0.0f, 1.0f, 0.0f, 1.0f } });
+		vertices.push_back({ { x + 10.0f, y + 45.0f, z, 1.0f }, { 0.0f, 0.0f, 1.0f, 1.0f } });
+	}
+
+	std::vector<uint32_t> color(WIDTH * HEIGHT), zeta(WIDTH * HEIGHT);
+	raster_state state{};
+	state.color_pitch = WIDTH * 4;
+	state.zeta_pitch = WIDTH * 4;
+	state.color_fmt = NV097_SET_SURFACE_FORMAT_COLOR_LE_A8R8G8B8;
+	state.zeta_fmt = NV097_SET_SURFACE_FORMAT_ZETA_Z24S8;
+	state.clip_x1 = WIDTH;
+	state.clip_y1 = HEIGHT;
+	state.depth_func = NV097_SET_DEPTH_FUNC_V_LESS;
+	state.color_mask = 0xFFFFFFFF;
+
+	for (uint32_t num_of_threads : { 1, 4 }) {
+		rasterizer raster;
+		raster.init(num_of_threads);
+		auto draw = [&](const char *name, uint8_t *color_base, uint8_t *zeta_base) {
+			state.color_base = color_base;
+			state.zeta_base = zeta_base;
+			state.depth_test = state.depth_write = zeta_base != nullptr;
+			raster.setState(state);
+			harness::benchmark(name, 0, [&]() {
+				raster.clearSurface(0, WIDTH - 1, 0, HEIGHT - 1, NV097_CLEAR_SURFACE_Z | NV097_CLEAR_SURFACE_STENCIL, 0, 0xFFFFFF00);
+				for (uint32_t i = 0; i < vertices.size(); i += 3) {
+					raster.drawTriangle(vertices[i], vertices[i + 1], vertices[i + 2]);
+				}
+				raster.flush();
+				});
+			};
+
+		logger("  %u threads", num_of_threads);
+		draw("2000 tris color", (uint8_t *)color.data(), nullptr);
+		draw("2000 tris color and depth", (uint8_t *)color.data(), (uint8_t *)zeta.data());
+		draw("2000 tris depth only", nullptr, (uint8_t *)zeta.data());
+		raster.deinit();
+	}
+}
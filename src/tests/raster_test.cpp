@@ -0,0 +1,165 @@
+// SPDX-License-Identifier: GPL-3.0-only
+
+// SPDX-FileCopyrightText: 2026 ergo720
+
+#include "harness.hpp"
+#include "video/gpu/raster.hpp"
+#include "video/gpu/swizzle.hpp"
+#include "video/gpu/nv2a_classes.hpp"
+#include <vector>
+
+#define SIZE 128 // width and height of the surfaces
+#define NUM_OF_TRIS 200
+#define CLEAR_COLOR 0x12345678
+#define CLEAR_ZSTENCIL 0x80000055 // half of the depth range, and a stencil that the triangles must preserve
+
+
+static raster_vertex
+make_vertex(float x, float y, float z, float r, float g, float b)
+{
+	return { { x, y, z, 1.0f }, { r, g, b, 1.0f } };
+}
+
+static raster_state
+make_state(uint8_t *color, uint8_t *zeta, uint32_t zeta_fmt, bool is_swizzled)
+{
+	raster_state state{};
+	state.color_base = color;
+	state.zeta_base = zeta;
+	state.color_pitch = is_swizzled ? 0 : SIZE * 4;
+	state.zeta_pitch = is_swizzled ? 0 : SIZE * (zeta_fmt == NV097_SET_SURFACE_FORMAT_ZETA_Z16 ? 2 : 4);
+	state.swizzle_width = is_swizzled ? SIZE : 0;
+	state.swizzle_height = is_swizzled ? SIZE : 0;
+	state.color_fmt = NV097_SET_SURFACE_FORMAT_COLOR_LE_A8R8G8B8;
+	state.zeta_fmt = zeta_fmt;
+	state.clip_x1 = SIZE;
+	state.clip_y1 = SIZE;
+	state.depth_func = NV097_SET_DEPTH_FUNC_V_LESS;
+	state.color_mask = NV097_SET_COLOR_MASK_ALPHA_WRITE_ENABLE | NV097_SET_COLOR_MASK_RED_WRITE_ENABLE | NV097_SET_COLOR_MASK_GREEN_WRITE_ENABLE |
+		NV097_SET_COLOR_MASK_BLUE_WRITE_ENABLE;
+	state.depth_test = zeta != nullptr;
+	state.depth_write = zeta != nullptr;
+	return state;
+}
+
+NXBX_CASE(raster_rect_covers_each_pixel_once)
+{
+	// A rectangle with integer corners made of two triangles covers exactly the pixels inside it, and the pixels of the shared diagonal are drawn by
+	// only one of the two triangles
+	rasterizer raster;
+	raster.init(4);
+	std::vector<uint32_t> color(SIZE * SIZE, CLEAR_COLOR);
+	raster.setState(make_state((uint8_t *)color.data(), nullptr, 0, false));
+	raster.drawTriangle(make_vertex(3, 5, 0, 1, 0, 0), make_vertex(70, 5, 0, 1, 0, 0), make_vertex(3, 90, 0, 1, 0, 0));
+	raster.drawTriangle(make_vertex(70, 5, 0, 0, 1, 0), make_vertex(70, 90, 0, 0, 1, 0), make_vertex(3, 90, 0, 0, 1, 0));
+	raster.flush();
+	raster.deinit();
+
+	uint32_t num_of_red = 0;
+	for (uint32_t y = 0; y < SIZE; ++y) {
+		for (uint32_t x = 0; x < SIZE; ++x) {
+			uint32_t pixel = color[y * SIZE + x];
+			if ((x >= 3) && (x < 70) && (y >= 5) && (y < 90)) {
+				CHECK((pixel == 0xFFFF0000) || (pixel == 0xFF00FF00));
+				num_of_red += pixel == 0xFFFF0000;
+			}
+			else {
+				CHECK(pixel == CLEAR_COLOR);
+			}
+		}
+	}
+	// The diagonal splits the pixels almost evenly
+	CHECK((num_of_red > (67 * 85 / 2 - 67)) && (num_of_red < (67 * 85 / 2 + 67)));
+}
+
+NXBX_CASE(raster_depth_matches_on_pitch_and_swizzled_surfaces)
+{
+	// The depth of the pitch surfaces is tested four pixels at a time, while the one of the swizzled surfaces is tested one pixel at a time, so drawing
+	// the same triangles to both must produce the same surfaces
+	for (uint32_t zeta_fmt : { NV097_SET_SURFACE_FORMAT_ZETA_Z16, NV097_SET_SURFACE_FORMAT_ZETA_Z24S8 }) {
+		for (uint32_t depth_func = NV097_SET_DEPTH_FUNC_V_NEVER; depth_func <= NV097_SET_DEPTH_FUNC_V_ALWAYS; ++depth_func) {
+			uint32_t zeta_bpp = zeta_fmt == NV097_SET_SURFACE_FORMAT_ZETA_Z16 ? 2 : 4;
+			uint32_t clear_z = zeta_fmt == NV097_SET_SURFACE_FORMAT_ZETA_Z16 ? (CLEAR_ZSTENCIL >> 16) : CLEAR_ZSTENCIL;
+			float z_range = zeta_fmt == NV097_SET_SURFACE_FORMAT_ZETA_Z16 ? 65535.0f : 16777215.0f;
+			std::vector<uint8_t> surfaces[2][2];
+			for (uint32_t i = 0; i < 2; ++i) {
+				surfaces[i][0].resize(SIZE * SIZE * 4);
+				surfaces[i][1].resize(SIZE * SIZE * zeta_bpp);
+			}
+
+			harness::rng rng;
+			std::vector<raster_vertex> vertices;
+			for (uint32_t i = 0; i < NUM_OF_TRIS * 3; ++i) {
+				// Some triangles are flat at the depth of the clear, to also test the equal cases
+				bool is_flat = (i / 3) % 4 == 0;
+				float z = is_flat ? float(clear_z >> (zeta_bpp == 4 ? 8 : 0)) : rng.next(1 << 16) / 65536.0f * z_range;
+				vertices.push_back(make_vertex(rng.next(SIZE * 16 + 64) / 16.0f - 2.0f, rng.next(SIZE * 16 + 64) / 16.0f - 2.0f, z, rng.next(256) / 255.0f,
+					rng.next(256) / 255.0f, rng.next(256) / 255.0f));
+			}
+
+			for (uint32_t is_swizzled = 0; is_swizzled < 2; ++is_swizzled) {
+				rasterizer raster;
+				raster.init(is_swizzled ? 1 : 4);
+				raster_state state = make_state(surfaces[is_swizzled][0].data(), surfaces[is_swizzled][1].data(), zeta_fmt, is_swizzled);
+				state.depth_func = depth_func;
+				raster.setState(state);
+				raster.clearSurface(0, SIZE - 1, 0, SIZE - 1, NV097_CLEAR_SURFACE_Z | NV097_CLEAR_SURFACE_STENCIL | NV097_CLEAR_SURFACE_R |
+					NV097_CLEAR_SURFACE_G | NV097_CLEAR_SURFACE_B | NV097_CLEAR_SURFACE_A, CLEAR_COLOR, clear_z);
+				for (uint32_t i = 0; i < vertices.size(); i += 3) {
+					raster.drawTriangle(vertices[i], vertices[i + 1], vertices[i + 2]);
+				}
+				raster.flush();
+				raster.deinit();
+			}
+
+			for (uint32_t i = 0; i < 2; ++i) {
+				uint32_t bpp = i == 0 ? 4 : zeta_bpp;
+				std::vector<uint8_t> unswizzled(SIZE * SIZE * bpp);
+				unswizzle_rect(unswizzled.data(), surfaces[1][i].data(), SIZE * bpp, SIZE, SIZE, bpp, 0, 0, SIZE, SIZE);
+				if (unswizzled != surfaces[0][i]) {
+					logger("  with zeta_fmt=%u depth_func=0x%X surface=%s", zeta_fmt, depth_func, i == 0 ? "color" : "zeta");
+					CHECK(unswizzled == surfaces[0][i]);
+				}
+			}
+
+			// The stencil is never written by the triangles
+			if (zeta_bpp == 4) {
+				for (uint32_t i = 0; i < SIZE * SIZE; ++i) {
+					CHECK(surfaces[0][1][i * 4] == (CLEAR_ZSTENCIL & 0xFF));
+				}
+			}
+		}
+	}
+}
+
+NXBX_CASE(raster_depth_less_keeps_the_nearest)
+{
+	// Two overlapping rectangles drawn far first, and then near, and near first, and then far, must both show the near one where they overlap
+	for (uint32_t zeta_fmt : { NV097_SET_SURFACE_FORMAT_ZETA_Z16, NV097_SET_SURFACE_FORMAT_ZETA_Z24S8 }) {
+		for (uint32_t is_near_first = 0; is_near_first < 2; ++is_near_first) {
+			std::vector<uint32_t> color(SIZE * SIZE, CLEAR_COLOR), zeta(SIZE * SIZE, 0xFFFFFFFF);
+			rasterizer raster;
+			raster.init(2);
+			raster.setState(make_state((uint8_t *)color.data(), (uint8_t *)zeta.data(), zeta_fmt, false));
+			auto draw_rect = [&](float x0, float y0, float x1, float y1, float z, float r, float b) {
+				raster.drawTriangle(make_vertex(x0, y0, z, r, 0, b), make_vertex(x1, y0, z, r, 0, b), make_vertex(x0, y1, z, r, 0, b));
+				raster.drawTriangle(make_vertex(x1, y0, z, r, 0, b), make_vertex(x1, y1, z, r, 0, b), make_vertex(x0, y1, z, r, 0, b));
+				};
+			for (uint32_t i = 0; i < 2; ++i) {
+				if ((i == 0) == (is_near_first == 1)) {
+					draw_rect(10, 10, 60, 60, 1000, 1, 0); // near, red
+				}
+				else {
+					draw_rect(30, 30, 100, 100, 5000, 0, 1); // far, blue
+				}
+			}
+			raster.flush();
+			raster.deinit();
+
+			CHECK(color[40 * SIZE + 40] == 0xFFFF0000);
+			CHECK(color[20 * SIZE + 20] == 0xFFFF0000);
+			CHECK(color[80 * SIZE + 80] == 0xFF0000FF);
+			CHECK(color[5 * SIZE + 5] == CLEAR_COLOR);
+		}
+	}
+}
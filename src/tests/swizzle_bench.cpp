@@ -0,0 +1,57 @@
+// SPDX-License-Identifier: GPL-3.0-only
+
+// SPDX-FileCopyrightText: 2026 ergo720
+
+#include "harness.hpp"
+#include "cpu_features.hpp"
+#include "video/gpu/swizzle.hpp"
+#include <vector>
+#include <cstring>
+#include <cstdio>
+
+
+NXBX_CASE(swizzle_bench)
+{
+#if defined(HOST_CPU_X86)
+	logger("  avx2 kernels: %s", has_avx2() ? "yes" : "no");
+#endif
+
+	for (uint32_t size : { 256, 1024 }) {
+		for (uint32_t bpp : { 1, 2, 4 }) {
+			std::vector<uint8_t> linear(size * size * bpp), swizzled(linear.size());
+			harness::rng().fill(linear.data(), linear.size());
+			uint32_t pitch = size * bpp;
+			char name[64];
+
+			std::snprintf(name, sizeof(name), "swizzle_rect %ux%u %ubpp", size, size, bpp * 8);
+			harness::benchmark(name, linear.size(), [&]() {
+				swizzle_rect(swizzled.data(), linear.data(), pitch, size, size, bpp, 0, 0, size, size);
+				});
+			std::snprintf(name, sizeof(name), "unswizzle_rect %ux%u %ubpp", size, size, bpp * 8);
+			harness::benchmark(name, linear.size(), [&]() {
+				unswizzle_rect(linear.data(), swizzled.data(), pitch, size, size, bpp, 0, 0, size, size);
+				});
+			std::snprintf(name, sizeof(name), "swizzle_index loop %ux%u %ubpp", size, size, bpp * 8);
+			harness::benchmark(name, linear.size(), [&]() {
+				for (uint32_t y = 0; y < size; ++y) {
+					for (uint32_t x = 0; x < size; ++x) {
+						std::memcpy(&linear[y * pitch + x * bpp], &swizzled[swizzle_index(x, y, 0, size, size, 1) * bpp], bpp);
+					}
+				}
+				});
+		}
+	}
+
+	// Partial update of a texture, which has unaligned borders
+	std::vector<uint8_t> linear(1024 * 1024 * 4), swizzled(linear.size());
+	harness::benchmark("swizzle_rect 1024x1024 32bpp, 301x197 at (13,7)", 301 * 197 * 4, [&]() {
+		swizzle_rect(swizzled.data(), linear.data(), 1024 * 4, 1024, 1024, 4, 13, 7, 301, 197);
+		});
+
+	harness::benchmark("swizzle_box 64x64x64 32bpp", 64 * 64 * 64 * 4, [&]() {
+		swizzle_box(swizzled.data(), linear.data(), 64 * 4, 64 * 64 * 4, 64, 64, 64, 4);
+		});
+	harness::benchmark("unswizzle_box 64x64x64 32bpp", 64 * 64 * 64 * 4, [&]() {
+		unswizzle_box(linear.data(), swizzled.data(), 64 * 4, 64 * 64 * 4, 64, 64, 64, 4);
+		});
+}
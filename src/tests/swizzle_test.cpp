@@ -0,0 +1,149 @@
+// SPDX-License-Identifier: GPL-3.0-only
+
+// SPDX-FileCopyrightText: 2026 ergo720
+
+#include "harness.hpp"
+#include "video/gpu/swizzle.hpp"
+#include <vector>
+#include <cstring>
+
+#define MAX_SIZE_SHIFT 9 // the 2d images go up to 512x512
+#define MAX_EXHAUSTIVE_SIZE 8 // all the sub-rectangles are checked up to this size, and random ones above it
+#define NUM_OF_RANDOM_RECTS 32
+
+
+// Every texel size with a dedicated kernel, plus two that use the generic copy
+static constexpr uint32_t s_texel_sizes[] = { 1, 2, 4, 8, 16 };
+
+static void
+check_rect(harness::rng &rng, uint32_t width, uint32_t height, uint32_t bpp, uint32_t x, uint32_t y, uint32_t rect_width, uint32_t rect_height)
+{
+	// The pitch is larger than the rectangle, to catch kernels that assume they are equal
+	uint32_t pitch = (rect_width + 3) * bpp;
+	std::vector<uint8_t> linear(pitch * rect_height), swizzled(width * height * bpp), expected;
+	rng.fill(linear.data(), linear.size());
+	rng.fill(swizzled.data(), swizzled.size());
+
+	// swizzle_rect must only write the texels of the rectangle
+	expected = swizzled;
+	for (uint32_t j = 0; j < rect_height; ++j) {
+		for (uint32_t i = 0; i < rect_width; ++i) {
+			std::memcpy(&expected[swizzle_index(x + i, y + j, 0, width, height, 1) * bpp], &linear[j * pitch + i * bpp], bpp);
+		}
+	}
+	swizzle_rect(swizzled.data(), linear.data(), pitch, width, height, bpp, x, y, rect_width, rect_height);
+	CHECK(swizzled == expected);
+
+	// unswizzle_rect must read the same texels back, and leave the padding of the rows alone
+	rng.fill(swizzled.data(), swizzled.size());
+	expected = linear;
+	for (uint32_t j = 0; j < rect_height; ++j) {
+		for (uint32_t i = 0; i < rect_width; ++i) {
+			std::memcpy(&expected[j * pitch + i * bpp], &swizzled[swizzle_index(x + i, y + j, 0, width, height, 1) * bpp], bpp);
+		}
+	}
+	unswizzle_rect(linear.data(), swizzled.data(), pitch, width, height, bpp, x, y, rect_width, rect_height);
+	CHECK(linear == expected);
+}
+
+NXBX_CASE(swizzle_index_is_a_permutation)
+{
+	for (uint32_t w = 1; w <= 64; w <<= 1) {
+		for (uint32_t h = 1; h <= 64; h <<= 1) {
+			for (uint32_t d = 1; d <= 16; d <<= 1) {
+				std::vector<bool> is_used(w * h * d);
+				for (uint32_t z = 0; z < d; ++z) {
+					for (uint32_t y = 0; y < h; ++y) {
+						for (uint32_t x = 0; x < w; ++x) {
+							uint32_t index = swizzle_index(x, y, z, w, h, d);
+							CHECK(index < is_used.size());
+							CHECK(!is_used[index]);
+							is_used[index] = true;
+						}
+					}
+				}
+			}
+		}
+	}
+
+	// Known indices: x takes the even bits and y the odd ones, until the smaller dimension runs out of bits
+	CHECK(swizzle_index(1, 0, 0, 4, 4, 1) == 1);
+	CHECK(swizzle_index(0, 1, 0, 4, 4, 1) == 2);
+	CHECK(swizzle_index(3, 3, 0, 4, 4, 1) == 15);
+	CHECK(swizzle_index(4, 0, 0, 8, 2, 1) == 8);
+	CHECK(swizzle_index(0, 1, 1, 2, 2, 2) == 6);
+}
+
+NXBX_CASE(swizzle_rect_matches_swizzle_index)
+{
+	harness::rng rng;
+	for (uint32_t bpp : s_texel_sizes) {
+		for (uint32_t w_shift = 0; w_shift <= MAX_SIZE_SHIFT; ++w_shift) {
+			for (uint32_t h_shift = 0; h_shift <= MAX_SIZE_SHIFT; ++h_shift) {
+				uint32_t width = 1 << w_shift, height = 1 << h_shift;
+				if ((width * height * bpp) > (1 << 20)) {
+					continue; // the large images of the large texels are slow to check, and they don't use different code paths
+				}
+
+				check_rect(rng, width, height, bpp, 0, 0, width, height);
+				if ((width <= MAX_EXHAUSTIVE_SIZE) && (height <= MAX_EXHAUSTIVE_SIZE)) {
+					for (uint32_t y = 0; y < height; ++y) {
+						for (uint32_t x = 0; x < width; ++x) {
+							for (uint32_t rect_height = 1; (y + rect_height) <= height; ++rect_height) {
+								for (uint32_t rect_width = 1; (x + rect_width) <= width; ++rect_width) {
+									check_rect(rng, width, height, bpp, x, y, rect_width, rect_height);
+								}
+							}
+						}
+					}
+				}
+				else {
+					for (uint32_t i = 0; i < NUM_OF_RANDOM_RECTS; ++i) {
+						uint32_t x = rng.next(width), y = rng.next(height);
+						check_rect(rng, width, height, bpp, x, y, rng.next(width - x) + 1, rng.next(height - y) + 1);
+					}
+				}
+				if (harness::has_failed()) {
+					logger("  with width=%u height=%u bpp=%u", width, height, bpp);
+					return;
+				}
+			}
+		}
+	}
+}
+
+NXBX_CASE(swizzle_box_matches_swizzle_index)
+{
+	harness::rng rng;
+	for (uint32_t bpp : s_texel_sizes) {
+		for (uint32_t width = 1; width <= 32; width <<= 1) {
+			for (uint32_t height = 1; height <= 32; height <<= 1) {
+				for (uint32_t depth = 1; depth <= 32; depth <<= 1) {
+					uint32_t pitch = (width + 1) * bpp, slice_pitch = pitch * (height + 1);
+					std::vector<uint8_t> linear(slice_pitch * depth), swizzled(width * height * depth * bpp), expected(swizzled.size());
+					rng.fill(linear.data(), linear.size());
+					for (uint32_t z = 0; z < depth; ++z) {
+						for (uint32_t y = 0; y < height; ++y) {
+							for (uint32_t x = 0; x < width; ++x) {
+								std::memcpy(&expected[swizzle_index(x, y, z, width, height, depth) * bpp], &linear[z * slice_pitch + y * pitch + x * bpp], bpp);
+							}
+						}
+					}
+					swizzle_box(swizzled.data(), linear.data(), pitch, slice_pitch, width, height, depth, bpp);
+					CHECK(swizzled == expected);
+
+					std::vector<uint8_t> unswizzled(linear.size());
+					rng.fill(unswizzled.data(), unswizzled.size());
+					for (uint32_t z = 0; z < depth; ++z) {
+						for (uint32_t y = 0; y < height; ++y) {
+							std::memcpy(&linear[z * slice_pitch + y * pitch + width * bpp], &unswizzled[z * slice_pitch + y * pitch + width * bpp], bpp);
+						}
+						std::memcpy(&linear[z * slice_pitch + height * pitch], &unswizzled[z * slice_pitch + height * pitch], pitch);
+					}
+					unswizzle_box(unswizzled.data(), swizzled.data(), pitch, slice_pitch, width, height, depth, bpp);
+					CHECK(unswizzled == linear);
+				}
+			}
+		}
+	}
+}
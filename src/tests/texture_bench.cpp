@@ -0,0 +1,35 @@
+// SPDX-License-Identifier: GPL-3.0-only
+
+// SPDX-FileCopyrightText: 2026 ergo720
+
+#include "harness.hpp"
+#include "video/gpu/texture.hpp"
+#include "video/gpu/nv2a_classes.hpp"
+#include <vector>
+
+
+NXBX_CASE(texture_bench)
+{
+	harness::rng rng;
+	std::vector<uint8_t> src(1024 * 1024 * 2);
+	std::vector<uint32_t> dst(1024 * 1024), palette(256);
+	rng.fill(src.data(), src.size());
+	rng.fill(palette.data(), palette.size() * 4);
+
+	// The throughput is the one of the decoded texels
+	harness::benchmark("texture_decode dxt1 1024x1024", 1024 * 1024 * 4, [&]() {
+		texture_decode(dst.data(), 1024 * 4, src.data(), 0, NV097_SET_TEXTURE_FORMAT_COLOR_L_DXT1_A1R5G5B5, 1024, 1024, 0, 0, 1024, 1024, nullptr, 0);
+		});
+	harness::benchmark("texture_decode dxt5 1024x1024", 1024 * 1024 * 4, [&]() {
+		texture_decode(dst.data(), 1024 * 4, src.data(), 0, NV097_SET_TEXTURE_FORMAT_COLOR_L_DXT45_A8R8G8B8, 1024, 1024, 0, 0, 1024, 1024, nullptr, 0);
+		});
+	harness::benchmark("texture_decode p8 1024x1024", 1024 * 1024 * 4, [&]() {
+		texture_decode(dst.data(), 1024 * 4, src.data(), 0, NV097_SET_TEXTURE_FORMAT_COLOR_SZ_I8_A8R8G8B8, 1024, 1024, 0, 0, 1024, 1024, palette.data(), 256);
+		});
+	harness::benchmark("texture_decode yuy2 640x480", 640 * 480 * 4, [&]() {
+		texture_decode(dst.data(), 640 * 4, src.data(), 640 * 2, NV097_SET_TEXTURE_FORMAT_COLOR_LC_IMAGE_CR8YB8CB8YA8, 640, 480, 0, 0, 640, 480, nullptr, 0);
+		});
+	harness::benchmark("texture_decode uyvy 640x480", 640 * 480 * 4, [&]() {
+		texture_decode(dst.data(), 640 * 4, src.data(), 640 * 2, NV097_SET_TEXTURE_FORMAT_COLOR_LC_IMAGE_YB8CR8YA8CB8, 640, 480, 0, 0, 640, 480, nullptr, 0);
+		});
+}
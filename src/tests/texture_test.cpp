@@ -0,0 +1,224 @@
+// SPDX-License-Identifier: GPL-3.0-only
+
+// SPDX-FileCopyrightText: 2026 ergo720
+
+#include "harness.hpp"
+#include "video/gpu/texture.hpp"
+#include "video/gpu/swizzle.hpp"
+#include "video/gpu/nv2a_classes.hpp"
+#include <vector>
+#include <algorithm>
+#include <cstring>
+
+#define NUM_OF_RANDOM_RECTS 64
+#define DST_PADDING 5 // texels at the end of every row of the destination, which the decoder must not touch
+
+
+// Scalar references, written texel by texel from the format descriptions, without sharing any code with the decoders
+static uint32_t
+ref_channel(uint32_t value, uint32_t bits)
+{
+	return (value << (8 - bits)) | (value >> (2 * bits - 8));
+}
+
+static uint32_t
+ref_dxt_texel(const uint8_t *data, uint32_t format, uint32_t width, uint32_t x, uint32_t y)
+{
+	uint32_t block_size = format == NV097_SET_TEXTURE_FORMAT_COLOR_L_DXT1_A1R5G5B5 ? 8 : 16;
+	const uint8_t *block = data + ((y / 4) * std::max((width + 3) / 4, 1u) + x / 4) * block_size;
+	const uint8_t *color_block = block_size == 8 ? block : block + 8;
+	uint32_t i = (y & 3) * 4 + (x & 3);
+
+	uint32_t c[2] = { (uint32_t)color_block[0] | (color_block[1] << 8), (uint32_t)color_block[2] | (color_block[3] << 8) };
+	uint32_t rgb[2][3];
+	for (uint32_t j = 0; j < 2; ++j) {
+		rgb[j][0] = ref_channel(c[j] >> 11, 5);
+		rgb[j][1] = ref_channel((c[j] >> 5) & 0x3F, 6);
+		rgb[j][2] = ref_channel(c[j] & 0x1F, 5);
+	}
+	uint32_t code = (color_block[4 + i / 4] >> ((i % 4) * 2)) & 3;
+	uint32_t r, g, b, a = 255;
+	bool has_four_colors = (c[0] > c[1]) || (format != NV097_SET_TEXTURE_FORMAT_COLOR_L_DXT1_A1R5G5B5);
+	if (code < 2) {
+		r = rgb[code][0], g = rgb[code][1], b = rgb[code][2];
+	}
+	else if (has_four_colors) {
+		uint32_t w0 = code == 2 ? 2 : 1, w1 = 3 - w0;
+		r = (rgb[0][0] * w0 + rgb[1][0] * w1) / 3;
+		g = (rgb[0][1] * w0 + rgb[1][1] * w1) / 3;
+		b = (rgb[0][2] * w0 + rgb[1][2] * w1) / 3;
+	}
+	else if (code == 2) {
+		r = (rgb[0][0] + rgb[1][0]) / 2, g = (rgb[0][1] + rgb[1][1]) / 2, b = (rgb[0][2] + rgb[1][2]) / 2;
+	}
+	else {
+		r = g = b = a = 0;
+	}
+
+	if (format == NV097_SET_TEXTURE_FORMAT_COLOR_L_DXT23_A8R8G8B8) {
+		uint32_t nibble = (block[i / 2] >> ((i & 1) * 4)) & 0xF;
+		a = (nibble << 4) | nibble;
+	}
+	else if (format == NV097_SET_TEXTURE_FORMAT_COLOR_L_DXT45_A8R8G8B8) {
+		uint32_t a0 = block[0], a1 = block[1], bit = i * 3, index = 0;
+		for (uint32_t j = 0; j < 3; ++j, ++bit) {
+			index |= ((block[2 + bit / 8] >> (bit % 8)) & 1) << j;
+		}
+		if (index < 2) {
+			a = index == 0 ? a0 : a1;
+		}
+		else if (a0 > a1) {
+			a = ((8 - index) * a0 + (index - 1) * a1) / 7;
+		}
+		else if (index < 6) {
+			a = ((6 - index) * a0 + (index - 1) * a1) / 5;
+		}
+		else {
+			a = index == 6 ? 0 : 255;
+		}
+	}
+
+	return (a << 24) | (r << 16) | (g << 8) | b;
+}
+
+static uint32_t
+ref_yuv_texel(const uint8_t *data, uint32_t pitch, bool is_uyvy, uint32_t width, uint32_t x, uint32_t y)
+{
+	// In YUY2 a pair is y0 u y1 v, and in UYVY it's u y0 v y1. The last texel of an odd row uses the v of the previous pair
+	const uint8_t *row = data + y * pitch;
+	uint32_t pair = x / 2;
+	int32_t luma = row[pair * 4 + (is_uyvy ? 1 : 0) + (x & 1) * 2];
+	int32_t u = row[pair * 4 + (is_uyvy ? 0 : 1)];
+	int32_t v = 128;
+	if (((pair * 2 + 1) < width)) {
+		v = row[pair * 4 + (is_uyvy ? 2 : 3)];
+	}
+	else if (pair > 0) {
+		v = row[(pair - 1) * 4 + (is_uyvy ? 2 : 3)];
+	}
+
+	int32_t c = luma - 16, d = u - 128, e = v - 128;
+	int32_t r = std::clamp((298 * c + 409 * e + 128) >> 8, 0, 255);
+	int32_t g = std::clamp((298 * c - 100 * d - 208 * e + 128) >> 8, 0, 255);
+	int32_t b = std::clamp((298 * c + 516 * d + 128) >> 8, 0, 255);
+	return 0xFF000000 | (r << 16) | (g << 8) | b;
+}
+
+template<typename F>
+static void
+check_decode(harness::rng &rng, const std::vector<uint8_t> &data, uint32_t pitch, uint32_t format, uint32_t width, uint32_t height, const uint32_t *palette,
+	uint32_t palette_size, F &&ref_texel)
+{
+	// The rectangle can go past the texture, and the decoder must then clip it
+	for (uint32_t i = 0; i < NUM_OF_RANDOM_RECTS; ++i) {
+		uint32_t x = i == 0 ? 0 : rng.next(width), y = i == 0 ? 0 : rng.next(height);
+		uint32_t rect_width = i == 0 ? width : rng.next(width - x + 2) + 1, rect_height = i == 0 ? height : rng.next(height - y + 2) + 1;
+		uint32_t dst_width = rect_width + DST_PADDING;
+		std::vector<uint32_t> dst(dst_width * rect_height), expected;
+		rng.fill(dst.data(), dst.size() * 4);
+		expected = dst;
+		for (uint32_t j = 0; j < std::min(rect_height, height - y); ++j) {
+			for (uint32_t k = 0; k < std::min(rect_width, width - x); ++k) {
+				expected[j * dst_width + k] = ref_texel(x + k, y + j);
+			}
+		}
+
+		CHECK(texture_decode(dst.data(), dst_width * 4, data.data(), pitch, format, width, height, x, y, rect_width, rect_height, palette, palette_size));
+		if (dst != expected) {
+			logger("  with width=%u height=%u rect=%u,%u %ux%u", width, height, x, y, rect_width, rect_height);
+			CHECK(dst == expected);
+		}
+	}
+}
+
+NXBX_CASE(texture_dxt_matches_reference)
+{
+	harness::rng rng;
+	for (uint32_t format : { NV097_SET_TEXTURE_FORMAT_COLOR_L_DXT1_A1R5G5B5, NV097_SET_TEXTURE_FORMAT_COLOR_L_DXT23_A8R8G8B8,
+		NV097_SET_TEXTURE_FORMAT_COLOR_L_DXT45_A8R8G8B8 }) {
+		uint32_t block_size = format == NV097_SET_TEXTURE_FORMAT_COLOR_L_DXT1_A1R5G5B5 ? 8 : 16;
+		for (uint32_t width : { 1, 3, 4, 13, 64 }) {
+			for (uint32_t height : { 1, 2, 4, 9, 32 }) {
+				// The size is exact, so that a decoder reading past the last block is caught by the sanitizers
+				std::vector<uint8_t> data(std::max((width + 3) / 4, 1u) * std::max((height + 3) / 4, 1u) * block_size);
+				rng.fill(data.data(), data.size());
+				for (size_t i = 0; i < data.size(); i += block_size * 2) {
+					// Half of the blocks have c0 <= c1 and a0 <= a1, to also exercise the three color mode of DXT1 and the six alpha mode of DXT5
+					uint8_t *block = &data[i];
+					uint8_t *color_block = block_size == 8 ? block : block + 8;
+					std::swap(color_block[1], color_block[3]);
+					if (color_block[1] > color_block[3]) {
+						std::swap(color_block[1], color_block[3]);
+					}
+					if (block[0] > block[1]) {
+						std::swap(block[0], block[1]);
+					}
+				}
+				check_decode(rng, data, 0, format, width, height, nullptr, 0, [&](uint32_t x, uint32_t y) {
+					return ref_dxt_texel(data.data(), format, width, x, y);
+					});
+				if (harness::has_failed()) {
+					logger("  with format=0x%X", format);
+					return;
+				}
+			}
+		}
+	}
+}
+
+NXBX_CASE(texture_p8_matches_reference)
+{
+	harness::rng rng;
+	uint32_t palette[256];
+	rng.fill(palette, sizeof(palette));
+	for (uint32_t palette_size : { 256, 32 }) {
+		for (uint32_t width = 1; width <= 128; width <<= 1) {
+			for (uint32_t height = 1; height <= 128; height <<= 1) {
+				std::vector<uint8_t> data(width * height);
+				rng.fill(data.data(), data.size());
+				// Indices past the end of the palette read as black
+				check_decode(rng, data, 0, NV097_SET_TEXTURE_FORMAT_COLOR_SZ_I8_A8R8G8B8, width, height, palette, palette_size, [&](uint32_t x, uint32_t y) {
+					uint8_t index = data[swizzle_index(x, y, 0, width, height, 1)];
+					return index < palette_size ? palette[index] : 0;
+					});
+				if (harness::has_failed()) {
+					logger("  with palette_size=%u", palette_size);
+					return;
+				}
+			}
+		}
+	}
+}
+
+NXBX_CASE(texture_yuv_matches_reference)
+{
+	harness::rng rng;
+	for (uint32_t format : { NV097_SET_TEXTURE_FORMAT_COLOR_LC_IMAGE_CR8YB8CB8YA8, NV097_SET_TEXTURE_FORMAT_COLOR_LC_IMAGE_YB8CR8YA8CB8 }) {
+		bool is_uyvy = format == NV097_SET_TEXTURE_FORMAT_COLOR_LC_IMAGE_YB8CR8YA8CB8;
+		for (uint32_t width : { 1, 2, 3, 8, 17, 33, 640 }) {
+			for (uint32_t height : { 1, 3, 16 }) {
+				// The last row ends exactly at the end of the buffer, which catches the decoders that read the missing half of an odd pair
+				uint32_t pitch = width * 2 + (height > 1 ? 6 : 0);
+				std::vector<uint8_t> data(pitch * (height - 1) + width * 2);
+				rng.fill(data.data(), data.size());
+				check_decode(rng, data, pitch, format, width, height, nullptr, 0, [&](uint32_t x, uint32_t y) {
+					return ref_yuv_texel(data.data(), pitch, is_uyvy, width, x, y);
+					});
+				if (harness::has_failed()) {
+					logger("  with format=0x%X", format);
+					return;
+				}
+			}
+		}
+	}
+}
+
+NXBX_CASE(texture_level_offset_sums_the_levels)
+{
+	// 64x16 DXT1: 16x4 blocks, then 8x2 and 4x1, then 2x1
+	CHECK(texture_level_offset(NV097_SET_TEXTURE_FORMAT_COLOR_L_DXT1_A1R5G5B5, 64, 16, 3) == (64 + 16 + 4) * 8);
+	CHECK(texture_level_offset(NV097_SET_TEXTURE_FORMAT_COLOR_L_DXT45_A8R8G8B8, 64, 16, 4) == (64 + 16 + 4 + 2) * 16);
+	CHECK(texture_level_offset(NV097_SET_TEXTURE_FORMAT_COLOR_SZ_I8_A8R8G8B8, 8, 2, 3) == 16 + 4 + 2);
+	CHECK(texture_level_offset(NV097_SET_TEXTURE_FORMAT_COLOR_LC_IMAGE_CR8YB8CB8YA8, 8, 8, 1) == 0);
+	CHECK(!texture_decode(nullptr, 0, nullptr, 0, 0, 1, 1, 0, 0, 1, 1, nullptr, 0));
+}
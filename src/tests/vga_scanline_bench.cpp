@@ -0,0 +1,57 @@
+// SPDX-License-Identifier: GPL-3.0-only
+
+// SPDX-FileCopyrightText: 2026 ergo720
+
+#include "harness.hpp"
+#include "cpu_features.hpp"
+#include "video/vga_scanline.hpp"
+#include <vector>
+
+#define WIDTH 640
+#define HEIGHT 480
+
+
+// Every mode renders a whole 640x480 frame, one line at a time like the vga renderer, with the fast and with the reference version
+NXBX_CASE(vga_scanline_bench)
+{
+#if defined(HOST_CPU_X86)
+	logger("  avx2 kernels: %s", has_avx2() ? "yes" : "no");
+#endif
+
+	harness::rng rng;
+	std::vector<uint8_t> vram(WIDTH * HEIGHT * 4);
+	std::vector<uint32_t> dst(WIDTH * HEIGHT);
+	uint32_t dac_palette[256];
+	uint8_t attr_palette[16];
+	rng.fill(vram.data(), vram.size());
+	rng.fill(dac_palette, sizeof(dac_palette));
+	rng.fill(attr_palette, sizeof(attr_palette));
+	vga_palette_luts luts;
+	vga_build_luts(luts, dac_palette, 0xFF, attr_palette);
+
+	auto frame = [&](const char *name, auto &&draw_line) {
+		harness::benchmark(name, WIDTH * HEIGHT * 4, [&]() {
+			for (uint32_t y = 0; y < HEIGHT; ++y) {
+				draw_line(&dst[y * WIDTH], y);
+			}
+			});
+		};
+
+	// Mode 13h is 320 pixels wide, so it's doubled to 640
+	frame("13h doubled", [&](uint32_t *line, uint32_t y) { vga_draw_13h(line, vram.data(), y * 80, WIDTH, true, luts); });
+	frame("13h doubled (ref)", [&](uint32_t *line, uint32_t y) { vga_draw_13h_ref(line, vram.data(), y * 80, WIDTH, true, dac_palette, 0xFF); });
+	frame("4bpp", [&](uint32_t *line, uint32_t y) { vga_draw_4bpp(line, vram.data(), y * 320, WIDTH, false, 0, 15, luts); });
+	frame("4bpp (ref)", [&](uint32_t *line, uint32_t y) { vga_draw_4bpp_ref(line, vram.data(), y * 320, WIDTH, false, 0, 15, dac_palette, 0xFF,
+		attr_palette); });
+	frame("4bpp panned by 3", [&](uint32_t *line, uint32_t y) { vga_draw_4bpp(line, vram.data(), y * 320, WIDTH, false, 3, 15, luts); });
+	frame("8bpp", [&](uint32_t *line, uint32_t y) { vga_draw_8bpp(line, &vram[y * WIDTH], WIDTH, dac_palette); });
+	frame("8bpp (ref)", [&](uint32_t *line, uint32_t y) { vga_draw_8bpp_ref(line, &vram[y * WIDTH], WIDTH, dac_palette); });
+	frame("15bpp", [&](uint32_t *line, uint32_t y) { vga_draw_15bpp(line, &vram[y * WIDTH * 2], WIDTH); });
+	frame("15bpp (ref)", [&](uint32_t *line, uint32_t y) { vga_draw_15bpp_ref(line, &vram[y * WIDTH * 2], WIDTH); });
+	frame("16bpp", [&](uint32_t *line, uint32_t y) { vga_draw_16bpp(line, &vram[y * WIDTH * 2], WIDTH); });
+	frame("16bpp (ref)", [&](uint32_t *line, uint32_t y) { vga_draw_16bpp_ref(line, &vram[y * WIDTH * 2], WIDTH); });
+	frame("24bpp", [&](uint32_t *line, uint32_t y) { vga_draw_24bpp(line, &vram[y * WIDTH * 3], WIDTH); });
+	frame("24bpp (ref)", [&](uint32_t *line, uint32_t y) { vga_draw_24bpp_ref(line, &vram[y * WIDTH * 3], WIDTH); });
+	frame("32bpp", [&](uint32_t *line, uint32_t y) { vga_draw_32bpp(line, &vram[y * WIDTH * 4], WIDTH); });
+	frame("32bpp (ref)", [&](uint32_t *line, uint32_t y) { vga_draw_32bpp_ref(line, &vram[y * WIDTH * 4], WIDTH); });
+}
@@ -0,0 +1,136 @@
+// SPDX-License-Identifier: GPL-3.0-only
+
+// SPDX-FileCopyrightText: 2026 ergo720
+
+#include "harness.hpp"
+#include "video/vga_scanline.hpp"
+#include <vector>
+
+#define VRAM_SIZE (256 * 1024)
+#define NUM_OF_LINES 512 // random lines checked per mode
+#define DST_PADDING 16 // pixels after the end of the line, which the renderers must leave alone
+
+
+struct palettes_t
+{
+	uint32_t dac[256];
+	uint8_t attr[16];
+	uint8_t dac_mask;
+	vga_palette_luts luts;
+};
+
+static void
+random_palettes(harness::rng &rng, palettes_t &palettes)
+{
+	rng.fill(palettes.dac, sizeof(palettes.dac));
+	rng.fill(palettes.attr, sizeof(palettes.attr));
+	// The dac mask is usually 0xFF, but the renderers must apply any value
+	palettes.dac_mask = rng.next(2) ? 0xFF : (uint8_t)rng.next();
+	vga_build_luts(palettes.luts, palettes.dac, palettes.dac_mask, palettes.attr);
+}
+
+// Renders the line with both versions to buffers with the same random content, and compares them, including the padding after the line
+template<typename F, typename R>
+static void
+check_line(harness::rng &rng, uint32_t width, F &&fast, R &&ref)
+{
+	std::vector<uint32_t> dst(width + DST_PADDING), expected;
+	rng.fill(dst.data(), dst.size() * 4);
+	expected = dst;
+	fast(dst.data());
+	ref(expected.data());
+	CHECK(dst == expected);
+}
+
+NXBX_CASE(vga_13h_matches_reference)
+{
+	harness::rng rng;
+	std::vector<uint8_t> vram(VRAM_SIZE);
+	rng.fill(vram.data(), vram.size());
+	palettes_t palettes;
+	for (uint32_t i = 0; i < NUM_OF_LINES; ++i) {
+		random_palettes(rng, palettes);
+		// The renderers draw groups of four (eight when doubled) pixels, so the width is a multiple of eight, like the one of the vga modes
+		uint32_t width = (rng.next(100) + 1) * 8;
+		bool is_double = rng.next(2);
+		uint32_t addr = rng.next((VRAM_SIZE - width * 4) / 4) * 4;
+		check_line(rng, width,
+			[&](uint32_t *dst) { vga_draw_13h(dst, vram.data(), addr, width, is_double, palettes.luts); },
+			[&](uint32_t *dst) { vga_draw_13h_ref(dst, vram.data(), addr, width, is_double, palettes.dac, palettes.dac_mask); });
+		if (harness::has_failed()) {
+			logger("  with width=%u is_double=%d addr=0x%X", width, is_double, addr);
+			return;
+		}
+	}
+}
+
+NXBX_CASE(vga_4bpp_matches_reference)
+{
+	harness::rng rng;
+	std::vector<uint8_t> vram(VRAM_SIZE);
+	rng.fill(vram.data(), vram.size());
+	palettes_t palettes;
+	for (uint32_t i = 0; i < NUM_OF_LINES; ++i) {
+		random_palettes(rng, palettes);
+		// Any width and panning, so that the groups cut by both are checked. A doubled line has an even width, because it's made of pixel pairs
+		bool is_double = rng.next(2);
+		uint32_t width = rng.next(800) + 1;
+		width += is_double ? (width & 1) : 0;
+		uint32_t pixel_panning = rng.next(16), addr = rng.next((VRAM_SIZE - width * 4 - 8) / 4) * 4;
+		uint8_t enable_mask = rng.next(2) ? 15 : (uint8_t)rng.next(16);
+		check_line(rng, width,
+			[&](uint32_t *dst) { vga_draw_4bpp(dst, vram.data(), addr, width, is_double, pixel_panning, enable_mask, palettes.luts); },
+			[&](uint32_t *dst) { vga_draw_4bpp_ref(dst, vram.data(), addr, width, is_double, pixel_panning, enable_mask, palettes.dac, palettes.dac_mask,
+				palettes.attr); });
+		if (harness::has_failed()) {
+			logger("  with width=%u is_double=%d pixel_panning=%u enable_mask=0x%X addr=0x%X", width, is_double, pixel_panning, enable_mask, addr);
+			return;
+		}
+	}
+}
+
+NXBX_CASE(vga_packed_modes_match_reference)
+{
+	harness::rng rng;
+	palettes_t palettes;
+	for (uint32_t bpp : { 8, 15, 16, 24, 32 }) {
+		for (uint32_t i = 0; i < NUM_OF_LINES; ++i) {
+			random_palettes(rng, palettes);
+			// The line ends exactly at the end of the buffer, so that the sanitizers catch the renderers that load past its last pixel
+			uint32_t width = i < 64 ? i : rng.next(1100);
+			std::vector<uint8_t> src(width * ((bpp + 7) / 8));
+			rng.fill(src.data(), src.size());
+			switch (bpp)
+			{
+			case 8:
+				check_line(rng, width, [&](uint32_t *dst) { vga_draw_8bpp(dst, src.data(), width, palettes.dac); },
+					[&](uint32_t *dst) { vga_draw_8bpp_ref(dst, src.data(), width, palettes.dac); });
+				break;
+
+			case 15:
+				check_line(rng, width, [&](uint32_t *dst) { vga_draw_15bpp(dst, src.data(), width); },
+					[&](uint32_t *dst) { vga_draw_15bpp_ref(dst, src.data(), width); });
+				break;
+
+			case 16:
+				check_line(rng, width, [&](uint32_t *dst) { vga_draw_16bpp(dst, src.data(), width); },
+					[&](uint32_t *dst) { vga_draw_16bpp_ref(dst, src.data(), width); });
+				break;
+
+			case 24:
+				check_line(rng, width, [&](uint32_t *dst) { vga_draw_24bpp(dst, src.data(), width); },
+					[&](uint32_t *dst) { vga_draw_24bpp_ref(dst, src.data(), width); });
+				break;
+
+			case 32:
+				check_line(rng, width, [&](uint32_t *dst) { vga_draw_32bpp(dst, src.data(), width); },
+					[&](uint32_t *dst) { vga_draw_32bpp_ref(dst, src.data(), width); });
+				break;
+			}
+			if (harness::has_failed()) {
+				logger("  with bpp=%u width=%u", bpp, width);
+				return;
+			}
+		}
+	}
+}
@@ -0,0 +1,157 @@
+// SPDX-License-Identifier: GPL-3.0-only
+
+// SPDX-FileCopyrightText: 2026 ergo720
+
+#include "harness.hpp"
+#include "video/vga.hpp"
+#include <vector>
+#include <algorithm>
+
+#define VRAM_SIZE (256 * 1024 + 16) // the four planes of 64 KiB, which the planar writes can reach
+#define VRAM_WINDOW_BASE 0xA0000
+#define WIDTH 640
+#define HEIGHT 200
+#define LINE_SIZE 320 // bytes of vram drawn in a line, in both modes
+
+
+// Programs the registers of a 640x200 screen in mode 13h (with doubled pixels) or in 4bpp planar mode, with a fixed palette
+static void
+set_mode(vga &dev, bool is_13h)
+{
+	auto write_index = [&](uint32_t port, uint8_t index, uint8_t value) {
+		dev.ioWrite8(port, index);
+		dev.ioWrite8(port + 1, value);
+		};
+
+	write_index(0x3C4, 1, 0x01); // 8 dot characters, no dot clock divide
+	write_index(0x3C4, 2, 0x0F);
+	write_index(0x3C4, 4, is_13h ? 0x0E : 0x06); // chain4 or planar writes
+	write_index(0x3CE, 5, is_13h ? 0x40 : 0x00);
+	write_index(0x3CE, 6, 0x05); // graphics mode, 64 KiB window at 0xA0000
+	write_index(0x3CE, 8, 0xFF);
+	write_index(0x3D4, 0x01, WIDTH / 8 - 1);
+	write_index(0x3D4, 0x02, WIDTH / 8);
+	write_index(0x3D4, 0x12, HEIGHT - 1);
+	write_index(0x3D4, 0x15, HEIGHT);
+	write_index(0x3D4, 0x13, LINE_SIZE / 8);
+
+	dev.ioRead8(0x3DA); // resets the flip-flop of the attribute controller
+	for (uint8_t i = 0; i < 16; ++i) {
+		dev.ioWrite8(0x3C0, 0x20 | i);
+		dev.ioWrite8(0x3C0, i);
+	}
+	dev.ioWrite8(0x3C0, 0x20 | 0x12);
+	dev.ioWrite8(0x3C0, 0x0F);
+	dev.ioWrite8(0x3C0, 0x20 | 0x10);
+	dev.ioWrite8(0x3C0, is_13h ? 0x41 : 0x01);
+
+	dev.ioWrite8(0x3C6, 0xFF);
+	dev.ioWrite8(0x3C8, 0);
+	for (uint32_t i = 0; i < 256; ++i) {
+		dev.ioWrite8(0x3C9, i & 63);
+		dev.ioWrite8(0x3C9, (i >> 2) & 63);
+		dev.ioWrite8(0x3C9, (i * 5) & 63);
+	}
+}
+
+// Draws vram with a new vga, so that all of its lines are drawn
+static std::vector<uint32_t>
+draw_whole_frame(std::vector<uint8_t> vram, bool is_13h)
+{
+	vga dev;
+	dev.init(vram.data(), vram.size());
+	set_mode(dev, is_13h);
+	dev.update();
+	std::vector<uint32_t> pixels;
+	uint32_t width = 0, height = 0;
+	uint64_t frame_num = 0;
+	dev.getFrame(pixels, width, height, frame_num);
+	return pixels;
+}
+
+// Writes a byte of the line through the vram window, like the guest does, which marks the line as modified
+static void
+write_line(vga &dev, const std::vector<uint8_t> &vram, bool is_13h, uint32_t line, uint32_t offset)
+{
+	if (is_13h) {
+		uint32_t addr = line * LINE_SIZE + offset;
+		dev.memWrite8(VRAM_WINDOW_BASE + addr, ~vram[addr]);
+	}
+	else {
+		// Planar writes store the byte in the four planes of the group at addr * 4
+		uint32_t addr = line * (LINE_SIZE / 4) + offset / 4;
+		dev.memWrite8(VRAM_WINDOW_BASE + addr, ~vram[addr * 4]);
+	}
+}
+
+static void
+check_dirty_lines(bool is_13h)
+{
+	harness::rng rng;
+	std::vector<uint8_t> vram(VRAM_SIZE);
+	rng.fill(vram.data(), vram.size());
+	vga dev;
+	dev.init(vram.data(), vram.size());
+	set_mode(dev, is_13h);
+
+	std::vector<uint32_t> pixels;
+	uint32_t width = 0, height = 0;
+	uint64_t frame_num = 0;
+
+	// The first frame draws all the lines to the first buffer
+	dev.update();
+	CHECK(dev.getFrame(pixels, width, height, frame_num));
+	CHECK((width == WIDTH) && (height == HEIGHT));
+	CHECK(pixels == draw_whole_frame(vram, is_13h));
+
+	// Nothing changed, so there isn't a new frame
+	dev.update();
+	CHECK(!dev.getFrame(pixels, width, height, frame_num));
+
+	// Lines written through the window, and one (silent_line) written to vram directly, which the host frames can't know about. The second buffer wasn't
+	// drawn yet, so all of its lines are drawn now
+	uint32_t lines[4];
+	for (uint32_t i = 0; i < 4; ++i) {
+		do {
+			lines[i] = rng.next(HEIGHT);
+		} while (std::find(lines, lines + i, lines[i]) != lines + i);
+	}
+	uint32_t line_a = lines[0], line_b = lines[1], line_c = lines[2], silent_line = lines[3];
+	write_line(dev, vram, is_13h, line_a, rng.next(LINE_SIZE));
+	dev.update();
+	CHECK(dev.getFrame(pixels, width, height, frame_num));
+	CHECK(pixels == draw_whole_frame(vram, is_13h));
+
+	std::vector<uint8_t> shown_vram = vram;
+	for (uint32_t i = 0; i < LINE_SIZE; ++i) {
+		vram[silent_line * LINE_SIZE + i] ^= 0xFF;
+	}
+
+	// Both buffers are drawn once now, so an update only redraws the lines written since the buffer was last drawn: line_a and line_b in the first buffer,
+	// and line_b and line_c in the second buffer. The silent line is never redrawn, so it shows its old content in both of them
+	for (uint32_t line : { line_b, line_c }) {
+		write_line(dev, vram, is_13h, line, rng.next(LINE_SIZE));
+		std::copy_n(&vram[line_a * LINE_SIZE], LINE_SIZE, &shown_vram[line_a * LINE_SIZE]);
+		std::copy_n(&vram[line * LINE_SIZE], LINE_SIZE, &shown_vram[line * LINE_SIZE]);
+		dev.update();
+		CHECK(dev.getFrame(pixels, width, height, frame_num));
+		CHECK(pixels == draw_whole_frame(shown_vram, is_13h));
+		CHECK(pixels != draw_whole_frame(vram, is_13h));
+	}
+
+	// Register writes redraw all the lines, so the silent line shows up
+	dev.ioWrite8(0x3C6, 0xFF);
+	dev.update();
+	CHECK(dev.getFrame(pixels, width, height, frame_num));
+	CHECK(pixels == draw_whole_frame(vram, is_13h));
+}
+
+NXBX_CASE(vga_13h_redraws_only_modified_lines)
+{
+	check_dirty_lines(true);
+}
+
+NXBX_CASE(vga_4bpp_redraws_only_modified_lines)
+{
+	check_dirty_lines(false);
+}
@@ -0,0 +1,153 @@
+// SPDX-License-Identifier: GPL-3.0-only
+
+// SPDX-FileCopyrightText: 2026 ergo720
+
+#include "harness.hpp"
+#include "xdvdfs.hpp"
+#include <vector>
+#include <string>
+#include <cstring>
+#include <chrono>
+#include <fstream>
+#include <filesystem>
+#include <algorithm>
+
+#define SECTOR_SIZE 2048
+#define ROOT_DIR_SECTOR 32
+#define FILE_DIRECTORY 0x10
+#define NUM_OF_DIRS 16 // in the root directory
+#define NUM_OF_SUBDIRS 32 // in each directory
+#define NUM_OF_FILES 64 // in each subdirectory
+#define NUM_OF_VALIDATES 5
+
+
+struct entry_t {
+	std::string name;
+	uint32_t sector;
+	uint32_t size;
+	uint8_t attributes;
+};
+
+// Writes the dirents in preorder, so that the dirents of the left and right subtrees always come after their parent, like the xiso walks expect
+static uint32_t
+write_dirent_tree(std::vector<char> &dir, const std::vector<entry_t> &entries, size_t first, size_t last)
+{
+	if (first == last) {
+		return 0;
+	}
+
+	size_t mid = (first + last) / 2;
+	const entry_t &entry = entries[mid];
+	uint32_t offset = dir.size();
+	dir.resize(offset + ((14 + entry.name.size() + 3) & ~3), (char)0xFF);
+	uint16_t left_idx = write_dirent_tree(dir, entries, first, mid) >> 2;
+	uint16_t right_idx = write_dirent_tree(dir, entries, mid + 1, last) >> 2;
+	char *dirent = &dir[offset];
+	std::memcpy(dirent, &left_idx, 2);
+	std::memcpy(dirent + 2, &right_idx, 2);
+	std::memcpy(dirent + 4, &entry.sector, 4);
+	std::memcpy(dirent + 8, &entry.size, 4);
+	dirent[12] = entry.attributes;
+	dirent[13] = (char)entry.name.size();
+	std::memcpy(dirent + 14, entry.name.data(), entry.name.size());
+	return offset;
+}
+
+// Appends a directory to the image, and returns its dirent in the parent directory
+static entry_t
+append_dir(std::vector<char> &image, std::string name, std::vector<entry_t> entries)
+{
+	std::sort(entries.begin(), entries.end(), [](const entry_t &a, const entry_t &b) { return a.name < b.name; });
+	std::vector<char> dir;
+	write_dirent_tree(dir, entries, 0, entries.size());
+	uint32_t sector = image.size() / SECTOR_SIZE;
+	image.insert(image.end(), dir.begin(), dir.end());
+	image.resize((image.size() + SECTOR_SIZE - 1) & ~(SECTOR_SIZE - 1), (char)0xFF);
+	return { std::move(name), sector, (uint32_t)dir.size(), FILE_DIRECTORY };
+}
+
+// Builds a scrubbed xiso with NUM_OF_DIRS * NUM_OF_SUBDIRS * NUM_OF_FILES files, and returns their paths, in mixed case like the ones of the games
+static std::vector<std::string>
+build_xiso(const std::filesystem::path &path)
+{
+	std::vector<char> image((ROOT_DIR_SECTOR + 1) * SECTOR_SIZE);
+	std::vector<std::string> paths;
+	std::vector<entry_t> root_entries;
+	char name[32];
+	for (uint32_t i = 0; i < NUM_OF_DIRS; ++i) {
+		std::vector<entry_t> dir_entries;
+		for (uint32_t j = 0; j < NUM_OF_SUBDIRS; ++j) {
+			std::vector<entry_t> subdir_entries;
+			for (uint32_t k = 0; k < NUM_OF_FILES; ++k) {
+				std::snprintf(name, sizeof(name), "FILE%04u.BIN", k);
+				subdir_entries.emplace_back(name, 0, 4096, 0);
+				std::snprintf(name, sizeof(name), "Dir%02u/SubDir%02u/file%04u.bin", i, j, k);
+				paths.emplace_back(name);
+			}
+			std::snprintf(name, sizeof(name), "SUBDIR%02u", j);
+			dir_entries.push_back(append_dir(image, name, std::move(subdir_entries)));
+		}
+		std::snprintf(name, sizeof(name), "DIR%02u", i);
+		root_entries.push_back(append_dir(image, name, std::move(dir_entries)));
+	}
+	entry_t root = append_dir(image, "", std::move(root_entries));
+
+	static constexpr char magic[] = { 'M', 'I', 'C', 'R', 'O', 'S', 'O', 'F', 'T', '*', 'X', 'B', 'O', 'X', '*', 'M', 'E', 'D', 'I', 'A' };
+	char *volume_desc = &image[ROOT_DIR_SECTOR * SECTOR_SIZE];
+	std::memcpy(volume_desc, magic, 20);
+	std::memcpy(volume_desc + 20, &root.sector, 4);
+	std::memcpy(volume_desc + 24, &root.size, 4);
+	std::memcpy(volume_desc + 0x7EC, magic, 20);
+
+	std::ofstream(path, std::ios::binary).write(image.data(), image.size());
+	return paths;
+}
+
+// Times the mount of a large xiso, which walks all its dirent trees to build the index, and then the opens of its files, the first one right after the mount,
+// and the following ones once the index and the image are warm
+NXBX_CASE(xdvdfs_bench)
+{
+	std::filesystem::path path = std::filesystem::temp_directory_path() / "nxbx_xdvdfs_bench.iso";
+	std::vector<std::string> paths = build_xiso(path);
+	logger("  %zu files, %ju KiB image", paths.size(), (uintmax_t)std::filesystem::file_size(path) / 1024);
+
+	using clock = std::chrono::steady_clock;
+	xdvdfs::driver &driver = xdvdfs::driver::get();
+	double validate_us = 0.0, first_open_us = 0.0;
+	for (uint32_t i = 0; i < NUM_OF_VALIDATES; ++i) {
+		clock::time_point start = clock::now();
+		if (!driver.validate(path.string())) {
+			logger("  failed to validate the xiso");
+			std::filesystem::remove(path);
+			return;
+		}
+		clock::time_point validated = clock::now();
+		driver.search_file(paths[paths.size() / 2]);
+		clock::time_point opened = clock::now();
+		validate_us += std::chrono::duration<double, std::micro>(validated - start).count() / NUM_OF_VALIDATES;
+		first_open_us += std::chrono::duration<double, std::micro>(opened - validated).count() / NUM_OF_VALIDATES;
+	}
+	logger("  %-40s %10.2f us", "validate (cold)", validate_us);
+	logger("  %-40s %10.2f us", "first open after validate (cold)", first_open_us);
+
+	uint32_t num_of_missing = 0;
+	harness::benchmark("open of all the files (warm)", 0, [&]() {
+		for (const std::string &file_path : paths) {
+			num_of_missing += !driver.search_file(file_path).exists;
+		}
+		});
+	double per_file_us = 0.0;
+	{
+		clock::time_point start = clock::now();
+		for (const std::string &file_path : paths) {
+			num_of_missing += !driver.search_file(file_path).exists;
+		}
+		per_file_us = std::chrono::duration<double, std::micro>(clock::now() - start).count() / paths.size();
+	}
+	logger("  %-40s %10.3f us", "open of one file (warm)", per_file_us);
+	if (num_of_missing) {
+		logger("  %u opens didn't find their file", num_of_missing);
+	}
+
+	std::filesystem::remove(path);
+}